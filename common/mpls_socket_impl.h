@@ -166,6 +166,21 @@ extern int mpls_socket_tcp_read(const mpls_socket_mgr_handle handle,
 extern int mpls_socket_tcp_write(const mpls_socket_mgr_handle handle,
   mpls_socket_handle socket, uint8_t * buffer, const int size);
 
+/*
+ * in: handle, socket
+ * return: int, bytes written but not yet taken by the kernel
+ */
+extern int mpls_socket_tcp_tx_queued(const mpls_socket_mgr_handle handle,
+  mpls_socket_handle socket);
+
+/*
+ * in: handle, socket, lowat
+ * once no more than lowat bytes are queued LDP_EVENT_TCP_WRITABLE is
+ * delivered, one time
+ */
+extern void mpls_socket_tcp_tx_notify(const mpls_socket_mgr_handle handle,
+  mpls_socket_handle socket, const int lowat);
+
 /*
  * in: handle, o
  * return: int
@@ -175,6 +190,17 @@ extern int mpls_socket_udp_sendto(const mpls_socket_mgr_handle handle,
 
   const int size, const mpls_dest * to);
 
+/*
+ * in: handle, socket, buffer, size, to, iface
+ * return: int
+ *
+ * like mpls_socket_udp_sendto but out of iface, without changing the
+ * multicast interface of the socket for other datagrams
+ */
+extern int mpls_socket_udp_sendto_if(const mpls_socket_mgr_handle handle,
+  mpls_socket_handle socket, uint8_t * buffer, const int size,
+  const mpls_dest * to, const mpls_if_handle iface);
+
 /*
  * in: handle, o
  * return: int
@@ -45,6 +45,13 @@ extern void mpls_timer_delete(const mpls_timer_mgr_handle handle,
 extern mpls_return_enum mpls_timer_modify(const mpls_timer_mgr_handle handle,
   const mpls_timer_handle timer, const int duration);
 
+/*
+ * in: handle, timer, percent
+ * every (re)start shortens the duration by up to percent, at random
+ */
+extern void mpls_timer_jitter(const mpls_timer_mgr_handle handle,
+  const mpls_timer_handle timer, const int percent);
+
 /*
  * in: handle, timer, type
  * return: mpls_return_enum
@@ -58,4 +65,10 @@ extern mpls_return_enum mpls_timer_start(const mpls_timer_mgr_handle handle,
 extern void mpls_timer_stop(const mpls_timer_mgr_handle handle,
   const mpls_timer_handle timer);
 
+/*
+ * in: handle
+ * return: uint32_t, milliseconds of a clock that never goes back
+ */
+extern uint32_t mpls_timer_get_msec(const mpls_timer_mgr_handle handle);
+
 #endif
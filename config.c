@@ -4,6 +4,49 @@
 #define MAX_CONFIG_LINE_LENGTH	1024
 #define MAX_CONFIG_LINE_WORDS	32
 
+/* global settings that are only taken over by restarting LDP */
+#define CONFIG_GLOBAL_RESTART	(LDP_GLOBAL_CFG_WHEN_DOWN | LDP_GLOBAL_CFG_TRANS_ADDR |\
+								LDP_GLOBAL_CFG_LABEL_MERGE | LDP_GLOBAL_CFG_LOOP_DETECTION_MODE)
+
+/* entity settings that can be changed on a running entity */
+#define CONFIG_ENTITY_FLAGS		(LDP_ENTITY_CFG_DISTRIBUTION_MODE | LDP_ENTITY_CFG_REMOTE_TCP |\
+								LDP_ENTITY_CFG_REMOTE_UDP | LDP_ENTITY_CFG_MAX_PDU |\
+								LDP_ENTITY_CFG_HELLOTIME_INTERVAL | LDP_ENTITY_CFG_KEEPALIVE_INTERVAL |\
+								LDP_ENTITY_CFG_SESSION_SETUP_COUNT | LDP_ENTITY_CFG_PATHVECTOR_LIMIT |\
+								LDP_ENTITY_CFG_HOPCOUNT_LIMIT | LDP_ENTITY_CFG_REQUEST_COUNT)
+
+
+/*
+ * A config file is parsed into a model of what the daemon should look
+ * like, and only the differences to the running state are applied. A
+ * setting missing from the file is back at its default.
+ */
+typedef struct configIface_s {
+	char						name[IFNAMSIZ + 1];
+	int							up;				/* mpls ip */
+	int							vpn;			/* l2transport configured */
+	struct in_addr				vpnDest;
+	ldp_entity					entity;
+	TAILQ_ENTRY(configIface_s)	entry;
+} configIface_t;
+
+typedef struct configModel_s {
+	ldp_global					g;
+	mpls_bool					isStaticLSRID;
+	struct in_addr				lsrID;
+	mpls_bool					implicitNull;
+	int32_t						vpnMin, vpnMax;
+	int32_t						dynMin, dynMax;
+	int							routeBatch;
+	egressMode_t				egress;
+	addressMode_t				address;
+	transAddrMode_t				transAddr;
+	struct in_addr				transAddrIP;
+	char						transAddrIfName[IFNAMSIZ + 1];
+	policySet_t					*policy;		/* prefix lists and label filters */
+	TAILQ_HEAD(, configIface_s)	ifaces;
+} configModel_t;
+
 static char *config = "/usr/local/etc/ldpd.conf";
 static int argc;
 static char *argv[MAX_CONFIG_LINE_WORDS];
@@ -49,325 +92,676 @@ static int Config_ReadLine(FILE *file)
 }
 
 
-void Config_Load(char *path)
+static void Config_InitModel(configModel_t *model)
 {
-	int globalFlags, entityFlags, up, label, changed;
-	FILE *file;
-	ldp_global g;
+	memset(model, 0, sizeof(configModel_t));
+
+	model->g.edge_inlabel = LDP_GLOBAL_DEF_EDGE_INLABEL;
+	model->g.initial_slice_fecs = LDP_GLOBAL_DEF_INITIAL_SLICE_FECS;
+	model->g.initial_slice_msec = LDP_GLOBAL_DEF_INITIAL_SLICE_MSEC;
+	model->g.lsp_control_mode = LDP_GLOBAL_DEF_CONTROL_MODE;
+	model->g.label_retention_mode = LDP_GLOBAL_DEF_RETENTION_MODE;
+	model->g.lsp_repair_mode = LDP_GLOBAL_DEF_REPAIR_MODE;
+	model->g.propagate_release = LDP_GLOBAL_DEF_PROPOGATE_RELEASE;
+	model->g.label_merge = LDP_GLOBAL_DEF_LABEL_MERGE;
+	model->g.loop_detection_mode = LDP_GLOBAL_DEF_LOOP_DETECTION_MODE;
+	model->g.ttl_less_domain = LDP_GLOBAL_DEF_TTLLESS_DOMAIN;
+	model->g.local_tcp_port = LDP_GLOBAL_DEF_LOCAL_TCP_PORT;
+	model->g.local_udp_port = LDP_GLOBAL_DEF_LOCAL_UDP_PORT;
+
+	model->isStaticLSRID = MPLS_BOOL_FALSE;
+	model->implicitNull = MPLS_BOOL_TRUE;
+	model->vpnMin = LABEL_DEF_VPN_MIN;
+	model->vpnMax = LABEL_DEF_VPN_MAX;
+	model->dynMin = LABEL_DEF_DYN_MIN;
+	model->dynMax = LABEL_DEF_DYN_MAX;
+	model->routeBatch = KERNEL_DEF_ROUTE_BATCH;
+	model->egress = LDP_DEF_EGRESS_POLICY;
+	model->address = LDP_DEF_ADDRESS_POLICY;
+	model->transAddr = LDP_DEF_TRANSPORT_ADDRESS_POLICY;
+	model->policy = mpls_policy_create();
+
+	TAILQ_INIT(&model->ifaces);
+}
+
+
+static void Config_FreeModel(configModel_t *model)
+{
+	configIface_t *ci;
+
+	while((ci = TAILQ_FIRST(&model->ifaces))) {
+		TAILQ_REMOVE(&model->ifaces, ci, entry);
+		free(ci);
+	}
+
+	mpls_policy_free(model->policy);
+	model->policy = NULL;
+}
+
+
+/* reads the lines of an interface block up to the next empty one */
+static void Config_ParseInterface(FILE *file, configIface_t *ci)
+{
+	struct in_addr addr;
 	ldp_entity *e;
+
+	e = &ci->entity;
+	while(Config_ReadLine(file)) {
+		if(!strcmp(argv[0], "mpls")) {
+			if(argc > 1 && !strcmp(argv[1], "ip"))
+				ci->up = 1;
+		} else if(!strcmp(argv[0], "l2transport")) {
+			/* only one vpn per interfaces is allowed */
+			if(ci->vpn)
+				continue;
+			if(argc > 1 && inet_aton(argv[1], &addr)) {
+				ci->vpn = 1;
+				ci->vpnDest.s_addr = addr.s_addr;
+			}
+		} else if(!strcmp(argv[0], "vrf")) {
+		} else if(argc < 2) {
+			continue;
+		} else if(!strcmp(argv[0], "distribution-mode")) {
+			/* distribution-mode dod or du */
+			if(!strcmp(argv[1], "dod"))
+				e->label_distribution_mode = LDP_DISTRIBUTION_ONDEMAND;
+			else
+				e->label_distribution_mode = LDP_DISTRIBUTION_UNSOLICITED;
+		} else if(!strcmp(argv[0], "remote-tcp-port")) {
+			/* remote-tcp-port */
+			e->remote_tcp_port = atoi(argv[1]);
+		} else if(!strcmp(argv[0], "remote-udp-port")) {
+			/* remote-udp-port */
+			e->remote_udp_port = atoi(argv[1]);
+		} else if(!strcmp(argv[0], "max-pdu")) {
+			/* max-pdu */
+			e->max_pdu = atoi(argv[1]);
+		} else if(!strcmp(argv[0], "hello-interval")) {
+			/* hello-interval */
+			e->hellotime_interval = atoi(argv[1]);
+		} else if(!strcmp(argv[0], "keepalive-interval")) {
+			/* keepalive-interval */
+			e->keepalive_interval = atoi(argv[1]);
+		} else if(!strcmp(argv[0], "max-session-attempt")) {
+			/* max-session_attempt */
+			e->session_setup_count = atoi(argv[1]);
+		} else if(!strcmp(argv[0], "max-path-vector")) {
+			/* max-path-vector */
+			e->path_vector_limit = atoi(argv[1]);
+		} else if(!strcmp(argv[0], "max-hop-count")) {
+			/* max-hop-count */
+			e->hop_count_limit = atoi(argv[1]);
+		} else if(!strcmp(argv[0], "max-label-requests")) {
+			/* max-label-requests */
+			e->label_request_count = atoi(argv[1]);
+		}
+	}
+}
+
+
+/*
+==============
+Config_Parse
+
+Fills model from file without touching the running state.
+==============
+*/
+/* prefix-list NAME permit|deny ADDR/LEN [ge N] [le N] */
+static void Config_ParsePrefixList(configModel_t *model)
+{
+	int i, permit, length, ge, le;
+	char *slash;
 	struct in_addr addr;
-	struct mpls_dest dest;
-	interface_t *iface;
-	peer_t *peer;
 
-	if(ldp->configured == MPLS_BOOL_FALSE) {
-		ldp->configured = MPLS_BOOL_TRUE;
-		LDP_Enable();
+	if(argc < 4) {
+		printf("invalid prefix list\n");
+		return;
 	}
 
-	while(!LIST_EMPTY(&ldp->peers)) {
-		peer = LIST_FIRST(&ldp->peers);
-		Peer_Destroy(peer);
+	if(!strcmp(argv[2], "permit"))
+		permit = 1;
+	else if(!strcmp(argv[2], "deny"))
+		permit = 0;
+	else {
+		printf("prefix list action must be permit or deny\n");
+		return;
 	}
 
-	if(path)
-		config = path;
+	slash = strchr(argv[3], '/');
+	if(!slash) {
+		printf("invalid prefix %s\n", argv[3]);
+		return;
+	}
+	*slash = '\0';
+	length = atoi(slash + 1);
+	if(!inet_aton(argv[3], &addr)) {
+		printf("unknown address format\n");
+		return;
+	}
 
-	file = fopen(config, "r");
-	if(!file)
+	ge = le = 0;
+	for(i = 4; i + 1 < argc; i += 2) {
+		if(!strcmp(argv[i], "ge"))
+			ge = atoi(argv[i + 1]);
+		else if(!strcmp(argv[i], "le"))
+			le = atoi(argv[i + 1]);
+	}
+
+	if(mpls_policy_add_prefix(model->policy, argv[1], permit, addr, length, ge, le) == -1)
+		printf("invalid prefix list entry for %s\n", argv[1]);
+}
+
+
+/* label-filter import|export|egress NAME [neighbor LSRID] */
+static void Config_ParseLabelFilter(configModel_t *model)
+{
+	policyType_t type;
+	struct in_addr neighbor;
+
+	if(argc < 3) {
+		printf("invalid label filter\n");
+		return;
+	}
+
+	if(!strcmp(argv[1], "import"))
+		type = POLICY_IMPORT;
+	else if(!strcmp(argv[1], "export"))
+		type = POLICY_EXPORT;
+	else if(!strcmp(argv[1], "egress"))
+		type = POLICY_EGRESS;
+	else {
+		printf("label filter must be import, export or egress\n");
 		return;
+	}
+
+	neighbor.s_addr = INADDR_ANY;
+	if(argc >= 5 && !strcmp(argv[3], "neighbor")) {
+		if(type == POLICY_EGRESS) {
+			printf("egress label filter applies to all neighbors\n");
+			return;
+		}
+		if(!inet_aton(argv[4], &neighbor)) {
+			printf("unknown address format\n");
+			return;
+		}
+	}
 
-	ldp->isStaticLSRID = MPLS_BOOL_FALSE;
+	if(mpls_policy_add_filter(model->policy, type, neighbor, argv[2]) == -1)
+		printf("Config_ParseLabelFilter: Cannot add label filter %s\n", argv[2]);
+}
 
-	changed = 0;
-	globalFlags = 0;
+
+static void Config_Parse(FILE *file, configModel_t *model)
+{
+	struct in_addr addr;
+	configIface_t *ci;
+	ldp_global *g;
+
+	g = &model->g;
 	while(!feof(file)) {
 		if(!Config_ReadLine(file))
 			continue;
 
 		if(!strcmp(argv[0], "vrf")) {
 		
+		} else if(argc < 2) {
+			printf("missing argument for %s\n", argv[0]);
 		} else if(!strcmp(argv[0], "interface")) {
 			/* interface configuration */
-			iface = Interface_FindByName(argv[1]);
-			if(iface) {
-				e = &iface->entity;
-				entityFlags = 0;
-				up = 0;
-				label = -1;
-				while(Config_ReadLine(file)) {
-					if(!strcmp(argv[0], "mpls")) {
-						if(!strcmp(argv[1], "ip"))
-							up = 1;
-					} else if(!strcmp(argv[0], "l2transport")) {
-						/* only one vpn per interfaces is allowed */
-						if(iface->vpnLabel > 0) {
-							continue;
-						}
-
-						if(inet_aton(argv[1], &addr)) {
-							iface->vpnType = 2;
-							iface->vpnDest.s_addr = addr.s_addr;
-							iface->vpnLabel = mpls_alloc_label();
-						} else {
-							iface->vpnLabel = -1;
-						}
-					} else if(!strcmp(argv[0], "vrf")) {
-					} else if(!strcmp(argv[0], "distribution-mode")) {
-						/* distribution-mode dod or du */
-						if(!strcmp(argv[1], "dod"))
-							e->label_distribution_mode = LDP_DISTRIBUTION_ONDEMAND;
-						else
-							e->label_distribution_mode = LDP_DISTRIBUTION_UNSOLICITED;
-						entityFlags |= LDP_ENTITY_CFG_DISTRIBUTION_MODE;
-					} else if(!strcmp(argv[0], "remote-tcp-port")) {
-						/* remote-tcp-port */
-						e->remote_tcp_port = atoi(argv[1]);
-						entityFlags |= LDP_ENTITY_CFG_REMOTE_TCP;
-					} else if(!strcmp(argv[0], "remote-udp-port")) {
-						/* remote-udp-port */
-						e->remote_udp_port = atoi(argv[1]);
-						entityFlags |= LDP_ENTITY_CFG_REMOTE_UDP;
-					} else if(!strcmp(argv[0], "max-pdu")) {
-						/* max-pdu */
-						e->max_pdu = atoi(argv[1]);
-						entityFlags |= LDP_ENTITY_CFG_MAX_PDU;
-					} else if(!strcmp(argv[0], "hello-interval")) {
-						/* hello-interval */
-						e->hellotime_interval = atoi(argv[1]);
-						entityFlags |= LDP_ENTITY_CFG_HELLOTIME_INTERVAL;
-					} else if(!strcmp(argv[0], "keepalive-interval")) {
-						/* keepalive-interval */
-						e->keepalive_interval = atoi(argv[1]);
-						entityFlags |= LDP_ENTITY_CFG_KEEPALIVE_INTERVAL;
-					} else if(!strcmp(argv[0], "max-session-attempt")) {
-						/* max-session_attempt */
-						e->session_setup_count = atoi(argv[1]);
-						entityFlags |= LDP_ENTITY_CFG_SESSION_SETUP_COUNT;
-					} else if(!strcmp(argv[0], "max-path-vector")) {
-						/* max-path-vector */
-						e->path_vector_limit = atoi(argv[1]);
-						entityFlags |= LDP_ENTITY_CFG_PATHVECTOR_LIMIT;
-					} else if(!strcmp(argv[0], "max-hop-count")) {
-						/* max-hop-count */
-						e->hop_count_limit = atoi(argv[1]);
-						entityFlags |= LDP_ENTITY_CFG_HOPCOUNT_LIMIT;
-					} else if(!strcmp(argv[0], "max-label-requests")) {
-						/* max-label-requests */
-						e->label_request_count = atoi(argv[1]);
-						entityFlags |= LDP_ENTITY_CFG_REQUEST_COUNT;
-					}
-				}
-
-				/* configure or shutdown interface */
-				if(iface->configUp && !up) {
-					Interface_Shutdown(iface);
-					/* TODO move to Interface_Shutdown */
-					mpls_disable_interface(iface->name);
-				} else if(!iface->configUp && up) {
-					Interface_Init(iface);
-					/* TODO move to Interface_Init */
-					mpls_enable_interface(iface->name);
-					if(iface->vpnLabel > 0) {
-						mpls_add_vpn(iface->vpnType, iface->name, &iface->vpnDest, iface->vpnLabel);
-					}
-				}
-
-				/* apply config */
-				if(iface->entity.index) {
-					Interface_Disable(iface);
-					ldp_cfg_entity_set(ldp->config, e, entityFlags);
-					Interface_Enable(iface);
-				}
+			ci = calloc(1, sizeof(configIface_t));
+			if(!ci) {
+				printf("Config_Parse: Cannot allocate interface %s\n", argv[1]);
+				continue;
 			}
-
+			strlcpy(ci->name, argv[1], sizeof(ci->name));
+			ldp_entity_set_defaults(&ci->entity);
+			Config_ParseInterface(file, ci);
+			TAILQ_INSERT_TAIL(&model->ifaces, ci, entry);
 		} else if(!strcmp(argv[0], "lsr-id")) {
 			/* lsr-id ADDR */
 			if(inet_aton(argv[1], &addr)) {
-				ldp->isStaticLSRID = MPLS_BOOL_TRUE;
-				ldp->lsrID.s_addr = addr.s_addr;
-			} else {
+				model->isStaticLSRID = MPLS_BOOL_TRUE;
+				model->lsrID.s_addr = addr.s_addr;
+			} else
 				printf("unknown address format\n");
-				continue;
-			}
-			changed = 1;
 		} else if(!strcmp(argv[0], "edge-inlabel")) {
 			/* edge-inlabel on or off */
 			if(!strcmp(argv[1], "on"))
-				g.edge_inlabel = MPLS_BOOL_TRUE;
+				g->edge_inlabel = MPLS_BOOL_TRUE;
 			else if(!strcmp(argv[1], "off"))
-				g.edge_inlabel = MPLS_BOOL_FALSE;
-			else
-				continue;
-			globalFlags |= LDP_GLOBAL_CFG_EDGE_INLABEL;
+				g->edge_inlabel = MPLS_BOOL_FALSE;
 		} else if(!strcmp(argv[0], "implicit-null")) {
-			/* edge-inlabel on or off */
+			/* implicit-null on or off */
 			if(!strcmp(argv[1], "on"))
-				ldp->implicitNull = MPLS_BOOL_TRUE;
+				model->implicitNull = MPLS_BOOL_TRUE;
 			else if(!strcmp(argv[1], "off"))
-				ldp->implicitNull = MPLS_BOOL_FALSE;
-			else
+				model->implicitNull = MPLS_BOOL_FALSE;
+		} else if(!strcmp(argv[0], "label-range")) {
+			/* label-range MIN MAX */
+			if(argc < 3) {
+				printf("invalid label range\n");
+				continue;
+			}
+			model->dynMin = atoi(argv[1]);
+			model->dynMax = atoi(argv[2]);
+		} else if(!strcmp(argv[0], "vpn-label-range")) {
+			/* vpn-label-range MIN MAX */
+			if(argc < 3) {
+				printf("invalid VPN label range\n");
+				continue;
+			}
+			model->vpnMin = atoi(argv[1]);
+			model->vpnMax = atoi(argv[2]);
+		} else if(!strcmp(argv[0], "initial-slice")) {
+			/* initial-slice FECS MSEC, 0 is unbounded */
+			if(argc < 3 || atoi(argv[1]) < 0 || atoi(argv[2]) < 0) {
+				printf("invalid initial slice\n");
 				continue;
-			changed = 1;
+			}
+			g->initial_slice_fecs = atoi(argv[1]);
+			g->initial_slice_msec = atoi(argv[2]);
+		} else if(!strcmp(argv[0], "route-batch")) {
+			/* route-batch MSEC, 0 applies route updates right after they are read */
+			if(atoi(argv[1]) < 0) {
+				printf("invalid route batch window\n");
+				continue;
+			}
+			model->routeBatch = atoi(argv[1]);
 		} else if(!strcmp(argv[0], "lsp-control-mode")) {
 			/* lsp-control-mode independent or ordered*/
 			if(!strcmp(argv[1], "independent"))
-				g.lsp_control_mode = LDP_CONTROL_INDEPENDENT;
+				g->lsp_control_mode = LDP_CONTROL_INDEPENDENT;
 			else if(!strcmp(argv[1], "ordered"))
-				g.lsp_control_mode = LDP_CONTROL_ORDERED;
-			else
-				continue;
-			globalFlags |= LDP_GLOBAL_CFG_CONTROL_MODE;
+				g->lsp_control_mode = LDP_CONTROL_ORDERED;
 		} else if(!strcmp(argv[0], "label-retention-mode")) {
 			/* label-retention-mode liberal or conservative */
 			if(!strcmp(argv[1], "liberal"))
-				g.label_retention_mode = LDP_RETENTION_LIBERAL;
+				g->label_retention_mode = LDP_RETENTION_LIBERAL;
 			else if(!strcmp(argv[1], "conservative"))
-				g.label_retention_mode = LDP_RETENTION_CONSERVATIVE;
-			else
-				continue;
-			globalFlags |= LDP_GLOBAL_CFG_RETENTION_MODE;
+				g->label_retention_mode = LDP_RETENTION_CONSERVATIVE;
 		} else if(!strcmp(argv[0], "lsp-repair-mode")) {
 			/* lsp-repair-mode local or global */
 			if(!strcmp(argv[1], "local"))
-				g.lsp_repair_mode = LDP_REPAIR_LOCAL;
+				g->lsp_repair_mode = LDP_REPAIR_LOCAL;
 			else if(!strcmp(argv[1], "global"))
-				g.lsp_repair_mode = LDP_REPAIR_GLOBAL;
-			else
-				continue;
-			globalFlags |= LDP_GLOBAL_CFG_REPAIR_MODE;
+				g->lsp_repair_mode = LDP_REPAIR_GLOBAL;
 		} else if(!strcmp(argv[0], "propagate-release")) {
 			/* propagate-release on or off */
 			if(!strcmp(argv[1], "on"))
-				g.propagate_release = MPLS_BOOL_TRUE;
+				g->propagate_release = MPLS_BOOL_TRUE;
 			else if(!strcmp(argv[1], "off"))
-				g.propagate_release = MPLS_BOOL_FALSE;
-			else
-				continue;
-			globalFlags |= LDP_GLOBAL_CFG_PROPOGATE_RELEASE;
+				g->propagate_release = MPLS_BOOL_FALSE;
 		} else if(!strcmp(argv[0], "label-merge")) {
 			/* label-merge */
 			if(!strcmp(argv[1], "on"))
-				g.label_merge = MPLS_BOOL_TRUE;
+				g->label_merge = MPLS_BOOL_TRUE;
 			else if(!strcmp(argv[1], "off"))
-				g.label_merge = MPLS_BOOL_FALSE;
-			else
-				continue;
-			globalFlags |= LDP_GLOBAL_CFG_LABEL_MERGE;
+				g->label_merge = MPLS_BOOL_FALSE;
 		} else if(!strcmp(argv[0], "loop-detection-mode")) {
 			/* loop-detection-mode hop or path or both */
 			if(!strcmp(argv[1], "hop"))
-				g.loop_detection_mode = LDP_LOOP_HOPCOUNT;
+				g->loop_detection_mode = LDP_LOOP_HOPCOUNT;
 			else if(!strcmp(argv[1], "path"))
-				g.loop_detection_mode = LDP_LOOP_PATHVECTOR;
+				g->loop_detection_mode = LDP_LOOP_PATHVECTOR;
 			else if(!strcmp(argv[1], "both"))
-				g.loop_detection_mode = LDP_LOOP_HOPCOUNT_PATHVECTOR;
-			else
-				continue;
-			globalFlags |= LDP_GLOBAL_CFG_LOOP_DETECTION_MODE;
+				g->loop_detection_mode = LDP_LOOP_HOPCOUNT_PATHVECTOR;
 		} else if(!strcmp(argv[0], "ttl-less-domain")) {
 			/* ttl-less-domain on or off */
 			if(!strcmp(argv[1], "on"))
-				g.ttl_less_domain = MPLS_BOOL_TRUE;
+				g->ttl_less_domain = MPLS_BOOL_TRUE;
 			else if(!strcmp(argv[1], "off"))
-				g.ttl_less_domain = MPLS_BOOL_FALSE;
-			else
-				continue;
-			globalFlags |= LDP_GLOBAL_CFG_TTLLESS_DOMAIN;
+				g->ttl_less_domain = MPLS_BOOL_FALSE;
 		} else if(!strcmp(argv[0], "local-tcp-port")) {
 			/* local-tcp-port */
-			g.local_tcp_port = atoi(argv[1]);
-			globalFlags |= LDP_GLOBAL_CFG_LOCAL_TCP_PORT;
+			g->local_tcp_port = atoi(argv[1]);
 		} else if(!strcmp(argv[0], "local-udp-port")) {
 			/* local-udp-port */
-			g.local_udp_port = atoi(argv[1]);
-			globalFlags |= LDP_GLOBAL_CFG_LOCAL_UDP_PORT;
+			g->local_udp_port = atoi(argv[1]);
 		} else if(!strcmp(argv[0], "egress")) {
 			/* egress lsr-id or connected or all */
 			if(!strcmp(argv[1], "lsr-id"))
-				ldp->egress = LDP_EGRESS_LSRID;
+				model->egress = LDP_EGRESS_LSRID;
 			else if(!strcmp(argv[1], "connected"))
-				ldp->egress = LDP_EGRESS_CONNECTED;
+				model->egress = LDP_EGRESS_CONNECTED;
 			else if(!strcmp(argv[1], "all"))
-				ldp->egress = LDP_EGRESS_ALL;
-			else
-				continue;
+				model->egress = LDP_EGRESS_ALL;
 		} else if(!strcmp(argv[0], "address-mode")) {
 			/* address-mode lsr-id or ldp or all */
 			if(!strcmp(argv[1], "lsr-id"))
-				ldp->address = LDP_ADDRESS_LSRID;
+				model->address = LDP_ADDRESS_LSRID;
 			else if(!strcmp(argv[1], "ldp"))
-				ldp->address = LDP_ADDRESS_LDP;
+				model->address = LDP_ADDRESS_LDP;
 			else if(!strcmp(argv[1], "all"))
-				ldp->address = LDP_ADDRESS_ALL;
-			else
-				continue;
+				model->address = LDP_ADDRESS_ALL;
 		} else if(!strcmp(argv[0], "transport-address")) {
 			/* transport-address lsr-id or interface or ADDR or NAME */
-			g.transport_address.type = MPLS_FAMILY_NONE;
-			g.transport_address.u.ipv4 = 0;
-
-			if(!strcmp(argv[1], "lsr-id")) {
-				/* lsr-id: use lsr-id */
-				ldp->transAddr = LDP_TRANS_ADDR_LSRID;
-				g.transport_address.type = MPLS_FAMILY_IPV4;
-				g.transport_address.u.ipv4 = ntohl(ldp->lsrID.s_addr);
-			} else if(!strcmp(argv[1], "interface"))
-				/* interface: use interface address */
-				ldp->transAddr = LDP_TRANS_ADDR_INTERFACE;
-			else {
-				if(inet_aton(argv[1], &addr)) {
-					/* address: use static address */
-					ldp->transAddr = LDP_TRANS_ADDR_STATIC_IP;
-					g.transport_address.type = MPLS_FAMILY_IPV4;
-					g.transport_address.u.ipv4 = ntohl(addr.s_addr);
-				} else {
-					/* interface name: use address of specified interface */
-					ldp->transAddr = LDP_TRANS_ADDR_STATIC_INTERFACE;
-					strlcpy(ldp->transAddrIfName, argv[1], sizeof(ldp->transAddrIfName));
-					iface = Interface_FindByName(argv[1]);
-					if(iface) {
-						g.transport_address.type = MPLS_FAMILY_IPV4;
-						g.transport_address.u.ipv4 = ntohl(Interface_GetAddress(iface));
-					} else
-						continue;
-				}
+			if(!strcmp(argv[1], "lsr-id"))
+				model->transAddr = LDP_TRANS_ADDR_LSRID;
+			else if(!strcmp(argv[1], "interface"))
+				model->transAddr = LDP_TRANS_ADDR_INTERFACE;
+			else if(inet_aton(argv[1], &addr)) {
+				model->transAddr = LDP_TRANS_ADDR_STATIC_IP;
+				model->transAddrIP.s_addr = addr.s_addr;
+			} else {
+				model->transAddr = LDP_TRANS_ADDR_STATIC_INTERFACE;
+				strlcpy(model->transAddrIfName, argv[1], sizeof(model->transAddrIfName));
 			}
+		} else if(!strcmp(argv[0], "prefix-list")) {
+			Config_ParsePrefixList(model);
+		} else if(!strcmp(argv[0], "label-filter")) {
+			Config_ParseLabelFilter(model);
+		}
+	}
+}
 
-			/* update transport addresses of all interfaces */
-			TAILQ_FOREACH(iface, &interfaces, entry) {
-				if(ldp->transAddr == LDP_TRANS_ADDR_INTERFACE) {
-					iface->entity.transport_address.type = MPLS_FAMILY_IPV4;
-					iface->entity.transport_address.u.ipv4 = ntohl(Interface_GetAddress(iface));
-				} else {
-					iface->entity.transport_address.type = MPLS_FAMILY_NONE;
-					iface->entity.transport_address.u.ipv4 = 0;
-				}
-				if(iface->entity.index) {
-					Interface_Disable(iface);
-					ldp_cfg_entity_set(ldp->config, &iface->entity, LDP_ENTITY_CFG_TRANS_ADDR);
-					Interface_Enable(iface);
-				}
-			}
 
-			globalFlags |= LDP_GLOBAL_CFG_TRANS_ADDR;
+/* flags of the global settings model wants changed */
+static uint32_t Config_DiffGlobal(ldp_global *cur, ldp_global *g)
+{
+	uint32_t flags;
+
+	flags = 0;
+	if(cur->edge_inlabel != g->edge_inlabel)
+		flags |= LDP_GLOBAL_CFG_EDGE_INLABEL;
+	if(cur->initial_slice_fecs != g->initial_slice_fecs || cur->initial_slice_msec != g->initial_slice_msec)
+		flags |= LDP_GLOBAL_CFG_INITIAL_SLICE;
+	if(cur->lsp_control_mode != g->lsp_control_mode)
+		flags |= LDP_GLOBAL_CFG_CONTROL_MODE;
+	if(cur->label_retention_mode != g->label_retention_mode)
+		flags |= LDP_GLOBAL_CFG_RETENTION_MODE;
+	if(cur->lsp_repair_mode != g->lsp_repair_mode)
+		flags |= LDP_GLOBAL_CFG_REPAIR_MODE;
+	if(cur->propagate_release != g->propagate_release)
+		flags |= LDP_GLOBAL_CFG_PROPOGATE_RELEASE;
+	if(cur->label_merge != g->label_merge)
+		flags |= LDP_GLOBAL_CFG_LABEL_MERGE;
+	if(cur->loop_detection_mode != g->loop_detection_mode)
+		flags |= LDP_GLOBAL_CFG_LOOP_DETECTION_MODE;
+	if(cur->ttl_less_domain != g->ttl_less_domain)
+		flags |= LDP_GLOBAL_CFG_TTLLESS_DOMAIN;
+	if(cur->local_tcp_port != g->local_tcp_port)
+		flags |= LDP_GLOBAL_CFG_LOCAL_TCP_PORT;
+	if(cur->local_udp_port != g->local_udp_port)
+		flags |= LDP_GLOBAL_CFG_LOCAL_UDP_PORT;
+
+	return flags;
+}
+
+
+/* flags of the entity settings e wants changed */
+static uint32_t Config_DiffEntity(ldp_entity *cur, ldp_entity *e)
+{
+	uint32_t flags;
+
+	flags = 0;
+	if(cur->label_distribution_mode != e->label_distribution_mode)
+		flags |= LDP_ENTITY_CFG_DISTRIBUTION_MODE;
+	if(cur->remote_tcp_port != e->remote_tcp_port)
+		flags |= LDP_ENTITY_CFG_REMOTE_TCP;
+	if(cur->remote_udp_port != e->remote_udp_port)
+		flags |= LDP_ENTITY_CFG_REMOTE_UDP;
+	if(cur->max_pdu != e->max_pdu)
+		flags |= LDP_ENTITY_CFG_MAX_PDU;
+	if(cur->hellotime_interval != e->hellotime_interval)
+		flags |= LDP_ENTITY_CFG_HELLOTIME_INTERVAL;
+	if(cur->keepalive_interval != e->keepalive_interval)
+		flags |= LDP_ENTITY_CFG_KEEPALIVE_INTERVAL;
+	if(cur->session_setup_count != e->session_setup_count)
+		flags |= LDP_ENTITY_CFG_SESSION_SETUP_COUNT;
+	if(cur->path_vector_limit != e->path_vector_limit)
+		flags |= LDP_ENTITY_CFG_PATHVECTOR_LIMIT;
+	if(cur->hop_count_limit != e->hop_count_limit)
+		flags |= LDP_ENTITY_CFG_HOPCOUNT_LIMIT;
+	if(cur->label_request_count != e->label_request_count)
+		flags |= LDP_ENTITY_CFG_REQUEST_COUNT;
+
+	return flags;
+}
+
+
+/* copies the settings in flags from e to dst */
+static void Config_CopyEntity(ldp_entity *dst, ldp_entity *e, uint32_t flags)
+{
+	if(flags & LDP_ENTITY_CFG_DISTRIBUTION_MODE)
+		dst->label_distribution_mode = e->label_distribution_mode;
+	if(flags & LDP_ENTITY_CFG_REMOTE_TCP)
+		dst->remote_tcp_port = e->remote_tcp_port;
+	if(flags & LDP_ENTITY_CFG_REMOTE_UDP)
+		dst->remote_udp_port = e->remote_udp_port;
+	if(flags & LDP_ENTITY_CFG_MAX_PDU)
+		dst->max_pdu = e->max_pdu;
+	if(flags & LDP_ENTITY_CFG_HELLOTIME_INTERVAL)
+		dst->hellotime_interval = e->hellotime_interval;
+	if(flags & LDP_ENTITY_CFG_KEEPALIVE_INTERVAL)
+		dst->keepalive_interval = e->keepalive_interval;
+	if(flags & LDP_ENTITY_CFG_SESSION_SETUP_COUNT)
+		dst->session_setup_count = e->session_setup_count;
+	if(flags & LDP_ENTITY_CFG_PATHVECTOR_LIMIT)
+		dst->path_vector_limit = e->path_vector_limit;
+	if(flags & LDP_ENTITY_CFG_HOPCOUNT_LIMIT)
+		dst->hop_count_limit = e->hop_count_limit;
+	if(flags & LDP_ENTITY_CFG_REQUEST_COUNT)
+		dst->label_request_count = e->label_request_count;
+}
+
+
+/*
+==============
+Config_ApplyEntity
+
+Changes what differs on the entity of iface. Only settings the library
+refuses on an enabled entity cost a restart of this one interface.
+==============
+*/
+static void Config_ApplyEntity(interface_t *iface, ldp_entity *e)
+{
+	uint32_t flags;
+	ldp_entity cur;
+
+	cur.index = iface->entity.index;
+	if(ldp_cfg_entity_get(ldp->config, &cur, 0xFFFFFFFF) != MPLS_SUCCESS)
+		return;
+
+	flags = Config_DiffEntity(&cur, e);
+	Config_CopyEntity(&iface->entity, e, CONFIG_ENTITY_FLAGS);
+	if(!flags)
+		return;
+
+	if(flags & LDP_ENTITY_CFG_WHEN_DOWN) {
+		Interface_Disable(iface);
+		ldp_cfg_entity_set(ldp->config, &iface->entity, flags);
+		Interface_Enable(iface);
+	} else
+		ldp_cfg_entity_set(ldp->config, &iface->entity, flags);
+}
+
+
+/* Config_ApplyInterface */
+static void Config_ApplyInterface(interface_t *iface, configIface_t *ci)
+{
+	/* a removed or moved l2transport gives its label back */
+	if(iface->vpnLabel > 0 && (!ci || !ci->vpn || ci->vpnDest.s_addr != iface->vpnDest.s_addr)) {
+		if(iface->up == MPLS_BOOL_TRUE)
+			mpls_delete_local(iface->vpnLabel);
+		Label_Free(iface->vpnLabel);
+		iface->vpnLabel = -1;
+		iface->vpnDest.s_addr = INADDR_ANY;
+	}
+
+	if(ci && ci->vpn && iface->vpnLabel <= 0) {
+		iface->vpnType = 2;
+		iface->vpnDest.s_addr = ci->vpnDest.s_addr;
+		iface->vpnLabel = Label_Alloc(LABEL_BLOCK_VPN);
+		if(iface->vpnLabel < 0)
+			printf("no free VPN labels for %s\n", iface->name);
+		else if(iface->up == MPLS_BOOL_TRUE)
+			mpls_add_vpn(iface->vpnType, iface->name, &iface->vpnDest, iface->vpnLabel);
+	}
+
+	/* configure or shutdown interface */
+	if(iface->configUp && (!ci || !ci->up)) {
+		Interface_Shutdown(iface);
+		/* TODO move to Interface_Shutdown */
+		mpls_disable_interface(iface->name);
+	} else if(!iface->configUp && ci && ci->up) {
+		Config_CopyEntity(&iface->entity, &ci->entity, CONFIG_ENTITY_FLAGS);
+		Interface_Init(iface);
+		/* TODO move to Interface_Init */
+		mpls_enable_interface(iface->name);
+		if(iface->vpnLabel > 0) {
+			mpls_add_vpn(iface->vpnType, iface->name, &iface->vpnDest, iface->vpnLabel);
 		}
 	}
 
-	fclose(file);
+	if(ci && iface->entity.index)
+		Config_ApplyEntity(iface, &ci->entity);
+}
 
-	if(globalFlags)
-		changed = 1;
 
-	if(changed)
+/* global transport address for the mode of model */
+static void Config_TransportAddress(configModel_t *model, mpls_inet_addr *addr)
+{
+	interface_t *iface;
+
+	addr->type = MPLS_FAMILY_NONE;
+	addr->u.ipv4 = 0;
+
+	switch(model->transAddr) {
+	case LDP_TRANS_ADDR_LSRID:
+		addr->type = MPLS_FAMILY_IPV4;
+		addr->u.ipv4 = ntohl(ldp->lsrID.s_addr);
+		break;
+	case LDP_TRANS_ADDR_STATIC_IP:
+		addr->type = MPLS_FAMILY_IPV4;
+		addr->u.ipv4 = ntohl(model->transAddrIP.s_addr);
+		break;
+	case LDP_TRANS_ADDR_STATIC_INTERFACE:
+		iface = Interface_FindByName(model->transAddrIfName);
+		if(iface) {
+			addr->type = MPLS_FAMILY_IPV4;
+			addr->u.ipv4 = ntohl(Interface_GetAddress(iface));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+
+/*
+==============
+Config_Apply
+
+Brings the running state in line with model. LDP is only restarted for
+settings that do not work otherwise, and interfaces are only touched when
+their own settings changed. A changed label policy is applied to the
+existing bindings.
+==============
+*/
+static void Config_Apply(configModel_t *model)
+{
+	int restart, transport, policy;
+	uint32_t globalFlags;
+	struct in_addr lsrID;
+	ldp_global cur;
+	interface_t *iface;
+	configIface_t *ci;
+
+	ldp_cfg_global_get(ldp->config, &cur, 0xFFFFFFFF);
+	globalFlags = Config_DiffGlobal(&cur, &model->g);
+
+	lsrID = model->isStaticLSRID ? model->lsrID : routerID;
+	transport = model->transAddr != ldp->transAddr ||
+		(model->transAddr == LDP_TRANS_ADDR_STATIC_IP &&
+			ntohl(model->transAddrIP.s_addr) != cur.transport_address.u.ipv4) ||
+		(model->transAddr == LDP_TRANS_ADDR_STATIC_INTERFACE &&
+			strcmp(model->transAddrIfName, ldp->transAddrIfName));
+
+	restart = (globalFlags & CONFIG_GLOBAL_RESTART) || transport ||
+		lsrID.s_addr != ldp->lsrID.s_addr || model->implicitNull != ldp->implicitNull;
+
+	/* settings applied without a restart */
+	policy = mpls_policy_install(model->policy) || model->egress != ldp->egress;
+	model->policy = NULL;
+	ldp->egress = model->egress;
+	ldp->address = model->address;
+	if(Label_SetRange(LABEL_BLOCK_VPN, model->vpnMin, model->vpnMax) == -1)
+		printf("invalid VPN label range\n");
+	if(Label_SetRange(LABEL_BLOCK_DYNAMIC, model->dynMin, model->dynMax) == -1)
+		printf("invalid label range\n");
+	Kernel_SetBatch(model->routeBatch);
+
+	if(restart)
 		LDP_Disable();
 
-	LDP_UpdateLSRID();
+	ldp->isStaticLSRID = model->isStaticLSRID;
+	ldp->implicitNull = model->implicitNull;
+	ldp->transAddr = model->transAddr;
+	strlcpy(ldp->transAddrIfName, model->transAddrIfName, sizeof(ldp->transAddrIfName));
+
+	if(restart) {
+		LDP_UpdateLSRID();
+		Config_TransportAddress(model, &model->g.transport_address);
+		globalFlags |= LDP_GLOBAL_CFG_TRANS_ADDR;
+	}
 	if(globalFlags)
-		ldp_cfg_global_set(ldp->config, &g, globalFlags);
+		ldp_cfg_global_set(ldp->config, &model->g, globalFlags);
+
+	/* update transport addresses of all interfaces */
+	if(transport)
+		TAILQ_FOREACH(iface, &interfaces, entry) {
+			if(ldp->transAddr == LDP_TRANS_ADDR_INTERFACE) {
+				iface->entity.transport_address.type = MPLS_FAMILY_IPV4;
+				iface->entity.transport_address.u.ipv4 = ntohl(Interface_GetAddress(iface));
+			} else {
+				iface->entity.transport_address.type = MPLS_FAMILY_NONE;
+				iface->entity.transport_address.u.ipv4 = 0;
+			}
+			if(iface->entity.index) {
+				Interface_Disable(iface);
+				ldp_cfg_entity_set(ldp->config, &iface->entity, LDP_ENTITY_CFG_TRANS_ADDR);
+				Interface_Enable(iface);
+			}
+		}
 
-	if(changed)
+	/* interfaces missing from the config are shut down */
+	TAILQ_FOREACH(iface, &interfaces, entry) {
+		TAILQ_FOREACH(ci, &model->ifaces, entry)
+			if(!strncmp(ci->name, iface->name, sizeof(iface->name) - 1))
+				break;
+		Config_ApplyInterface(iface, ci);
+	}
+
+	if(restart)
 		LDP_Enable();
+	else if(policy)
+		ldp_cfg_policy_apply(ldp->config);
+}
+
+
+void Config_Load(char *path)
+{
+	FILE *file;
+	configModel_t model;
+
+	if(ldp->configured == MPLS_BOOL_FALSE) {
+		ldp->configured = MPLS_BOOL_TRUE;
+		LDP_Enable();
+	}
+
+	if(path)
+		config = path;
+
+	file = fopen(config, "r");
+	if(!file)
+		return;
+
+	Config_InitModel(&model);
+	Config_Parse(file, &model);
+	fclose(file);
+
+	Config_Apply(&model);
+	Config_FreeModel(&model);
 }
 
 
@@ -382,6 +776,7 @@ static void Config_SaveLDP(FILE *file)
 	ldp_global g;
 	struct in_addr addr;
 	char addrBuf[64];
+	int32_t min, max;
 
 	MPLS_ASSERT(file);
 
@@ -396,8 +791,16 @@ static void Config_SaveLDP(FILE *file)
 	if(!ldp->implicitNull)
 		fprintf(file, "implicit-null off\n");
 
+	Label_GetRange(LABEL_BLOCK_VPN, &min, &max);
+	if(min != LABEL_DEF_VPN_MIN || max != LABEL_DEF_VPN_MAX)
+		fprintf(file, "vpn-label-range %d %d\n", min, max);
+
+	Label_GetRange(LABEL_BLOCK_DYNAMIC, &min, &max);
+	if(min != LABEL_DEF_DYN_MIN || max != LABEL_DEF_DYN_MAX)
+		fprintf(file, "label-range %d %d\n", min, max);
+
 	if(g.edge_inlabel != LDP_GLOBAL_DEF_EDGE_INLABEL) {
-		fprintf(file, "edge_inlabel ");
+		fprintf(file, "edge-inlabel ");
 		if(g.edge_inlabel == MPLS_BOOL_TRUE)
 			fprintf(file, "on");
 		else
@@ -406,6 +809,12 @@ static void Config_SaveLDP(FILE *file)
 
 	}
 
+	if(g.initial_slice_fecs != LDP_GLOBAL_DEF_INITIAL_SLICE_FECS || g.initial_slice_msec != LDP_GLOBAL_DEF_INITIAL_SLICE_MSEC)
+		fprintf(file, "initial-slice %d %d\n", g.initial_slice_fecs, g.initial_slice_msec);
+
+	if(Kernel_GetBatch() != KERNEL_DEF_ROUTE_BATCH)
+		fprintf(file, "route-batch %d\n", Kernel_GetBatch());
+
 	if(g.lsp_control_mode != LDP_GLOBAL_DEF_CONTROL_MODE) {
 		fprintf(file, "lsp-control-mode ");
 		if(g.lsp_control_mode == LDP_CONTROL_INDEPENDENT)
@@ -522,6 +931,8 @@ static void Config_SaveLDP(FILE *file)
 		}
 	}
 
+	mpls_policy_save(file);
+
 	fprintf(file, "\n");
 }
 
@@ -3,45 +3,378 @@
 #include <sys/un.h>
 #include "control.h"
 
-typedef struct client_s {
-	int				fd;
-	struct event	ev;
-} client_t;
+
+/* responses are only built while less than this is waiting for a client */
+#define CONTROL_OUT_HIGH	(256 * 1024)
+
+/*
+ * A connection stays open for as many requests as the client sends.
+ * Responses are queued in out and written from EV_WRITE, so a slow
+ * reader never blocks the daemon and never gets a truncated answer.
+ * Answers that grow with the tables are generated by a show function
+ * that stops once CONTROL_OUT_HIGH is waiting and is called again from
+ * EV_WRITE with the same cursor, so only one window of it is ever in
+ * memory. The next request waits until the answer is complete.
+ */
+struct client_s {
+	int						fd;
+	struct event			ev;			/* EV_READ, persistent */
+	struct event			writeEv;	/* armed while out is not empty */
+	uint8_t					in[sizeof(msgHeader_t) + CONTROL_MAX_REQUEST];
+	uint32_t				inLength;
+	uint8_t					*out;
+	uint32_t				outStart;	/* first byte not yet written */
+	uint32_t				outLength;
+	uint32_t				outSize;
+	int						chunk;		/* offset of the open chunk header, -1 if none */
+	uint32_t				type;		/* command being answered */
+	controlShow_t			show;		/* generates the rest of the answer, NULL if none */
+	controlCursor_t			cursor;		/* where show is */
+	int						failed;		/* output was lost, the answer ends in MSG_FLAG_ERROR */
+	uint32_t				follow;		/* command streamed to the client, 0 if none */
+	TAILQ_ENTRY(client_s)	entry;
+};
 
 static int controlFD;
 static struct event listenEvent;
+static TAILQ_HEAD(clientList_s, client_s) clients = TAILQ_HEAD_INITIALIZER(clients);
 
-static void Control_ShowFEC(int fd);
-static void Control_ShowNeighbors(int fd);
-static void Control_ShowDatabase(int fd);
-static void Control_ShowLDP(int fd);
+static int Control_ShowFEC(client_t *client, controlCursor_t *cursor);
+static int Control_ShowNeighbors(client_t *client, controlCursor_t *cursor);
+static int Control_ShowDatabase(client_t *client, controlCursor_t *cursor);
+static void Control_ShowLDP(client_t *client);
 
-static void Control_Receive(int fd, short event, void *data)
+
+static void Control_Close(client_t *client)
+{
+	event_del(&client->ev);
+	event_del(&client->writeEv);
+	close(client->fd);
+	TAILQ_REMOVE(&clients, client, entry);
+	free(client->cursor.data);
+	free(client->out);
+	free(client);
+}
+
+
+/* makes room for length more bytes in the output buffer */
+static int Control_Reserve(client_t *client, uint32_t length)
 {
-	uint32_t type;
+	uint8_t *out;
+	uint32_t size;
+
+	/* drop what has been written already */
+	if(client->outStart) {
+		memmove(client->out, client->out + client->outStart, client->outLength - client->outStart);
+		client->outLength -= client->outStart;
+		if(client->chunk >= 0)
+			client->chunk -= client->outStart;
+		client->outStart = 0;
+	}
+
+	if(client->outLength + length <= client->outSize)
+		return 0;
+
+	size = client->outSize ? client->outSize : 4096;
+	while(size < client->outLength + length)
+		size *= 2;
+
+	out = realloc(client->out, size);
+	if(!out)
+		return -1;
+	client->out = out;
+	client->outSize = size;
+
+	return 0;
+}
+
+
+/* returns -1 if there was no room for the header */
+static int Control_CloseChunk(client_t *client, uint32_t flags)
+{
+	msgHeader_t *header;
+
+	if(client->chunk < 0) {
+		if(Control_Reserve(client, sizeof(msgHeader_t)) == -1)
+			return -1;
+		client->chunk = client->outLength;
+		client->outLength += sizeof(msgHeader_t);
+	}
+
+	header = (msgHeader_t *)(client->out + client->chunk);
+	header->type = client->type;
+	header->length = client->outLength - client->chunk - sizeof(msgHeader_t);
+	header->flags = flags;
+	client->chunk = -1;
 
-	if(!read(fd, &type, sizeof(type))) {
-		printf("Control_Receive: read type\n");
+	return 0;
+}
+
+
+/*
+==============
+Control_Write
+
+Appends data to the response being built, cutting it into chunks. Once
+the buffer cannot grow the rest of the answer is dropped, and it ends
+with MSG_FLAG_ERROR so the client does not take it for a complete one.
+==============
+*/
+void Control_Write(client_t *client, const void *data, uint32_t length)
+{
+	uint32_t room, n;
+
+	if(client->failed)
 		return;
+
+	while(length) {
+		if(client->chunk < 0) {
+			if(Control_Reserve(client, sizeof(msgHeader_t)) == -1) {
+				client->failed = 1;
+				return;
+			}
+			client->chunk = client->outLength;
+			client->outLength += sizeof(msgHeader_t);
+		}
+
+		room = CONTROL_MAX_CHUNK - (client->outLength - client->chunk - sizeof(msgHeader_t));
+		n = length < room ? length : room;
+		if(Control_Reserve(client, n) == -1) {
+			printf("Control_Write: Cannot grow output buffer\n");
+			client->failed = 1;
+			return;
+		}
+		memcpy(client->out + client->outLength, data, n);
+		client->outLength += n;
+		data = (const uint8_t *)data + n;
+		length -= n;
+
+		if(n == room)
+			Control_CloseChunk(client, 0);
+	}
+}
+
+
+/* tells a show function whether to go on or wait for the client to read */
+int Control_Room(client_t *client)
+{
+	return !client->failed && client->outLength - client->outStart < CONTROL_OUT_HIGH;
+}
+
+
+/*
+==============
+Control_Follow
+
+Appends data to the stream of every client that follows type. Clients
+that do not keep up miss data instead of growing their buffer.
+==============
+*/
+void Control_Follow(uint32_t type, const void *data, uint32_t length)
+{
+	client_t *client;
+
+	TAILQ_FOREACH(client, &clients, entry) {
+		if(client->follow != type || client->outLength - client->outStart >= CONTROL_OUT_HIGH)
+			continue;
+
+		if(client->chunk < 0)
+			client->type = type;
+		else if(client->type != type)
+			continue;
+		Control_Write(client, data, length);
 	}
+}
+
+
+/* writes as much of the output buffer as the socket takes */
+static int Control_Flush(client_t *client)
+{
+	ssize_t n;
+
+	while(client->outStart < client->outLength) {
+		n = write(client->fd, client->out + client->outStart, client->outLength - client->outStart);
+		if(n == -1) {
+			if(errno == EINTR)
+				continue;
+			if(errno == EAGAIN)
+				break;
+			return -1;
+		}
+		client->outStart += n;
+	}
+
+	if(client->outStart == client->outLength) {
+		client->outStart = 0;
+		client->outLength = 0;
+	}
+
+	/* an unfinished answer goes on from EV_WRITE, even with out empty */
+	if(client->outLength || client->show)
+		event_add(&client->writeEv, NULL);
+	else
+		event_del(&client->writeEv);
+
+	return 0;
+}
+
+
+/* ends the answer, returns -1 if the client has to be closed */
+static int Control_Finish(client_t *client)
+{
+	uint32_t flags;
+
+	flags = MSG_FLAG_LAST;
+	if(client->failed)
+		flags |= MSG_FLAG_ERROR;
+	client->failed = 0;
+
+	return Control_CloseChunk(client, flags);
+}
+
+
+/* runs the show function of the answer being sent, a failed answer is cut short */
+static int Control_Continue(client_t *client)
+{
+	if(!client->show || (!client->failed && client->show(client, &client->cursor)))
+		return 0;
+
+	client->show = NULL;
+	free(client->cursor.data);
+	memset(&client->cursor, 0, sizeof(client->cursor));
+
+	return Control_Finish(client);
+}
+
+
+/* returns -1 if the client has to be closed */
+static int Control_Execute(client_t *client, uint32_t type)
+{
+	client->type = type;
 
 	switch(type) {
 	case COMMAND_SHOW_LDP:
-		Control_ShowLDP(fd);
+		Control_ShowLDP(client);
 		break;
 	case COMMAND_SHOW_LDP_FEC:
-		Control_ShowFEC(fd);
+		client->show = Control_ShowFEC;
 		break;
 	case COMMAND_SHOW_LDP_NEIGHBORS:
-		Control_ShowNeighbors(fd);
+		client->show = Control_ShowNeighbors;
 		break;
 	case COMMAND_SHOW_LDP_DATABASE:
-		Control_ShowDatabase(fd);
+		client->show = Control_ShowDatabase;
 		break;
 	case COMMAND_SHOW_FORWARDING:
-		MPLS_ShowLIB(fd);
+		client->show = MPLS_ShowLIB;
+		break;
+	case COMMAND_SHOW_LABELS:
+		Label_ShowBlocks(client);
+		break;
+	case COMMAND_SHOW_MEMORY:
+		mpls_mm_show(client);
 		break;
+	case COMMAND_SHOW_LOG:
+		client->show = mpls_log_show;
+		break;
+	case COMMAND_FOLLOW_LOG:
+		/* records arrive from the log drain until the client disconnects */
+		client->follow = type;
+		return 0;
+	default:
+		return Control_CloseChunk(client, MSG_FLAG_LAST | MSG_FLAG_ERROR);
+	}
+
+	if(!client->show)
+		return Control_Finish(client);
+
+	return Control_Continue(client);
+}
+
+
+/*
+==============
+Control_Process
+
+Runs the complete requests in the input buffer. While a client does not
+read its answers, further requests wait in the buffer. Returns -1 if the
+client sent a request that can never fit and has to be closed.
+==============
+*/
+static int Control_Process(client_t *client)
+{
+	uint32_t length;
+	msgHeader_t header;
+
+	while(client->inLength >= sizeof(msgHeader_t) && !client->show && client->outLength - client->outStart < CONTROL_OUT_HIGH) {
+		memcpy(&header, client->in, sizeof(header));
+		if(header.length > CONTROL_MAX_REQUEST) {
+			printf("Control_Process: request of %u bytes\n", header.length);
+			return -1;
+		}
+
+		length = sizeof(msgHeader_t) + header.length;
+		if(client->inLength < length)
+			break;
+
+		memmove(client->in, client->in + length, client->inLength - length);
+		client->inLength -= length;
+
+		if(Control_Execute(client, header.type) == -1)
+			return -1;
+	}
+
+	/* stop reading while the input buffer is full */
+	if(client->inLength == sizeof(client->in))
+		event_del(&client->ev);
+	else
+		event_add(&client->ev, NULL);
+
+	return 0;
+}
+
+
+static void Control_Receive(int fd, short event, void *data)
+{
+	ssize_t n;
+	client_t *client;
+
+	client = data;
+
+	if(client->inLength < sizeof(client->in)) {
+		n = read(fd, client->in + client->inLength, sizeof(client->in) - client->inLength);
+		if(n == 0 || (n == -1 && errno != EAGAIN && errno != EINTR)) {
+			Control_Close(client);
+			return;
+		}
+		if(n > 0)
+			client->inLength += n;
+	}
+
+	if(Control_Process(client) == -1 || Control_Flush(client) == -1)
+		Control_Close(client);
+}
+
+
+static void Control_Send(int fd, short event, void *data)
+{
+	client_t *client;
+
+	client = data;
+	if(Control_Flush(client) == -1) {
+		Control_Close(client);
+		return;
 	}
+
+	/* the rest of the answer, then requests held back by it */
+	if(client->show && client->outLength - client->outStart < CONTROL_OUT_HIGH)
+		if(Control_Continue(client) == -1 || Control_Flush(client) == -1) {
+			Control_Close(client);
+			return;
+		}
+	if(client->inLength)
+		if(Control_Process(client) == -1 || Control_Flush(client) == -1)
+			Control_Close(client);
 }
 
 
@@ -51,7 +384,7 @@ static void Control_Accept(int fd, short event, void *data)
 	socklen_t len;
 	struct sockaddr_un sun;
 
-	client = malloc(sizeof(client));
+	client = calloc(1, sizeof(client_t));
 	if(!client)
 		return;
 
@@ -60,16 +393,39 @@ static void Control_Accept(int fd, short event, void *data)
 	if(client->fd == -1) {
 		if(errno != EWOULDBLOCK && errno != EINTR)
 			printf("Control_Accept: accept");
+		free(client);
 		return;
 	}
 
 	fcntl(client->fd, F_SETFL, O_NONBLOCK);
+	client->chunk = -1;
+	TAILQ_INSERT_TAIL(&clients, client, entry);
 
-	event_set(&client->ev, client->fd, EV_READ, Control_Receive, NULL);
+	event_set(&client->ev, client->fd, EV_READ | EV_PERSIST, Control_Receive, client);
+	event_set(&client->writeEv, client->fd, EV_WRITE | EV_PERSIST, Control_Send, client);
 	event_add(&client->ev, NULL);
 }
 
 
+/* sends what Control_Follow appended */
+void Control_FollowFlush()
+{
+	client_t *client, *next;
+
+	for(client = TAILQ_FIRST(&clients); client; client = next) {
+		next = TAILQ_NEXT(client, entry);
+		if(!client->follow || (client->chunk < 0 && !client->failed))
+			continue;
+
+		/* records were lost, the client learns from MSG_FLAG_ERROR */
+		Control_CloseChunk(client, client->failed ? MSG_FLAG_ERROR : 0);
+		client->failed = 0;
+		if(Control_Flush(client) == -1)
+			Control_Close(client);
+	}
+}
+
+
 void Control_Init()
 {
 	int fd, oldumask;
@@ -124,52 +480,79 @@ void Control_Init()
 
 void Control_Shutdown()
 {
+	while(!TAILQ_EMPTY(&clients))
+		Control_Close(TAILQ_FIRST(&clients));
+
 	event_del(&listenEvent);
 	if(controlFD > 0)
 		close(controlFD);
 }
 
 
-static void Control_ShowFEC(int fd)
+/*
+ * The streamed answers walk their table by index, cursor->index is the
+ * last record sent. The count up front is the size of the table when the
+ * answer started, no more records follow but fewer may if it shrank.
+ */
+static int Control_ShowFEC(client_t *client, controlCursor_t *cursor)
 {
-	uint32_t i;
+	uint32_t count, max;
 	struct mpls_fec fec;
 	struct mpls_nexthop nh;
-	struct in_addr addr;
 	msgFEC_t msgFEC;
-	msgNexthop_t msgNexthop;
+	msgNexthop_t *msgNexthop, *list;
 
-	i = 0;
-	fec.index = 0;
-	while(ldp_cfg_fec_getnext(ldp->config, &fec, 0xFFFFFFFF) == MPLS_SUCCESS)
-		i++;
-	write(fd, &i, sizeof(i));
+	if(!cursor->started) {
+		count = ldp_cfg_fec_count(ldp->config);
+		Control_Write(client, &count, sizeof(count));
+		cursor->left = count;
+		cursor->started = 1;
+	}
 
-	fec.index = 0;
-	while(ldp_cfg_fec_getnext(ldp->config, &fec, 0xFFFFFFFF) == MPLS_SUCCESS) {
-		i = 0;
+	max = 0;
+	msgNexthop = NULL;
+	fec.index = cursor->index;
+	while(cursor->left && Control_Room(client)) {
+		if(ldp_cfg_fec_getnext(ldp->config, &fec, 0xFFFFFFFF) != MPLS_SUCCESS) {
+			cursor->left = 0;
+			break;
+		}
+
+		/* collect next hops so the FEC header can carry their number */
+		msgFEC.count = 0;
 		nh.index = 0;
-		while(ldp_cfg_fec_nexthop_getnext(ldp->config, &fec, &nh, 0xFFFFFFFF) == MPLS_SUCCESS)
-			i++;
+		while(ldp_cfg_fec_nexthop_getnext(ldp->config, &fec, &nh, 0xFFFFFFFF) == MPLS_SUCCESS) {
+			if(msgFEC.count == max) {
+				list = realloc(msgNexthop, sizeof(msgNexthop_t) * (max ? max * 2 : 8));
+				if(!list)
+					break;
+				msgNexthop = list;
+				max = max ? max * 2 : 8;
+			}
+			msgNexthop[msgFEC.count].index = nh.index;
+			msgNexthop[msgFEC.count].address = htonl(nh.ip.u.ipv4);
+			msgNexthop[msgFEC.count].attached = nh.attached;
+			msgFEC.count++;
+		}
 
 		msgFEC.index = fec.index;
 		msgFEC.prefix = htonl(fec.u.prefix.network.u.ipv4);
 		msgFEC.length = fec.u.prefix.length;
-		msgFEC.count = i;
-		write(fd, &msgFEC, sizeof(msgFEC));
+		Control_Write(client, &msgFEC, sizeof(msgFEC));
+		if(msgFEC.count)
+			Control_Write(client, msgNexthop, sizeof(msgNexthop_t) * msgFEC.count);
 
-		nh.index = 0;
-		while(ldp_cfg_fec_nexthop_getnext(ldp->config, &fec, &nh, 0xFFFFFFFF) == MPLS_SUCCESS) {
-			msgNexthop.index = nh.index;;
-			msgNexthop.address = htonl(nh.ip.u.ipv4);
-			msgNexthop.attached = nh.attached;
-			write(fd, &msgNexthop, sizeof(msgNexthop));
-		}
+		cursor->index = fec.index;
+		cursor->left--;
 	}
+
+	free(msgNexthop);
+
+	return cursor->left != 0;
 }
 
 
-static void Control_ShowNeighbors(int fd)
+static int Control_ShowNeighbors(client_t *client, controlCursor_t *cursor)
 {
 	ldp_adj adj;
 	ldp_addr addr;
@@ -183,14 +566,25 @@ static void Control_ShowNeighbors(int fd)
 	
 	ldp_cfg_global_get(ldp->config, &g, 0xFFFFFFFF);
 
-	count = 0;
-	adj.index = 0;
-	while(ldp_cfg_adj_getnext(ldp->config, &adj, 0xFFFFFFFF) == MPLS_SUCCESS)
-		count++;
-	write(fd, &count, sizeof(count));
+	if(!cursor->started) {
+		count = 0;
+		adj.index = 0;
+		while(ldp_cfg_adj_getnext(ldp->config, &adj, 0xFFFFFFFF) == MPLS_SUCCESS)
+			count++;
+		Control_Write(client, &count, sizeof(count));
+		cursor->left = count;
+		cursor->started = 1;
+	}
+
+	adj.index = cursor->index;
+	while(cursor->left && Control_Room(client)) {
+		if(ldp_cfg_adj_getnext(ldp->config, &adj, 0xFFFFFFFF) != MPLS_SUCCESS) {
+			cursor->left = 0;
+			break;
+		}
+		cursor->index = adj.index;
+		cursor->left--;
 
-	adj.index = 0;
-	while(ldp_cfg_adj_getnext(ldp->config, &adj, 0xFFFFFFFF) == MPLS_SUCCESS) {
 		if (adj.entity_index) {
 			e.index = adj.entity_index;
 			ldp_cfg_entity_get(ldp->config, &e, 0xFFFFFFFF);
@@ -222,6 +616,8 @@ static void Control_ShowNeighbors(int fd)
 			neighbor.mode = s.oper_distribution_mode;
 
 			neighbor.timeUp = s.oper_up;
+			neighbor.initialDone = s.initial_fec_done;
+			neighbor.initialTotal = s.initial_fec_total;
 		}
 
 		if(e.entity_type == LDP_DIRECT)
@@ -235,22 +631,24 @@ static void Control_ShowNeighbors(int fd)
 			while(ldp_cfg_session_raddr_getnext(ldp->config, &s, &addr, 0xFFFFFFFF) == MPLS_SUCCESS)
 				count++;
 			neighbor.numAddresses = count;
-			write(fd, &neighbor, sizeof(neighbor));
+			Control_Write(client, &neighbor, sizeof(neighbor));
 
 			addr.index = 0;
 			while(ldp_cfg_session_raddr_getnext(ldp->config, &s, &addr, 0xFFFFFFFF) == MPLS_SUCCESS) {
 				ipaddr = htonl(addr.address.u.ipv4);
-				write(fd, &ipaddr, sizeof(ipaddr));
+				Control_Write(client, &ipaddr, sizeof(ipaddr));
 			}
 		} else {
 			neighbor.numAddresses = 0;
-			write(fd, &neighbor, sizeof(neighbor));
+			Control_Write(client, &neighbor, sizeof(neighbor));
 		}
 	}
+
+	return cursor->left != 0;
 }
 
 
-static void Control_ShowDatabase(int fd)
+static int Control_ShowDatabase(client_t *client, controlCursor_t *cursor)
 {
 	ldp_session session;
 	ldp_outlabel out;
@@ -262,16 +660,25 @@ static void Control_ShowDatabase(int fd)
 	msgLabel_t label;
 
 	if(!ldp)
-		return;
+		return 0;
 
-	count = 0;
-	attr.index = 0;
-	while(ldp_cfg_attr_getnext(ldp->config, &attr, 0xFFFFFFFF) == MPLS_SUCCESS)
-		count++;
-	write(fd, &count, sizeof(count));
+	if(!cursor->started) {
+		count = ldp_cfg_attr_count(ldp->config);
+		Control_Write(client, &count, sizeof(count));
+		cursor->left = count;
+		cursor->started = 1;
+	}
+
+	memset(&attr, 0, sizeof(attr));
+	attr.index = cursor->index;
+	while(cursor->left && Control_Room(client)) {
+		if(ldp_cfg_attr_getnext(ldp->config, &attr, 0xFFFFFFFF) != MPLS_SUCCESS) {
+			cursor->left = 0;
+			break;
+		}
+		cursor->index = attr.index;
+		cursor->left--;
 
-	attr.index = 0;
-	while(ldp_cfg_attr_getnext(ldp->config, &attr, 0xFFFFFFFF) == MPLS_SUCCESS) {
 		label.prefix = htonl(attr.fecTlv.fecElArray[0].addressEl.address);
 		label.length = attr.fecTlv.fecElArray[0].addressEl.preLen;
 
@@ -279,7 +686,7 @@ static void Control_ShowDatabase(int fd)
 		session.index = attr.session_index;
 		if(ldp_cfg_session_get(ldp->config, &session, 0xFFFFFFFF) != MPLS_SUCCESS) {
 			label.isSession = 0;
-			write(fd, &label, sizeof(label));
+			Control_Write(client, &label, sizeof(label));
 			continue;
 		}
 
@@ -287,7 +694,7 @@ static void Control_ShowDatabase(int fd)
 		adj.index = session.adj_index;
 		if(ldp_cfg_adj_get(ldp->config, &adj, 0xFFFFFFFF) != MPLS_SUCCESS) {
 			label.isAdj = 0;
-			write(fd, &label, sizeof(label));
+			Control_Write(client, &label, sizeof(label));
 			continue;
 		}
 
@@ -330,12 +737,14 @@ static void Control_ShowDatabase(int fd)
 			break;
 		}
 
-		write(fd, &label, sizeof(label));
+		Control_Write(client, &label, sizeof(label));
 	}
+
+	return cursor->left != 0;
 }
 
 
-static void Control_ShowLDP(int fd)
+static void Control_ShowLDP(client_t *client)
 {
 	ldp_global g;
 	msgLDP_t msg;
@@ -358,6 +767,9 @@ static void Control_ShowLDP(int fd)
 	msg.keepaliveInterval = g.keepalive_interval;
 	msg.helloTimer = g.hellotime_timer;
 	msg.helloInterval = g.hellotime_interval;
+	Kernel_GetStats(&msg.routeUpdates, &msg.routeCoalesced, &msg.routeApplied);
+	mpls_socket_get_stats(&msg.helloWakeups, &msg.helloDatagrams, &msg.helloBatchMax);
+	MPLS_GetStats(&msg.libFlushes, &msg.libQueued, &msg.libCancelled);
 
-	write(fd, &msg, sizeof(msg));
+	Control_Write(client, &msg, sizeof(msg));
 }
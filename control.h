@@ -3,12 +3,36 @@
 
 #define LDPD_SOCK "/var/run/ldpd.sock"
 
+/*
+ * Requests and responses are framed by msgHeader_t. A client can send
+ * any number of requests over one connection. Every response is the
+ * record stream of its command, cut into chunks of at most
+ * CONTROL_MAX_CHUNK bytes, and the last chunk carries MSG_FLAG_LAST.
+ * Tables are sent while they are walked, the record count in front of
+ * them is an upper bound and the answer ends at MSG_FLAG_LAST.
+ */
+#define CONTROL_MAX_REQUEST	1024
+#define CONTROL_MAX_CHUNK	16384
+
+#define MSG_FLAG_LAST		0x01	/* final chunk of a response */
+#define MSG_FLAG_ERROR		0x02	/* request was not understood, or the answer is incomplete */
+
+typedef struct msgHeader_s {
+	uint32_t	type;		/* commandType_t */
+	uint32_t	length;		/* bytes following the header */
+	uint32_t	flags;
+} msgHeader_t;
+
 enum commandType_t {
 	COMMAND_SHOW_LDP,
 	COMMAND_SHOW_LDP_FEC,
 	COMMAND_SHOW_LDP_NEIGHBORS,
 	COMMAND_SHOW_LDP_DATABASE,
-	COMMAND_SHOW_FORWARDING
+	COMMAND_SHOW_FORWARDING,
+	COMMAND_SHOW_LABELS,
+	COMMAND_SHOW_MEMORY,
+	COMMAND_SHOW_LOG,
+	COMMAND_FOLLOW_LOG		/* never answered with MSG_FLAG_LAST */
 };
 
 typedef struct msgNexthop_s {
@@ -38,6 +62,8 @@ typedef struct msgNeighbor_s {
 	uint32_t	timeUp;
 	char		name[60];
 	uint32_t	numAddresses;
+	uint32_t	initialDone;	/* FECs of initial distribution processed */
+	uint32_t	initialTotal;
 } msgNeighbor_t;
 
 typedef enum {
@@ -76,6 +102,15 @@ typedef struct msgLDP_s {
 	uint32_t	keepaliveInterval;
 	uint32_t	helloTimer;
 	uint32_t	helloInterval;
+	uint32_t	routeUpdates;		/* read from the routing socket */
+	uint32_t	routeCoalesced;		/* dropped by route batching */
+	uint32_t	routeApplied;		/* handed to LDP */
+	uint32_t	helloWakeups;		/* hello socket read events */
+	uint32_t	helloDatagrams;		/* read from the hello socket */
+	uint32_t	helloBatchMax;		/* most datagrams in one read event */
+	uint32_t	libFlushes;			/* LIB batches sent to the kernel */
+	uint32_t	libQueued;			/* LIB changes batched */
+	uint32_t	libCancelled;		/* LIB changes undone before a flush */
 } msgLDP_t;
 
 typedef struct msgLIBEntry_s {
@@ -88,4 +123,33 @@ typedef struct msgLIBEntry_s {
 	uint32_t	nexthop;
 } msgLIBEntry_t;
 
+typedef struct msgLabelBlock_s {
+	char		name[16];
+	int32_t		min;
+	int32_t		max;
+	uint32_t	inUse;
+	uint32_t	peak;
+	uint32_t	allocs;
+	uint32_t	frees;
+	uint32_t	failures;
+} msgLabelBlock_t;
+
+typedef struct msgMemPool_s {
+	char		name[48];
+	uint32_t	size;		/* object size, 0 for the large pool */
+	uint32_t	slabs;
+	uint32_t	live;
+	uint32_t	peak;
+	uint32_t	allocs;
+	uint32_t	frees;
+} msgMemPool_t;
+
+typedef struct msgLogRecord_s {
+	uint32_t	seq;		/* gaps are records the ring lost */
+	uint32_t	sec;		/* monotonic */
+	uint32_t	usec;
+	uint32_t	level;
+	char		text[128];
+} msgLogRecord_t;
+
 #endif
@@ -7,10 +7,11 @@ struct ldp_s;
 struct interface_s;
 struct mpls_timer;
 struct mpls_socket;
+struct mpls_tree;
 
 #define ptr_verify(x) ((x) ? MPLS_BOOL_TRUE : MPLS_BOOL_FALSE)
 
-typedef void *mpls_tree_handle;
+typedef struct mpls_tree *mpls_tree_handle;
 #define mpls_tree_handle_compare(x,y) (x != y)
 #define mpls_tree_handle_verify(x) ptr_verify(x)
 
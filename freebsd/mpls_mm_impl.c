@@ -1,26 +1,249 @@
 #include "ldpd.h"
+#include "control.h"
 
 
-static int _mm_count = 0;
+/*
+ * Objects up to MPLS_MM_MAX bytes come from pools, one per size rounded
+ * to MPLS_MM_ALIGN. A pool carves slabs into objects and keeps released
+ * ones on a free list, so churn does not go through malloc and objects of
+ * a type stay packed together. Every object is preceded by a header that
+ * points to its pool, larger objects are malloc'ed with the same header.
+ * Built with MPLS_MM_POISON (make MM_POISON=1), released objects are
+ * filled with a pattern that is checked when they are handed out again.
+ */
+
+#define MPLS_MM_ALIGN		16
+#define MPLS_MM_MAX			1024
+#define MPLS_MM_POOLS		(MPLS_MM_MAX / MPLS_MM_ALIGN)
+#define MPLS_MM_SLAB		16384
+#define MPLS_MM_POISON_BYTE	0xdb
+
+typedef struct mmPool_s {
+	char		name[48];	/* types of this size */
+	uint32_t	size;		/* object size without header */
+	union mmHeader_u	*free;
+	uint32_t	slabs;
+	uint32_t	live;
+	uint32_t	peak;
+	uint32_t	allocs;
+	uint32_t	frees;
+} mmPool_t;
+
+typedef union mmHeader_u {
+	struct {
+		mmPool_t			*pool;
+		union mmHeader_u	*next;	/* free list, MPLS_MM_INUSE while handed out */
+	} h;
+	char	align[MPLS_MM_ALIGN];
+} mmHeader_t;
+
+#define MPLS_MM_INUSE	((mmHeader_t *)1)
+
+static mmPool_t pools[MPLS_MM_POOLS];
+static mmPool_t large = { "large" };
+
+
+static mmPool_t *MM_Pool(mpls_size_type size)
+{
+	mmPool_t *pool;
+
+	pool = &pools[size ? (size - 1) / MPLS_MM_ALIGN : 0];
+	if(!pool->size)
+		pool->size = (pool - pools + 1) * MPLS_MM_ALIGN;
+
+	return pool;
+}
+
+
+static int MM_Grow(mmPool_t *pool)
+{
+	int i, count;
+	uint32_t step;
+	char *slab;
+	mmHeader_t *obj;
+
+	step = sizeof(mmHeader_t) + pool->size;
+	count = MPLS_MM_SLAB / step;
+	slab = malloc(count * step);
+	if(!slab)
+		return -1;
+
+	for(i = count - 1; i >= 0; i--) {
+		obj = (mmHeader_t *)(slab + i * step);
+		obj->h.pool = pool;
+		obj->h.next = pool->free;
+		pool->free = obj;
+#ifdef MPLS_MM_POISON
+		memset(obj + 1, MPLS_MM_POISON_BYTE, pool->size);
+#endif
+	}
+	pool->slabs++;
+
+	return 0;
+}
+
+
+#ifdef MPLS_MM_POISON
+static void MM_Check(mmPool_t *pool, mmHeader_t *obj)
+{
+	uint32_t i;
+	uint8_t *data;
+
+	data = (uint8_t *)(obj + 1);
+	for(i = 0; i < pool->size; i++)
+		if(data[i] != MPLS_MM_POISON_BYTE) {
+			printf("mpls_malloc: %s object %p was written after free\n", pool->name, data);
+			return;
+		}
+}
+#endif
 
 
 void *mpls_malloc(mpls_size_type size)
 {
-	void *mem = malloc(size);
-	if(mem)
-		_mm_count++;
-	return mem;
+	mmPool_t *pool;
+	mmHeader_t *obj;
+
+	if(size > MPLS_MM_MAX) {
+		pool = &large;
+		obj = malloc(sizeof(mmHeader_t) + size);
+		if(!obj)
+			return NULL;
+		obj->h.pool = pool;
+	} else {
+		pool = MM_Pool(size);
+		if(!pool->free && MM_Grow(pool) == -1)
+			return NULL;
+		obj = pool->free;
+		pool->free = obj->h.next;
+#ifdef MPLS_MM_POISON
+		MM_Check(pool, obj);
+#endif
+	}
+
+	obj->h.next = MPLS_MM_INUSE;
+	pool->allocs++;
+	if(++pool->live > pool->peak)
+		pool->peak = pool->live;
+
+	return obj + 1;
 }
 
 
 void mpls_free(void *mem)
 {
-	_mm_count--;
-	free(mem);
+	mmPool_t *pool;
+	mmHeader_t *obj;
+
+	if(!mem)
+		return;
+
+	obj = (mmHeader_t *)mem - 1;
+	if(obj->h.next != MPLS_MM_INUSE) {
+		printf("mpls_free: %p is not allocated\n", mem);
+		return;
+	}
+
+	pool = obj->h.pool;
+	pool->live--;
+	pool->frees++;
+
+	if(pool == &large) {
+		obj->h.next = NULL;
+		free(obj);
+		return;
+	}
+
+#ifdef MPLS_MM_POISON
+	memset(mem, MPLS_MM_POISON_BYTE, pool->size);
+#endif
+	obj->h.next = pool->free;
+	pool->free = obj;
+}
+
+
+/* names the pool objects of size come from, for the statistics */
+void mpls_mm_name(mpls_size_type size, const char *name)
+{
+	mmPool_t *pool;
+
+	if(size > MPLS_MM_MAX)
+		return;
+
+	pool = MM_Pool(size);
+	if(strstr(pool->name, name))
+		return;
+	if(pool->name[0])
+		strlcat(pool->name, ",", sizeof(pool->name));
+	strlcat(pool->name, name, sizeof(pool->name));
+}
+
+
+/*
+==============
+mpls_mm_init
+
+Names the pools of the objects LDP churns through.
+==============
+*/
+void mpls_mm_init()
+{
+	mpls_mm_name(sizeof(ldp_attr), "attr");
+	mpls_mm_name(sizeof(ldp_fs), "fs");
+	mpls_mm_name(sizeof(ldp_fec), "fec");
+	mpls_mm_name(sizeof(ldp_nexthop), "nexthop");
+	mpls_mm_name(sizeof(ldp_inlabel), "inlabel");
+	mpls_mm_name(sizeof(ldp_outlabel), "outlabel");
+	mpls_mm_name(sizeof(ldp_addr), "addr");
+	mpls_mm_name(sizeof(ldp_adj), "adj");
+	mpls_mm_name(sizeof(ldp_mesg), "mesg");
+}
+
+
+/*
+==============
+mpls_mm_show
+==============
+*/
+void mpls_mm_show(client_t *client)
+{
+	int i;
+	uint32_t count;
+	mmPool_t *pool;
+	msgMemPool_t msg;
+
+	count = 1;
+	for(i = 0; i < MPLS_MM_POOLS; i++)
+		if(pools[i].allocs)
+			count++;
+	Control_Write(client, &count, sizeof(count));
+
+	for(i = 0; i <= MPLS_MM_POOLS; i++) {
+		pool = i < MPLS_MM_POOLS ? &pools[i] : &large;
+		if(pool != &large && !pool->allocs)
+			continue;
+
+		memset(&msg, 0, sizeof(msg));
+		strlcpy(msg.name, pool->name, sizeof(msg.name));
+		msg.size = pool->size;
+		msg.slabs = pool->slabs;
+		msg.live = pool->live;
+		msg.peak = pool->peak;
+		msg.allocs = pool->allocs;
+		msg.frees = pool->frees;
+		Control_Write(client, &msg, sizeof(msg));
+	}
 }
 
 
 void mpls_mm_results()
 {
-	printf("Info: LDP memory results: %d\n", _mm_count);
+	int i;
+	uint32_t live;
+
+	live = large.live;
+	for(i = 0; i < MPLS_MM_POOLS; i++)
+		live += pools[i].live;
+
+	printf("Info: LDP memory results: %u\n", live);
 }
@@ -48,6 +48,10 @@ mpls_return_enum mpls_mpls_insegment_add(mpls_mpls_handle handle, mpls_insegment
 		} else {
 			/* Allocate new */
 			in->label.u.gen = mpls_alloc_label();
+			if(in->label.u.gen < 0) {
+				in->label.type = MPLS_LABEL_TYPE_NONE;
+				return MPLS_FAILURE;
+			}
 		}
 	}
 
@@ -60,6 +64,7 @@ mpls_return_enum mpls_mpls_insegment_add(mpls_mpls_handle handle, mpls_insegment
 void mpls_mpls_insegment_del(mpls_mpls_handle handle, mpls_insegment *in)
 {
 	mpls_delete_local(in->label.u.gen);
+	mpls_free_label(in->label.u.gen);
 }
 
 
@@ -101,9 +106,12 @@ void mpls_mpls_fec2out_del(mpls_mpls_handle handle, mpls_fec *fec, mpls_outsegme
 
 mpls_return_enum mpls_mpls_get_label_space_range(mpls_mpls_handle handle, mpls_range *range)
 {
+  int32_t min, max;
+
+  Label_GetRange(LABEL_BLOCK_DYNAMIC, &min, &max);
   range->type = MPLS_LABEL_RANGE_GENERIC;
-  range->min.u.gen = 16;
-  range->max.u.gen = 0xFFFFF;
+  range->min.u.gen = min;
+  range->max.u.gen = max;
 
   return MPLS_SUCCESS;
 }
@@ -1,6 +1,442 @@
 #include "ldpd.h"
 
 
+/*
+ * Label filters. A prefix list is an ordered set of permit or deny
+ * entries, each matching a prefix and an optional range of lengths, the
+ * first entry that matches decides and a prefix no entry matches is
+ * denied. Every list is compiled into a binary trie with a node per
+ * prefix bit, entries hang off the node of their prefix in sequence
+ * order, so a lookup walks at most one node per bit of the FEC and only
+ * looks at entries whose prefix covers it. A filter binds a list to
+ * import, export or egress decisions, either for all peers or for the
+ * peer with a given LSR-ID, which then overrides the one for all peers.
+ */
+
+#define POLICY_NAME_LEN		32
+#define POLICY_NONE			-1
+
+typedef struct policyEntry_s {
+	int			permit;
+	uint32_t	prefix;		/* host byte order, host bits clear */
+	int			length;
+	int			ge;
+	int			le;
+	int32_t		next;		/* next entry on the same node */
+} policyEntry_t;
+
+typedef struct policyNode_s {
+	int32_t		child[2];
+	int32_t		entry;		/* first entry of this prefix */
+} policyNode_t;
+
+typedef struct policyList_s {
+	char			name[POLICY_NAME_LEN];
+	policyEntry_t	*entries;
+	uint32_t		entryCount;
+	uint32_t		entryMax;
+	policyNode_t	*nodes;		/* node 0 is the root */
+	uint32_t		nodeCount;
+	uint32_t		nodeMax;
+} policyList_t;
+
+typedef struct policyFilter_s {
+	policyType_t	type;
+	struct in_addr	neighbor;	/* INADDR_ANY for all peers */
+	char			name[POLICY_NAME_LEN];
+	policyList_t	*list;		/* NULL while the list is undefined */
+} policyFilter_t;
+
+struct policySet_s {
+	policyList_t	*lists;
+	uint32_t		listCount;
+	uint32_t		listMax;
+	policyFilter_t	*filters;
+	uint32_t		filterCount;
+	uint32_t		filterMax;
+};
+
+static policySet_t *policy;
+
+
+static uint32_t Policy_Mask(int length)
+{
+	return length ? (0xFFFFFFFF << (32 - length)) : 0;
+}
+
+
+/* grows an array to hold one more element */
+static int Policy_Grow(void **array, uint32_t count, uint32_t *max, size_t size)
+{
+	void *tmp;
+	uint32_t n;
+
+	if(count < *max)
+		return 0;
+
+	n = *max ? *max * 2 : 8;
+	tmp = realloc(*array, n * size);
+	if(!tmp)
+		return -1;
+
+	*array = tmp;
+	*max = n;
+
+	return 0;
+}
+
+
+static int32_t Policy_NewNode(policyList_t *list)
+{
+	policyNode_t *node;
+
+	if(Policy_Grow((void **)&list->nodes, list->nodeCount, &list->nodeMax, sizeof(policyNode_t)) == -1)
+		return POLICY_NONE;
+
+	node = &list->nodes[list->nodeCount];
+	node->child[0] = POLICY_NONE;
+	node->child[1] = POLICY_NONE;
+	node->entry = POLICY_NONE;
+
+	return list->nodeCount++;
+}
+
+
+static policyList_t *Policy_FindList(policySet_t *set, const char *name)
+{
+	uint32_t i;
+
+	for(i = 0; i < set->listCount; i++)
+		if(!strcmp(set->lists[i].name, name))
+			return &set->lists[i];
+
+	return NULL;
+}
+
+
+/* first entry of list matching prefix/length, POLICY_NONE if none does */
+static int32_t Policy_Match(policyList_t *list, uint32_t prefix, int length)
+{
+	int depth;
+	int32_t node, entry, best;
+	policyEntry_t *e;
+
+	best = POLICY_NONE;
+	node = list->nodeCount ? 0 : POLICY_NONE;
+	for(depth = 0; node != POLICY_NONE; depth++) {
+		/* entries are chained in sequence order, the first fit is enough */
+		for(entry = list->nodes[node].entry; entry != POLICY_NONE; entry = e->next) {
+			e = &list->entries[entry];
+			if(best != POLICY_NONE && entry > best)
+				break;
+			if(length >= e->ge && length <= e->le) {
+				best = entry;
+				break;
+			}
+		}
+
+		if(depth == length)
+			break;
+		node = list->nodes[node].child[(prefix >> (31 - depth)) & 1];
+	}
+
+	return best;
+}
+
+
+/* filter deciding type for the peer with lsrid, NULL if there is none */
+static policyFilter_t *Policy_FindFilter(policySet_t *set, policyType_t type, mpls_inet_addr *lsrid)
+{
+	uint32_t i;
+	in_addr_t neighbor;
+	policyFilter_t *global;
+
+	neighbor = lsrid ? htonl(lsrid->u.ipv4) : INADDR_ANY;
+
+	global = NULL;
+	for(i = 0; i < set->filterCount; i++) {
+		if(set->filters[i].type != type)
+			continue;
+		if(set->filters[i].neighbor.s_addr == INADDR_ANY)
+			global = &set->filters[i];
+		else if(neighbor != INADDR_ANY && set->filters[i].neighbor.s_addr == neighbor)
+			return &set->filters[i];
+	}
+
+	return global;
+}
+
+
+static mpls_bool Policy_Check(policyType_t type, mpls_fec *fec, mpls_inet_addr *lsrid)
+{
+	int length;
+	int32_t entry;
+	uint32_t prefix;
+	policyFilter_t *filter;
+
+	if(!policy)
+		return MPLS_BOOL_TRUE;
+
+	switch(fec->type) {
+	case MPLS_FEC_PREFIX:
+		prefix = fec->u.prefix.network.u.ipv4;
+		length = fec->u.prefix.length;
+		break;
+	case MPLS_FEC_HOST:
+		prefix = fec->u.host.u.ipv4;
+		length = 32;
+		break;
+	default:
+		/* VPN FECs are not subject to prefix lists */
+		return MPLS_BOOL_TRUE;
+	}
+
+	filter = Policy_FindFilter(policy, type, lsrid);
+	if(!filter || !filter->list)
+		return MPLS_BOOL_TRUE;
+
+	entry = Policy_Match(filter->list, prefix & Policy_Mask(length), length);
+	if(entry == POLICY_NONE || !filter->list->entries[entry].permit)
+		return MPLS_BOOL_FALSE;
+
+	return MPLS_BOOL_TRUE;
+}
+
+
+/* policySet_t */
+policySet_t *mpls_policy_create()
+{
+	return calloc(1, sizeof(policySet_t));
+}
+
+
+void mpls_policy_free(policySet_t *set)
+{
+	uint32_t i;
+
+	if(!set)
+		return;
+
+	for(i = 0; i < set->listCount; i++) {
+		free(set->lists[i].entries);
+		free(set->lists[i].nodes);
+	}
+	free(set->lists);
+	free(set->filters);
+	free(set);
+}
+
+
+/*
+==============
+mpls_policy_add_prefix
+
+Appends an entry to list, creating the list on first use. ge and le are
+0 when not given.
+==============
+*/
+int mpls_policy_add_prefix(policySet_t *set, const char *name, int permit, struct in_addr prefix, int length, int ge, int le)
+{
+	int depth, bit;
+	int32_t node, child, *link;
+	uint32_t key;
+	policyList_t *list;
+	policyEntry_t *e;
+
+	if(!set || length < 0 || length > 32)
+		return -1;
+
+	if(!ge && !le)
+		ge = le = length;
+	else if(!le)
+		le = 32;
+	else if(!ge)
+		ge = length;
+	if(ge < length || le < ge || le > 32)
+		return -1;
+
+	list = Policy_FindList(set, name);
+	if(!list) {
+		if(Policy_Grow((void **)&set->lists, set->listCount, &set->listMax, sizeof(policyList_t)) == -1)
+			return -1;
+		list = &set->lists[set->listCount++];
+		memset(list, 0, sizeof(policyList_t));
+		strlcpy(list->name, name, sizeof(list->name));
+	}
+
+	if(Policy_Grow((void **)&list->entries, list->entryCount, &list->entryMax, sizeof(policyEntry_t)) == -1)
+		return -1;
+
+	key = ntohl(prefix.s_addr) & Policy_Mask(length);
+
+	/* walk down to the node of the prefix, creating what is missing */
+	node = list->nodeCount ? 0 : Policy_NewNode(list);
+	for(depth = 0; node != POLICY_NONE && depth < length; depth++) {
+		bit = (key >> (31 - depth)) & 1;
+		child = list->nodes[node].child[bit];
+		if(child == POLICY_NONE) {
+			child = Policy_NewNode(list);
+			if(child != POLICY_NONE)
+				list->nodes[node].child[bit] = child;
+		}
+		node = child;
+	}
+	if(node == POLICY_NONE)
+		return -1;
+
+	e = &list->entries[list->entryCount];
+	e->permit = permit;
+	e->prefix = key;
+	e->length = length;
+	e->ge = ge;
+	e->le = le;
+	e->next = POLICY_NONE;
+
+	for(link = &list->nodes[node].entry; *link != POLICY_NONE; link = &list->entries[*link].next)
+		;
+	*link = list->entryCount++;
+
+	return 0;
+}
+
+
+/* a later filter for the same type and neighbor replaces the earlier one */
+int mpls_policy_add_filter(policySet_t *set, policyType_t type, struct in_addr neighbor, const char *name)
+{
+	uint32_t i;
+	policyFilter_t *filter;
+
+	if(!set)
+		return -1;
+
+	for(i = 0; i < set->filterCount; i++)
+		if(set->filters[i].type == type && set->filters[i].neighbor.s_addr == neighbor.s_addr)
+			break;
+
+	if(i == set->filterCount) {
+		if(Policy_Grow((void **)&set->filters, set->filterCount, &set->filterMax, sizeof(policyFilter_t)) == -1)
+			return -1;
+		set->filterCount++;
+	}
+
+	filter = &set->filters[i];
+	memset(filter, 0, sizeof(policyFilter_t));
+	filter->type = type;
+	filter->neighbor = neighbor;
+	strlcpy(filter->name, name, sizeof(filter->name));
+
+	return 0;
+}
+
+
+static int Policy_Same(policySet_t *a, policySet_t *b)
+{
+	uint32_t i, j;
+	policyEntry_t *x, *y;
+
+	if(!a || !b)
+		return a == b;
+
+	if(a->listCount != b->listCount || a->filterCount != b->filterCount)
+		return 0;
+
+	for(i = 0; i < a->listCount; i++) {
+		if(strcmp(a->lists[i].name, b->lists[i].name) || a->lists[i].entryCount != b->lists[i].entryCount)
+			return 0;
+		for(j = 0; j < a->lists[i].entryCount; j++) {
+			x = &a->lists[i].entries[j];
+			y = &b->lists[i].entries[j];
+			if(x->permit != y->permit || x->prefix != y->prefix || x->length != y->length ||
+				x->ge != y->ge || x->le != y->le)
+				return 0;
+		}
+	}
+
+	for(i = 0; i < a->filterCount; i++)
+		if(a->filters[i].type != b->filters[i].type ||
+			a->filters[i].neighbor.s_addr != b->filters[i].neighbor.s_addr ||
+			strcmp(a->filters[i].name, b->filters[i].name))
+			return 0;
+
+	return 1;
+}
+
+
+/*
+==============
+mpls_policy_install
+
+Makes set the running policy, set is owned by the policy code afterwards.
+Returns 1 if the policy changed and the bindings have to be checked again.
+==============
+*/
+int mpls_policy_install(policySet_t *set)
+{
+	uint32_t i;
+	policyFilter_t *filter;
+
+	if(Policy_Same(policy, set)) {
+		mpls_policy_free(set);
+		return 0;
+	}
+
+	if(set)
+		for(i = 0; i < set->filterCount; i++) {
+			filter = &set->filters[i];
+			filter->list = Policy_FindList(set, filter->name);
+			if(!filter->list)
+				printf("Warning: prefix list %s is not defined, label filter permits all\n", filter->name);
+		}
+
+	mpls_policy_free(policy);
+	policy = set;
+
+	return 1;
+}
+
+
+/* mpls_policy_save */
+void mpls_policy_save(FILE *file)
+{
+	uint32_t i, j;
+	char addrBuf[64];
+	struct in_addr addr;
+	policyList_t *list;
+	policyEntry_t *e;
+	policyFilter_t *filter;
+	static const char *types[] = { "import", "export", "egress" };
+
+	if(!policy)
+		return;
+
+	for(i = 0; i < policy->listCount; i++) {
+		list = &policy->lists[i];
+		for(j = 0; j < list->entryCount; j++) {
+			e = &list->entries[j];
+			addr.s_addr = htonl(e->prefix);
+			if(!inet_ntop(AF_INET, &addr, addrBuf, sizeof(addrBuf)))
+				continue;
+			fprintf(file, "prefix-list %s %s %s/%d", list->name, e->permit ? "permit" : "deny", addrBuf, e->length);
+			if(e->ge != e->length || e->le != e->length) {
+				if(e->ge != e->length)
+					fprintf(file, " ge %d", e->ge);
+				if(e->le != 32 || e->ge == e->length)
+					fprintf(file, " le %d", e->le);
+			}
+			fprintf(file, "\n");
+		}
+	}
+
+	for(i = 0; i < policy->filterCount; i++) {
+		filter = &policy->filters[i];
+		fprintf(file, "label-filter %s %s", types[filter->type], filter->name);
+		if(filter->neighbor.s_addr != INADDR_ANY && inet_ntop(AF_INET, &filter->neighbor, addrBuf, sizeof(addrBuf)))
+			fprintf(file, " neighbor %s", addrBuf);
+		fprintf(file, "\n");
+	}
+}
+
+
 static void mpls_fec2zebra_prefix(mpls_fec *fec, prefix_t *prefix)
 {
 	switch(fec->type) {
@@ -27,9 +463,9 @@ static int prefix_same(const prefix_t *a, const prefix_t *b)
 }
 
 
-mpls_bool mpls_policy_import_check(mpls_instance_handle handle, mpls_fec *fec, mpls_nexthop *nexthop)
+mpls_bool mpls_policy_import_check(mpls_instance_handle handle, mpls_fec *fec, mpls_nexthop *nexthop, mpls_inet_addr *lsrid)
 {
-	return MPLS_BOOL_TRUE;
+	return Policy_Check(POLICY_IMPORT, fec, lsrid);
 }
 
 
@@ -65,13 +501,16 @@ mpls_bool mpls_policy_egress_check(mpls_instance_handle handle, mpls_fec *fec, m
 		break;
 	}
 
+	if(result == MPLS_BOOL_TRUE)
+		result = Policy_Check(POLICY_EGRESS, fec, NULL);
+
 	return result;
 }
 
 
-mpls_bool mpls_policy_export_check(mpls_instance_handle handle, mpls_fec *fec, mpls_nexthop *nexthop)
+mpls_bool mpls_policy_export_check(mpls_instance_handle handle, mpls_fec *fec, mpls_nexthop *nexthop, mpls_inet_addr *lsrid)
 {
-	return MPLS_BOOL_TRUE;
+	return Policy_Check(POLICY_EXPORT, fec, lsrid);
 }
 
 
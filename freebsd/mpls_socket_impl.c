@@ -1,12 +1,73 @@
 #include "ldpd.h"
 
 
+/*
+ * TCP output is queued in a per-socket ring and flushed with writev() when
+ * the socket becomes writable, so everything sent during one event goes
+ * out in as few syscalls as possible. Bulk producers watch
+ * mpls_socket_tcp_tx_queued() and ask with mpls_socket_tcp_tx_notify() for
+ * an LDP_EVENT_TCP_WRITABLE once the ring has drained. The ring still
+ * grows up to MPLS_SOCKET_TX_MAX, beyond that writes fail and the session
+ * goes down instead of stalling the daemon, which only a peer that stopped
+ * reading gets to.
+ */
+#define MPLS_SOCKET_TX_INIT	16384
+#define MPLS_SOCKET_TX_MAX	(4 * 1024 * 1024)
+
+/*
+ * UDP input is read in batches of up to MPLS_SOCKET_RX_BATCH datagrams per
+ * read event, with one recvmmsg() where the system has it. The batch is
+ * handed out by mpls_socket_udp_recvfrom() and only refilled once all of
+ * it has been processed, datagrams still queued in the kernel wait for the
+ * next read event.
+ */
+#define MPLS_SOCKET_RX_BATCH	32
+#define MPLS_SOCKET_RX_DGRAM	MPLS_PDUMAXLEN
+
+#ifndef MSG_WAITFORONE
+/* no recvmmsg(), the batch is filled by a recvmsg() loop */
+struct mmsghdr {
+	struct msghdr	msg_hdr;
+	unsigned int	msg_len;
+};
+#endif
+
+typedef struct socketRx_s {
+	int				count;		/* datagrams in the batch */
+	int				next;		/* next one handed out */
+	int				error;		/* errno of a failed read */
+	struct mmsghdr	msgs[MPLS_SOCKET_RX_BATCH];
+	struct iovec	iov[MPLS_SOCKET_RX_BATCH];
+	struct sockaddr	addr[MPLS_SOCKET_RX_BATCH];
+	char			control[MPLS_SOCKET_RX_BATCH][CMSG_SPACE(sizeof(struct sockaddr_dl))];
+	uint8_t			data[MPLS_SOCKET_RX_BATCH][MPLS_SOCKET_RX_DGRAM];
+} socketRx_t;
+
+static struct {
+	uint32_t	wakeups;	/* read events with datagrams */
+	uint32_t	datagrams;
+	uint32_t	batchMax;	/* most datagrams in one read event */
+} rxStats;
+
 struct mpls_socket {
 	int				fd;
 	int				type;
 	struct event	read;
 	struct event	write;
+	struct event	tx;		/* output ring, apart from the writelist event */
 	void			*extra;
+
+	uint8_t			*txBuf;		/* output ring */
+	int				txSize;		/* ring capacity */
+	int				txHead;		/* offset of first queued byte */
+	int				txLen;		/* bytes queued */
+	int				txArmed;	/* tx event is waiting */
+	int				txError;	/* connection failed, drop output */
+	int				txNotify;	/* LDP_EVENT_TCP_WRITABLE is asked for */
+	int				txLowat;	/* once txLen drops to this */
+	in_addr_t		txIfAddr;	/* IP_MULTICAST_IF last set, INADDR_ANY at first */
+
+	socketRx_t		*rx;		/* UDP input batch */
 };
 
 
@@ -41,6 +102,80 @@ static void *getsockopt_cmsg_data(struct msghdr *msgh, int level, int type)
 }
 
 
+/* reads the datagrams of one read event, returns how many */
+static int socket_rx_fill(struct mpls_socket *socket)
+{
+	int i, count;
+	socketRx_t *rx;
+	struct msghdr *msg;
+
+	rx = socket->rx;
+	for(i = 0; i < MPLS_SOCKET_RX_BATCH; i++) {
+		msg = &rx->msgs[i].msg_hdr;
+		msg->msg_namelen = sizeof(struct sockaddr);
+		msg->msg_controllen = sizeof(rx->control[i]);
+		msg->msg_flags = 0;
+	}
+
+#ifdef MSG_WAITFORONE
+	count = recvmmsg(socket->fd, rx->msgs, MPLS_SOCKET_RX_BATCH, MSG_DONTWAIT, NULL);
+#else
+	for(count = 0; count < MPLS_SOCKET_RX_BATCH; count++) {
+		i = recvmsg(socket->fd, &rx->msgs[count].msg_hdr, MSG_DONTWAIT);
+		if(i < 0)
+			break;
+		rx->msgs[count].msg_len = i;
+	}
+	if(!count)
+		count = -1;
+#endif
+
+	rx->next = 0;
+	rx->error = 0;
+	if(count < 0) {
+		rx->count = 0;
+		if(errno != EAGAIN)
+			rx->error = errno;
+		return 0;
+	}
+	rx->count = count;
+
+	if(count) {
+		rxStats.wakeups++;
+		rxStats.datagrams += count;
+		if(count > rxStats.batchMax)
+			rxStats.batchMax = count;
+	}
+
+	return count;
+}
+
+
+static socketRx_t *socket_rx_create()
+{
+	int i;
+	socketRx_t *rx;
+	struct msghdr *msg;
+
+	rx = mpls_malloc(sizeof(socketRx_t));
+	if(!rx)
+		return NULL;
+
+	memset(rx, 0, sizeof(socketRx_t));
+	for(i = 0; i < MPLS_SOCKET_RX_BATCH; i++) {
+		rx->iov[i].iov_base = rx->data[i];
+		rx->iov[i].iov_len = MPLS_SOCKET_RX_DGRAM;
+		msg = &rx->msgs[i].msg_hdr;
+		msg->msg_name = &rx->addr[i];
+		msg->msg_iov = &rx->iov[i];
+		msg->msg_iovlen = 1;
+		msg->msg_control = rx->control[i];
+	}
+
+	return rx;
+}
+
+
 static void socket_read_handler(int fd, short event, void *arg)
 {
 	struct mpls_socket *socket;
@@ -57,11 +192,22 @@ static void socket_read_handler(int fd, short event, void *arg)
 		ldp_event(ldp->config, socket, socket->extra, LDP_EVENT_TCP_LISTEN);
 		break;
 	case MPLS_SOCKET_UDP_DATA:
-		ldp_event(ldp->config, socket, socket->extra, LDP_EVENT_UDP_DATA);
+		/*
+		 * an ldp_event stops early when a datagram fails, the rest of the
+		 * batch is handed out by further calls before it is refilled,
+		 * every call takes a datagram or the read error off the batch
+		 */
+		if(socket->rx->next == socket->rx->count)
+			socket_rx_fill(socket);
+		while(socket->rx->next < socket->rx->count || socket->rx->error)
+			ldp_event(ldp->config, socket, socket->extra, LDP_EVENT_UDP_DATA);
 		break;
 	default:
 		MPLS_ASSERT(0);
 	}
+
+	ldp_cfg_flush(ldp->config);
+	mpls_flush();
 }
 
 
@@ -80,6 +226,116 @@ static void socket_write_handler(int fd, short event, void *arg)
 	default:
 		MPLS_ASSERT(0);
 	}
+
+	ldp_cfg_flush(ldp->config);
+	mpls_flush();
+}
+
+
+/* returns the number of bytes written, -1 when the socket is dead */
+static int socket_tx_drain(struct mpls_socket *socket)
+{
+	int n, cnt, tail;
+	struct iovec iov[2];
+
+	if(!socket->txLen)
+		return 0;
+
+	tail = socket->txHead + socket->txLen;
+	iov[0].iov_base = socket->txBuf + socket->txHead;
+	if(tail <= socket->txSize) {
+		iov[0].iov_len = socket->txLen;
+		cnt = 1;
+	} else {
+		iov[0].iov_len = socket->txSize - socket->txHead;
+		iov[1].iov_base = socket->txBuf;
+		iov[1].iov_len = tail - socket->txSize;
+		cnt = 2;
+	}
+
+	n = writev(socket->fd, iov, cnt);
+	if(n < 0) {
+		if(errno == EAGAIN || errno == EINTR)
+			return 0;
+		perror("socket_tx_drain");
+		socket->txError = 1;
+		socket->txHead = 0;
+		socket->txLen = 0;
+		return -1;
+	}
+
+	socket->txLen -= n;
+	socket->txHead = socket->txLen ? (socket->txHead + n) % socket->txSize : 0;
+
+	return n;
+}
+
+
+static void socket_tx_handler(int fd, short event, void *arg)
+{
+	struct mpls_socket *socket;
+
+	socket = (struct mpls_socket *)arg;
+	socket->txArmed = 0;
+
+	if(socket_tx_drain(socket) < 0)
+		return;
+
+	if(socket->txLen) {
+		/* socket buffer is full, wait until it drains */
+		event_set(&socket->tx, socket->fd, EV_WRITE, socket_tx_handler, socket);
+		if(event_add(&socket->tx, NULL) != -1)
+			socket->txArmed = 1;
+	}
+
+	/* last, the session may close the socket */
+	if(socket->txNotify && socket->txLen <= socket->txLowat) {
+		socket->txNotify = 0;
+		ldp_event(ldp->config, socket, socket->extra, LDP_EVENT_TCP_WRITABLE);
+		ldp_cfg_flush(ldp->config);
+		mpls_flush();
+	}
+}
+
+
+/* makes room for size more bytes, unwrapping the ring into a larger one */
+static int socket_tx_reserve(struct mpls_socket *socket, int size)
+{
+	int newSize, first;
+	uint8_t *buf;
+
+	if(socket->txLen + size <= socket->txSize)
+		return 0;
+
+	if(socket->txLen + size > MPLS_SOCKET_TX_MAX)
+		return -1;
+
+	newSize = socket->txSize ? socket->txSize : MPLS_SOCKET_TX_INIT;
+	while(newSize < socket->txLen + size)
+		newSize *= 2;
+	if(newSize > MPLS_SOCKET_TX_MAX)
+		newSize = MPLS_SOCKET_TX_MAX;
+
+	buf = mpls_malloc(newSize);
+	if(!buf)
+		return -1;
+
+	if(socket->txLen) {
+		first = socket->txSize - socket->txHead;
+		if(first >= socket->txLen)
+			memcpy(buf, socket->txBuf + socket->txHead, socket->txLen);
+		else {
+			memcpy(buf, socket->txBuf + socket->txHead, first);
+			memcpy(buf + first, socket->txBuf, socket->txLen - first);
+		}
+	}
+
+	mpls_free(socket->txBuf);
+	socket->txBuf = buf;
+	socket->txSize = newSize;
+	socket->txHead = 0;
+
+	return 0;
 }
 
 
@@ -97,7 +353,14 @@ void mpls_socket_mgr_close(mpls_socket_mgr_handle handle)
 void mpls_socket_close(mpls_socket_mgr_handle handle, mpls_socket_handle socket)
 {
 	if(socket) {
+		if(socket->txArmed)
+			event_del(&socket->tx);
+		/* last chance for a pending notification to get out */
+		socket_tx_drain(socket);
 		close(socket->fd);
+		if(socket->txBuf)
+			mpls_free(socket->txBuf);
+		mpls_free(socket->rx);
 		mpls_free(socket);
 	}
 }
@@ -141,6 +404,13 @@ mpls_socket_handle mpls_socket_create_udp(mpls_socket_mgr_handle handle)
 		return NULL;
 	}
 
+	sock->rx = socket_rx_create();
+	if(!sock->rx) {
+		close(sock->fd);
+		mpls_free(sock);
+		return NULL;
+	}
+
 	return sock;
 }
 
@@ -175,6 +445,10 @@ mpls_socket_handle mpls_socket_tcp_accept(mpls_socket_mgr_handle handle, mpls_so
 	unsigned int size;
 
 	sock = mpls_malloc(sizeof(struct mpls_socket));
+	if(!sock)
+		return NULL;
+
+	memset(sock, 0, sizeof(struct mpls_socket));
 	size = sizeof(addr);
 	if((sock->fd = accept(socket->fd, &addr, &size)) < 0) {
 		mpls_free(sock);
@@ -318,6 +592,8 @@ mpls_return_enum mpls_socket_multicast_if_tx(mpls_socket_mgr_handle handle, mpls
 	if(setsockopt(socket->fd, IPPROTO_IP, IP_MULTICAST_IF, &addr, sizeof(addr)) < 0)
 		return MPLS_FAILURE;
 
+	socket->txIfAddr = addr.s_addr;
+
 	return MPLS_SUCCESS;
 }
 
@@ -416,7 +692,51 @@ int mpls_socket_tcp_read(mpls_socket_mgr_handle handle, mpls_socket_handle socke
 
 int mpls_socket_tcp_write(mpls_socket_mgr_handle handle, mpls_socket_handle socket, uint8_t *buffer, int size)
 {
-	return write(socket->fd, buffer, size);
+	int tail, first;
+
+	if(socket->txError)
+		return -1;
+
+	if(size <= 0)
+		return 0;
+
+	if(socket_tx_reserve(socket, size) == -1) {
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	tail = (socket->txHead + socket->txLen) % socket->txSize;
+	first = socket->txSize - tail;
+	if(first >= size)
+		memcpy(socket->txBuf + tail, buffer, size);
+	else {
+		memcpy(socket->txBuf + tail, buffer, first);
+		memcpy(socket->txBuf, buffer + first, size - first);
+	}
+	socket->txLen += size;
+
+	if(!socket->txArmed) {
+		event_set(&socket->tx, socket->fd, EV_WRITE, socket_tx_handler, socket);
+		if(event_add(&socket->tx, NULL) == -1)
+			return -1;
+		socket->txArmed = 1;
+	}
+
+	return size;
+}
+
+
+int mpls_socket_tcp_tx_queued(mpls_socket_mgr_handle handle, mpls_socket_handle socket)
+{
+	return socket->txLen;
+}
+
+
+/* only called with more than lowat bytes queued, the ring is armed then */
+void mpls_socket_tcp_tx_notify(mpls_socket_mgr_handle handle, mpls_socket_handle socket, int lowat)
+{
+	socket->txNotify = 1;
+	socket->txLowat = lowat;
 }
 
 
@@ -430,43 +750,107 @@ int mpls_socket_udp_sendto(mpls_socket_mgr_handle handle, mpls_socket_handle soc
 }
 
 
-int mpls_socket_udp_recvfrom(mpls_socket_mgr_handle handle, mpls_socket_handle socket, uint8_t *buffer, int size, mpls_dest *from)
+/*
+ * Sends a datagram out of iface on a socket shared by all interfaces.
+ * Where the stack takes the interface per packet (IP_PKTINFO) it goes
+ * into the control data. Otherwise the source is pinned with
+ * IP_SENDSRCADDR and the multicast interface is only set when it differs
+ * from the one of the last datagram.
+ */
+int mpls_socket_udp_sendto_if(mpls_socket_mgr_handle handle, mpls_socket_handle socket, uint8_t *buffer, int size, const mpls_dest *to,
+								const mpls_if_handle iface)
 {
-	int ret;
 	struct sockaddr addr;
 	struct iovec iov;
 	struct cmsghdr *cmsg;
-	struct sockaddr_dl *sdl;
-	char buf[sizeof(struct cmsghdr) + sizeof(struct sockaddr_dl)];
+#ifdef IP_PKTINFO
+	struct in_pktinfo *info;
+	char buf[CMSG_SPACE(sizeof(struct in_pktinfo))];
+#else
+	char buf[CMSG_SPACE(sizeof(struct in_addr))];
+#endif
 	struct msghdr msg = {
 		.msg_name = &addr, .msg_namelen = sizeof(struct sockaddr),
 		.msg_iov = &iov, .msg_iovlen = 1,
-		.msg_control = buf, .msg_controllen = sizeof(buf),
+		.msg_control = NULL, .msg_controllen = 0,
 		.msg_flags = 0
 	};
 
+	_mpls_dest2sockaddr(to, &addr);
 	iov.iov_base = buffer;
 	iov.iov_len = size;
 
-	ret = recvmsg(socket->fd, &msg, 0);
-	if(ret < 0 && errno != EAGAIN)
-		return 0;
+	if(!iface)
+		return sendmsg(socket->fd, &msg, 0);
 
-	_sockaddr2mpls_dest(&addr, from);
+	memset(buf, 0, sizeof(buf));
+	msg.msg_control = buf;
+	msg.msg_controllen = sizeof(buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = IPPROTO_IP;
 
-//	struct in_addr *i = (struct in_addr *)getsockopt_cmsg_data(&msg, IPPROTO_IP, IP_RECVDSTADDR);
+#ifdef IP_PKTINFO
+	cmsg->cmsg_type = IP_PKTINFO;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+	info = (struct in_pktinfo *)CMSG_DATA(cmsg);
+	info->ipi_ifindex = iface->index;
+	info->ipi_spec_dst.s_addr = Interface_GetAddress(iface);
+#else
+	cmsg->cmsg_type = IP_SENDSRCADDR;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_addr));
+	((struct in_addr *)CMSG_DATA(cmsg))->s_addr = Interface_GetAddress(iface);
 
-//	sdl = (struct sockaddr_dl *)getsockopt_cmsg_data(&msg, IPPROTO_IP, IP_RECVIF);
-//	from->if_handle = sdl ? Interface_FindByIndex(sdl->sdl_index) : NULL;
+	/* keyed on the address, the interface may have been renumbered */
+	if(socket->txIfAddr != Interface_GetAddress(iface) &&
+		mpls_socket_multicast_if_tx(handle, socket, iface) == MPLS_FAILURE)
+		return -1;
+#endif
 
-	from->if_handle = NULL;
-	cmsg = CMSG_FIRSTHDR(&msg);
-	if(cmsg && cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVIF) {
-		sdl = (struct sockaddr_dl *)CMSG_DATA(cmsg);
-		from->if_handle = (sdl) ? Interface_FindByIndex(sdl->sdl_index) : NULL;
+	return sendmsg(socket->fd, &msg, 0);
+}
+
+
+/* hands out the next datagram of the batch read for this read event */
+int mpls_socket_udp_recvfrom(mpls_socket_mgr_handle handle, mpls_socket_handle socket, uint8_t *buffer, int size, mpls_dest *from)
+{
+	int len;
+	socketRx_t *rx;
+	struct msghdr *msg;
+	struct sockaddr_dl *sdl;
+
+	rx = socket->rx;
+	if(rx->next == rx->count) {
+		if(rx->error) {
+			errno = rx->error;
+			rx->error = 0;
+			return 0;
+		}
+		errno = EAGAIN;
+		return -1;
 	}
 
-	return ret;
+	msg = &rx->msgs[rx->next].msg_hdr;
+	len = rx->msgs[rx->next].msg_len;
+	if(len > size)
+		len = size;
+	memcpy(buffer, rx->data[rx->next], len);
+	rx->next++;
+
+	_sockaddr2mpls_dest(msg->msg_name, from);
+
+	sdl = (struct sockaddr_dl *)getsockopt_cmsg_data(msg, IPPROTO_IP, IP_RECVIF);
+	from->if_handle = sdl ? Interface_FindByIndex(sdl->sdl_index) : NULL;
+
+	return len;
+}
+
+
+/* mpls_socket_get_stats */
+void mpls_socket_get_stats(uint32_t *wakeups, uint32_t *datagrams, uint32_t *batchMax)
+{
+	*wakeups = rxStats.wakeups;
+	*datagrams = rxStats.datagrams;
+	*batchMax = rxStats.batchMax;
 }
 
 
@@ -1,54 +1,291 @@
 #include "ldpd.h"
 
 
+/*
+ * Hierarchical timing wheel driven by a single libevent timer. Time is
+ * counted in ticks of MPLS_TIMER_TICK ms. The first level has a slot per
+ * tick for the next 256 ticks, every further level covers 64 slots of the
+ * level below and is cascaded down when the level below wraps. Start, stop
+ * and modify only link or unlink a timer, so they are O(1). The libevent
+ * timer sleeps until the next non empty slot or the next cascade, and is
+ * not armed at all while no timer runs. Timers of duration 0 bypass the
+ * wheel, they run on the next pass of the event loop instead of a tick
+ * later.
+ */
+
+#define MPLS_TIMER_TICK		10			/* ms */
+#define MPLS_TIMER_BITS0	8
+#define MPLS_TIMER_BITSN	6
+#define MPLS_TIMER_LEVELS	3			/* levels above the first */
+#define MPLS_TIMER_SLOTS0	(1 << MPLS_TIMER_BITS0)
+#define MPLS_TIMER_SLOTSN	(1 << MPLS_TIMER_BITSN)
+#define MPLS_TIMER_SPAN		(1ULL << (MPLS_TIMER_BITS0 + MPLS_TIMER_LEVELS * MPLS_TIMER_BITSN))
+
+LIST_HEAD(timerList_s, mpls_timer);
+
 struct mpls_timer {
-	struct event		ev;
+	LIST_ENTRY(mpls_timer)	entry;
+	uint64_t			expires;	/* tick */
 	int					active;
 	mpls_time_unit_enum	unit;
 	int 				duration;
+	int					jitter;		/* percent the duration is cut by at most */
 	int 				type;
 	void 				*extra;
 	mpls_cfg_handle		cfg;
 	void (*handler)(mpls_timer_handle timer, void *extra, mpls_cfg_handle cfg);
 };
 
-static void setupTimeval(struct timeval *tv, mpls_time_unit_enum unit, int duration)
+static struct {
+	struct event		ev;
+	int					open;
+	int					armed;
+	int					running;	/* in timerTick */
+	uint64_t			wakeup;		/* tick ev is armed for */
+	uint64_t			now;		/* next tick to run */
+	uint32_t			count;		/* timers in the wheel */
+	struct timerList_s	zero;		/* timers of duration 0 */
+	struct timerList_s	slot0[MPLS_TIMER_SLOTS0];
+	struct timerList_s	slotN[MPLS_TIMER_LEVELS][MPLS_TIMER_SLOTSN];
+} wheel;
+
+
+static uint64_t timerMsec()
 {
-	if(!tv)
-		return;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+static uint64_t timerClock()
+{
+	return timerMsec() / MPLS_TIMER_TICK;
+}
+
+
+/* duration of a timer in ticks, at least one unless the duration is 0 */
+static uint64_t timerTicks(struct mpls_timer *timer)
+{
+	uint64_t ms;
+
+	if(!timer->duration)
+		return 0;
+
+	switch(timer->unit) {
+	case MPLS_UNIT_MICRO:
+		ms = timer->duration / 1000;
+		break;
+	case MPLS_UNIT_MIN:
+		ms = (uint64_t)timer->duration * 60000;
+		break;
+	case MPLS_UNIT_HOUR:
+		ms = (uint64_t)timer->duration * 3600000;
+		break;
+	case MPLS_UNIT_SEC:
+	default:
+		ms = (uint64_t)timer->duration * 1000;
+		break;
+	}
+
+	if(timer->jitter && ms)
+		ms -= arc4random_uniform(ms * timer->jitter / 100 + 1);
+
+	ms = (ms + MPLS_TIMER_TICK - 1) / MPLS_TIMER_TICK;
+
+	return ms ? ms : 1;
+}
+
 
-	timerclear(tv);
+static void timerArm(uint64_t tick)
+{
+	struct timeval tv;
+	uint64_t now;
+
+	if(wheel.armed) {
+		if(wheel.wakeup <= tick)
+			return;
+		evtimer_del(&wheel.ev);
+	}
+
+	now = timerClock();
+	tick = tick > now ? tick - now : 0;
+	tv.tv_sec = tick * MPLS_TIMER_TICK / 1000;
+	tv.tv_usec = (tick * MPLS_TIMER_TICK % 1000) * 1000;
+
+	wheel.armed = evtimer_add(&wheel.ev, &tv) == 0;
+	wheel.wakeup = now + tick;
+}
 
-	if(unit == MPLS_UNIT_MICRO)
-		tv->tv_usec = duration;
+
+static void timerLink(struct mpls_timer *timer)
+{
+	uint64_t delta;
+	int level;
+
+	if(timer->expires < wheel.now)
+		timer->expires = wheel.now;
+	delta = timer->expires - wheel.now;
+	if(delta >= MPLS_TIMER_SPAN) {
+		timer->expires = wheel.now + MPLS_TIMER_SPAN - 1;
+		delta = MPLS_TIMER_SPAN - 1;
+	}
+
+	if(delta < MPLS_TIMER_SLOTS0)
+		LIST_INSERT_HEAD(&wheel.slot0[timer->expires & (MPLS_TIMER_SLOTS0 - 1)], timer, entry);
 	else {
-		int mult;
-		if(unit == MPLS_UNIT_SEC)
-			mult = 1;
-		else if(mult == MPLS_UNIT_MIN)
-			mult = 60;
-		else if(mult == MPLS_UNIT_HOUR)
-			mult = 3600;
-		tv->tv_sec = duration * mult;
+		for(level = 0; delta >= (1ULL << (MPLS_TIMER_BITS0 + (level + 1) * MPLS_TIMER_BITSN)); level++)
+			;
+		LIST_INSERT_HEAD(&wheel.slotN[level][(timer->expires >> (MPLS_TIMER_BITS0 + level * MPLS_TIMER_BITSN)) & (MPLS_TIMER_SLOTSN - 1)], timer, entry);
+	}
+}
+
+
+static void timerSchedule(struct mpls_timer *timer)
+{
+	uint64_t ticks;
+
+	if(timer->active) {
+		LIST_REMOVE(timer, entry);
+		wheel.count--;
+	} else if(!wheel.count && !wheel.running)
+		wheel.now = timerClock();	/* the wheel stood still */
+
+	ticks = timerTicks(timer);
+	timer->expires = timerClock() + ticks;
+	timer->active = 1;
+	wheel.count++;
+
+	if(!ticks) {
+		LIST_INSERT_HEAD(&wheel.zero, timer, entry);
+		timerArm(0);
+		return;
+	}
+
+	timerLink(timer);
+	timerArm(timer->expires);
+}
+
+
+static void timerUnlink(struct mpls_timer *timer)
+{
+	if(!timer->active)
+		return;
+
+	LIST_REMOVE(timer, entry);
+	timer->active = 0;
+	wheel.count--;
+}
+
+
+/* moves the timers of a slot one level down, the first level is 0 */
+static int timerCascade(int level)
+{
+	int index;
+	struct mpls_timer *timer;
+	struct timerList_s *list;
+
+	index = (wheel.now >> (MPLS_TIMER_BITS0 + level * MPLS_TIMER_BITSN)) & (MPLS_TIMER_SLOTSN - 1);
+	list = &wheel.slotN[level][index];
+	while((timer = LIST_FIRST(list))) {
+		LIST_REMOVE(timer, entry);
+		timerLink(timer);
 	}
+
+	return index;
 }
 
-static void timer_handler(int fd, short event, void *arg)
+
+/* next tick a slot of the first level has to run or a cascade is due */
+static uint64_t timerNext()
+{
+	uint64_t tick, end;
+
+	end = (wheel.now | (MPLS_TIMER_SLOTS0 - 1)) + 1;
+	for(tick = wheel.now; tick < end; tick++)
+		if(LIST_FIRST(&wheel.slot0[tick & (MPLS_TIMER_SLOTS0 - 1)]))
+			break;
+
+	return tick;
+}
+
+
+static void timerTick(int fd, short event, void *arg)
 {
+	int level;
+	uint64_t now;
 	struct mpls_timer *timer;
+	struct timerList_s *list, zero;
+
+	wheel.armed = 0;
+	wheel.running = 1;
+	now = timerClock();
+
+	/* zero timers restarted by their handler wait for the next pass */
+	LIST_INIT(&zero);
+	while((timer = LIST_FIRST(&wheel.zero))) {
+		LIST_REMOVE(timer, entry);
+		LIST_INSERT_HEAD(&zero, timer, entry);
+	}
+	while((timer = LIST_FIRST(&zero))) {
+		timerUnlink(timer);
+		if(timer->type == MPLS_TIMER_REOCCURRING)
+			timerSchedule(timer);
+		if(timer->handler)
+			timer->handler(timer, timer->extra, timer->cfg);
+	}
+
+	while(wheel.now <= now && wheel.count) {
+		if(!(wheel.now & (MPLS_TIMER_SLOTS0 - 1)))
+			for(level = 0; level < MPLS_TIMER_LEVELS && !timerCascade(level); level++)
+				;
+
+		list = &wheel.slot0[wheel.now & (MPLS_TIMER_SLOTS0 - 1)];
+		while((timer = LIST_FIRST(list))) {
+			/* the handler may restart, stop or delete the timer */
+			timerUnlink(timer);
+			if(timer->type == MPLS_TIMER_REOCCURRING)
+				timerSchedule(timer);
+			if(timer->handler)
+				timer->handler(timer, timer->extra, timer->cfg);
+		}
 
-	timer = (struct mpls_timer *)arg;
-	if(timer->active && timer->handler) {
-		timer->handler(timer, timer->extra, timer->cfg);
-		if(timer->type == MPLS_TIMER_REOCCURRING) {
-			mpls_timer_start(0, timer, MPLS_TIMER_REOCCURRING);
-		} else
-			mpls_timer_stop(0, timer);
+		wheel.now++;
 	}
+	wheel.running = 0;
+
+	if(LIST_FIRST(&wheel.zero))
+		timerArm(0);
+	else if(wheel.count)
+		timerArm(timerNext());
+
+	ldp_cfg_flush(ldp->config);
+	mpls_flush();
 }
 
+/* the wheel outlives LDP restarts, timers left running keep firing */
 mpls_timer_mgr_handle mpls_timer_open(mpls_instance_handle user_data)
 {
+	int i, j;
+
+	if(wheel.open)
+		return 0xdeadbeef;
+
+	mpls_mm_name(sizeof(struct mpls_timer), "timer");
+
+	LIST_INIT(&wheel.zero);
+	for(i = 0; i < MPLS_TIMER_SLOTS0; i++)
+		LIST_INIT(&wheel.slot0[i]);
+	for(i = 0; i < MPLS_TIMER_LEVELS; i++)
+		for(j = 0; j < MPLS_TIMER_SLOTSN; j++)
+			LIST_INIT(&wheel.slotN[i][j]);
+
+	evtimer_set(&wheel.ev, timerTick, NULL);
+	wheel.now = timerClock();
+	wheel.open = 1;
+
 	return 0xdeadbeef;
 }
 
@@ -56,7 +293,7 @@ void mpls_timer_close(mpls_timer_mgr_handle handle)
 {
 }
 
-mpls_timer_handle mpls_timer_create(mpls_timer_mgr_handle handle, mpls_time_unit_enum unit, int duration, void *extra, mpls_cfg_handle cfg, 
+mpls_timer_handle mpls_timer_create(mpls_timer_mgr_handle handle, mpls_time_unit_enum unit, int duration, void *extra, mpls_cfg_handle cfg,
 				void (*callback)(mpls_timer_handle timer, void *extra, mpls_cfg_handle cfg))
 {
 	struct mpls_timer *timer;
@@ -67,61 +304,59 @@ mpls_timer_handle mpls_timer_create(mpls_timer_mgr_handle handle, mpls_time_unit
 
 	timer->unit = unit;
 	timer->duration = duration;
+	timer->jitter = 0;
 	timer->extra = extra;
 	timer->cfg = cfg;
 	timer->handler = callback;
 	timer->active = 0;
-	evtimer_set(&timer->ev, timer_handler, timer);
 
 	return timer;
 }
 
 mpls_return_enum mpls_timer_modify(mpls_timer_mgr_handle handle, mpls_timer_handle timer, int duration)
 {
-	struct timeval  tv;
-
 	if(!timer)
 		return MPLS_FAILURE;
 
 	timer->duration = duration;
-	if(timer->active) {
-		if(evtimer_del(&timer->ev) == -1)
-			return MPLS_FAILURE;
-		setupTimeval(&tv, timer->unit, timer->duration);
-		if(evtimer_add(&timer->ev, &tv) == -1)
-			return MPLS_FAILURE;
-	}
+	if(timer->active)
+		timerSchedule(timer);
 
 	return MPLS_SUCCESS;
 }
 
-void mpls_timer_delete(mpls_timer_mgr_handle handle, mpls_timer_handle timer)
+void mpls_timer_jitter(mpls_timer_mgr_handle handle, mpls_timer_handle timer, int percent)
 {
 	if(timer)
+		timer->jitter = percent < 0 ? 0 : percent > 100 ? 100 : percent;
+}
+
+void mpls_timer_delete(mpls_timer_mgr_handle handle, mpls_timer_handle timer)
+{
+	if(timer) {
+		timerUnlink(timer);
 		mpls_free(timer);
+	}
 }
 
 mpls_return_enum mpls_timer_start(mpls_timer_mgr_handle handle, mpls_timer_handle timer, mpls_timer_type_enum type)
 {
-	struct timeval tv;
-
 	if(!timer)
 		return MPLS_FAILURE;
 
 	timer->type = type;
-	timer->active = 1;
-
-	setupTimeval(&tv, timer->unit, timer->duration);
-	if(evtimer_add(&timer->ev, &tv) == -1)
-		return MPLS_FAILURE;
+	timerSchedule(timer);
 
 	return MPLS_SUCCESS;
 }
 
 void mpls_timer_stop(mpls_timer_mgr_handle handle, mpls_timer_handle timer)
 {
-	if(timer && timer->active) {
-		evtimer_del(&timer->ev);
-		timer->active = 0;
-	}
+	if(timer)
+		timerUnlink(timer);
+}
+
+uint32_t mpls_timer_get_msec(mpls_timer_mgr_handle handle)
+{
+	return timerMsec();
 }
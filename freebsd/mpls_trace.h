@@ -6,6 +6,56 @@ extern uint8_t trace_buffer[16834];
 extern int trace_buffer_len;
 
 
+/*
+ * Binary log ring, see mpls_trace_impl.c. A record keeps the format
+ * string and up to MPLS_LOG_ARGS 32 bit arguments, formatting is left
+ * to the drain. Formats may only use integer conversions, no %s, which
+ * MPLS_LOG enforces at compile time by checking fmt against its
+ * arguments as printf would. Records above MPLS_LOG_LEVEL are compiled
+ * out (make LOG_LEVEL=n).
+ */
+#define MPLS_LOG_ERROR	0
+#define MPLS_LOG_WARN	1
+#define MPLS_LOG_INFO	2
+#define MPLS_LOG_DEBUG	3
+#define MPLS_LOG_TRACE	4	/* LDP_ENTER, LDP_EXIT and LDP_PRINT */
+
+#ifndef MPLS_LOG_LEVEL
+#define MPLS_LOG_LEVEL	MPLS_LOG_DEBUG
+#endif
+
+#define MPLS_LOG_ARGS	4
+
+void mpls_log_write(int level, const char *fmt, int count, const uint32_t *args);
+
+/* never called, only gives the compiler the format to check */
+static inline void __attribute__((format(printf, 1, 2))) mpls_log_check(const char *fmt, ...)
+{
+}
+
+#define MPLS_LOG(level, fmt, args...) {											\
+	if((level) <= MPLS_LOG_LEVEL) {												\
+		uint32_t _args[] = { 0, ##args };										\
+		_Static_assert(sizeof(_args) / sizeof(_args[0]) - 1 <= MPLS_LOG_ARGS,	\
+			"too many MPLS_LOG arguments");										\
+		_Pragma("GCC diagnostic push")											\
+		_Pragma("GCC diagnostic error \"-Wformat\"")							\
+		if(0)																	\
+			mpls_log_check(fmt, ##args);										\
+		_Pragma("GCC diagnostic pop")											\
+		mpls_log_write(level, fmt, sizeof(_args) / sizeof(_args[0]) - 1, _args + 1);	\
+	}																			\
+}
+
+
+/*
+ * LDP_TRACE_LOG stays a direct snprintf and printf and does not go through
+ * the ring. Its callers pass session names and pointers with %s and %p,
+ * which the ring cannot keep, and converting them to integer formats
+ * would lose what the traces are read for. They only cost a flag test
+ * unless tracing is turned on with -v, which the daemon clears unless
+ * started with -d.
+ */
 #define LDP_TRACE_OUT(handle, args...) {																					\
 	if(ldp_traceflags & LDP_TRACE_FLAG_DEBUG) {																				\
 		if(trace_buffer_len == 0) {																							\
@@ -40,6 +90,7 @@ extern int trace_buffer_len;
 	}												\
 }
 
+#if MPLS_LOG_LEVEL >= MPLS_LOG_TRACE
 #define LDP_PRINT(data, args...) {				\
 	if(ldp_traceflags & LDP_TRACE_FLAG_DEBUG) {	\
 		printf("Debug: PRT: " args);			\
@@ -59,5 +110,11 @@ extern int trace_buffer_len;
 		printf("\n");							\
 	}											\
 }
+#else
+/* not a runtime switch, -v only prints these from a LOG_LEVEL=4 build */
+#define LDP_PRINT(data, args...)
+#define LDP_ENTER(data, args...)
+#define LDP_EXIT(data, args...)
+#endif
 
 #endif
@@ -0,0 +1,176 @@
+#include "ldpd.h"
+#include "control.h"
+
+
+/*
+ * Binary log ring. mpls_log_write only copies the format pointer, the
+ * arguments and a coarse timestamp into the next slot, the oldest record
+ * is overwritten once the ring is full. Formatting happens in the drain,
+ * which runs from a timer armed by the first record after a drain, prints
+ * what is at or below the print level and streams it to following
+ * control clients. Everything runs in the event loop, so the ring needs
+ * no locking.
+ */
+
+#define MPLS_LOG_RING		8192		/* records, power of 2 */
+#define MPLS_LOG_DRAIN		100			/* ms */
+
+typedef struct logRecord_s {
+	struct timespec	time;
+	const char		*fmt;
+	uint32_t		level;
+	uint32_t		args[MPLS_LOG_ARGS];
+} logRecord_t;
+
+static struct {
+	logRecord_t		ring[MPLS_LOG_RING];
+	uint64_t		head;		/* records written */
+	uint64_t		drained;	/* records seen by the drain */
+	int				open;
+	int				armed;
+	struct event	ev;
+} logRing;
+
+static const char *levelNames[] = { "Error", "Warning", "Info", "Debug", "Trace" };
+
+
+static void Log_Format(uint64_t seq, msgLogRecord_t *msg)
+{
+	logRecord_t *rec;
+
+	rec = &logRing.ring[seq & (MPLS_LOG_RING - 1)];
+
+	memset(msg, 0, sizeof(*msg));
+	msg->seq = seq;
+	msg->sec = rec->time.tv_sec;
+	msg->usec = rec->time.tv_nsec / 1000;
+	msg->level = rec->level;
+	snprintf(msg->text, sizeof(msg->text), rec->fmt, rec->args[0], rec->args[1], rec->args[2], rec->args[3]);
+}
+
+
+/* first record still in the ring */
+static uint64_t Log_Oldest()
+{
+	return logRing.head > MPLS_LOG_RING ? logRing.head - MPLS_LOG_RING : 0;
+}
+
+
+static void Log_Drain(int fd, short event, void *arg)
+{
+	int level;
+	uint64_t seq;
+	msgLogRecord_t msg;
+
+	logRing.armed = 0;
+
+	/* records overwritten before the drain saw them leave a gap in seq */
+	seq = Log_Oldest();
+	if(logRing.drained < seq)
+		logRing.drained = seq;
+
+	level = ldp_traceflags & LDP_TRACE_FLAG_DEBUG ? MPLS_LOG_TRACE : MPLS_LOG_INFO;
+	for(; logRing.drained != logRing.head; logRing.drained++) {
+		Log_Format(logRing.drained, &msg);
+		if(msg.level <= level)
+			printf("%s: %s\n", levelNames[msg.level], msg.text);
+		Control_Follow(COMMAND_FOLLOW_LOG, &msg, sizeof(msg));
+	}
+
+	Control_FollowFlush();
+	fflush(stdout);
+}
+
+
+void mpls_log_write(int level, const char *fmt, int count, const uint32_t *args)
+{
+	int i;
+	struct timeval tv;
+	logRecord_t *rec;
+
+	rec = &logRing.ring[logRing.head++ & (MPLS_LOG_RING - 1)];
+	clock_gettime(CLOCK_MONOTONIC_FAST, &rec->time);
+	rec->fmt = fmt;
+	rec->level = level;
+	for(i = 0; i < count && i < MPLS_LOG_ARGS; i++)
+		rec->args[i] = args[i];
+	for(; i < MPLS_LOG_ARGS; i++)
+		rec->args[i] = 0;
+
+	if(!logRing.armed && logRing.open) {
+		tv.tv_sec = 0;
+		tv.tv_usec = MPLS_LOG_DRAIN * 1000;
+		logRing.armed = evtimer_add(&logRing.ev, &tv) == 0;
+	}
+}
+
+
+/*
+==============
+mpls_log_init
+==============
+*/
+void mpls_log_init()
+{
+	struct timeval tv;
+
+	evtimer_set(&logRing.ev, Log_Drain, NULL);
+	logRing.open = 1;
+
+	/* records written before the event loop existed */
+	if(logRing.head != logRing.drained) {
+		timerclear(&tv);
+		logRing.armed = evtimer_add(&logRing.ev, &tv) == 0;
+	}
+}
+
+
+/* drains what is left, the ring keeps taking records */
+void mpls_log_flush()
+{
+	if(logRing.armed)
+		evtimer_del(&logRing.ev);
+	Log_Drain(-1, 0, NULL);
+}
+
+
+/*
+==============
+mpls_log_show
+
+Sends the records in the ring when the answer started, oldest first.
+Those overwritten before the client read them are skipped. Following
+clients get every record from the next drain on, seq tells where they
+overlap.
+==============
+*/
+int mpls_log_show(client_t *client, controlCursor_t *cursor)
+{
+	uint64_t oldest;
+	uint32_t count;
+	msgLogRecord_t msg;
+
+	if(!cursor->started) {
+		cursor->index = Log_Oldest();
+		count = logRing.head - cursor->index;
+		Control_Write(client, &count, sizeof(count));
+		cursor->left = count;
+		cursor->started = 1;
+	}
+
+	oldest = Log_Oldest();
+	if(cursor->index < oldest) {
+		if(oldest - cursor->index >= cursor->left)
+			cursor->left = 0;
+		else
+			cursor->left -= oldest - cursor->index;
+		cursor->index = oldest;
+	}
+
+	for(; cursor->left && Control_Room(client); cursor->index++, cursor->left--) {
+		Log_Format(cursor->index, &msg);
+		Control_Write(client, &msg, sizeof(msg));
+	}
+
+	return cursor->left != 0;
+}
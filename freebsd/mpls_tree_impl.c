@@ -1,31 +1,158 @@
 #include "ldpd.h"
 
 
+/*
+ * Path-compressed binary radix tree keyed on (prefix, length), with keys
+ * in host byte order. Nodes without info are glue nodes that only join
+ * two subtrees. Every operation walks at most one node per prefix bit.
+ * Nodes are carved out of pooled chunks and recycled through a free list.
+ */
+
+#define MPLS_TREE_CHUNK	256
+
 struct mpls_tree_node {
-	RB_ENTRY(mpls_tree_node)	node;
-	uint32_t					key;
-	int							length;
-	void						*info;
+	struct mpls_tree_node	*parent;
+	struct mpls_tree_node	*child[2];
+	uint32_t				key;
+	int						length;
+	int						used;		/* carries info, not a glue node */
+	void					*info;
 };
 
+struct mpls_tree_chunk {
+	struct mpls_tree_chunk	*next;
+	struct mpls_tree_node	nodes[MPLS_TREE_CHUNK];
+};
+
+struct mpls_tree {
+	struct mpls_tree_node	*root;
+	struct mpls_tree_node	*free;
+	struct mpls_tree_chunk	*chunks;
+	int						depth;
+};
+
+
+static uint32_t mpls_tree_mask(int length)
+{
+	return length ? (0xFFFFFFFF << (32 - length)) : 0;
+}
+
+
+/* bit of key right below the first length bits */
+static int mpls_tree_bit(uint32_t key, int length)
+{
+	return (key >> (31 - length)) & 1;
+}
+
+
+/* number of leading bits a and b have in common, at most length */
+static int mpls_tree_common(uint32_t a, uint32_t b, int length)
+{
+	int i;
+	uint32_t diff;
+
+	diff = a ^ b;
+	for(i = 0; i < length; i++)
+		if(diff & (0x80000000 >> i))
+			break;
+
+	return i;
+}
+
+
+static struct mpls_tree_node *mpls_tree_node_alloc(struct mpls_tree *tree, uint32_t key, int length)
+{
+	int i;
+	struct mpls_tree_node *node;
+	struct mpls_tree_chunk *chunk;
+
+	if(!tree->free) {
+		chunk = mpls_malloc(sizeof(struct mpls_tree_chunk));
+		if(!chunk)
+			return NULL;
+		chunk->next = tree->chunks;
+		tree->chunks = chunk;
+		for(i = 0; i < MPLS_TREE_CHUNK; i++) {
+			chunk->nodes[i].parent = tree->free;
+			tree->free = &chunk->nodes[i];
+		}
+	}
+
+	node = tree->free;
+	tree->free = node->parent;
+
+	memset(node, 0, sizeof(struct mpls_tree_node));
+	node->key = key & mpls_tree_mask(length);
+	node->length = length;
+
+	return node;
+}
+
+
+static void mpls_tree_node_free(struct mpls_tree *tree, struct mpls_tree_node *node)
+{
+	node->parent = tree->free;
+	tree->free = node;
+}
+
+
+/* put node in place of old in the parent of old */
+static void mpls_tree_link(struct mpls_tree *tree, struct mpls_tree_node *old, struct mpls_tree_node *node)
+{
+	struct mpls_tree_node *parent;
+
+	parent = old->parent;
+	if(node)
+		node->parent = parent;
+
+	if(!parent)
+		tree->root = node;
+	else if(parent->child[0] == old)
+		parent->child[0] = node;
+	else
+		parent->child[1] = node;
+}
+
 
-static int mpls_tree_node_compare(struct mpls_tree_node *a, struct mpls_tree_node *b)
+static struct mpls_tree_node *mpls_tree_find(struct mpls_tree *tree, uint32_t key, int length)
 {
-	if(ntohl(a->key) < ntohl(b->key))
-		return (-1);
-	if(ntohl(a->key) > ntohl(b->key))
-		return (1);
-	if(a->length < b->length)
-		return (-1);
-	if(a->length > b->length)
-		return (1);
-	return (0);
+	struct mpls_tree_node *node;
+
+	key &= mpls_tree_mask(length);
+	node = tree->root;
+	while(node && node->length <= length) {
+		if((key & mpls_tree_mask(node->length)) != node->key)
+			return NULL;
+		if(node->length == length)
+			return node->used ? node : NULL;
+		node = node->child[mpls_tree_bit(key, node->length)];
+	}
+
+	return NULL;
 }
 
 
-typedef RB_HEAD(mpls_tree, mpls_tree_node) mpls_tree;
-RB_PROTOTYPE(mpls_tree, mpls_tree_node, node, mpls_tree_node_compare)
-RB_GENERATE(mpls_tree, mpls_tree_node, node, mpls_tree_node_compare)
+/* pre-order successor, which is the next node in (key, length) order */
+static struct mpls_tree_node *mpls_tree_next(struct mpls_tree_node *node)
+{
+	struct mpls_tree_node *parent;
+
+	do {
+		if(node->child[0])
+			node = node->child[0];
+		else if(node->child[1])
+			node = node->child[1];
+		else {
+			while((parent = node->parent) && (parent->child[1] == node || !parent->child[1]))
+				node = parent;
+			if(!parent)
+				return NULL;
+			node = parent->child[1];
+		}
+	} while(!node->used);
+
+	return node;
+}
 
 
 mpls_tree_handle mpls_tree_create(int depth)
@@ -33,8 +160,10 @@ mpls_tree_handle mpls_tree_create(int depth)
 	struct mpls_tree *tree;
 
 	tree = mpls_malloc(sizeof(struct mpls_tree));
-	if(tree)
-		RB_INIT(tree);
+	if(tree) {
+		memset(tree, 0, sizeof(struct mpls_tree));
+		tree->depth = depth;
+	}
 
 	return tree;
 }
@@ -42,40 +171,101 @@ mpls_tree_handle mpls_tree_create(int depth)
 
 mpls_return_enum mpls_tree_insert(mpls_tree_handle tree, uint32_t key, int length, void *info)
 {
-	struct mpls_tree_node *node;
+	int common, bit;
+	struct mpls_tree_node *node, *parent, *new, *glue;
 
-	node = mpls_malloc(sizeof(struct mpls_tree_node));
-	node->key = key;
-	node->length = length;
-	node->info = info;
-	if(RB_INSERT(mpls_tree, tree, node) != NULL)
+	if(length < 0 || length > 32)
 		return MPLS_FAILURE;
 
-	return MPLS_SUCCESS;
-}
+	key &= mpls_tree_mask(length);
+	parent = NULL;
+	node = tree->root;
+	while(node && node->length <= length && (key & mpls_tree_mask(node->length)) == node->key) {
+		if(node->length == length) {
+			if(node->used)
+				return MPLS_FAILURE;
+			/* glue node becomes a real one */
+			node->used = 1;
+			node->info = info;
+			return MPLS_SUCCESS;
+		}
+		parent = node;
+		node = node->child[mpls_tree_bit(key, node->length)];
+	}
 
+	new = mpls_tree_node_alloc(tree, key, length);
+	if(!new)
+		return MPLS_FAILURE;
+	new->used = 1;
+	new->info = info;
+
+	if(!node) {
+		/* empty slot below parent */
+		new->parent = parent;
+		if(!parent)
+			tree->root = new;
+		else
+			parent->child[mpls_tree_bit(key, parent->length)] = new;
+		return MPLS_SUCCESS;
+	}
 
-static struct mpls_tree_node *mpls_tree_find(struct mpls_tree *tree, uint32_t key, int length)
-{
-	struct mpls_tree_node query;
+	common = mpls_tree_common(key, node->key, length < node->length ? length : node->length);
+	if(common == length) {
+		/* new prefix covers node */
+		mpls_tree_link(tree, node, new);
+		new->child[mpls_tree_bit(node->key, length)] = node;
+		node->parent = new;
+		return MPLS_SUCCESS;
+	}
+
+	/* prefixes diverge, join them under a glue node */
+	glue = mpls_tree_node_alloc(tree, key, common);
+	if(!glue) {
+		mpls_tree_node_free(tree, new);
+		return MPLS_FAILURE;
+	}
 
-	query.key = key;
-	query.length = length;
-	return RB_FIND(mpls_tree, tree, &query);
+	mpls_tree_link(tree, node, glue);
+	bit = mpls_tree_bit(key, common);
+	glue->child[bit] = new;
+	glue->child[!bit] = node;
+	new->parent = glue;
+	node->parent = glue;
+
+	return MPLS_SUCCESS;
 }
 
 
 mpls_return_enum mpls_tree_remove(mpls_tree_handle tree, uint32_t key, int length, void **info)
 {
-	struct mpls_tree_node *node;
+	struct mpls_tree_node *node, *child, *parent;
 
 	node = mpls_tree_find(tree, key, length);
 	if(!node)
 		return MPLS_FAILURE;
+
 	*info = node->info;
-	RB_REMOVE(mpls_tree, tree, node);
-	mpls_free(node);
-	
+	node->info = NULL;
+	node->used = 0;
+
+	/* a node with two children stays as glue */
+	if(node->child[0] && node->child[1])
+		return MPLS_SUCCESS;
+
+	parent = node->parent;
+	child = node->child[0] ? node->child[0] : node->child[1];
+	mpls_tree_link(tree, node, child);
+	mpls_tree_node_free(tree, node);
+
+	/* a glue parent left with one child is not needed anymore */
+	if(parent && !parent->used) {
+		child = parent->child[0] ? parent->child[0] : parent->child[1];
+		if(!parent->child[0] || !parent->child[1]) {
+			mpls_tree_link(tree, parent, child);
+			mpls_tree_node_free(tree, parent);
+		}
+	}
+
 	return MPLS_SUCCESS;
 }
 
@@ -111,14 +301,22 @@ mpls_return_enum mpls_tree_get(mpls_tree_handle tree, uint32_t key, int length,
 
 mpls_return_enum mpls_tree_get_longest(mpls_tree_handle tree, uint32_t key, void **info)
 {
-	struct mpls_tree_node *node;
+	struct mpls_tree_node *node, *best;
+
+	best = NULL;
+	node = tree->root;
+	while(node && (key & mpls_tree_mask(node->length)) == node->key) {
+		if(node->used)
+			best = node;
+		if(node->length == 32)
+			break;
+		node = node->child[mpls_tree_bit(key, node->length)];
+	}
 
-	/* is it right? */
-	node = mpls_tree_find(tree, key, 0);
-	if(!node)
+	if(!best)
 		return MPLS_FAILURE;
 
-	*info = node->info;
+	*info = best->info;
 
 	return MPLS_SUCCESS;
 }
@@ -128,7 +326,11 @@ void mpls_tree_dump(const mpls_tree_handle tree, mpls_tree_dump_callback callbac
 {
 	struct mpls_tree_node *node;
 
-	RB_FOREACH(node, mpls_tree, tree) {
+	node = tree->root;
+	if(node && !node->used)
+		node = mpls_tree_next(node);
+
+	for(; node; node = mpls_tree_next(node)) {
 		if(callback)
 			callback(&node->key);
 	}
@@ -137,13 +339,17 @@ void mpls_tree_dump(const mpls_tree_handle tree, mpls_tree_dump_callback callbac
 
 void mpls_tree_delete(mpls_tree_handle tree)
 {
-	struct mpls_tree_node *node, *next;
+	struct mpls_tree_chunk *chunk, *next;
 
-	for(node = RB_MIN(mpls_tree, tree); node != NULL; node = next) {
-		next = RB_NEXT(mpls_tree, tree, node);
-		RB_REMOVE(mpls_tree, tree, node);
-		mpls_free(node);
+	if(!tree)
+		return;
+
+	for(chunk = tree->chunks; chunk; chunk = next) {
+		next = chunk->next;
+		mpls_free(chunk);
 	}
+
+	mpls_free(tree);
 }
 
 
@@ -151,7 +357,9 @@ mpls_return_enum mpls_tree_getfirst(mpls_tree_handle tree, uint32_t *key, int *l
 {
 	struct mpls_tree_node *node;
 
-	node = RB_MIN(mpls_tree, tree);
+	node = tree->root;
+	if(node && !node->used)
+		node = mpls_tree_next(node);
 	if(!node)
 		return MPLS_FAILURE;
 
@@ -171,7 +379,7 @@ mpls_return_enum mpls_tree_getnext(mpls_tree_handle tree, uint32_t *key, int *le
 	if(!node)
 		return MPLS_FAILURE;
 
-	node = RB_NEXT(mpls_tree, tree, node);
+	node = mpls_tree_next(node);
 	if(!node)
 		return MPLS_FAILURE;
 
@@ -13,6 +13,43 @@ static struct event ev;
 static int fd = -1;
 
 
+/*
+ * Route updates are not handed to LDP one at a time. Every prefix has
+ * one pending entry while the batch window is open, with one entry per
+ * path (nexthop) of the route that keeps the last update seen for it,
+ * and only the net change is applied when the window closes. A path
+ * that flaps inside the window costs nothing. RTM_CHANGE replaces the
+ * whole path set of the prefix with the nexthop it carries. Queued
+ * nexthops keep the interface index, the interface is looked up when the
+ * update is applied since it may depart while the window is open.
+ */
+typedef struct pathUpdate_s {
+	struct mpls_nexthop			nexthop;		/* without if_handle */
+	int							ifindex;
+	int							lastType;		/* RTM_ADD or RTM_DELETE */
+	TAILQ_ENTRY(pathUpdate_s)	entry;
+} pathUpdate_t;
+
+typedef struct routeUpdate_s {
+	prefix_t					prefix;
+	int							replace;		/* RTM_CHANGE seen */
+	struct mpls_nexthop			replaceNexthop;
+	int							replaceIfindex;
+	uint32_t					count;			/* updates merged into this one */
+	TAILQ_HEAD(, pathUpdate_s)	paths;
+	TAILQ_ENTRY(routeUpdate_s)	entry;
+} routeUpdate_t;
+
+static TAILQ_HEAD(routeUpdateList_s, routeUpdate_s) pending = TAILQ_HEAD_INITIALIZER(pending);
+static mpls_tree_handle pendingTree;
+static struct event batchEv;
+static int batchMsec = KERNEL_DEF_ROUTE_BATCH;
+
+static uint32_t updatesReceived;
+static uint32_t updatesCoalesced;	/* never reached LDP */
+static uint32_t updatesApplied;
+
+
 static void prefix2mpls_fec(prefix_t *prefix, mpls_fec *fec)
 {
 	fec->type = MPLS_FEC_PREFIX;
@@ -62,6 +99,274 @@ static void GetAddresses(int addrs, struct sockaddr *sa, struct sockaddr **rti_i
 }  
 
 
+static int SameNexthop(pathUpdate_t *path, struct mpls_nexthop *nexthop, int ifindex)
+{
+	return path->nexthop.ip.u.ipv4 == nexthop->ip.u.ipv4 && path->ifindex == ifindex &&
+		path->nexthop.attached == nexthop->attached;
+}
+
+
+/* fills in the interface of a nexthop, if it is still there */
+static struct mpls_nexthop *ResolveNexthop(struct mpls_nexthop *nexthop, int ifindex, struct mpls_nexthop *resolved)
+{
+	*resolved = *nexthop;
+	resolved->type &= ~MPLS_NH_IF;
+	if((resolved->if_handle = Interface_FindByIndex(ifindex)))
+		resolved->type |= MPLS_NH_IF;
+
+	return resolved;
+}
+
+
+/*
+==============
+RouteAddPath
+
+Adds a path to the route of prefix, creating the FEC for its first one.
+Returns 0 when the path was there already.
+==============
+*/
+static int RouteAddPath(prefix_t *prefix, struct mpls_nexthop *nexthop)
+{
+	struct mpls_fec fec;
+	struct mpls_nexthop ldpNexthop;
+
+	ldpNexthop = *nexthop;
+	prefix2mpls_fec(prefix, &fec);
+	if(ldp_cfg_fec_get(ldp->config, &fec, 0) != MPLS_SUCCESS || fec.is_route == MPLS_BOOL_FALSE)
+		if(ldp_cfg_fec_set(ldp->config, &fec, LDP_CFG_ADD) != MPLS_SUCCESS)
+			MPLS_ASSERT(0);
+
+	if(ldp_cfg_fec_nexthop_get(ldp->config, &fec, &ldpNexthop, LDP_FEC_CFG_BY_INDEX) == MPLS_SUCCESS)
+		return 0;
+
+	if(ldp_cfg_fec_nexthop_set(ldp->config, &fec, &ldpNexthop, LDP_CFG_ADD | LDP_FEC_CFG_BY_INDEX) != MPLS_SUCCESS)
+		MPLS_ASSERT(0);
+
+	return 1;
+}
+
+
+/* removes the FEC of a route once its last path is gone */
+static void RouteDeleteIfEmpty(struct mpls_fec *fec)
+{
+	struct mpls_nexthop ldpNexthop;
+
+	ldpNexthop.index = 0;
+	if(ldp_cfg_fec_nexthop_getnext(ldp->config, fec, &ldpNexthop, LDP_FEC_CFG_BY_INDEX) == MPLS_SUCCESS)
+		return;
+
+	if(ldp_cfg_fec_set(ldp->config, fec, LDP_CFG_DEL | LDP_FEC_CFG_BY_INDEX) != MPLS_SUCCESS)
+		MPLS_ASSERT(0);
+}
+
+
+/*
+==============
+RouteDeletePath
+
+Removes a path from the route of prefix, and the FEC with its last one.
+Returns 0 when there was no such path.
+==============
+*/
+static int RouteDeletePath(prefix_t *prefix, struct mpls_nexthop *nexthop)
+{
+	struct mpls_fec fec;
+	struct mpls_nexthop ldpNexthop;
+
+	ldpNexthop = *nexthop;
+	prefix2mpls_fec(prefix, &fec);
+	if(ldp_cfg_fec_get(ldp->config, &fec, 0) != MPLS_SUCCESS || fec.is_route == MPLS_BOOL_FALSE)
+		return 0;
+
+	if(ldp_cfg_fec_nexthop_get(ldp->config, &fec, &ldpNexthop, LDP_FEC_CFG_BY_INDEX) != MPLS_SUCCESS)
+		return 0;
+
+	if(ldp_cfg_fec_nexthop_set(ldp->config, &fec, &ldpNexthop, LDP_FEC_CFG_BY_INDEX | LDP_CFG_DEL |
+								LDP_FEC_NEXTHOP_CFG_BY_INDEX) != MPLS_SUCCESS)
+		MPLS_ASSERT(0);
+
+	RouteDeleteIfEmpty(&fec);
+
+	return 1;
+}
+
+
+/*
+==============
+RouteReplace
+
+Makes nexthop the only path of the route of prefix. The new path is added
+before the old ones are removed, so the FEC is never without a nexthop.
+==============
+*/
+static int RouteReplace(prefix_t *prefix, struct mpls_nexthop *nexthop)
+{
+	int changed;
+	struct mpls_fec fec;
+	struct mpls_nexthop ldpNexthop;
+
+	changed = RouteAddPath(prefix, nexthop);
+
+	prefix2mpls_fec(prefix, &fec);
+	if(ldp_cfg_fec_get(ldp->config, &fec, 0) != MPLS_SUCCESS)
+		return changed;
+
+	ldpNexthop.index = 0;
+	while(ldp_cfg_fec_nexthop_getnext(ldp->config, &fec, &ldpNexthop, LDP_FEC_CFG_BY_INDEX) == MPLS_SUCCESS) {
+		if(ldpNexthop.ip.u.ipv4 == nexthop->ip.u.ipv4)
+			continue;
+		if(ldp_cfg_fec_nexthop_set(ldp->config, &fec, &ldpNexthop, LDP_FEC_CFG_BY_INDEX | LDP_CFG_DEL |
+									LDP_FEC_NEXTHOP_CFG_BY_INDEX) != MPLS_SUCCESS)
+			MPLS_ASSERT(0);
+		changed = 1;
+	}
+
+	return changed;
+}
+
+
+static void FreeRouteUpdate(routeUpdate_t *update)
+{
+	void *info;
+	pathUpdate_t *path;
+
+	while((path = TAILQ_FIRST(&update->paths))) {
+		TAILQ_REMOVE(&update->paths, path, entry);
+		free(path);
+	}
+
+	TAILQ_REMOVE(&pending, update, entry);
+	mpls_tree_remove(pendingTree, ntohl(update->prefix.prefix.s_addr), update->prefix.length, &info);
+	free(update);
+}
+
+
+/*
+==============
+ApplyRouteUpdates
+
+Closes the batch window and hands the net change of every pending prefix to LDP.
+New paths go in before old ones are taken out, so a route that moves from
+one nexthop to another keeps its FEC and labels.
+==============
+*/
+static void ApplyRouteUpdates(int fd, short event, void *arg)
+{
+	uint32_t applied;
+	routeUpdate_t *update;
+	pathUpdate_t *path;
+	struct mpls_nexthop nexthop;
+
+	evtimer_del(&batchEv);
+
+	while((update = TAILQ_FIRST(&pending))) {
+		applied = 0;
+		if(update->replace)
+			applied += RouteReplace(&update->prefix, ResolveNexthop(&update->replaceNexthop, update->replaceIfindex, &nexthop));
+
+		TAILQ_FOREACH(path, &update->paths, entry)
+			if(path->lastType == RTM_ADD)
+				applied += RouteAddPath(&update->prefix, ResolveNexthop(&path->nexthop, path->ifindex, &nexthop));
+
+		TAILQ_FOREACH(path, &update->paths, entry)
+			if(path->lastType == RTM_DELETE)
+				applied += RouteDeletePath(&update->prefix, ResolveNexthop(&path->nexthop, path->ifindex, &nexthop));
+
+		updatesApplied += applied;
+		if(update->count > applied)
+			updatesCoalesced += update->count - applied;
+
+		FreeRouteUpdate(update);
+	}
+
+	ldp_cfg_flush(ldp->config);
+	mpls_flush();
+}
+
+
+/*
+==============
+QueueRouteUpdate
+
+Type is RTM_ADD or RTM_DELETE for a single path, or RTM_CHANGE for a route
+whose paths are all replaced with nexthop. The nexthop goes out through the
+interface with index ifindex, its if_handle is not used.
+==============
+*/
+static void QueueRouteUpdate(int type, prefix_t *prefix, struct mpls_nexthop *nexthop, int ifindex)
+{
+	struct timeval tv;
+	routeUpdate_t *update;
+	pathUpdate_t *path;
+	struct mpls_nexthop resolved;
+
+	updatesReceived++;
+
+	if(mpls_tree_get(pendingTree, ntohl(prefix->prefix.s_addr), prefix->length, (void **)&update) != MPLS_SUCCESS) {
+		update = malloc(sizeof(routeUpdate_t));
+		if(!update || mpls_tree_insert(pendingTree, ntohl(prefix->prefix.s_addr), prefix->length, update) != MPLS_SUCCESS) {
+			free(update);
+			update = NULL;
+		} else {
+			update->prefix = *prefix;
+			update->replace = 0;
+			update->count = 0;
+			TAILQ_INIT(&update->paths);
+			TAILQ_INSERT_TAIL(&pending, update, entry);
+
+			if(batchMsec && !evtimer_pending(&batchEv, NULL)) {
+				tv.tv_sec = batchMsec / 1000;
+				tv.tv_usec = (batchMsec % 1000) * 1000;
+				evtimer_add(&batchEv, &tv);
+			}
+		}
+	}
+
+	path = NULL;
+	if(update && type != RTM_CHANGE) {
+		TAILQ_FOREACH(path, &update->paths, entry)
+			if(SameNexthop(path, nexthop, ifindex))
+				break;
+		if(!path && (path = malloc(sizeof(pathUpdate_t)))) {
+			path->nexthop = *nexthop;
+			path->nexthop.if_handle = NULL;
+			path->ifindex = ifindex;
+			TAILQ_INSERT_TAIL(&update->paths, path, entry);
+		}
+	}
+
+	if(!update || (type != RTM_CHANGE && !path)) {
+		/* cannot batch it, keep the order and apply it now */
+		ApplyRouteUpdates(-1, 0, NULL);
+		nexthop = ResolveNexthop(nexthop, ifindex, &resolved);
+		if(type == RTM_ADD)
+			RouteAddPath(prefix, nexthop);
+		else if(type == RTM_DELETE)
+			RouteDeletePath(prefix, nexthop);
+		else
+			RouteReplace(prefix, nexthop);
+		updatesApplied++;
+		return;
+	}
+
+	if(type == RTM_CHANGE) {
+		/* the paths queued so far are overridden */
+		while((path = TAILQ_FIRST(&update->paths))) {
+			TAILQ_REMOVE(&update->paths, path, entry);
+			free(path);
+		}
+		update->replace = 1;
+		update->replaceNexthop = *nexthop;
+		update->replaceNexthop.if_handle = NULL;
+		update->replaceIfindex = ifindex;
+	} else
+		path->lastType = type;
+
+	update->count++;
+}
+
+
 /*
 ==============
 ParseRouteUpdate
@@ -73,10 +378,8 @@ static void ParseRouteUpdate(struct rt_msghdr *rtm)
 	struct in_addr nexthop;
 	int ifindex;
 	int isConnected;
-	struct mpls_fec fec;
 	struct mpls_nexthop ldpNexthop;
 	struct sockaddr *sa, *rti_info[RTAX_MAX];
-	struct sockaddr_in *sa_in;
 
 	if(!rtm)
 		return;
@@ -93,20 +396,17 @@ static void ParseRouteUpdate(struct rt_msghdr *rtm)
 	if(rtm->rtm_flags & RTF_LLINFO)	/* arp cache */
 		return;
 
-#ifdef RTF_MPATH
-	if(rtm->rtm_flags & RTF_MPATH)	 /* multipath */
-		return;
-#endif
-
 	switch (sa->sa_family) {
 	case AF_INET:
 		prefix.prefix.s_addr = ((struct sockaddr_in *)sa)->sin_addr.s_addr;
 		prefix.length = PrefixLength((struct sockaddr_in *)rti_info[RTAX_NETMASK], (struct sockaddr_in *)sa, rtm->rtm_flags & RTF_HOST);
 		break;
 	default:
-		break;
+		return;
 	}
 
+	nexthop.s_addr = 0;
+	isConnected = 0;
 	ifindex = rtm->rtm_index;
 	if((sa = rti_info[RTAX_GATEWAY]) != NULL)
 		switch (sa->sa_family) {
@@ -129,31 +429,14 @@ static void ParseRouteUpdate(struct rt_msghdr *rtm)
 	ldpNexthop.distance = 10;
 	ldpNexthop.metric = 10;
 	ldpNexthop.attached = isConnected ? MPLS_BOOL_TRUE : MPLS_BOOL_FALSE;
-	if((ldpNexthop.if_handle = Interface_FindByIndex(ifindex)))
-		ldpNexthop.type |= MPLS_NH_IF;
-
-	prefix2mpls_fec(&prefix, &fec);
-	if(rtm->rtm_type == RTM_ADD || rtm->rtm_type == RTM_GET) {
-		if(ldp_cfg_fec_get(ldp->config, &fec, 0) != MPLS_SUCCESS || fec.is_route == MPLS_BOOL_FALSE) {
-			if(ldp_cfg_fec_set(ldp->config, &fec, LDP_CFG_ADD) != MPLS_SUCCESS)
-				MPLS_ASSERT(0);
-			if(ldp_cfg_fec_nexthop_get(ldp->config, &fec, &ldpNexthop, LDP_FEC_CFG_BY_INDEX) != MPLS_SUCCESS)
-				if(ldp_cfg_fec_nexthop_set(ldp->config, &fec, &ldpNexthop, LDP_CFG_ADD | LDP_FEC_CFG_BY_INDEX) != MPLS_SUCCESS)
-					MPLS_ASSERT(0);
-		}
-	} else if(rtm->rtm_type == RTM_DELETE) {
-		if(ldp_cfg_fec_get(ldp->config, &fec, 0) == MPLS_SUCCESS && fec.is_route == MPLS_BOOL_TRUE) {
-			if(ldp_cfg_fec_nexthop_get(ldp->config, &fec, &ldpNexthop, LDP_FEC_CFG_BY_INDEX) == MPLS_SUCCESS) {
-				if(ldp_cfg_fec_nexthop_set(ldp->config, &fec, &ldpNexthop, LDP_FEC_CFG_BY_INDEX | LDP_CFG_DEL |
-											LDP_FEC_NEXTHOP_CFG_BY_INDEX) != MPLS_SUCCESS)
-					MPLS_ASSERT(0);
-			} else
-				MPLS_ASSERT(0);
-			if(ldp_cfg_fec_set(ldp->config, &fec, LDP_CFG_DEL | LDP_FEC_CFG_BY_INDEX) != MPLS_SUCCESS)
-				MPLS_ASSERT(0);
-		} else
-			MPLS_ASSERT(0);
-	}
+
+	/* every path of a multipath route comes in a message of its own */
+	if(rtm->rtm_type == RTM_ADD || rtm->rtm_type == RTM_GET)
+		QueueRouteUpdate(RTM_ADD, &prefix, &ldpNexthop, ifindex);
+	else if(rtm->rtm_type == RTM_DELETE)
+		QueueRouteUpdate(RTM_DELETE, &prefix, &ldpNexthop, ifindex);
+	else if(rtm->rtm_type == RTM_CHANGE)
+		QueueRouteUpdate(RTM_CHANGE, &prefix, &ldpNexthop, ifindex);
 }
 
 
@@ -411,6 +694,41 @@ static void ProcessMessage(int fd, short event, void *arg)
 			break;
 		}
 	}
+
+	/* without a window updates are still coalesced within one read */
+	if(!batchMsec)
+		ApplyRouteUpdates(-1, 0, NULL);
+
+	ldp_cfg_flush(ldp->config);
+}
+
+
+/*
+==============
+Kernel_SetBatch
+
+Sets the route update batch window in milliseconds, 0 applies updates after every read.
+==============
+*/
+void Kernel_SetBatch(int msec)
+{
+	batchMsec = msec < 0 ? 0 : msec;
+}
+
+
+/* Kernel_GetBatch */
+int Kernel_GetBatch()
+{
+	return batchMsec;
+}
+
+
+/* Kernel_GetStats */
+void Kernel_GetStats(uint32_t *received, uint32_t *coalesced, uint32_t *applied)
+{
+	*received = updatesReceived;
+	*coalesced = updatesCoalesced;
+	*applied = updatesApplied;
 }
 
 
@@ -439,9 +757,18 @@ void Kernel_Init()
 	for(receiveBuffer = MAX_RTSOCK_BUF; receiveBuffer > defaultReceiveBuffer &&
 		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer)) == -1 && errno == ENOBUFS; receiveBuffer /= 2);
 
+	pendingTree = mpls_tree_create(32);
+	if(!pendingTree) {
+		fprintf(stderr, "cannot create route update tree\n");
+		exit(1);
+	}
+	evtimer_set(&batchEv, ApplyRouteUpdates, NULL);
+
 	ReadInterfaces();
 
+	/* the initial table has nothing to coalesce */
 	ReadRoutes();
+	ApplyRouteUpdates(-1, 0, NULL);
 
 	event_set(&ev, fd, EV_READ | EV_PERSIST, ProcessMessage, NULL);
 	event_add(&ev, NULL);
@@ -455,7 +782,15 @@ Kernel_Shutdown
 */
 void Kernel_Shutdown()
 {
+	routeUpdate_t *update;
+
 	event_del(&ev);
+	evtimer_del(&batchEv);
+
+	while((update = TAILQ_FIRST(&pending)))
+		FreeRouteUpdate(update);
+	mpls_tree_delete(pendingTree);
+	pendingTree = NULL;
 
 	if(fd > 0)
 		close(fd);
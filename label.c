@@ -0,0 +1,251 @@
+#include "ldpd.h"
+#include "control.h"
+
+
+/*
+ * Label manager. The 20-bit label space is split into blocks, each with
+ * its own allocator: labels that were never handed out are taken from a
+ * high-water mark, and released ones go to a free stack that is only used
+ * once the block has been walked through, so a label is not reused right
+ * after it has been withdrawn. A bitmap tracks labels in use so double
+ * frees and frees of foreign labels are caught. Alloc and free are O(1).
+ */
+
+typedef struct labelBlock_s {
+	const char	*name;
+	int32_t		min;		/* first label of the block */
+	int32_t		max;		/* last label of the block */
+	int32_t		next;		/* next never used label */
+	int32_t		*free;		/* released labels */
+	uint32_t	freeCount;
+	uint32_t	freeMax;
+	uint8_t		*used;		/* bitmap of labels in use */
+	uint32_t	inUse;		/* current usage */
+	uint32_t	peak;		/* peak usage */
+	uint32_t	allocs;		/* successful allocations */
+	uint32_t	frees;		/* releases */
+	uint32_t	failures;	/* allocations failed with block exhausted */
+} labelBlock_t;
+
+static labelBlock_t blocks[LABEL_BLOCK_NUM] = {
+	{ "reserved",	0,					LABEL_MIN - 1 },
+	{ "vpn",		LABEL_DEF_VPN_MIN,	LABEL_DEF_VPN_MAX },
+	{ "dynamic",	LABEL_DEF_DYN_MIN,	LABEL_DEF_DYN_MAX }
+};
+
+
+static int Label_InitBlock(labelBlock_t *block)
+{
+	uint32_t size;
+
+	free(block->used);
+	free(block->free);
+
+	size = block->max - block->min + 1;
+	block->used = calloc((size + 7) / 8, 1);
+	if(!block->used) {
+		printf("Label_InitBlock: Cannot allocate bitmap for %s block\n", block->name);
+		return -1;
+	}
+
+	block->free = NULL;
+	block->freeCount = 0;
+	block->freeMax = 0;
+	block->next = block->min;
+	block->inUse = 0;
+
+	return 0;
+}
+
+
+static labelBlock_t *Label_FindBlock(int32_t label)
+{
+	int i;
+
+	for(i = LABEL_BLOCK_VPN; i < LABEL_BLOCK_NUM; i++)
+		if(label >= blocks[i].min && label <= blocks[i].max)
+			return &blocks[i];
+
+	return NULL;
+}
+
+
+/*
+==============
+Label_Init
+==============
+*/
+int Label_Init()
+{
+	int i;
+
+	for(i = LABEL_BLOCK_VPN; i < LABEL_BLOCK_NUM; i++)
+		if(Label_InitBlock(&blocks[i]) == -1)
+			return -1;
+
+	return 0;
+}
+
+
+/*
+==============
+Label_SetRange
+
+Changes the range of a block, only allowed while no label of it is in use.
+==============
+*/
+int Label_SetRange(int type, int32_t min, int32_t max)
+{
+	int i;
+	labelBlock_t *block;
+
+	if(type <= LABEL_BLOCK_RESERVED || type >= LABEL_BLOCK_NUM)
+		return -1;
+
+	if(min < LABEL_MIN || max > LABEL_MAX || min > max)
+		return -1;
+
+	block = &blocks[type];
+	if(block->min == min && block->max == max)
+		return 0;
+
+	if(block->inUse) {
+		printf("Label_SetRange: %s block is in use, range is not changed\n", block->name);
+		return -1;
+	}
+
+	for(i = LABEL_BLOCK_VPN; i < LABEL_BLOCK_NUM; i++)
+		if(i != type && min <= blocks[i].max && max >= blocks[i].min) {
+			printf("Label_SetRange: %s block overlaps %s block\n", block->name, blocks[i].name);
+			return -1;
+		}
+
+	block->min = min;
+	block->max = max;
+
+	return Label_InitBlock(block);
+}
+
+
+/* Label_GetRange */
+void Label_GetRange(int type, int32_t *min, int32_t *max)
+{
+	*min = blocks[type].min;
+	*max = blocks[type].max;
+}
+
+
+/*
+==============
+Label_Alloc
+==============
+*/
+int32_t Label_Alloc(int type)
+{
+	int32_t label, offset;
+	labelBlock_t *block;
+
+	block = &blocks[type];
+	if(!block->used)
+		return -1;
+
+	if(block->next <= block->max)
+		label = block->next++;
+	else if(block->freeCount)
+		label = block->free[--block->freeCount];
+	else {
+		block->failures++;
+		return -1;
+	}
+
+	offset = label - block->min;
+	block->used[offset >> 3] |= 1 << (offset & 7);
+
+	block->allocs++;
+	if(++block->inUse > block->peak)
+		block->peak = block->inUse;
+
+	return label;
+}
+
+
+/*
+==============
+Label_Free
+==============
+*/
+void Label_Free(int32_t label)
+{
+	int32_t *list, offset;
+	uint32_t size;
+	labelBlock_t *block;
+
+	block = Label_FindBlock(label);
+	if(!block || !block->used)
+		return;
+
+	offset = label - block->min;
+	if(!(block->used[offset >> 3] & (1 << (offset & 7)))) {
+		printf("Label_Free: label %d is not allocated\n", label);
+		return;
+	}
+
+	if(block->freeCount == block->freeMax) {
+		size = block->freeMax ? block->freeMax * 2 : 1024;
+		list = realloc(block->free, size * sizeof(int32_t));
+		if(!list) {
+			/* label is leaked but never handed out twice */
+			printf("Label_Free: Cannot grow free list of %s block\n", block->name);
+			return;
+		}
+		block->free = list;
+		block->freeMax = size;
+	}
+
+	block->used[offset >> 3] &= ~(1 << (offset & 7));
+	block->free[block->freeCount++] = label;
+	block->inUse--;
+	block->frees++;
+}
+
+
+/*
+==============
+Label_ShowBlocks
+==============
+*/
+void Label_ShowBlocks(client_t *client)
+{
+	uint32_t i;
+	msgLabelBlock_t msg;
+
+	i = LABEL_BLOCK_NUM;
+	Control_Write(client, &i, sizeof(i));
+
+	for(i = 0; i < LABEL_BLOCK_NUM; i++) {
+		memset(&msg, 0, sizeof(msg));
+		strlcpy(msg.name, blocks[i].name, sizeof(msg.name));
+		msg.min = blocks[i].min;
+		msg.max = blocks[i].max;
+		msg.inUse = blocks[i].inUse;
+		msg.peak = blocks[i].peak;
+		msg.allocs = blocks[i].allocs;
+		msg.frees = blocks[i].frees;
+		msg.failures = blocks[i].failures;
+		Control_Write(client, &msg, sizeof(msg));
+	}
+}
+
+
+/* Label_Shutdown */
+void Label_Shutdown()
+{
+	int i;
+
+	for(i = LABEL_BLOCK_VPN; i < LABEL_BLOCK_NUM; i++) {
+		free(blocks[i].used);
+		free(blocks[i].free);
+		blocks[i].used = NULL;
+		blocks[i].free = NULL;
+	}
+}
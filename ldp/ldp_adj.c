@@ -50,6 +50,7 @@ ldp_adj *ldp_adj_create(mpls_inet_addr * source, mpls_inet_addr * lsraddr,
     /* these values are learned form the remote peer */
     memcpy(&a->remote_source_address, source, sizeof(mpls_inet_addr));
     memcpy(&a->remote_lsr_address, lsraddr, sizeof(mpls_inet_addr));
+    a->remote_label_space = labelspace;
 
     addr.s_addr = htonl(lsraddr->u.ipv4);
     LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_PERIODIC,
@@ -30,8 +30,6 @@
 
 static ldp_fec *_ldp_attr_get_fec2(ldp_global * g, mpls_fec * f, mpls_bool flag);
 static ldp_fec *_ldp_attr_get_fec(ldp_global * g, ldp_attr * a, mpls_bool flag);
-static ldp_fs *_ldp_fec_add_fs_ds(ldp_fec * fec, ldp_session * s);
-static ldp_fs *_ldp_fec_add_fs_us(ldp_fec * fec, ldp_session * s);
 static ldp_fs *_ldp_fec_find_fs_us(ldp_fec * fec, ldp_session * s,
   mpls_bool flag);
 static ldp_fs *_ldp_fec_find_fs_ds(ldp_fec * fec, ldp_session * s,
@@ -262,7 +260,7 @@ void ldp_attr_remove_complete(ldp_global * g, ldp_attr * attr,
 
         if (out->merge_count > 0) {
           for (i = 0; i < attr->fecTlv.numberFecElements; i++) {
-            fec_tlv2mpls_fec(&attr->fecTlv, i, &fec);
+            ldp_attr2mpls_fec(attr, &fec);
             out->merge_count--;
 #if MPLS_USE_LSR
             {
@@ -339,9 +337,7 @@ ldp_attr *ldp_attr_create(ldp_global *g, mpls_fec * fec)
     a->filtered = MPLS_BOOL_FALSE;
 
     if (fec != NULL) {
-      mpls_fec2fec_tlv(fec, &a->fecTlv, 0);
-      a->fecTlv.numberFecElements = 1;
-      a->fecTlvExists = 1;
+      mpls_fec2ldp_attr(fec, a);
     }
     _ldp_global_add_attr(g, a);
   }
@@ -354,13 +350,63 @@ void ldp_attr_delete(ldp_global *g, ldp_attr * a)
   MPLS_REFCNT_ASSERT(a, 0);
   MPLS_ASSERT(a->in_tree == MPLS_BOOL_FALSE);
   _ldp_global_del_attr(g, a);
+  if (a->ext) {
+    mpls_free(a->ext);
+  }
   mpls_free(a);
 }
 
+const ldp_attr_ext ldp_attr_ext_none;
+
+/* the out of line TLVs of a, allocated on first use, NULL if that fails */
+ldp_attr_ext *ldp_attr_ext_get(ldp_attr * a)
+{
+  if (a->ext == NULL) {
+    a->ext = (ldp_attr_ext *) mpls_malloc(sizeof(ldp_attr_ext));
+    if (a->ext != NULL) {
+      memset(a->ext, 0, sizeof(ldp_attr_ext));
+    }
+  }
+  return a->ext;
+}
+
+void ldp_attr2mpls_fec(ldp_attr * a, mpls_fec * fec)
+{
+  fec_el2mpls_fec(&a->fecTlv.fecElArray[0], a->fecTlv.fecElemTypes[0], fec);
+}
+
+void mpls_fec2ldp_attr(mpls_fec * fec, ldp_attr * a)
+{
+  mpls_fec2fec_el(fec, &a->fecTlv.fecElArray[0], &a->fecTlv.fecElemTypes[0]);
+  a->fecTlv.numberFecElements = 1;
+  a->fecTlvExists = 1;
+}
+
+/* element i of a received FEC TLV becomes the FEC of a */
+void fec_tlv2ldp_attr(mplsLdpFecTlv_t * tlv, int i, ldp_attr * a)
+{
+  memcpy(&a->fecTlv.fecElArray[0], &tlv->fecElArray[i],
+    sizeof(mplsFecElement_t));
+  a->fecTlv.fecElemTypes[0] = tlv->fecElemTypes[i];
+  a->fecTlv.numberFecElements = 1;
+  a->fecTlvExists = 1;
+}
+
+void ldp_attr2fec_tlv(ldp_attr * a, mplsLdpFecTlv_t * tlv)
+{
+  memcpy(&tlv->fecElArray[0], &a->fecTlv.fecElArray[0],
+    sizeof(mplsFecElement_t));
+  tlv->fecElemTypes[0] = a->fecTlv.fecElemTypes[0];
+  tlv->numberFecElements = a->fecTlv.numberFecElements;
+  tlv->wcElemExists = 0;
+}
+
 void ldp_attr2ldp_attr(ldp_attr * a, ldp_attr * b, uint32_t flag)
 {
+  ldp_attr_ext *ext;
+
   if (a->fecTlvExists && flag & LDP_ATTR_FEC) {
-    memcpy(&b->fecTlv, &a->fecTlv, sizeof(mplsLdpFecTlv_t));
+    memcpy(&b->fecTlv, &a->fecTlv, sizeof(ldp_attr_fec_tlv));
     b->fecTlvExists = 1;
   }
   if (a->genLblTlvExists && flag & LDP_ATTR_LABEL) {
@@ -377,20 +423,29 @@ void ldp_attr2ldp_attr(ldp_attr * a, ldp_attr * b, uint32_t flag)
     memcpy(&b->hopCountTlv, &a->hopCountTlv, sizeof(mplsLdpHopTlv_t));
     b->hopCountTlvExists = 1;
   }
-  if (a->pathVecTlvExists && flag & LDP_ATTR_PATH) {
-    memcpy(&b->pathVecTlv, &a->pathVecTlv, sizeof(mplsLdpPathTlv_t));
-    b->pathVecTlvExists = 1;
-  }
   if (a->lblMsgIdTlvExists && flag & LDP_ATTR_MSGID) {
     memcpy(&b->lblMsgIdTlv, &a->lblMsgIdTlv, sizeof(mplsLdpLblMsgIdTlv_t));
     b->lblMsgIdTlvExists = 1;
   }
+
+  if (!(a->pathVecTlvExists && flag & LDP_ATTR_PATH) &&
+    !(a->lspidTlvExists && flag & LDP_ATTR_LSPID) &&
+    !(a->trafficTlvExists && flag & LDP_ATTR_TRAFFIC)) {
+    return;
+  }
+  if ((ext = ldp_attr_ext_get(b)) == NULL) {
+    return;
+  }
+  if (a->pathVecTlvExists && flag & LDP_ATTR_PATH) {
+    memcpy(&ext->pathVecTlv, &a->ext->pathVecTlv, sizeof(mplsLdpPathTlv_t));
+    b->pathVecTlvExists = 1;
+  }
   if (a->lspidTlvExists && flag & LDP_ATTR_LSPID) {
-    memcpy(&b->lspidTlv, &a->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
+    memcpy(&ext->lspidTlv, &a->ext->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
     b->lspidTlvExists = 1;
   }
   if (a->trafficTlvExists && flag & LDP_ATTR_TRAFFIC) {
-    memcpy(&b->trafficTlv, &a->trafficTlv, sizeof(mplsLdpTrafficTlv_t));
+    memcpy(&ext->trafficTlv, &a->ext->trafficTlv, sizeof(mplsLdpTrafficTlv_t));
     b->trafficTlvExists = 1;
   }
 }
@@ -498,7 +553,7 @@ mpls_bool ldp_attr_is_equal(ldp_attr * a, ldp_attr * b, uint32_t flag)
 
     if (a->pathVecTlvExists && b->pathVecTlvExists) {
       for (i = 0; i < MPLS_MAXHOPSNUMBER; i++) {
-        if (a->pathVecTlv.lsrId[i] != b->pathVecTlv.lsrId[i]) {
+        if (a->ext->pathVecTlv.lsrId[i] != b->ext->pathVecTlv.lsrId[i]) {
           return MPLS_BOOL_FALSE;
         }
       }
@@ -554,8 +609,8 @@ mpls_bool ldp_attr_is_equal(ldp_attr * a, ldp_attr * b, uint32_t flag)
   }
   if (flag & LDP_ATTR_LSPID) {
     if (a->lspidTlvExists && b->lspidTlvExists) {
-      if (a->lspidTlv.localCrlspId != b->lspidTlv.localCrlspId ||
-        a->lspidTlv.routerId != b->lspidTlv.routerId) {
+      if (a->ext->lspidTlv.localCrlspId != b->ext->lspidTlv.localCrlspId ||
+        a->ext->lspidTlv.routerId != b->ext->lspidTlv.routerId) {
         return MPLS_BOOL_FALSE;
       }
     } else {
@@ -812,7 +867,7 @@ void mpls_label_struct2ldp_attr(mpls_label_struct * l, ldp_attr * a)
       a->frLblTlv.flags.flags.len = l->u.fr.len;
       a->frLblTlv.flags.flags.dlci = l->u.fr.dlci;
     default:
-	  printf("label type %d\n", l->type);
+      MPLS_LOG(MPLS_LOG_ERROR, "label type %d", l->type);
       MPLS_ASSERT(0);
   }
 }
@@ -877,88 +932,152 @@ static ldp_fec *_ldp_attr_get_fec(ldp_global * g, ldp_attr * a, mpls_bool flag)
   mpls_fec fec;
 
   /* get FEC from attr */
-  fec_tlv2mpls_fec(&a->fecTlv, 0, &fec);
+  ldp_attr2mpls_fec(a, &fec);
   return _ldp_attr_get_fec2(g, &fec, flag);
 }
 
-static ldp_fs *_ldp_fec_add_fs_ds(ldp_fec * fec, ldp_session * s)
+/*
+ * The fs of a FEC are on a list and, for sessions that have a slot, in a
+ * table indexed by that slot, so finding the fs of a session does not
+ * depend on how many sessions share the FEC.  An fs that could not go
+ * into the table (no slot, no memory, or the slot still holds the fs of
+ * a session that went away) is only on the list, and the table is marked
+ * incomplete until the list drains.
+ */
+static ldp_fs *_ldp_fs_list_find(struct ldp_fs_list *root, ldp_fs_slots *t,
+  ldp_session * s)
 {
-  ldp_fs *fs = _ldp_fec_find_fs_ds(fec, s, MPLS_BOOL_FALSE);
+  ldp_fs *fs;
 
-  if (fs == NULL) {
-    fs = _ldp_fs_create(s);
-    if (fs == NULL) {
+  if (s->slot >= 0) {
+    if (s->slot < t->size) {
+      fs = t->fs[s->slot];
+      if (fs != NULL && fs->session == s) {
+        return fs;
+      }
+      if (fs == NULL && t->incomplete == MPLS_BOOL_FALSE) {
+        return NULL;
+      }
+    } else if (t->incomplete == MPLS_BOOL_FALSE) {
       return NULL;
     }
-    MPLS_LIST_ADD_HEAD(&fec->fs_root_ds, fs, _fec, ldp_fs);
   }
-  return fs;
+
+  fs = MPLS_LIST_HEAD(root);
+  while (fs != NULL) {
+    if (fs->session->index == s->index) {
+      return fs;
+    }
+    fs = MPLS_LIST_NEXT(root, fs, _fec);
+  }
+  return NULL;
 }
 
-static ldp_fs *_ldp_fec_add_fs_us(ldp_fec * fec, ldp_session * s)
+static void _ldp_fs_slots_add(ldp_fs_slots *t, ldp_fs * fs)
 {
-  ldp_fs *fs = _ldp_fec_find_fs_us(fec, s, MPLS_BOOL_FALSE);
+  int slot = fs->session->slot;
+  struct ldp_fs **table;
+  int size;
+
+  if (slot < 0) {
+    t->incomplete = MPLS_BOOL_TRUE;
+    return;
+  }
+
+  if (slot >= t->size) {
+    size = t->size ? t->size : 4;
+    while (size <= slot) {
+      size *= 2;
+    }
+    table = (struct ldp_fs **) mpls_malloc(sizeof(struct ldp_fs *) * size);
+    if (!table) {
+      t->incomplete = MPLS_BOOL_TRUE;
+      return;
+    }
+    memset(table, 0, sizeof(struct ldp_fs *) * size);
+    if (t->fs) {
+      memcpy(table, t->fs, sizeof(struct ldp_fs *) * t->size);
+      mpls_free(t->fs);
+    }
+    t->fs = table;
+    t->size = size;
+  }
+
+  if (t->fs[slot] != NULL) {
+    t->incomplete = MPLS_BOOL_TRUE;
+    return;
+  }
+  t->fs[slot] = fs;
+  fs->slot = slot;
+}
+
+static ldp_fs *_ldp_fs_list_add(struct ldp_fs_list *root, ldp_fs_slots *t,
+  ldp_session * s)
+{
+  ldp_fs *fs = _ldp_fs_list_find(root, t, s);
 
   if (fs == NULL) {
     fs = _ldp_fs_create(s);
     if (fs == NULL) {
       return NULL;
     }
-    MPLS_LIST_ADD_HEAD(&fec->fs_root_us, fs, _fec, ldp_fs);
+    MPLS_LIST_ADD_HEAD(root, fs, _fec, ldp_fs);
+    _ldp_fs_slots_add(t, fs);
   }
   return fs;
 }
 
+static void _ldp_fs_list_del(struct ldp_fs_list *root, ldp_fs_slots *t,
+  ldp_fs * fs)
+{
+  if (fs == NULL) {
+    return;
+  }
+  MPLS_LIST_REMOVE(root, fs, _fec);
+  if (fs->slot >= 0 && fs->slot < t->size && t->fs[fs->slot] == fs) {
+    t->fs[fs->slot] = NULL;
+  }
+  if (MPLS_LIST_EMPTY(root)) {
+    if (t->fs) {
+      mpls_free(t->fs);
+    }
+    t->fs = NULL;
+    t->size = 0;
+    t->incomplete = MPLS_BOOL_FALSE;
+  }
+  _ldp_fs_delete(fs);
+}
+
 static ldp_fs *_ldp_fec_find_fs_us(ldp_fec * fec, ldp_session * s,
   mpls_bool flag)
 {
-  ldp_fs *fs = MPLS_LIST_HEAD(&fec->fs_root_us);
+  ldp_fs *fs = _ldp_fs_list_find(&fec->fs_root_us, &fec->fs_slot_us, s);
 
-  while (fs != NULL) {
-    if (fs->session->index == s->index) {
-      return fs;
-    }
-    fs = MPLS_LIST_NEXT(&fec->fs_root_us, fs, _fec);
+  if (fs != NULL || flag == MPLS_BOOL_FALSE) {
+    return fs;
   }
-  if (flag == MPLS_BOOL_FALSE) {
-    return NULL;
-  }
-  return _ldp_fec_add_fs_us(fec, s);
+  return _ldp_fs_list_add(&fec->fs_root_us, &fec->fs_slot_us, s);
 }
 
 static ldp_fs *_ldp_fec_find_fs_ds(ldp_fec * fec, ldp_session * s,
   mpls_bool flag)
 {
-  ldp_fs *fs = MPLS_LIST_HEAD(&fec->fs_root_ds);
+  ldp_fs *fs = _ldp_fs_list_find(&fec->fs_root_ds, &fec->fs_slot_ds, s);
 
-  while (fs != NULL) {
-    if (fs->session->index == s->index) {
-      return fs;
-    }
-    fs = MPLS_LIST_NEXT(&fec->fs_root_ds, fs, _fec);
-  }
-  if (flag == MPLS_BOOL_FALSE) {
-    return NULL;
+  if (fs != NULL || flag == MPLS_BOOL_FALSE) {
+    return fs;
   }
-  return _ldp_fec_add_fs_ds(fec, s);
+  return _ldp_fs_list_add(&fec->fs_root_ds, &fec->fs_slot_ds, s);
 }
 
 static void _ldp_fec_del_fs_us(ldp_fec * fec, ldp_fs * fs)
 {
-  if (fs == NULL) {
-    return;
-  }
-  MPLS_LIST_REMOVE(&fec->fs_root_us, fs, _fec);
-  _ldp_fs_delete(fs);
+  _ldp_fs_list_del(&fec->fs_root_us, &fec->fs_slot_us, fs);
 }
 
 static void _ldp_fec_del_fs_ds(ldp_fec * fec, ldp_fs * fs)
 {
-  if (fs == NULL) {
-    return;
-  }
-  MPLS_LIST_REMOVE(&fec->fs_root_ds, fs, _fec);
-  _ldp_fs_delete(fs);
+  _ldp_fs_list_del(&fec->fs_root_ds, &fec->fs_slot_ds, fs);
 }
 
 static ldp_fs *_ldp_fs_create(ldp_session * s)
@@ -969,6 +1088,7 @@ static ldp_fs *_ldp_fs_create(ldp_session * s)
     memset(fs, 0, sizeof(ldp_fs));
     MPLS_LIST_INIT(&fs->attr_root, ldp_attr);
     MPLS_LIST_ELEM_INIT(fs, _fec);
+    fs->slot = -1;
     if (s != NULL) {
       MPLS_REFCNT_HOLD(s);
       fs->session = s;
@@ -35,6 +35,17 @@ extern int ldp_attr_num_us2ds(ldp_attr * ds);
 extern ldp_attr *ldp_attr_create(ldp_global * g, mpls_fec * fec);
 extern void ldp_attr_delete(ldp_global * g, ldp_attr * a);
 extern void ldp_attr2ldp_attr(ldp_attr * a, ldp_attr * b, uint32_t flag);
+
+/* reads of out of line TLVs an attr does not have see zeroes */
+extern const ldp_attr_ext ldp_attr_ext_none;
+#define LDP_ATTR_EXT(a) \
+  ((const ldp_attr_ext *)((a)->ext ? (a)->ext : &ldp_attr_ext_none))
+extern ldp_attr_ext *ldp_attr_ext_get(ldp_attr * a);
+
+extern void ldp_attr2mpls_fec(ldp_attr * a, mpls_fec * fec);
+extern void mpls_fec2ldp_attr(mpls_fec * fec, ldp_attr * a);
+extern void fec_tlv2ldp_attr(mplsLdpFecTlv_t * tlv, int i, ldp_attr * a);
+extern void ldp_attr2fec_tlv(ldp_attr * a, mplsLdpFecTlv_t * tlv);
 extern void ldp_attr_remove_complete(ldp_global * g, ldp_attr * attr, mpls_bool);
 
 extern ldp_attr *ldp_attr_find_downstream_state2(ldp_global * g,ldp_session * s,
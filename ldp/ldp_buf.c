@@ -49,9 +49,19 @@ ldp_buf *ldp_buf_create(int size)
 void ldp_buf_delete(ldp_buf * b)
 {
   MPLS_ASSERT(b);
+  mpls_free(b->buffer);
   mpls_free(b);
 }
 
+void ldp_buf_reset(ldp_buf * b)
+{
+  MPLS_ASSERT(b);
+  b->current = b->buffer;
+  b->current_size = 0;
+  b->size = 0;
+  b->want = 0;
+}
+
 void ldp_buf_dump(mpls_instance_handle handle, ldp_buf * b, int size)
 {
   unsigned char *buf = b->current;
@@ -69,20 +79,38 @@ void ldp_buf_dump(mpls_instance_handle handle, ldp_buf * b, int size)
   LDP_TRACE_OUT(handle, "\n");
 }
 
-int ldp_encode_one_mesg(ldp_global * g, uint32_t lsraddr, int label_space,
-  ldp_buf * b, ldp_mesg * msg)
+/*
+ * Appends msg to the PDU open in b, opening a new one when b is empty.
+ * The PDU never grows past max_pdu octets (b->total when max_pdu is 0)
+ * and its header is rewritten with every message, so b can be sent as
+ * it is at any time. Returns the encoded size of msg, or the encoder
+ * error when msg does not fit, in which case the PDU is left as it was.
+ */
+int ldp_encode_append_mesg(ldp_global * g, uint32_t lsraddr, int label_space,
+  ldp_buf * b, ldp_mesg * msg, int max_pdu)
 {
   ldp_trace_flags type = LDP_TRACE_FLAG_INIT;
 
   unsigned char *hdrBuf = b->buffer;
-  unsigned char *bodyBuf = hdrBuf + MPLS_LDP_HDRSIZE;
+  unsigned char *bodyBuf;
 
-  int bodyBuf_size = b->total - MPLS_LDP_HDRSIZE;
+  int bodyBuf_size;
   int hdrBuf_size = MPLS_LDP_HDRSIZE;
+  int limit = b->total;
 
   int hdr_size;
   int body_size;
 
+  if (max_pdu > MPLS_LDP_HDRSIZE && max_pdu < limit) {
+    limit = max_pdu;
+  }
+  if (b->size < MPLS_LDP_HDRSIZE) {
+    b->size = MPLS_LDP_HDRSIZE;
+  }
+
+  bodyBuf = hdrBuf + b->size;
+  bodyBuf_size = limit - b->size;
+
   switch (msg->u.generic.flags.flags.msgType) {
     case MPLS_INIT_MSGTYPE:
       body_size = Mpls_encodeLdpInitMsg(&msg->u.init, bodyBuf, bodyBuf_size);
@@ -122,12 +150,17 @@ int ldp_encode_one_mesg(ldp_global * g, uint32_t lsraddr, int label_space,
   }
 
   if (body_size < 0) {
+    if (b->size == MPLS_LDP_HDRSIZE) {
+      b->size = 0;
+    }
     return body_size;
   }
 
+  b->size += body_size;
+
+  /* the PDU length does not cover the version and length fields */
   msg->header.protocolVersion = 1;
-  msg->header.pduLength = body_size;
-  msg->header.pduLength = body_size + MPLS_LDPIDLEN;
+  msg->header.pduLength = b->size - 4;
   msg->header.lsrAddress = lsraddr;
   msg->header.labelSpace = label_space;
 
@@ -195,12 +228,26 @@ int ldp_encode_one_mesg(ldp_global * g, uint32_t lsraddr, int label_space,
     return hdr_size;
   }
 
-  b->current_size = hdr_size + body_size;
+  b->current = bodyBuf;
+  LDP_DUMP_PKT(g->user_data, type, MPLS_TRACE_STATE_SEND,
+    ldp_buf_dump(g->user_data, b, body_size));
+
   b->current = b->buffer;
-  b->size = b->current_size;
+  b->current_size = b->size;
 
-  LDP_DUMP_PKT(g->user_data, type, MPLS_TRACE_STATE_SEND,
-    ldp_buf_dump(g->user_data, b, b->size));
+  return body_size;
+}
+
+int ldp_encode_one_mesg(ldp_global * g, uint32_t lsraddr, int label_space,
+  ldp_buf * b, ldp_mesg * msg)
+{
+  int result;
+
+  b->size = 0;
+  result = ldp_encode_append_mesg(g, lsraddr, label_space, b, msg, 0);
+  if (result < 0) {
+    return result;
+  }
 
   return b->size;
 }
@@ -231,6 +278,340 @@ mpls_return_enum ldp_decode_header(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
   return MPLS_SUCCESS;
 }
 
+/* the TLVs the full decoder of each label message knows */
+static mpls_bool ldp_mesg_tlv_known(u_short msg_type, u_short tlv_type)
+{
+  switch (msg_type) {
+    case MPLS_LBLMAP_MSGTYPE:
+      switch (tlv_type) {
+        case MPLS_FEC_TLVTYPE:
+        case MPLS_GENLBL_TLVTYPE:
+        case MPLS_ATMLBL_TLVTYPE:
+        case MPLS_FRLBL_TLVTYPE:
+        case MPLS_HOPCOUNT_TLVTYPE:
+        case MPLS_PATH_TLVTYPE:
+        case MPLS_REQMSGID_TLVTYPE:
+        case MPLS_TRAFFIC_TLVTYPE:
+        case MPLS_LSPID_TLVTYPE:
+          return MPLS_BOOL_TRUE;
+      }
+      break;
+    case MPLS_LBLREQ_MSGTYPE:
+      switch (tlv_type) {
+        case MPLS_FEC_TLVTYPE:
+        case MPLS_HOPCOUNT_TLVTYPE:
+        case MPLS_PATH_TLVTYPE:
+        case MPLS_LBLMSGID_TLVTYPE:
+        case MPLS_ER_TLVTYPE:
+        case MPLS_TRAFFIC_TLVTYPE:
+        case MPLS_LSPID_TLVTYPE:
+        case MPLS_PINNING_TLVTYPE:
+        case MPLS_RESCLASS_TLVTYPE:
+        case MPLS_PREEMPT_TLVTYPE:
+          return MPLS_BOOL_TRUE;
+      }
+      break;
+    case MPLS_LBLWITH_MSGTYPE:
+    case MPLS_LBLREL_MSGTYPE:
+      switch (tlv_type) {
+        case MPLS_FEC_TLVTYPE:
+        case MPLS_GENLBL_TLVTYPE:
+        case MPLS_ATMLBL_TLVTYPE:
+        case MPLS_FRLBL_TLVTYPE:
+        case MPLS_LSPID_TLVTYPE:
+          return MPLS_BOOL_TRUE;
+      }
+      break;
+    case MPLS_LBLABORT_MSGTYPE:
+      switch (tlv_type) {
+        case MPLS_FEC_TLVTYPE:
+        case MPLS_REQMSGID_TLVTYPE:
+          return MPLS_BOOL_TRUE;
+      }
+      break;
+  }
+  return MPLS_BOOL_FALSE;
+}
+
+/* the TLVs of the last message are still flagged in the union */
+static void ldp_mesg_tlv_reset(ldp_mesg * msg)
+{
+  switch (msg->u.generic.flags.flags.msgType) {
+    case MPLS_LBLMAP_MSGTYPE:
+      msg->u.map.fecTlvExists = 0;
+      msg->u.map.genLblTlvExists = 0;
+      msg->u.map.atmLblTlvExists = 0;
+      msg->u.map.frLblTlvExists = 0;
+      msg->u.map.hopCountTlvExists = 0;
+      msg->u.map.pathVecTlvExists = 0;
+      msg->u.map.lblMsgIdTlvExists = 0;
+      msg->u.map.lspidTlvExists = 0;
+      msg->u.map.trafficTlvExists = 0;
+      break;
+    case MPLS_LBLREQ_MSGTYPE:
+      msg->u.request.fecTlvExists = 0;
+      msg->u.request.hopCountTlvExists = 0;
+      msg->u.request.pathVecTlvExists = 0;
+      msg->u.request.lblMsgIdTlvExists = 0;
+      msg->u.request.erTlvExists = 0;
+      msg->u.request.trafficTlvExists = 0;
+      msg->u.request.lspidTlvExists = 0;
+      msg->u.request.pinningTlvExists = 0;
+      msg->u.request.recClassTlvExists = 0;
+      msg->u.request.preemptTlvExists = 0;
+      break;
+    case MPLS_LBLWITH_MSGTYPE:
+    case MPLS_LBLREL_MSGTYPE:
+      msg->u.release.fecTlvExists = 0;
+      msg->u.release.genLblTlvExists = 0;
+      msg->u.release.atmLblTlvExists = 0;
+      msg->u.release.frLblTlvExists = 0;
+      msg->u.release.lspidTlvExists = 0;
+      break;
+    case MPLS_LBLABORT_MSGTYPE:
+      msg->u.abort.fecTlvExists = 0;
+      msg->u.abort.lblMsgIdTlvExists = 0;
+      break;
+  }
+}
+
+/*
+ * Decodes the base of a label message and notes where each of its TLVs
+ * is, without decoding them.  The message is checked as far as the full
+ * decoder would check it before looking into a TLV: lengths, and unknown
+ * TLVs without the U bit.  Returns the size of the message.
+ */
+static int ldp_decode_label_mesg(ldp_mesg * msg, u_char * buf, int size)
+{
+  mplsLdpMsg_t *base = &msg->u.generic;
+  mplsLdpTlv_t tlv;
+  ldp_tlv_view *v;
+  int used;
+  int end;
+  int i;
+
+  if ((used = Mpls_decodeLdpBaseMsg(base, buf, size)) < 0) {
+    return MPLS_DEC_BASEMSGERROR;
+  }
+  end = MPLS_MSGIDFIXLEN + base->msgLength;
+  if (end > size || end < used) {
+    return MPLS_DEC_BUFFTOOSMALL;
+  }
+
+  ldp_mesg_tlv_reset(msg);
+  msg->tlv_count = 0;
+  msg->tlv_error = MPLS_BOOL_FALSE;
+
+  while (used < end) {
+    if (Mpls_decodeLdpTlv(&tlv, buf + used, end - used) < 0) {
+      return MPLS_DEC_TLVERROR;
+    }
+    used += MPLS_TLVFIXLEN;
+    if (tlv.length > end - used) {
+      return MPLS_DEC_TLVERROR;
+    }
+
+    if (ldp_mesg_tlv_known(base->flags.flags.msgType,
+        tlv.flags.flags.tBit) == MPLS_BOOL_TRUE) {
+      /* a repeated TLV replaces the earlier one, as in the full decoder */
+      for (i = 0; i < msg->tlv_count; i++) {
+        if (msg->tlv[i].tlv.flags.flags.tBit == tlv.flags.flags.tBit) {
+          break;
+        }
+      }
+      MPLS_ASSERT(i < LDP_MESG_TLV_MAX);
+      if (i == msg->tlv_count) {
+        msg->tlv_count++;
+      }
+      v = &msg->tlv[i];
+      v->tlv = tlv;
+      v->value = buf + used;
+      v->decoded = NULL;
+      v->done = MPLS_BOOL_FALSE;
+    } else if (tlv.flags.flags.uBit != 1) {
+      return MPLS_TLVTYPEERROR;
+    }
+    used += tlv.length;
+  }
+
+  return used;
+}
+
+/*
+ * The FEC, label, hop count and message id decoders fill in all of their
+ * TLV, the others are cleared first like the full decoder clears the
+ * whole message.  The path vector has to be, its LSR ids end at a 0.
+ */
+#define LDP_TLV_DECODE(m, name, exists, decode) \
+  if ((decode) < 0) {                           \
+    return NULL;                                \
+  }                                             \
+  (m)->exists = 1;                              \
+  (m)->name.baseTlv = v->tlv;                   \
+  return &(m)->name;
+
+#define LDP_TLV_CLEAR_DECODE(m, name, exists, decode) \
+  memset(&(m)->name, 0, sizeof((m)->name));           \
+  LDP_TLV_DECODE(m, name, exists, decode)
+
+/* decodes v into its place in the message, NULL when it does not decode */
+static void *ldp_mesg_tlv_decode(ldp_mesg * msg, ldp_tlv_view * v)
+{
+  u_char *buf = v->value;
+  u_short len = v->tlv.length;
+
+  switch (msg->u.generic.flags.flags.msgType) {
+    case MPLS_LBLMAP_MSGTYPE:
+      {
+        mplsLdpLblMapMsg_t *map = &msg->u.map;
+
+        switch (v->tlv.flags.flags.tBit) {
+          case MPLS_FEC_TLVTYPE:
+            LDP_TLV_DECODE(map, fecTlv, fecTlvExists,
+              Mpls_decodeLdpFecTlv(&map->fecTlv, buf, len, len));
+          case MPLS_GENLBL_TLVTYPE:
+            LDP_TLV_DECODE(map, genLblTlv, genLblTlvExists,
+              Mpls_decodeLdpGenLblTlv(&map->genLblTlv, buf, len));
+          case MPLS_ATMLBL_TLVTYPE:
+            LDP_TLV_DECODE(map, atmLblTlv, atmLblTlvExists,
+              Mpls_decodeLdpAtmLblTlv(&map->atmLblTlv, buf, len));
+          case MPLS_FRLBL_TLVTYPE:
+            LDP_TLV_DECODE(map, frLblTlv, frLblTlvExists,
+              Mpls_decodeLdpFrLblTlv(&map->frLblTlv, buf, len));
+          case MPLS_HOPCOUNT_TLVTYPE:
+            LDP_TLV_DECODE(map, hopCountTlv, hopCountTlvExists,
+              Mpls_decodeLdpHopTlv(&map->hopCountTlv, buf, len));
+          case MPLS_PATH_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(map, pathVecTlv, pathVecTlvExists,
+              Mpls_decodeLdpPathVectorTlv(&map->pathVecTlv, buf, len, len));
+          case MPLS_REQMSGID_TLVTYPE:
+            LDP_TLV_DECODE(map, lblMsgIdTlv, lblMsgIdTlvExists,
+              Mpls_decodeLdpLblMsgIdTlv(&map->lblMsgIdTlv, buf, len));
+          case MPLS_TRAFFIC_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(map, trafficTlv, trafficTlvExists,
+              Mpls_decodeLdpTrafficTlv(&map->trafficTlv, buf, len, len));
+          case MPLS_LSPID_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(map, lspidTlv, lspidTlvExists,
+              Mpls_decodeLdpLspIdTlv(&map->lspidTlv, buf, len));
+        }
+        break;
+      }
+    case MPLS_LBLREQ_MSGTYPE:
+      {
+        mplsLdpLblReqMsg_t *req = &msg->u.request;
+
+        switch (v->tlv.flags.flags.tBit) {
+          case MPLS_FEC_TLVTYPE:
+            LDP_TLV_DECODE(req, fecTlv, fecTlvExists,
+              Mpls_decodeLdpFecTlv(&req->fecTlv, buf, len, len));
+          case MPLS_HOPCOUNT_TLVTYPE:
+            LDP_TLV_DECODE(req, hopCountTlv, hopCountTlvExists,
+              Mpls_decodeLdpHopTlv(&req->hopCountTlv, buf, len));
+          case MPLS_PATH_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(req, pathVecTlv, pathVecTlvExists,
+              Mpls_decodeLdpPathVectorTlv(&req->pathVecTlv, buf, len, len));
+          case MPLS_LBLMSGID_TLVTYPE:
+            /* the full decoder only notes that it is there */
+            LDP_TLV_CLEAR_DECODE(req, lblMsgIdTlv, lblMsgIdTlvExists, 0);
+          case MPLS_ER_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(req, erTlv, erTlvExists,
+              Mpls_decodeLdpERTlv(&req->erTlv, buf, len, len));
+          case MPLS_TRAFFIC_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(req, trafficTlv, trafficTlvExists,
+              Mpls_decodeLdpTrafficTlv(&req->trafficTlv, buf, len, len));
+          case MPLS_LSPID_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(req, lspidTlv, lspidTlvExists,
+              Mpls_decodeLdpLspIdTlv(&req->lspidTlv, buf, len));
+          case MPLS_PINNING_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(req, pinningTlv, pinningTlvExists,
+              Mpls_decodeLdpPinningTlv(&req->pinningTlv, buf, len));
+          case MPLS_RESCLASS_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(req, resClassTlv, recClassTlvExists,
+              Mpls_decodeLdpResClsTlv(&req->resClassTlv, buf, len));
+          case MPLS_PREEMPT_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(req, preemptTlv, preemptTlvExists,
+              Mpls_decodeLdpPreemptTlv(&req->preemptTlv, buf, len));
+        }
+        break;
+      }
+    case MPLS_LBLWITH_MSGTYPE:
+    case MPLS_LBLREL_MSGTYPE:
+      {
+        mplsLdpLbl_W_R_Msg_t *rw = &msg->u.release;
+
+        switch (v->tlv.flags.flags.tBit) {
+          case MPLS_FEC_TLVTYPE:
+            LDP_TLV_DECODE(rw, fecTlv, fecTlvExists,
+              Mpls_decodeLdpFecTlv(&rw->fecTlv, buf, len, len));
+          case MPLS_GENLBL_TLVTYPE:
+            LDP_TLV_DECODE(rw, genLblTlv, genLblTlvExists,
+              Mpls_decodeLdpGenLblTlv(&rw->genLblTlv, buf, len));
+          case MPLS_ATMLBL_TLVTYPE:
+            LDP_TLV_DECODE(rw, atmLblTlv, atmLblTlvExists,
+              Mpls_decodeLdpAtmLblTlv(&rw->atmLblTlv, buf, len));
+          case MPLS_FRLBL_TLVTYPE:
+            LDP_TLV_DECODE(rw, frLblTlv, frLblTlvExists,
+              Mpls_decodeLdpFrLblTlv(&rw->frLblTlv, buf, len));
+          case MPLS_LSPID_TLVTYPE:
+            LDP_TLV_CLEAR_DECODE(rw, lspidTlv, lspidTlvExists,
+              Mpls_decodeLdpLspIdTlv(&rw->lspidTlv, buf, len));
+        }
+        break;
+      }
+    case MPLS_LBLABORT_MSGTYPE:
+      {
+        mplsLdpLblAbortMsg_t *abrt = &msg->u.abort;
+
+        switch (v->tlv.flags.flags.tBit) {
+          case MPLS_FEC_TLVTYPE:
+            LDP_TLV_DECODE(abrt, fecTlv, fecTlvExists,
+              Mpls_decodeLdpFecTlv(&abrt->fecTlv, buf, len, len));
+          case MPLS_REQMSGID_TLVTYPE:
+            LDP_TLV_DECODE(abrt, lblMsgIdTlv, lblMsgIdTlvExists,
+              Mpls_decodeLdpLblMsgIdTlv(&abrt->lblMsgIdTlv, buf, len));
+        }
+        break;
+      }
+  }
+  return NULL;
+}
+
+/*
+ * Returns the TLV of type in a received label message, decoding it the
+ * first time, or NULL when the message does not carry it.  A TLV that
+ * does not decode is NULL as well and sets msg->tlv_error.
+ */
+void *ldp_mesg_tlv(ldp_mesg * msg, u_short type)
+{
+  ldp_tlv_view *v;
+  int i;
+
+  for (i = 0; i < msg->tlv_count; i++) {
+    v = &msg->tlv[i];
+    if (v->tlv.flags.flags.tBit != type) {
+      continue;
+    }
+    if (v->done == MPLS_BOOL_FALSE) {
+      v->done = MPLS_BOOL_TRUE;
+      if (!(v->decoded = ldp_mesg_tlv_decode(msg, v))) {
+        msg->tlv_error = MPLS_BOOL_TRUE;
+      }
+    }
+    return v->decoded;
+  }
+  return NULL;
+}
+
+/* decodes every TLV of a received label message, for printing it */
+void ldp_mesg_tlv_all(ldp_mesg * msg)
+{
+  int i;
+
+  for (i = 0; i < msg->tlv_count; i++) {
+    ldp_mesg_tlv(msg, msg->tlv[i].tlv.flags.flags.tBit);
+  }
+}
+
 int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
 {
   int max_mesg_size;
@@ -258,10 +639,17 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
   LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_RECV, LDP_TRACE_FLAG_PACKET,
     "Found type %x\n", type);
 
+  /*
+   * only the member being decoded is cleared, the whole union is several
+   * KB because of the address list and most messages are much smaller.
+   * Label messages, by far the most frequent, are not decoded here at all
+   * past their TLV headers, see ldp_mesg_tlv.
+   */
   switch (type) {
     case MPLS_INIT_MSGTYPE:
       {
         MPLS_MSGPTR(Init) = &msg->u.init;
+        memset(MPLS_MSGPARAM(Init), 0, sizeof(*MPLS_MSGPARAM(Init)));
         encodedSize = Mpls_decodeLdpInitMsg(MPLS_MSGPARAM(Init),
           b->current, max_mesg_size);
         LDP_DUMP_PKT(g->user_data, LDP_TRACE_FLAG_INIT, MPLS_TRACE_STATE_RECV,
@@ -281,6 +669,7 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
     case MPLS_NOT_MSGTYPE:
       {
         MPLS_MSGPTR(Notif) = &msg->u.notif;
+        memset(MPLS_MSGPARAM(Notif), 0, sizeof(*MPLS_MSGPARAM(Notif)));
         encodedSize = Mpls_decodeLdpNotMsg(MPLS_MSGPARAM(Notif),
           b->current, max_mesg_size);
         LDP_DUMP_PKT(g->user_data, LDP_TRACE_FLAG_NOTIF, MPLS_TRACE_STATE_RECV,
@@ -302,6 +691,7 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
     case MPLS_KEEPAL_MSGTYPE:
       {
         MPLS_MSGPTR(KeepAl) = &msg->u.keep;
+        memset(MPLS_MSGPARAM(KeepAl), 0, sizeof(*MPLS_MSGPARAM(KeepAl)));
         encodedSize = Mpls_decodeLdpKeepAliveMsg(MPLS_MSGPARAM(KeepAl),
           b->current, max_mesg_size);
         LDP_DUMP_PKT(g->user_data, LDP_TRACE_FLAG_PERIODIC,
@@ -323,6 +713,7 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
     case MPLS_HELLO_MSGTYPE:
       {
         MPLS_MSGPTR(Hello) = &msg->u.hello;
+        memset(MPLS_MSGPARAM(Hello), 0, sizeof(*MPLS_MSGPARAM(Hello)));
         encodedSize = Mpls_decodeLdpHelloMsg(MPLS_MSGPARAM(Hello),
           b->current, max_mesg_size);
         LDP_DUMP_PKT(g->user_data, LDP_TRACE_FLAG_PERIODIC,
@@ -344,8 +735,7 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
     case MPLS_LBLREQ_MSGTYPE:
       {
         MPLS_MSGPTR(LblReq) = &msg->u.request;
-        encodedSize = Mpls_decodeLdpLblReqMsg(MPLS_MSGPARAM(LblReq),
-          b->current, max_mesg_size);
+        encodedSize = ldp_decode_label_mesg(msg, b->current, max_mesg_size);
         LDP_DUMP_PKT(g->user_data, LDP_TRACE_FLAG_LABEL, MPLS_TRACE_STATE_RECV,
           ldp_buf_dump(g->user_data, b, encodedSize));
         LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_RECV,
@@ -356,7 +746,8 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
         LDP_TRACE_PKT(g->user_data, MPLS_TRACE_STATE_RECV,
           LDP_TRACE_FLAG_LABEL,
           printHeader(g->user_data, &msg->header),
-          printLlbReqMsg(g->user_data, MPLS_MSGPARAM(LblReq)));
+          (ldp_mesg_tlv_all(msg),
+            printLlbReqMsg(g->user_data, MPLS_MSGPARAM(LblReq))));
         b->current += encodedSize;
         mesgSize += encodedSize;
         break;
@@ -364,8 +755,7 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
     case MPLS_LBLMAP_MSGTYPE:
       {
         MPLS_MSGPTR(LblMap) = &msg->u.map;
-        encodedSize = Mpls_decodeLdpLblMapMsg(MPLS_MSGPARAM(LblMap),
-          b->current, max_mesg_size);
+        encodedSize = ldp_decode_label_mesg(msg, b->current, max_mesg_size);
         LDP_DUMP_PKT(g->user_data, LDP_TRACE_FLAG_LABEL, MPLS_TRACE_STATE_RECV,
           ldp_buf_dump(g->user_data, b, encodedSize));
         LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_RECV,
@@ -376,7 +766,8 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
         LDP_TRACE_PKT(g->user_data, MPLS_TRACE_STATE_RECV,
           LDP_TRACE_FLAG_LABEL,
           printHeader(g->user_data, &msg->header),
-          printLlbMapMsg(g->user_data, MPLS_MSGPARAM(LblMap)));
+          (ldp_mesg_tlv_all(msg),
+            printLlbMapMsg(g->user_data, MPLS_MSGPARAM(LblMap))));
         b->current += encodedSize;
         mesgSize += encodedSize;
         break;
@@ -385,6 +776,7 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
     case MPLS_ADDRWITH_MSGTYPE:
       {
         MPLS_MSGPTR(Adr) = &msg->u.addr;
+        memset(MPLS_MSGPARAM(Adr), 0, sizeof(*MPLS_MSGPARAM(Adr)));
         encodedSize = Mpls_decodeLdpAdrMsg(MPLS_MSGPARAM(Adr),
           b->current, max_mesg_size);
         LDP_DUMP_PKT(g->user_data, LDP_TRACE_FLAG_ADDRESS,
@@ -407,8 +799,7 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
     case MPLS_LBLREL_MSGTYPE:
       {
         MPLS_MSGPTR(Lbl_W_R_) = &msg->u.release;
-        encodedSize = Mpls_decodeLdpLbl_W_R_Msg(MPLS_MSGPARAM(Lbl_W_R_),
-          b->current, max_mesg_size);
+        encodedSize = ldp_decode_label_mesg(msg, b->current, max_mesg_size);
         LDP_DUMP_PKT(g->user_data, LDP_TRACE_FLAG_LABEL, MPLS_TRACE_STATE_RECV,
           ldp_buf_dump(g->user_data, b, encodedSize));
         LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_RECV,
@@ -420,7 +811,8 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
         LDP_TRACE_PKT(g->user_data, MPLS_TRACE_STATE_RECV,
           LDP_TRACE_FLAG_LABEL,
           printHeader(g->user_data, &msg->header),
-          printLbl_W_R_Msg(g->user_data, MPLS_MSGPARAM(Lbl_W_R_)));
+          (ldp_mesg_tlv_all(msg),
+            printLbl_W_R_Msg(g->user_data, MPLS_MSGPARAM(Lbl_W_R_))));
         b->current += encodedSize;
         mesgSize += encodedSize;
         break;
@@ -428,8 +820,7 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
     case MPLS_LBLABORT_MSGTYPE:
       {
         MPLS_MSGPTR(LblAbort) = &msg->u.abort;
-        encodedSize = Mpls_decodeLdpLblAbortMsg(MPLS_MSGPARAM(LblAbort),
-          b->current, max_mesg_size);
+        encodedSize = ldp_decode_label_mesg(msg, b->current, max_mesg_size);
         LDP_DUMP_PKT(g->user_data, LDP_TRACE_FLAG_LABEL, MPLS_TRACE_STATE_RECV,
           ldp_buf_dump(g->user_data, b, encodedSize));
         LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_RECV,
@@ -441,7 +832,8 @@ int ldp_decode_one_mesg(ldp_global * g, ldp_buf * b, ldp_mesg * msg)
         LDP_TRACE_PKT(g->user_data, MPLS_TRACE_STATE_RECV,
           LDP_TRACE_FLAG_LABEL,
           printHeader(g->user_data, &msg->header),
-          printLlbAbortMsg(g->user_data, MPLS_MSGPARAM(LblAbort)));
+          (ldp_mesg_tlv_all(msg),
+            printLlbAbortMsg(g->user_data, MPLS_MSGPARAM(LblAbort))));
         b->current += encodedSize;
         mesgSize += encodedSize;
         break;
@@ -22,9 +22,14 @@
 
 extern ldp_buf *ldp_buf_create(int);
 extern void ldp_buf_delete(ldp_buf *);
+extern void ldp_buf_reset(ldp_buf *);
 extern int ldp_encode_one_mesg(ldp_global * g, uint32_t lsraddr,
   int label_space, ldp_buf * b, ldp_mesg * msg);
+extern int ldp_encode_append_mesg(ldp_global * g, uint32_t lsraddr,
+  int label_space, ldp_buf * b, ldp_mesg * msg, int max_pdu);
 extern int ldp_decode_one_mesg(ldp_global * g, ldp_buf * pdu, ldp_mesg * msg);
+extern void *ldp_mesg_tlv(ldp_mesg * msg, u_short type);
+extern void ldp_mesg_tlv_all(ldp_mesg * msg);
 extern mpls_return_enum ldp_decode_header(ldp_global * g, ldp_buf * b,
 
   ldp_mesg * msg);
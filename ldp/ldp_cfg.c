@@ -23,6 +23,7 @@
 #include "ldp_label_mapping.h"
 #include "ldp_hop.h"
 #include "ldp_hop_list.h"
+#include "ldp_mesg.h"
 #include "mpls_lock_impl.h"
 #include "mpls_trace_impl.h"
 #include "mpls_tree_impl.h"
@@ -44,6 +45,28 @@ void ldp_cfg_close(mpls_cfg_handle g)
   LDP_EXIT((mpls_instance_handle) g->user_data, "ldp_cfg_close");
 }
 
+/* send the PDUs sessions have been collecting during the last event */
+void ldp_cfg_flush(mpls_cfg_handle handle)
+{
+  ldp_global *g = (ldp_global *) handle;
+
+  mpls_lock_get(g->global_lock); /* LOCK */
+  ldp_mesg_flush_tcp(g);
+  mpls_lock_release(g->global_lock); /* UNLOCK */
+}
+
+/* the label policy changed, bring the existing bindings in line */
+void ldp_cfg_policy_apply(mpls_cfg_handle handle)
+{
+  ldp_global *g = (ldp_global *) handle;
+
+  mpls_lock_get(g->global_lock); /* LOCK */
+  if (g->admin_state == MPLS_ADMIN_ENABLE) {
+    ldp_fec_policy_apply(g);
+  }
+  mpls_lock_release(g->global_lock); /* UNLOCK */
+}
+
 /******************* GLOBAL **********************/
 
 void ldp_cfg_global_attr(mpls_cfg_handle handle) {
@@ -123,6 +146,10 @@ mpls_return_enum ldp_cfg_global_get(mpls_cfg_handle handle, ldp_global * g,
   if (flag & LDP_GLOBAL_CFG_EDGE_INLABEL) {
     g->edge_inlabel = global->edge_inlabel;
   }
+  if (flag & LDP_GLOBAL_CFG_INITIAL_SLICE) {
+    g->initial_slice_fecs = global->initial_slice_fecs;
+    g->initial_slice_msec = global->initial_slice_msec;
+  }
 #if MPLS_USE_LSR
   if (flag & LDP_GLOBAL_CFG_LSR_HANDLE) {
     g->lsr_handle = global->lsr_handle;
@@ -252,6 +279,10 @@ mpls_return_enum ldp_cfg_global_set(mpls_cfg_handle handle, ldp_global * g,
   if (flag & LDP_GLOBAL_CFG_EDGE_INLABEL) {
     global->edge_inlabel = g->edge_inlabel;
   }
+  if (flag & LDP_GLOBAL_CFG_INITIAL_SLICE) {
+    global->initial_slice_fecs = g->initial_slice_fecs;
+    global->initial_slice_msec = g->initial_slice_msec;
+  }
 #if MPLS_USE_LSR
   if (flag & LDP_GLOBAL_CFG_LSR_HANDLE) {
     global->lsr_handle = g->lsr_handle ;
@@ -379,7 +410,6 @@ mpls_return_enum ldp_cfg_entity_getnext(mpls_cfg_handle handle, ldp_entity * e,
   ldp_global *g = (ldp_global *) handle;
   ldp_entity *entity = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(g->user_data, "ldp_cfg_entity_getnext");
@@ -391,19 +421,7 @@ mpls_return_enum ldp_cfg_entity_getnext(mpls_cfg_handle handle, ldp_entity * e,
   }
 
   mpls_lock_get(g->global_lock); /* LOCK */
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_entity_index(g, index, &entity))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_entity_next(g, index, &entity);
   mpls_lock_release(g->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
@@ -770,7 +788,6 @@ mpls_return_enum ldp_cfg_if_getnext(mpls_cfg_handle handle, ldp_if * i,
   ldp_global *g = (ldp_global *) handle;
   ldp_if *iff = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(g->user_data, "ldp_cfg_if_getnext");
@@ -782,19 +799,7 @@ mpls_return_enum ldp_cfg_if_getnext(mpls_cfg_handle handle, ldp_if * i,
   }
 
   mpls_lock_get(g->global_lock); /* LOCK */
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_if_index(g, index, &iff))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_if_next(g, index, &iff);
   mpls_lock_release(g->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
@@ -870,7 +875,7 @@ mpls_return_enum ldp_cfg_if_set(mpls_cfg_handle handle, ldp_if * i, uint32_t fla
     }
 
     /* copy the handle from the user */
-    iff->handle = i->handle;
+    _ldp_global_set_if_handle(global, iff, i->handle);
 
     /* search for addrs and nexthops that are waiting for this interface */
     ap = MPLS_LIST_HEAD(&global->addr);
@@ -980,7 +985,8 @@ mpls_return_enum ldp_cfg_attr_get(mpls_cfg_handle handle, ldp_attr * a,
   if (flag & LDP_ATTR_CFG_HOP_COUNT) {
     ldp_attr2ldp_attr(attr, a, LDP_ATTR_HOPCOUNT);
   }
-  if (flag & LDP_ATTR_CFG_PATH) {
+  /* the path is only copied into ext storage the caller provides */
+  if (flag & LDP_ATTR_CFG_PATH && a->ext) {
     ldp_attr2ldp_attr(attr, a, LDP_ATTR_PATH);
   }
   if (flag & LDP_ATTR_CFG_SESSION_INDEX) {
@@ -1011,7 +1017,6 @@ mpls_return_enum ldp_cfg_attr_getnext(mpls_cfg_handle handle, ldp_attr * a,
   ldp_global *g = (ldp_global *) handle;
   ldp_attr *attr = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(g->user_data, "ldp_cfg_attr_getnext");
@@ -1023,19 +1028,7 @@ mpls_return_enum ldp_cfg_attr_getnext(mpls_cfg_handle handle, ldp_attr * a,
   }
 
   mpls_lock_get(g->global_lock); /* LOCK */
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_attr_index(g, index, &attr))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_attr_next(g, index, &attr);
   mpls_lock_release(g->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
@@ -1047,6 +1040,18 @@ mpls_return_enum ldp_cfg_attr_getnext(mpls_cfg_handle handle, ldp_attr * a,
   return r;
 }
 
+uint32_t ldp_cfg_attr_count(mpls_cfg_handle handle)
+{
+  ldp_global *g = (ldp_global *) handle;
+  uint32_t count;
+
+  mpls_lock_get(g->global_lock); /* LOCK */
+  count = g->attr.count;
+  mpls_lock_release(g->global_lock); /* UNLOCK */
+
+  return count;
+}
+
 /******************* PEER **********************/
 
 mpls_return_enum ldp_cfg_peer_get(mpls_cfg_handle handle, ldp_peer * p,
@@ -1099,7 +1104,6 @@ mpls_return_enum ldp_cfg_peer_getnext(mpls_cfg_handle handle, ldp_peer * p,
   ldp_global *g = (ldp_global *) handle;
   ldp_peer *peer = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(g->user_data, "ldp_cfg_peer_getnext");
@@ -1111,19 +1115,7 @@ mpls_return_enum ldp_cfg_peer_getnext(mpls_cfg_handle handle, ldp_peer * p,
   }
 
   mpls_lock_get(g->global_lock); /* LOCK */
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_peer_index(g, index, &peer))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_peer_next(g, index, &peer);
   mpls_lock_release(g->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
@@ -1196,7 +1188,7 @@ mpls_return_enum ldp_cfg_peer_set(mpls_cfg_handle handle, ldp_peer * p,
     peer->target_role = p->target_role;
   }
   if (flag & LDP_PEER_CFG_DEST_ADDR) {
-    memcpy(&peer->dest.addr, &p->dest.addr, sizeof(mpls_inet_addr));
+    _ldp_global_set_peer_addr(global, peer, &p->dest.addr);
   }
   if (flag & LDP_PEER_CFG_PEER_NAME) {
     LDP_PRINT(global->user_data, "ldp_cfg_peer_set: peer_name = %s\n",
@@ -1257,7 +1249,6 @@ mpls_return_enum ldp_cfg_fec_getnext(mpls_cfg_handle handle, mpls_fec * f,
   ldp_global *g = (ldp_global *) handle;
   ldp_fec *fec = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(g->user_data, "ldp_cfg_fec_getnext");
@@ -1269,19 +1260,7 @@ mpls_return_enum ldp_cfg_fec_getnext(mpls_cfg_handle handle, mpls_fec * f,
   }
 
   mpls_lock_get(g->global_lock); /* LOCK */
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_fec_index(g, index, &fec))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_fec_next(g, index, &fec);
   mpls_lock_release(g->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
@@ -1293,6 +1272,18 @@ mpls_return_enum ldp_cfg_fec_getnext(mpls_cfg_handle handle, mpls_fec * f,
   return r;
 }
 
+uint32_t ldp_cfg_fec_count(mpls_cfg_handle handle)
+{
+  ldp_global *g = (ldp_global *) handle;
+  uint32_t count;
+
+  mpls_lock_get(g->global_lock); /* LOCK */
+  count = g->fec.count;
+  mpls_lock_release(g->global_lock); /* UNLOCK */
+
+  return count;
+}
+
 mpls_return_enum ldp_cfg_fec_test(mpls_cfg_handle handle, mpls_fec * f,
   uint32_t flag)
 {
@@ -1628,7 +1619,6 @@ mpls_return_enum ldp_cfg_addr_getnext(mpls_cfg_handle handle, ldp_addr *a,
   ldp_global *global = (ldp_global *) handle;
   ldp_addr *addr = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(global->user_data, "ldp_cfg_addr_getnext");
@@ -1641,19 +1631,7 @@ mpls_return_enum ldp_cfg_addr_getnext(mpls_cfg_handle handle, ldp_addr *a,
 
   mpls_lock_get(global->global_lock); /* LOCK */
 
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_addr_index(global, index, &addr))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_addr_next(global, index, &addr);
   mpls_lock_release(global->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
@@ -1889,7 +1867,6 @@ mpls_return_enum ldp_cfg_adj_getnext(mpls_cfg_handle handle, ldp_adj * a,
   ldp_global *g = (ldp_global *) handle;
   ldp_adj *adj = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(g->user_data, "ldp_cfg_adj_getnext");
@@ -1901,19 +1878,7 @@ mpls_return_enum ldp_cfg_adj_getnext(mpls_cfg_handle handle, ldp_adj * a,
   }
 
   mpls_lock_get(g->global_lock); /* LOCK */
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_adj_index(g, index, &adj))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_adj_next(g, index, &adj);
   mpls_lock_release(g->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
@@ -2002,6 +1967,10 @@ mpls_return_enum ldp_cfg_session_get(mpls_cfg_handle handle, ldp_session * s,
   if (flag & LDP_SESSION_CFG_MESG_RX) {
     s->mesg_rx = session->mesg_rx;
   }
+  if (flag & LDP_SESSION_CFG_INITIAL) {
+    s->initial_fec_done = session->initial_fec_done;
+    s->initial_fec_total = session->initial_fec_total;
+  }
   if (flag & LDP_SESSION_CFG_LOCAL_NAME) {
     if (mpls_socket_handle_verify(global->socket_handle,
       session->socket) == MPLS_BOOL_TRUE) {
@@ -2032,7 +2001,6 @@ mpls_return_enum ldp_cfg_session_getnext(mpls_cfg_handle handle, ldp_session * s
   ldp_global *g = (ldp_global *) handle;
   ldp_session *ses = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(g->user_data, "ldp_cfg_session_getnext");
@@ -2044,19 +2012,7 @@ mpls_return_enum ldp_cfg_session_getnext(mpls_cfg_handle handle, ldp_session * s
   }
 
   mpls_lock_get(g->global_lock); /* LOCK */
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_session_index(g, index, &ses))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_session_next(g, index, &ses);
   mpls_lock_release(g->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
@@ -2248,7 +2204,6 @@ mpls_return_enum ldp_cfg_inlabel_getnext(mpls_cfg_handle handle, ldp_inlabel * i
   ldp_global *g = (ldp_global *) handle;
   ldp_inlabel *inlabel = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(g->user_data, "ldp_cfg_inlabel_getnext");
@@ -2260,19 +2215,7 @@ mpls_return_enum ldp_cfg_inlabel_getnext(mpls_cfg_handle handle, ldp_inlabel * i
   }
 
   mpls_lock_get(g->global_lock); /* LOCK */
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_inlabel_index(g, index, &inlabel))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_inlabel_next(g, index, &inlabel);
   mpls_lock_release(g->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
@@ -2338,7 +2281,6 @@ mpls_return_enum ldp_cfg_outlabel_getnext(mpls_cfg_handle handle,
   ldp_global *g = (ldp_global *) handle;
   ldp_outlabel *outlabel = NULL;
   mpls_return_enum r = MPLS_FAILURE;
-  mpls_bool done = MPLS_BOOL_FALSE;
   int index;
 
   LDP_ENTER(g->user_data, "ldp_cfg_outlabel_getnext");
@@ -2350,19 +2292,7 @@ mpls_return_enum ldp_cfg_outlabel_getnext(mpls_cfg_handle handle,
   }
 
   mpls_lock_get(g->global_lock); /* LOCK */
-  while (done == MPLS_BOOL_FALSE) {
-    switch ((r = ldp_global_find_outlabel_index(g, index, &outlabel))) {
-      case MPLS_SUCCESS:
-      case MPLS_END_OF_LIST:
-        done = MPLS_BOOL_TRUE;
-        break;
-      case MPLS_FAILURE:
-        break;
-      default:
-        MPLS_ASSERT(0);
-    }
-    index++;
-  }
+  r = ldp_global_find_outlabel_next(g, index, &outlabel);
   mpls_lock_release(g->global_lock); /* UNLOCK */
 
   if (r == MPLS_SUCCESS) {
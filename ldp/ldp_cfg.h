@@ -35,6 +35,7 @@
 #define LDP_GLOBAL_CFG_HELLOTIME_INTERVAL	0x00010000
 #define LDP_GLOBAL_CFG_LSR_HANDLE			0x00020000
 #define LDP_GLOBAL_CFG_EDGE_INLABEL			0x00040000
+#define LDP_GLOBAL_CFG_INITIAL_SLICE		0x00080000
 
 #define LDP_GLOBAL_CFG_WHEN_DOWN	(LDP_GLOBAL_CFG_LOCAL_TCP_PORT|\
 					LDP_GLOBAL_CFG_LOCAL_UDP_PORT|\
@@ -128,6 +129,7 @@
 #define LDP_SESSION_CFG_OPER_UP				0x00200000
 #define LDP_SESSION_CFG_LOCAL_NAME			0x00400000
 #define LDP_SESSION_CFG_REMOTE_NAME			0x00800000
+#define LDP_SESSION_CFG_INITIAL				0x01000000
 
 #define LDP_SESSION_RADDR_CFG_ADDR			0x00000002
 #define LDP_SESSION_RADDR_CFG_INDEX			0x00000004
@@ -207,6 +209,8 @@
 
 extern mpls_cfg_handle ldp_cfg_open(mpls_instance_handle data);
 extern void ldp_cfg_close(mpls_cfg_handle handle);
+extern void ldp_cfg_flush(mpls_cfg_handle handle);
+extern void ldp_cfg_policy_apply(mpls_cfg_handle handle);
 
 extern mpls_return_enum ldp_cfg_global_get(mpls_cfg_handle handle,
   ldp_global * g, uint32_t flag);
@@ -229,6 +233,7 @@ extern mpls_return_enum ldp_cfg_attr_get(mpls_cfg_handle handle, ldp_attr * a,
   uint32_t flag);
 extern mpls_return_enum ldp_cfg_attr_getnext(mpls_cfg_handle handle,
   ldp_attr * a, uint32_t flag);
+extern uint32_t ldp_cfg_attr_count(mpls_cfg_handle handle);
 
 extern mpls_return_enum ldp_cfg_peer_get(mpls_cfg_handle handle, ldp_peer * p,
   uint32_t flag);
@@ -243,6 +248,7 @@ extern mpls_return_enum ldp_cfg_fec_get(mpls_cfg_handle handle, mpls_fec * p,
   uint32_t flag);
 extern mpls_return_enum ldp_cfg_fec_getnext(mpls_cfg_handle handle,
   mpls_fec * p, uint32_t flag);
+extern uint32_t ldp_cfg_fec_count(mpls_cfg_handle handle);
 extern mpls_return_enum ldp_cfg_fec_test(mpls_cfg_handle handle, mpls_fec * p,
   uint32_t flag);
 extern mpls_return_enum ldp_cfg_fec_set(mpls_cfg_handle handle, mpls_fec * p,
@@ -24,6 +24,8 @@
 #define LDP_GLOBAL_DEF_SEND_LSRID_MAPPING	MPLS_BOOL_TRUE
 #define LDP_GLOBAL_DEF_NO_ROUTE_RETRY_TIME	10
 #define LDP_GLOBAL_DEF_EDGE_INLABEL			MPLS_BOOL_TRUE
+#define LDP_GLOBAL_DEF_INITIAL_SLICE_FECS	256
+#define LDP_GLOBAL_DEF_INITIAL_SLICE_MSEC	20
 
 #define LDP_ENTITY_DEF_TRANS_ADDR		0
 #define LDP_ENTITY_DEF_PROTO_VER		1
@@ -53,4 +55,14 @@
 
 #define LDP_REQUEST_CHUNK			2
 
+/*
+ * bytes queued to the socket of a session above which bulk sends stop,
+ * they go on once it drained to the low water mark
+ */
+#define LDP_SESSION_TX_HIWAT			(256 * 1024)
+#define LDP_SESSION_TX_LOWAT			(64 * 1024)
+
+/* percent hello intervals are shortened by at most, keeps hellos apart */
+#define LDP_HELLO_JITTER			25
+
 #endif
@@ -304,25 +304,15 @@ void ldp_entity_del_adj(ldp_entity * e, ldp_adj * a)
   MPLS_REFCNT_RELEASE(a, ldp_adj_delete);
 }
 
-ldp_adj *ldp_entity_find_adj(ldp_entity * e, ldp_mesg * msg)
+ldp_adj *ldp_entity_find_adj(ldp_global * g, ldp_entity * e, ldp_mesg * msg)
 {
-  ldp_adj *a = NULL;
   mpls_inet_addr lsraddr;
   int labelspace;
 
-  MPLS_ASSERT(e);
+  MPLS_ASSERT(g && e);
 
   ldp_mesg_hdr_get_labelspace(msg, &labelspace);
   ldp_mesg_hdr_get_lsraddr(msg, &lsraddr);
 
-  a = MPLS_LIST_HEAD(&e->adj_root);
-  while (a != NULL) {
-    if (a->remote_label_space == labelspace &&
-      (!mpls_inet_addr_compare(&lsraddr, &a->remote_lsr_address))) {
-      return a;
-    }
-    a = MPLS_LIST_NEXT(&e->adj_root, a, _entity);
-  }
-
-  return NULL;
+  return ldp_global_find_entity_adj(g, e, &lsraddr, labelspace);
 }
@@ -35,7 +35,8 @@ extern void ldp_entity_del_peer(ldp_entity * e);
 
 extern void ldp_entity_add_adj(ldp_entity * e, ldp_adj * a);
 extern void ldp_entity_del_adj(ldp_entity * e, ldp_adj * a);
-extern ldp_adj *ldp_entity_find_adj(ldp_entity * e, ldp_mesg * msg);
+extern ldp_adj *ldp_entity_find_adj(ldp_global * g, ldp_entity * e,
+  ldp_mesg * msg);
 
 extern mpls_return_enum ldp_entity_set_admin_state(ldp_global * g,
   ldp_entity * e, mpls_admin_state_enum state);
@@ -162,6 +162,12 @@ void ldp_fec_delete(ldp_global *g, ldp_fec * fec)
     inet_ntoa(htonl(fec->info.u.prefix.network.u.ipv4)), fec->info.u.prefix.length);
   ldp_fec_remove(g, &fec->info);
   _ldp_global_del_fec(g, fec);
+  if (fec->fs_slot_us.fs) {
+    mpls_free(fec->fs_slot_us.fs);
+  }
+  if (fec->fs_slot_ds.fs) {
+    mpls_free(fec->fs_slot_ds.fs);
+  }
   mpls_free(fec);
 }
 
@@ -333,8 +339,11 @@ mpls_return_enum ldp_fec_process_add(ldp_global * g, ldp_fec * f,
     if ((us_attr = ldp_attr_find_upstream_state2(g, peer, f,
       LDP_LSP_STATE_MAP_SENT))) {
       /* yep, don't send another */
-      if (ds_attr) {
-	/* we need to XC the label we sent with the one we already have */
+      if (ds_attr && !us_attr->inlabel->outlabel) {
+	/*
+	 * we need to XC the label we sent with the one we already have,
+	 * unless another path of the FEC carries it already
+	 */
         if (ldp_inlabel_add_outlabel(g, us_attr->inlabel,
           ds_attr->outlabel) != MPLS_SUCCESS) {
 	  return MPLS_FAILURE;
@@ -343,6 +352,12 @@ mpls_return_enum ldp_fec_process_add(ldp_global * g, ldp_fec * f,
       goto next_peer;
     }
 
+    /* is the peer allowed to learn about this FEC */
+    if (mpls_policy_export_check(g->user_data, &f->info, &nh->info,
+      ldp_session_lsraddr(peer)) == MPLS_BOOL_FALSE) {
+      goto next_peer;
+    }
+
     /* we need to send a label */
     if (peer->oper_distribution_mode == LDP_DISTRIBUTION_UNSOLICITED) {
       if (g->lsp_control_mode == LDP_CONTROL_INDEPENDENT) {
@@ -410,6 +425,39 @@ mpls_return_enum ldp_fec_process_add(ldp_global * g, ldp_fec * f,
   return MPLS_SUCCESS;           /* FEC.6 */
 }
 
+/*
+ * An inlabel is cross connected to a single outlabel, so with several
+ * paths only one of them carries transit traffic.  When that one goes
+ * away, move the upstream labels of the FEC over to ds_attr.
+ */
+static void ldp_fec_reconnect_upstream(ldp_global * g, ldp_fec * f,
+  ldp_attr * ds_attr)
+{
+  ldp_attr *us_attr;
+  ldp_fs *fs;
+
+  if (!ds_attr->outlabel) {
+    return;
+  }
+
+  fs = MPLS_LIST_HEAD(&f->fs_root_us);
+  while (fs) {
+    if (fs->session->index != ds_attr->session->index) {
+      us_attr = MPLS_LIST_HEAD(&fs->attr_root);
+      while (us_attr) {
+        if (us_attr->state == LDP_LSP_STATE_MAP_SENT && us_attr->inlabel &&
+          !us_attr->inlabel->outlabel &&
+          (!us_attr->ds_attr || us_attr->ds_attr == ds_attr)) {
+          ldp_attr_add_us2ds(us_attr, ds_attr);
+          ldp_inlabel_add_outlabel(g, us_attr->inlabel, ds_attr->outlabel);
+        }
+        us_attr = MPLS_LIST_NEXT(&fs->attr_root, us_attr, _fs);
+      }
+    }
+    fs = MPLS_LIST_NEXT(&f->fs_root_us, fs, _fec);
+  }
+}
+
 mpls_return_enum ldp_fec_process_change(ldp_global * g, ldp_fec * f,
   ldp_nexthop *nh, ldp_nexthop *nh_old, ldp_session *nh_session_old) {
   ldp_session *peer = NULL;
@@ -501,6 +549,9 @@ Detect_Change_Fec_Next_Hop_6:
     MPLS_SUCCESS) { /* NH.12 */
     return MPLS_FAILURE;
   }
+  if (g->label_merge == MPLS_BOOL_TRUE) {
+    ldp_fec_reconnect_upstream(g, f, ds_attr);
+  }
   goto Detect_Change_Fec_Next_Hop_20;
 
 Detect_Change_Fec_Next_Hop_13:
@@ -551,44 +602,203 @@ Detect_Change_Fec_Next_Hop_20:
   return MPLS_SUCCESS;
 }
 
+/* brings the bindings of FEC f with peer in line with the policy */
+static mpls_return_enum ldp_fec_policy_apply_peer(ldp_global * g, ldp_fec * f,
+  ldp_session * peer)
+{
+  mpls_return_enum retval = MPLS_SUCCESS;
+  ldp_attr *us_attr;
+  ldp_attr *ds_attr;
+  ldp_nexthop *nh;
+  mpls_inet_addr *lsraddr;
+  mpls_bool permit;
+
+  nh = MPLS_LIST_HEAD(&f->nh_root);
+  if (!nh) {
+    return MPLS_SUCCESS;
+  }
+  lsraddr = ldp_session_lsraddr(peer);
+
+  permit = mpls_policy_export_check(g->user_data, &f->info, &nh->info,
+    lsraddr);
+  us_attr = ldp_attr_find_upstream_state2(g, peer, f,
+    LDP_LSP_STATE_MAP_SENT);
+  if (us_attr && permit == MPLS_BOOL_TRUE && !us_attr->ds_attr &&
+    g->lsp_control_mode == LDP_CONTROL_ORDERED) {
+    /* we are egress for it, which policy may not allow on any next hop */
+    permit = MPLS_BOOL_FALSE;
+    while (nh && permit == MPLS_BOOL_FALSE) {
+      permit = mpls_policy_egress_check(g->user_data, &f->info, &nh->info);
+      nh = MPLS_LIST_NEXT(&f->nh_root, nh, _fec);
+    }
+  }
+
+  if (us_attr && permit == MPLS_BOOL_FALSE) {
+    MPLS_REFCNT_HOLD(us_attr);
+    ldp_attr_remove_complete(g, us_attr, MPLS_BOOL_FALSE);
+    retval = ldp_label_withdraw_send(g, peer, us_attr, LDP_NOTIF_NONE);
+    MPLS_REFCNT_RELEASE2(g, us_attr, ldp_attr_delete);
+  } else if (!us_attr && permit == MPLS_BOOL_TRUE &&
+    peer->oper_distribution_mode == LDP_DISTRIBUTION_UNSOLICITED) {
+    /* offered via every next hop, as the initial distribution does */
+    nh = MPLS_LIST_HEAD(&f->nh_root);
+    while (nh) {
+      ldp_label_mapping_offer(g, peer, f, nh);
+      nh = MPLS_LIST_NEXT(&f->nh_root, nh, _fec);
+    }
+  }
+
+  ds_attr = ldp_attr_find_downstream_state2(g, peer, f,
+    LDP_LSP_STATE_MAP_RECV);
+  if (ds_attr && retval == MPLS_SUCCESS) {
+    /* the next hop the mapping came from, if peer is one (LMp.11) */
+    nh = ldp_nexthop_for_fec_session(f, peer);
+    if (!nh) {
+      nh = MPLS_LIST_HEAD(&f->nh_root);
+    }
+    permit = mpls_policy_import_check(g->user_data, &f->info, &nh->info,
+      lsraddr);
+    if (ds_attr->filtered == MPLS_BOOL_TRUE && permit == MPLS_BOOL_TRUE) {
+      ds_attr->filtered = MPLS_BOOL_FALSE;
+      retval = ldp_label_mapping_process(g, peer, NULL, NULL, ds_attr, f);
+      ldp_fec_reconnect_upstream(g, f, ds_attr);
+    } else if (ds_attr->filtered == MPLS_BOOL_FALSE &&
+      permit == MPLS_BOOL_FALSE) {
+      retval = ldp_label_mapping_filter(g, peer, ds_attr);
+    }
+  }
+
+  return retval;
+}
+
+/*
+ * Brings the existing bindings in line with a changed policy without a
+ * session reset. Mappings a peer may no longer learn are withdrawn, and
+ * peers that may now learn a FEC are offered it. Received mappings the
+ * import policy now rejects are taken out of use but kept, without a
+ * release, so they are processed again once it lets them through.
+ *
+ * A peer whose socket has too much queued is left behind at the FEC it
+ * got to, ldp_fec_policy_resume() takes it from there once it drained.
+ */
+mpls_return_enum ldp_fec_policy_apply(ldp_global * g)
+{
+  mpls_return_enum retval = MPLS_SUCCESS;
+  ldp_session *peer;
+  ldp_fec *f, *next;
+
+  LDP_ENTER(g->user_data, "ldp_fec_policy_apply");
+
+  /* a walk left behind has to start over with the new policy */
+  peer = MPLS_LIST_HEAD(&g->session);
+  while (peer) {
+    peer->policy_fec_index = 0;
+    peer = MPLS_LIST_NEXT(&g->session, peer, _global);
+  }
+
+  f = MPLS_LIST_HEAD(&g->fec);
+  while (f && retval == MPLS_SUCCESS) {
+    MPLS_REFCNT_HOLD(f);
+
+    peer = MPLS_LIST_HEAD(&g->session);
+    while (peer && retval == MPLS_SUCCESS) {
+      if (peer->state != LDP_STATE_OPERATIONAL ||
+        peer->policy_pending == MPLS_BOOL_TRUE) {
+        goto next_peer;
+      }
+      if (ldp_session_tx_blocked(g, peer) == MPLS_BOOL_TRUE) {
+        peer->policy_pending = MPLS_BOOL_TRUE;
+        peer->policy_fec_index = f->index;
+        goto next_peer;
+      }
+      retval = ldp_fec_policy_apply_peer(g, f, peer);
+
+    next_peer:
+      peer = MPLS_LIST_NEXT(&g->session, peer, _global);
+    }
+
+    next = MPLS_LIST_NEXT(&g->fec, f, _global);
+    MPLS_REFCNT_RELEASE2(g, f, ldp_fec_delete);
+    f = next;
+  }
+
+  LDP_EXIT(g->user_data, "ldp_fec_policy_apply");
+
+  return retval;
+}
+
+/* goes on with a policy re-apply that stopped on the backlog of s */
+mpls_return_enum ldp_fec_policy_resume(ldp_global * g, ldp_session * s)
+{
+  mpls_return_enum retval = MPLS_SUCCESS;
+  ldp_fec *f, *next;
+
+  if (s->policy_pending == MPLS_BOOL_FALSE) {
+    return MPLS_SUCCESS;
+  }
+
+  LDP_ENTER(g->user_data, "ldp_fec_policy_resume");
+
+  s->policy_pending = MPLS_BOOL_FALSE;
+  ldp_global_find_fec_next(g, s->policy_fec_index, &f);
+  while (f && retval == MPLS_SUCCESS && s->state == LDP_STATE_OPERATIONAL) {
+    if (ldp_session_tx_blocked(g, s) == MPLS_BOOL_TRUE) {
+      s->policy_pending = MPLS_BOOL_TRUE;
+      s->policy_fec_index = f->index;
+      break;
+    }
+
+    MPLS_REFCNT_HOLD(f);
+    retval = ldp_fec_policy_apply_peer(g, f, s);
+    next = MPLS_LIST_NEXT(&g->fec, f, _global);
+    MPLS_REFCNT_RELEASE2(g, f, ldp_fec_delete);
+    f = next;
+  }
+
+  LDP_EXIT(g->user_data, "ldp_fec_policy_resume");
+
+  return retval;
+}
+
 void mpls_fec2ldp_fec(mpls_fec * a, ldp_fec * b)
 {
   memcpy(&b->info, a, sizeof(mpls_fec));
 }
 
-void mpls_fec2fec_tlv(mpls_fec * lf, mplsLdpFecTlv_t * tlv, int i)
+void mpls_fec2fec_el(mpls_fec * lf, mplsFecElement_t * el, u_short * type)
 {
-  tlv->fecElArray[i].addressEl.addressFam = 1;
+  el->addressEl.addressFam = 1;
 
   switch (lf->type) {
     case MPLS_FEC_PREFIX:
-      tlv->fecElArray[i].addressEl.type = MPLS_PREFIX_FEC;
-      tlv->fecElArray[i].addressEl.preLen = lf->u.prefix.length;
-      tlv->fecElArray[i].addressEl.address = lf->u.prefix.network.u.ipv4;
-      tlv->fecElemTypes[i] = MPLS_PREFIX_FEC;
+      el->addressEl.type = MPLS_PREFIX_FEC;
+      el->addressEl.preLen = lf->u.prefix.length;
+      el->addressEl.address = lf->u.prefix.network.u.ipv4;
+      *type = MPLS_PREFIX_FEC;
       break;
     case MPLS_FEC_HOST:
-      tlv->fecElArray[i].addressEl.type = MPLS_HOSTADR_FEC;
-      tlv->fecElArray[i].addressEl.preLen = MPLS_IPv4LEN;
-      tlv->fecElArray[i].addressEl.address = lf->u.host.u.ipv4;
-      tlv->fecElemTypes[i] = MPLS_HOSTADR_FEC;
+      el->addressEl.type = MPLS_HOSTADR_FEC;
+      el->addressEl.preLen = MPLS_IPv4LEN;
+      el->addressEl.address = lf->u.host.u.ipv4;
+      *type = MPLS_HOSTADR_FEC;
       break;
     default:
       MPLS_ASSERT(0);
   }
 }
 
-void fec_tlv2mpls_fec(mplsLdpFecTlv_t * tlv, int i, mpls_fec * lf) {
-  switch (tlv->fecElemTypes[i]) {
+void fec_el2mpls_fec(mplsFecElement_t * el, u_short type, mpls_fec * lf)
+{
+  switch (type) {
     case MPLS_PREFIX_FEC:
       lf->type = MPLS_FEC_PREFIX;
-      lf->u.prefix.length = tlv->fecElArray[i].addressEl.preLen;
-      lf->u.prefix.network.u.ipv4 = tlv->fecElArray[i].addressEl.address;
+      lf->u.prefix.length = el->addressEl.preLen;
+      lf->u.prefix.network.u.ipv4 = el->addressEl.address;
       lf->u.prefix.network.type = MPLS_FAMILY_IPV4;
       break;
     case MPLS_HOSTADR_FEC:
       lf->type = MPLS_FEC_HOST;
-      lf->u.host.u.ipv4 = tlv->fecElArray[i].addressEl.address;
+      lf->u.host.u.ipv4 = el->addressEl.address;
       lf->u.host.type = MPLS_FAMILY_IPV4;
       break;
     default:
@@ -596,6 +806,15 @@ void fec_tlv2mpls_fec(mplsLdpFecTlv_t * tlv, int i, mpls_fec * lf) {
   }
 }
 
+void mpls_fec2fec_tlv(mpls_fec * lf, mplsLdpFecTlv_t * tlv, int i)
+{
+  mpls_fec2fec_el(lf, &tlv->fecElArray[i], &tlv->fecElemTypes[i]);
+}
+
+void fec_tlv2mpls_fec(mplsLdpFecTlv_t * tlv, int i, mpls_fec * lf) {
+  fec_el2mpls_fec(&tlv->fecElArray[i], tlv->fecElemTypes[i], lf);
+}
+
 mpls_bool ldp_fec_empty(ldp_fec *fec)
 {
   if (MPLS_LIST_EMPTY(&fec->fs_root_us) && 
@@ -26,9 +26,14 @@ extern mpls_return_enum ldp_fec_process_add(ldp_global * g, ldp_fec * f,
 extern mpls_return_enum ldp_fec_process_change(ldp_global * g, ldp_fec * f,
   ldp_nexthop *nh, ldp_nexthop *nh_old, ldp_session * nh_session_old);
 
+extern mpls_return_enum ldp_fec_policy_apply(ldp_global * g);
+extern mpls_return_enum ldp_fec_policy_resume(ldp_global * g, ldp_session * s);
 extern mpls_bool ldp_fec_empty(ldp_fec *fec);
 extern void mpls_fec2ldp_fec(mpls_fec * a, ldp_fec * b);
 extern void fec_tlv2mpls_fec(mplsLdpFecTlv_t * tlv, int num, mpls_fec * lf);
 extern void mpls_fec2fec_tlv(mpls_fec * lf, mplsLdpFecTlv_t * tlv, int num);
+extern void fec_el2mpls_fec(mplsFecElement_t * el, u_short type, mpls_fec * lf);
+extern void mpls_fec2fec_el(mpls_fec * lf, mplsFecElement_t * el,
+  u_short * type);
 
 #endif
@@ -28,6 +28,9 @@
 #include "ldp_tunnel.h"
 #include "ldp_resource.h"
 #include "ldp_hop_list.h"
+#include "ldp_index.h"
+#include "ldp_mesg.h"
+#include "ldp_buf.h"
 
 #include "mpls_compare.h"
 
@@ -47,6 +50,61 @@
 #include "mpls_mpls_impl.h"
 #endif
 
+/*
+ * Objects get increasing indexes, so adding at the tail keeps the global
+ * lists sorted by index.  The backward walk only happens when an older
+ * object is added late or after the index counter wrapped.
+ */
+#define LDP_GLOBAL_ADD_ORDERED(root, elm, type) {			\
+  type *_p = MPLS_LIST_TAIL(root);					\
+  type *_n;								\
+  while (_p != NULL && _p->index > (elm)->index) {			\
+    _p = MPLS_LIST_PREV(root, _p, _global);				\
+  }									\
+  if (_p == NULL) {							\
+    MPLS_LIST_ADD_HEAD(root, elm, _global, type);			\
+  } else if ((_n = MPLS_LIST_NEXT(root, _p, _global)) == NULL) {	\
+    MPLS_LIST_ADD_TAIL(root, elm, _global, type);			\
+  } else {								\
+    MPLS_LIST_INSERT_BEFORE(root, _n, elm, _global);			\
+  }									\
+}
+
+#define LDP_GLOBAL_NEXT_PROBES 8
+
+/*
+ * ldp_global_find_*_next return the first object with an index of at
+ * least 'index'.  The cfg getnext functions pass the last index they
+ * returned plus one, so a walk over a whole table is O(n).  The caller's
+ * cursor is normally still alive and the walk resumes right after it,
+ * if it is gone the successor is usually one of the next indexes.
+ */
+#define LDP_GLOBAL_FIND_NEXT(root, table, index, type, result) {	\
+  type *_e = NULL;							\
+  type *_p;								\
+  int _probe;								\
+  if ((index) <= 1) {							\
+    _e = MPLS_LIST_HEAD(root);						\
+  } else if ((_e = (type *) ldp_index_lookup(table, (index) - 1))) {	\
+    _e = MPLS_LIST_NEXT(root, _e, _global);				\
+  } else {								\
+    for (_probe = 0; _probe < LDP_GLOBAL_NEXT_PROBES && !_e; _probe++) {	\
+      _e = (type *) ldp_index_lookup(table, (index) + _probe);		\
+    }									\
+    if (!_e) {								\
+      _e = MPLS_LIST_TAIL(root);					\
+      while (_e && (_p = MPLS_LIST_PREV(root, _e, _global)) &&		\
+        _p->index >= (index)) {						\
+        _e = _p;							\
+      }									\
+      if (_e && _e->index < (index)) {					\
+        _e = NULL;							\
+      }									\
+    }									\
+  }									\
+  (result) = _e;							\
+}
+
 ldp_global *ldp_global_create(mpls_instance_handle data)
 {
   ldp_global *g = (ldp_global *) mpls_malloc(sizeof(ldp_global));
@@ -74,6 +132,23 @@ ldp_global *ldp_global_create(mpls_instance_handle data)
     MPLS_LIST_INIT(&g->adj, ldp_adj);
     MPLS_LIST_INIT(&g->iff, ldp_if);
 
+    ldp_index_init(&g->outlabel_index);
+    ldp_index_init(&g->resource_index);
+    ldp_index_init(&g->hop_list_index);
+    ldp_index_init(&g->inlabel_index);
+    ldp_index_init(&g->session_index);
+    ldp_index_init(&g->tunnel_index);
+    ldp_index_init(&g->entity_index);
+    ldp_index_init(&g->peer_index);
+    ldp_index_init(&g->attr_index);
+    ldp_index_init(&g->addr_index);
+    ldp_index_init(&g->adj_index);
+    ldp_index_init(&g->if_index);
+    ldp_index_init(&g->fec_index);
+    ldp_index_init(&g->peer_addr_hash);
+    ldp_index_init(&g->if_handle_hash);
+    ldp_index_init(&g->adj_ldpid_hash);
+
     g->message_identifier = 1;
     g->configuration_sequence_number = 1;
     g->lsp_control_mode = LDP_GLOBAL_DEF_CONTROL_MODE;
@@ -90,6 +165,8 @@ ldp_global *ldp_global_create(mpls_instance_handle data)
     g->send_lsrid_mapping = LDP_GLOBAL_DEF_SEND_LSRID_MAPPING;
     g->no_route_to_peer_time = LDP_GLOBAL_DEF_NO_ROUTE_RETRY_TIME;
 	g->edge_inlabel = LDP_GLOBAL_DEF_EDGE_INLABEL;
+    g->initial_slice_fecs = LDP_GLOBAL_DEF_INITIAL_SLICE_FECS;
+    g->initial_slice_msec = LDP_GLOBAL_DEF_INITIAL_SLICE_MSEC;
 
     g->keepalive_timer = LDP_ENTITY_DEF_KEEPALIVE_TIMER;
     g->keepalive_interval = LDP_ENTITY_DEF_KEEPALIVE_INTERVAL;
@@ -102,6 +179,9 @@ ldp_global *ldp_global_create(mpls_instance_handle data)
     g->addr_tree = mpls_tree_create(32);
     g->fec_tree = mpls_tree_create(32);
 
+    g->rx_buffer = ldp_buf_create(MPLS_PDUMAXLEN);
+    g->rx_mesg = ldp_mesg_create();
+
     mpls_lock_release(g->global_lock);
 
     LDP_EXIT(g->user_data, "ldp_global_create");
@@ -421,6 +501,33 @@ mpls_return_enum ldp_global_delete(ldp_global * g)
     mpls_tree_delete(g->addr_tree);
     mpls_tree_delete(g->fec_tree);
 
+    if (g->session_slot) {
+      mpls_free(g->session_slot);
+    }
+    if (g->rx_buffer) {
+      ldp_buf_delete(g->rx_buffer);
+    }
+    if (g->rx_mesg) {
+      ldp_mesg_delete(g->rx_mesg);
+    }
+
+    ldp_index_clear(&g->outlabel_index);
+    ldp_index_clear(&g->resource_index);
+    ldp_index_clear(&g->hop_list_index);
+    ldp_index_clear(&g->inlabel_index);
+    ldp_index_clear(&g->session_index);
+    ldp_index_clear(&g->tunnel_index);
+    ldp_index_clear(&g->entity_index);
+    ldp_index_clear(&g->peer_index);
+    ldp_index_clear(&g->attr_index);
+    ldp_index_clear(&g->addr_index);
+    ldp_index_clear(&g->adj_index);
+    ldp_index_clear(&g->if_index);
+    ldp_index_clear(&g->fec_index);
+    ldp_index_clear(&g->peer_addr_hash);
+    ldp_index_clear(&g->if_handle_hash);
+    ldp_index_clear(&g->adj_ldpid_hash);
+
     mpls_lock_delete(g->global_lock);
     LDP_PRINT(g->user_data, "global delete\n");
     mpls_free(g);
@@ -430,50 +537,71 @@ mpls_return_enum ldp_global_delete(ldp_global * g)
 
 void _ldp_global_add_attr(ldp_global * g, ldp_attr * a)
 {
-  ldp_attr *ap = NULL;
-
   MPLS_ASSERT(g && a);
-  ap = MPLS_LIST_HEAD(&g->attr);
-  while (ap != NULL) {
-    if (ap->index > a->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->attr, ap, a, _global);
-      return;
-    }
-    ap = MPLS_LIST_NEXT(&g->attr, ap, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->attr, a, _global, ldp_attr);
+  LDP_GLOBAL_ADD_ORDERED(&g->attr, a, ldp_attr);
+  ldp_index_insert(&g->attr_index, a->index, a);
 }
 
 void _ldp_global_del_attr(ldp_global * g, ldp_attr * a)
 {
   MPLS_ASSERT(g && a);
   MPLS_LIST_REMOVE(&g->attr, a, _global);
+  ldp_index_remove(&g->attr_index, a->index);
 }
 
-void _ldp_global_add_peer(ldp_global * g, ldp_peer * p)
+/*
+ * Keys of the lookup hashes.  They only pick a bucket, every hit is
+ * compared in full, so collisions do no harm.  0 marks an empty slot.
+ */
+static uint32_t _ldp_global_hash_key(uint32_t v)
+{
+  return v ? v : 1;
+}
+
+static uint32_t _ldp_global_peer_key(mpls_inet_addr * addr)
 {
-  ldp_peer *pp = NULL;
+  return _ldp_global_hash_key(addr->u.ipv4);
+}
+
+static uint32_t _ldp_global_if_key(mpls_if_handle handle)
+{
+  return _ldp_global_hash_key((uint32_t)(unsigned long) handle);
+}
+
+static uint32_t _ldp_global_adj_key(mpls_inet_addr * lsraddr, int labelspace)
+{
+  return _ldp_global_hash_key(lsraddr->u.ipv4 ^
+    ((uint32_t) labelspace * 2654435761U));
+}
 
+void _ldp_global_add_peer(ldp_global * g, ldp_peer * p)
+{
   MPLS_ASSERT(g && p);
   MPLS_REFCNT_HOLD(p);
-  pp = MPLS_LIST_HEAD(&g->peer);
-  while (pp != NULL) {
-    if (pp->index > p->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->peer, pp, p, _global);
-      return;
-    }
-    pp = MPLS_LIST_NEXT(&g->peer, pp, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->peer, p, _global, ldp_peer);
+  LDP_GLOBAL_ADD_ORDERED(&g->peer, p, ldp_peer);
+  ldp_index_insert(&g->peer_index, p->index, p);
+  ldp_index_add(&g->peer_addr_hash, _ldp_global_peer_key(&p->dest.addr), p);
 }
 
 void _ldp_global_del_peer(ldp_global * g, ldp_peer * p)
 {
   MPLS_ASSERT(g && p);
   MPLS_LIST_REMOVE(&g->peer, p, _global);
+  ldp_index_remove(&g->peer_index, p->index);
+  ldp_index_del(&g->peer_addr_hash, _ldp_global_peer_key(&p->dest.addr), p);
   MPLS_REFCNT_RELEASE(p, ldp_peer_delete);
 }
 
+/* a peer in the global list only changes its address through here */
+void _ldp_global_set_peer_addr(ldp_global * g, ldp_peer * p,
+  mpls_inet_addr * addr)
+{
+  MPLS_ASSERT(g && p && addr);
+  ldp_index_del(&g->peer_addr_hash, _ldp_global_peer_key(&p->dest.addr), p);
+  memcpy(&p->dest.addr, addr, sizeof(mpls_inet_addr));
+  ldp_index_add(&g->peer_addr_hash, _ldp_global_peer_key(&p->dest.addr), p);
+}
+
 /*
  * _ldp_global_add_if/del_if and _ldp_global_add_addr/del_addr are
  * not the same as the rest of the global_add/del functions.  They
@@ -483,112 +611,122 @@ void _ldp_global_del_peer(ldp_global * g, ldp_peer * p)
 
 void _ldp_global_add_if(ldp_global * g, ldp_if * i)
 {
-  ldp_if *ip = NULL;
-
   MPLS_ASSERT(g && i);
-  ip = MPLS_LIST_HEAD(&g->iff);
-  while (ip != NULL) {
-    if (ip->index > i->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->iff, ip, i, _global);
-      return;
-    }
-    ip = MPLS_LIST_NEXT(&g->iff, ip, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->iff, i, _global, ldp_if);
+  LDP_GLOBAL_ADD_ORDERED(&g->iff, i, ldp_if);
+  ldp_index_insert(&g->if_index, i->index, i);
+  ldp_index_add(&g->if_handle_hash, _ldp_global_if_key(i->handle), i);
 }
 
 void _ldp_global_del_if(ldp_global * g, ldp_if * i)
 {
   MPLS_ASSERT(g && i);
   MPLS_LIST_REMOVE(&g->iff, i, _global);
+  ldp_index_remove(&g->if_index, i->index);
+  ldp_index_del(&g->if_handle_hash, _ldp_global_if_key(i->handle), i);
 }
 
-void _ldp_global_add_addr(ldp_global * g, ldp_addr * a)
+/* an if in the global list only gets its handle through here */
+void _ldp_global_set_if_handle(ldp_global * g, ldp_if * i,
+  mpls_if_handle handle)
 {
-  ldp_addr *ap = NULL;
+  MPLS_ASSERT(g && i);
+  ldp_index_del(&g->if_handle_hash, _ldp_global_if_key(i->handle), i);
+  i->handle = handle;
+  ldp_index_add(&g->if_handle_hash, _ldp_global_if_key(i->handle), i);
+}
 
+void _ldp_global_add_addr(ldp_global * g, ldp_addr * a)
+{
   MPLS_ASSERT(g && a);
-  ap = MPLS_LIST_HEAD(&g->addr);
-  while (ap != NULL) {
-    if (ap->index > a->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->addr, ap, a, _global);
-      return;
-    }
-    ap = MPLS_LIST_NEXT(&g->addr, ap, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->addr, a, _global, ldp_addr);
+  LDP_GLOBAL_ADD_ORDERED(&g->addr, a, ldp_addr);
+  ldp_index_insert(&g->addr_index, a->index, a);
 }
 
 void _ldp_global_del_addr(ldp_global * g, ldp_addr * a)
 {
   MPLS_ASSERT(g && a);
   MPLS_LIST_REMOVE(&g->addr, a, _global);
+  ldp_index_remove(&g->addr_index, a->index);
 }
 
 void _ldp_global_add_adj(ldp_global * g, ldp_adj * a)
 {
-  ldp_adj *ap = NULL;
-
   MPLS_ASSERT(g && a);
   MPLS_REFCNT_HOLD(a);
-  ap = MPLS_LIST_HEAD(&g->adj);
-  while (ap != NULL) {
-    if (ap->index > a->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->adj, ap, a, _global);
-      return;
-    }
-    ap = MPLS_LIST_NEXT(&g->adj, ap, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->adj, a, _global, ldp_adj);
+  LDP_GLOBAL_ADD_ORDERED(&g->adj, a, ldp_adj);
+  ldp_index_insert(&g->adj_index, a->index, a);
+  ldp_index_add(&g->adj_ldpid_hash,
+    _ldp_global_adj_key(&a->remote_lsr_address, a->remote_label_space), a);
 }
 
 void _ldp_global_del_adj(ldp_global * g, ldp_adj * a)
 {
   MPLS_ASSERT(g && a);
   MPLS_LIST_REMOVE(&g->adj, a, _global);
+  ldp_index_remove(&g->adj_index, a->index);
+  ldp_index_del(&g->adj_ldpid_hash,
+    _ldp_global_adj_key(&a->remote_lsr_address, a->remote_label_space), a);
   MPLS_REFCNT_RELEASE(a, ldp_adj_delete);
 }
 
 void _ldp_global_add_entity(ldp_global * g, ldp_entity * e)
 {
-  ldp_entity *ep = NULL;
-
   MPLS_ASSERT(g && e);
   MPLS_REFCNT_HOLD(e);
-  ep = MPLS_LIST_HEAD(&g->entity);
-  while (ep != NULL) {
-    if (ep->index > e->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->entity, ep, e, _global);
-      return;
-    }
-    ep = MPLS_LIST_NEXT(&g->entity, ep, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->entity, e, _global, ldp_entity);
+  LDP_GLOBAL_ADD_ORDERED(&g->entity, e, ldp_entity);
+  ldp_index_insert(&g->entity_index, e->index, e);
 }
 
 void _ldp_global_del_entity(ldp_global * g, ldp_entity * e)
 {
   MPLS_ASSERT(g && e);
   MPLS_LIST_REMOVE(&g->entity, e, _global);
+  ldp_index_remove(&g->entity_index, e->index);
   MPLS_REFCNT_RELEASE(e, ldp_entity_delete);
 }
 
-void _ldp_global_add_session(ldp_global * g, ldp_session * s)
+static void _ldp_global_add_session_slot(ldp_global * g, ldp_session * s)
 {
-  ldp_session *sp = NULL;
+  ldp_session **slot;
+  int size;
+  int i;
 
-  MPLS_ASSERT(g && s);
-  MPLS_REFCNT_HOLD(s);
-  s->on_global = MPLS_BOOL_TRUE;
-  sp = MPLS_LIST_HEAD(&g->session);
-  while (sp != NULL) {
-    if (sp->index > s->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->session, sp, s, _global);
+  for (i = 0; i < g->session_slot_size; i++) {
+    if (g->session_slot[i] == NULL) {
+      break;
+    }
+  }
+
+  if (i == g->session_slot_size) {
+    size = g->session_slot_size ? g->session_slot_size * 2 : 16;
+    slot = (ldp_session **) mpls_malloc(sizeof(ldp_session *) * size);
+    if (!slot) {
+      /* lookups for this session fall back to walking the lists */
+      s->slot = -1;
       return;
     }
-    sp = MPLS_LIST_NEXT(&g->session, sp, _global);
+    memset(slot, 0, sizeof(ldp_session *) * size);
+    if (g->session_slot) {
+      memcpy(slot, g->session_slot,
+        sizeof(ldp_session *) * g->session_slot_size);
+      mpls_free(g->session_slot);
+    }
+    g->session_slot = slot;
+    g->session_slot_size = size;
   }
-  MPLS_LIST_ADD_TAIL(&g->session, s, _global, ldp_session);
+
+  g->session_slot[i] = s;
+  s->slot = i;
+}
+
+void _ldp_global_add_session(ldp_global * g, ldp_session * s)
+{
+  MPLS_ASSERT(g && s);
+  MPLS_REFCNT_HOLD(s);
+  s->on_global = MPLS_BOOL_TRUE;
+  LDP_GLOBAL_ADD_ORDERED(&g->session, s, ldp_session);
+  ldp_index_insert(&g->session_index, s->index, s);
+  _ldp_global_add_session_slot(g, s);
 }
 
 void _ldp_global_del_session(ldp_global * g, ldp_session * s)
@@ -596,13 +734,17 @@ void _ldp_global_del_session(ldp_global * g, ldp_session * s)
   MPLS_ASSERT(g && s);
   MPLS_ASSERT(s->on_global == MPLS_BOOL_TRUE);
   MPLS_LIST_REMOVE(&g->session, s, _global);
+  ldp_index_remove(&g->session_index, s->index);
+  if (s->slot >= 0) {
+    g->session_slot[s->slot] = NULL;
+    s->slot = -1;
+  }
   s->on_global = MPLS_BOOL_FALSE;
   MPLS_REFCNT_RELEASE(s, ldp_session_delete);
 }
 
 mpls_return_enum _ldp_global_add_inlabel(ldp_global * g, ldp_inlabel * i, ldp_fec *f)
 {
-  ldp_inlabel *ip = NULL;
   mpls_return_enum result;
 
   MPLS_ASSERT(g && i);
@@ -625,15 +767,8 @@ mpls_return_enum _ldp_global_add_inlabel(ldp_global * g, ldp_inlabel * i, ldp_fe
     return result;
   }
 
-  ip = MPLS_LIST_HEAD(&g->inlabel);
-  while (ip != NULL) {
-    if (ip->index > i->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->inlabel, ip, i, _global);
-      return MPLS_SUCCESS;
-    }
-    ip = MPLS_LIST_NEXT(&g->inlabel, ip, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->inlabel, i, _global, ldp_inlabel);
+  LDP_GLOBAL_ADD_ORDERED(&g->inlabel, i, ldp_inlabel);
+  ldp_index_insert(&g->inlabel_index, i->index, i);
   return MPLS_SUCCESS;
 }
 
@@ -651,12 +786,12 @@ mpls_return_enum _ldp_global_del_inlabel(ldp_global * g, ldp_inlabel * i)
   mpls_mpls_insegment_del(g->mpls_handle, &i->info);
 #endif
   MPLS_LIST_REMOVE(&g->inlabel, i, _global);
+  ldp_index_remove(&g->inlabel_index, i->index);
   return MPLS_SUCCESS;
 }
 
 mpls_return_enum _ldp_global_add_outlabel(ldp_global * g, ldp_outlabel * o)
 {
-  ldp_outlabel *op = NULL;
   mpls_return_enum result;
 
   MPLS_ASSERT(g && o);
@@ -679,15 +814,8 @@ mpls_return_enum _ldp_global_add_outlabel(ldp_global * g, ldp_outlabel * o)
   }
 
   o->switching = MPLS_BOOL_TRUE;
-  op = MPLS_LIST_HEAD(&g->outlabel);
-  while (op != NULL) {
-    if (op->index > o->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->outlabel, op, o, _global);
-      return MPLS_SUCCESS;
-    }
-    op = MPLS_LIST_NEXT(&g->outlabel, op, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->outlabel, o, _global, ldp_outlabel);
+  LDP_GLOBAL_ADD_ORDERED(&g->outlabel, o, ldp_outlabel);
+  ldp_index_insert(&g->outlabel_index, o->index, o);
   return MPLS_SUCCESS;
 }
 
@@ -707,6 +835,7 @@ mpls_return_enum _ldp_global_del_outlabel(ldp_global * g, ldp_outlabel * o)
   o->switching = MPLS_BOOL_FALSE;
   MPLS_ASSERT(o->merge_count == 0);
   MPLS_LIST_REMOVE(&g->outlabel, o, _global);
+  ldp_index_remove(&g->outlabel_index, o->index);
   return MPLS_SUCCESS;
 }
 
@@ -722,8 +851,13 @@ mpls_return_enum ldp_global_find_attr_index(ldp_global * g, uint32_t index,
 
     a = MPLS_LIST_TAIL(&g->attr);
     if (a == NULL || a->index < index) {
-      return MPLS_END_OF_LIST;
       *attr = NULL;
+      return MPLS_END_OF_LIST;
+    }
+
+    if (g->attr_index.incomplete == MPLS_BOOL_FALSE) {
+      *attr = (ldp_attr *) ldp_index_lookup(&g->attr_index, index);
+      return (*attr) ? MPLS_SUCCESS : MPLS_FAILURE;
     }
 
     a = MPLS_LIST_HEAD(&g->attr);
@@ -755,6 +889,11 @@ mpls_return_enum ldp_global_find_session_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->session_index.incomplete == MPLS_BOOL_FALSE) {
+      *session = (ldp_session *) ldp_index_lookup(&g->session_index, index);
+      return (*session) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     s = MPLS_LIST_HEAD(&g->session);
     while (s != NULL) {
       if (s->index == index) {
@@ -784,6 +923,11 @@ mpls_return_enum ldp_global_find_inlabel_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->inlabel_index.incomplete == MPLS_BOOL_FALSE) {
+      *inlabel = (ldp_inlabel *) ldp_index_lookup(&g->inlabel_index, index);
+      return (*inlabel) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     i = MPLS_LIST_HEAD(&g->inlabel);
     while (i != NULL) {
       if (i->index == index) {
@@ -813,6 +957,11 @@ mpls_return_enum ldp_global_find_outlabel_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->outlabel_index.incomplete == MPLS_BOOL_FALSE) {
+      *outlabel = (ldp_outlabel *) ldp_index_lookup(&g->outlabel_index, index);
+      return (*outlabel) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     o = MPLS_LIST_HEAD(&g->outlabel);
     while (o != NULL) {
       if (o->index == index) {
@@ -858,6 +1007,11 @@ mpls_return_enum ldp_global_find_entity_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->entity_index.incomplete == MPLS_BOOL_FALSE) {
+      *entity = (ldp_entity *) ldp_index_lookup(&g->entity_index, index);
+      return (*entity) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     e = MPLS_LIST_HEAD(&g->entity);
     while (e != NULL) {
       if (e->index == index) {
@@ -874,12 +1028,19 @@ mpls_return_enum ldp_global_find_entity_index(ldp_global * g, uint32_t index,
 ldp_peer *ldp_global_find_peer_addr(ldp_global * g, mpls_inet_addr * addr)
 {
   ldp_peer *p;
+  uint32_t pos = 0;
 
   MPLS_ASSERT(g && addr);
 
-  /* JLEU: we will need to add a tree to optimize this search,
-     known peers will be in tree, unknown will take a "slow path" to
-     verify them, then be added to tree */
+  if (g->peer_addr_hash.incomplete == MPLS_BOOL_FALSE) {
+    while ((p = ldp_index_next(&g->peer_addr_hash,
+      _ldp_global_peer_key(addr), &pos))) {
+      if (!mpls_inet_addr_compare(&p->dest.addr, addr)) {
+        return p;
+      }
+    }
+    return NULL;
+  }
 
   p = MPLS_LIST_HEAD(&g->peer);
   while (p) {
@@ -905,8 +1066,13 @@ mpls_return_enum ldp_global_find_adj_index(ldp_global * g, uint32_t index,
 
     a = MPLS_LIST_TAIL(&g->adj);
     if (a == NULL || a->index < index) {
-      return MPLS_END_OF_LIST;
       *adj = NULL;
+      return MPLS_END_OF_LIST;
+    }
+
+    if (g->adj_index.incomplete == MPLS_BOOL_FALSE) {
+      *adj = (ldp_adj *) ldp_index_lookup(&g->adj_index, index);
+      return (*adj) ? MPLS_SUCCESS : MPLS_FAILURE;
     }
 
     a = MPLS_LIST_HEAD(&g->adj);
@@ -937,6 +1103,11 @@ mpls_return_enum ldp_global_find_peer_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->peer_index.incomplete == MPLS_BOOL_FALSE) {
+      *peer = (ldp_peer *) ldp_index_lookup(&g->peer_index, index);
+      return (*peer) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     p = MPLS_LIST_HEAD(&g->peer);
     while (p != NULL) {
       if (p->index == index) {
@@ -965,6 +1136,11 @@ mpls_return_enum ldp_global_find_fec_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->fec_index.incomplete == MPLS_BOOL_FALSE) {
+      *fec = (ldp_fec *) ldp_index_lookup(&g->fec_index, index);
+      return (*fec) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     f = MPLS_LIST_HEAD(&g->fec);
     while (f != NULL) {
       if (f->index == index) {
@@ -1012,6 +1188,11 @@ mpls_return_enum ldp_global_find_addr_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->addr_index.incomplete == MPLS_BOOL_FALSE) {
+      *addr = (ldp_addr *) ldp_index_lookup(&g->addr_index, index);
+      return (*addr) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     a = MPLS_LIST_HEAD(&g->addr);
     while (a != NULL) {
       if (a->index == index) {
@@ -1041,6 +1222,11 @@ mpls_return_enum ldp_global_find_if_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->if_index.incomplete == MPLS_BOOL_FALSE) {
+      *iff = (ldp_if *) ldp_index_lookup(&g->if_index, index);
+      return (*iff) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     i = MPLS_LIST_HEAD(&g->iff);
     while (i != NULL) {
       if (i->index == index) {
@@ -1056,9 +1242,22 @@ mpls_return_enum ldp_global_find_if_index(ldp_global * g, uint32_t index,
 
 ldp_if *ldp_global_find_if_handle(ldp_global * g, mpls_if_handle handle)
 {
-  ldp_if *i = MPLS_LIST_HEAD(&g->iff);
+  ldp_if *i;
+  uint32_t pos = 0;
 
   if (g) {
+    /*
+     * the hash knows handles by identity, which is what the porting layer
+     * hands us on receive; an equal handle that is another object is
+     * still found by walking the list
+     */
+    while ((i = ldp_index_next(&g->if_handle_hash, _ldp_global_if_key(handle),
+      &pos))) {
+      if (i->handle == handle)
+        return i;
+    }
+
+    i = MPLS_LIST_HEAD(&g->iff);
     while (i != NULL) {
       if (mpls_ifmgr_compare(g->ifmgr_handle, i->handle, handle) == MPLS_SUCCESS)
         return i;
@@ -1072,9 +1271,20 @@ ldp_if *ldp_global_find_if_handle(ldp_global * g, mpls_if_handle handle)
 ldp_adj *ldp_global_find_adj_ldpid(ldp_global * g, mpls_inet_addr * lsraddr,
   int labelspace)
 {
+  ldp_adj *a;
+  uint32_t pos = 0;
+
+  if (g->adj_ldpid_hash.incomplete == MPLS_BOOL_FALSE) {
+    while ((a = ldp_index_next(&g->adj_ldpid_hash,
+      _ldp_global_adj_key(lsraddr, labelspace), &pos))) {
+      if ((!mpls_inet_addr_compare(lsraddr, &a->remote_lsr_address)) &&
+        labelspace == a->remote_label_space)
+        return a;
+    }
+    return NULL;
+  }
 
-  ldp_adj *a = MPLS_LIST_HEAD(&g->adj);
-
+  a = MPLS_LIST_HEAD(&g->adj);
   while (a != NULL) {
     if ((!mpls_inet_addr_compare(lsraddr, &a->remote_lsr_address)) &&
       labelspace == a->remote_label_space)
@@ -1085,6 +1295,34 @@ ldp_adj *ldp_global_find_adj_ldpid(ldp_global * g, mpls_inet_addr * lsraddr,
   return NULL;
 }
 
+/* same as above, but only adjacencies of entity e are considered */
+ldp_adj *ldp_global_find_entity_adj(ldp_global * g, ldp_entity * e,
+  mpls_inet_addr * lsraddr, int labelspace)
+{
+  ldp_adj *a;
+  uint32_t pos = 0;
+
+  if (g->adj_ldpid_hash.incomplete == MPLS_BOOL_FALSE) {
+    while ((a = ldp_index_next(&g->adj_ldpid_hash,
+      _ldp_global_adj_key(lsraddr, labelspace), &pos))) {
+      if (a->entity == e && labelspace == a->remote_label_space &&
+        (!mpls_inet_addr_compare(lsraddr, &a->remote_lsr_address)))
+        return a;
+    }
+    return NULL;
+  }
+
+  a = MPLS_LIST_HEAD(&e->adj_root);
+  while (a != NULL) {
+    if (labelspace == a->remote_label_space &&
+      (!mpls_inet_addr_compare(lsraddr, &a->remote_lsr_address)))
+      return a;
+
+    a = MPLS_LIST_NEXT(&e->adj_root, a, _entity);
+  }
+  return NULL;
+}
+
 mpls_return_enum ldp_global_find_tunnel_index(ldp_global * g, uint32_t index,
   ldp_tunnel ** tunnel)
 {
@@ -1100,6 +1338,11 @@ mpls_return_enum ldp_global_find_tunnel_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->tunnel_index.incomplete == MPLS_BOOL_FALSE) {
+      *tunnel = (ldp_tunnel *) ldp_index_lookup(&g->tunnel_index, index);
+      return (*tunnel) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     t = MPLS_LIST_HEAD(&g->tunnel);
     while (t != NULL) {
       if (t->index == index) {
@@ -1128,6 +1371,11 @@ mpls_return_enum ldp_global_find_resource_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->resource_index.incomplete == MPLS_BOOL_FALSE) {
+      *resource = (ldp_resource *) ldp_index_lookup(&g->resource_index, index);
+      return (*resource) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     r = MPLS_LIST_HEAD(&g->resource);
     while (r != NULL) {
       if (r->index == index) {
@@ -1156,6 +1404,11 @@ mpls_return_enum ldp_global_find_hop_list_index(ldp_global * g, uint32_t index,
       return MPLS_END_OF_LIST;
     }
 
+    if (g->hop_list_index.incomplete == MPLS_BOOL_FALSE) {
+      *hop_list = (ldp_hop_list *) ldp_index_lookup(&g->hop_list_index, index);
+      return (*hop_list) ? MPLS_SUCCESS : MPLS_FAILURE;
+    }
+
     h = MPLS_LIST_HEAD(&g->hop_list);
     while (h != NULL) {
       if (h->index == index) {
@@ -1169,82 +1422,140 @@ mpls_return_enum ldp_global_find_hop_list_index(ldp_global * g, uint32_t index,
   return MPLS_FAILURE;
 }
 
-void _ldp_global_add_tunnel(ldp_global * g, ldp_tunnel * t)
+mpls_return_enum ldp_global_find_entity_next(ldp_global * g, uint32_t index,
+  ldp_entity ** entity)
+{
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->entity, &g->entity_index, index, ldp_entity,
+    *entity);
+  return (*entity) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
+
+mpls_return_enum ldp_global_find_if_next(ldp_global * g, uint32_t index,
+  ldp_if ** iff)
 {
-  ldp_tunnel *tp = NULL;
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->iff, &g->if_index, index, ldp_if, *iff);
+  return (*iff) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
+
+mpls_return_enum ldp_global_find_attr_next(ldp_global * g, uint32_t index,
+  ldp_attr ** attr)
+{
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->attr, &g->attr_index, index, ldp_attr, *attr);
+  return (*attr) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
+
+mpls_return_enum ldp_global_find_peer_next(ldp_global * g, uint32_t index,
+  ldp_peer ** peer)
+{
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->peer, &g->peer_index, index, ldp_peer, *peer);
+  return (*peer) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
 
+mpls_return_enum ldp_global_find_fec_next(ldp_global * g, uint32_t index,
+  ldp_fec ** fec)
+{
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->fec, &g->fec_index, index, ldp_fec, *fec);
+  return (*fec) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
+
+mpls_return_enum ldp_global_find_addr_next(ldp_global * g, uint32_t index,
+  ldp_addr ** addr)
+{
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->addr, &g->addr_index, index, ldp_addr, *addr);
+  return (*addr) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
+
+mpls_return_enum ldp_global_find_adj_next(ldp_global * g, uint32_t index,
+  ldp_adj ** adj)
+{
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->adj, &g->adj_index, index, ldp_adj, *adj);
+  return (*adj) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
+
+mpls_return_enum ldp_global_find_session_next(ldp_global * g, uint32_t index,
+  ldp_session ** session)
+{
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->session, &g->session_index, index, ldp_session,
+    *session);
+  return (*session) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
+
+mpls_return_enum ldp_global_find_inlabel_next(ldp_global * g, uint32_t index,
+  ldp_inlabel ** inlabel)
+{
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->inlabel, &g->inlabel_index, index, ldp_inlabel,
+    *inlabel);
+  return (*inlabel) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
+
+mpls_return_enum ldp_global_find_outlabel_next(ldp_global * g, uint32_t index,
+  ldp_outlabel ** outlabel)
+{
+  MPLS_ASSERT(g);
+  LDP_GLOBAL_FIND_NEXT(&g->outlabel, &g->outlabel_index, index, ldp_outlabel,
+    *outlabel);
+  return (*outlabel) ? MPLS_SUCCESS : MPLS_END_OF_LIST;
+}
+
+void _ldp_global_add_tunnel(ldp_global * g, ldp_tunnel * t)
+{
   MPLS_ASSERT(g && t);
   MPLS_REFCNT_HOLD(t);
-  tp = MPLS_LIST_HEAD(&g->tunnel);
-  while (tp != NULL) {
-    if (tp->index > t->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->tunnel, tp, t, _global);
-      return;
-    }
-    tp = MPLS_LIST_NEXT(&g->tunnel, tp, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->tunnel, t, _global, ldp_tunnel);
+  LDP_GLOBAL_ADD_ORDERED(&g->tunnel, t, ldp_tunnel);
+  ldp_index_insert(&g->tunnel_index, t->index, t);
 }
 
 void _ldp_global_del_tunnel(ldp_global * g, ldp_tunnel * t)
 {
   MPLS_ASSERT(g && t);
   MPLS_LIST_REMOVE(&g->tunnel, t, _global);
+  ldp_index_remove(&g->tunnel_index, t->index);
   MPLS_REFCNT_RELEASE(t, ldp_tunnel_delete);
 }
 
 void _ldp_global_add_resource(ldp_global * g, ldp_resource * r)
 {
-  ldp_resource *rp = NULL;
-
   MPLS_ASSERT(g && r);
   MPLS_REFCNT_HOLD(r);
-  rp = MPLS_LIST_HEAD(&g->resource);
-  while (rp != NULL) {
-    if (rp->index > r->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->resource, rp, r, _global);
-      return;
-    }
-    rp = MPLS_LIST_NEXT(&g->resource, rp, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->resource, r, _global, ldp_resource);
+  LDP_GLOBAL_ADD_ORDERED(&g->resource, r, ldp_resource);
+  ldp_index_insert(&g->resource_index, r->index, r);
 }
 
 void _ldp_global_del_resource(ldp_global * g, ldp_resource * r)
 {
   MPLS_ASSERT(g && r);
   MPLS_LIST_REMOVE(&g->resource, r, _global);
+  ldp_index_remove(&g->resource_index, r->index);
   MPLS_REFCNT_RELEASE(r, ldp_resource_delete);
 }
 
 void _ldp_global_add_hop_list(ldp_global * g, ldp_hop_list * h)
 {
-  ldp_hop_list *hp = NULL;
-
   MPLS_ASSERT(g && h);
   MPLS_REFCNT_HOLD(h);
-  hp = MPLS_LIST_HEAD(&g->hop_list);
-  while (hp != NULL) {
-    if (hp->index > h->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->hop_list, hp, h, _global);
-      return;
-    }
-    hp = MPLS_LIST_NEXT(&g->hop_list, hp, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->hop_list, h, _global, ldp_hop_list);
+  LDP_GLOBAL_ADD_ORDERED(&g->hop_list, h, ldp_hop_list);
+  ldp_index_insert(&g->hop_list_index, h->index, h);
 }
 
 void _ldp_global_del_hop_list(ldp_global * g, ldp_hop_list * h)
 {
   MPLS_ASSERT(g && h);
   MPLS_LIST_REMOVE(&g->hop_list, h, _global);
+  ldp_index_remove(&g->hop_list_index, h->index);
   MPLS_REFCNT_RELEASE(h, ldp_hop_list_delete);
 }
 
 void _ldp_global_add_fec(ldp_global * g, ldp_fec * f)
 {
-  ldp_fec *fp = NULL;
-
   MPLS_ASSERT(g && f);
   /*
    * TESTING: jleu 6/7/2004, since I want the FEC to be cleaned up
@@ -1254,37 +1565,21 @@ void _ldp_global_add_fec(ldp_global * g, ldp_fec * f)
    * ldp_fec_create()
    * MPLS_REFCNT_HOLD(f);
    */
-  fp = MPLS_LIST_HEAD(&g->fec);
-  while (fp != NULL) {
-    if (fp->index > f->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->fec, fp, f, _global);
-      return;
-    }
-    fp = MPLS_LIST_NEXT(&g->fec, fp, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->fec, f, _global, ldp_fec);
+  LDP_GLOBAL_ADD_ORDERED(&g->fec, f, ldp_fec);
+  ldp_index_insert(&g->fec_index, f->index, f);
 }
 
 void _ldp_global_del_fec(ldp_global * g, ldp_fec * f)
 {
   MPLS_ASSERT(g && f);
   MPLS_LIST_REMOVE(&g->fec, f, _global);
+  ldp_index_remove(&g->fec_index, f->index);
 }
 
 void _ldp_global_add_nexthop(ldp_global * g, ldp_nexthop * nh)
 {
-  ldp_nexthop *nhp = NULL;
-
   MPLS_ASSERT(g && nh);
-  nhp = MPLS_LIST_HEAD(&g->nexthop);
-  while (nhp != NULL) {
-    if (nhp->index > nh->index) {
-      MPLS_LIST_INSERT_BEFORE(&g->nexthop, nhp, nh, _global);
-      return;
-    }
-    nhp = MPLS_LIST_NEXT(&g->nexthop, nhp, _global);
-  }
-  MPLS_LIST_ADD_TAIL(&g->nexthop, nh, _global, ldp_nexthop);
+  LDP_GLOBAL_ADD_ORDERED(&g->nexthop, nh, ldp_nexthop);
 }
 
 void _ldp_global_del_nexthop(ldp_global * g, ldp_nexthop * nh)
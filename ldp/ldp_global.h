@@ -22,6 +22,8 @@ extern ldp_peer *ldp_global_find_peer_addr(ldp_global * g,
 extern ldp_if *ldp_global_find_if_handle(ldp_global * g, mpls_if_handle handle);
 extern ldp_adj *ldp_global_find_adj_ldpid(ldp_global * g,
   mpls_inet_addr * lsraddr, int labelspace);
+extern ldp_adj *ldp_global_find_entity_adj(ldp_global * g, ldp_entity * e,
+  mpls_inet_addr * lsraddr, int labelspace);
 
 extern mpls_return_enum ldp_global_find_adj_index(ldp_global * g, uint32_t index, ldp_adj ** adj);
 extern mpls_return_enum ldp_global_find_if_index(ldp_global * g, uint32_t index,
@@ -54,6 +56,26 @@ extern mpls_return_enum ldp_global_find_resource_index(ldp_global * g,
   uint32_t index, ldp_resource ** resource);
 extern mpls_return_enum ldp_global_find_hop_list_index(ldp_global * g,
   uint32_t index, ldp_hop_list ** hop_list);
+extern mpls_return_enum ldp_global_find_entity_next(ldp_global * g,
+  uint32_t index, ldp_entity ** entity);
+extern mpls_return_enum ldp_global_find_if_next(ldp_global * g,
+  uint32_t index, ldp_if ** iff);
+extern mpls_return_enum ldp_global_find_attr_next(ldp_global * g,
+  uint32_t index, ldp_attr ** attr);
+extern mpls_return_enum ldp_global_find_peer_next(ldp_global * g,
+  uint32_t index, ldp_peer ** peer);
+extern mpls_return_enum ldp_global_find_fec_next(ldp_global * g,
+  uint32_t index, ldp_fec ** fec);
+extern mpls_return_enum ldp_global_find_addr_next(ldp_global * g,
+  uint32_t index, ldp_addr ** addr);
+extern mpls_return_enum ldp_global_find_adj_next(ldp_global * g,
+  uint32_t index, ldp_adj ** adj);
+extern mpls_return_enum ldp_global_find_session_next(ldp_global * g,
+  uint32_t index, ldp_session ** session);
+extern mpls_return_enum ldp_global_find_inlabel_next(ldp_global * g,
+  uint32_t index, ldp_inlabel ** inlabel);
+extern mpls_return_enum ldp_global_find_outlabel_next(ldp_global * g,
+  uint32_t index, ldp_outlabel ** outlabel);
 
 extern void _ldp_global_add_entity(ldp_global * g, ldp_entity * e);
 extern void _ldp_global_del_entity(ldp_global * g, ldp_entity * e);
@@ -63,6 +85,8 @@ extern void _ldp_global_del_session(ldp_global * g, ldp_session * s);
 
 extern void _ldp_global_add_peer(ldp_global * g, ldp_peer * p);
 extern void _ldp_global_del_peer(ldp_global * g, ldp_peer * p);
+extern void _ldp_global_set_peer_addr(ldp_global * g, ldp_peer * p,
+  mpls_inet_addr * addr);
 
 extern void _ldp_global_add_fec(ldp_global * g, ldp_fec * l);
 extern void _ldp_global_del_fec(ldp_global * g, ldp_fec * l);
@@ -75,6 +99,8 @@ extern void _ldp_global_del_attr(ldp_global * g, ldp_attr * a);
 
 extern void _ldp_global_add_if(ldp_global * g, ldp_if * i);
 extern void _ldp_global_del_if(ldp_global * g, ldp_if * i);
+extern void _ldp_global_set_if_handle(ldp_global * g, ldp_if * i,
+  mpls_if_handle handle);
 
 extern void _ldp_global_add_addr(ldp_global * g, ldp_addr * a);
 extern void _ldp_global_del_addr(ldp_global * g, ldp_addr * a);
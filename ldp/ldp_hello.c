@@ -117,6 +117,7 @@ mpls_return_enum ldp_hello_send(ldp_global * g, ldp_entity * e)
       MPLS_REFCNT_RELEASE(e, ldp_entity_delete);
       return MPLS_FAILURE;
     }
+    mpls_timer_jitter(g->timer_handle, *timer, LDP_HELLO_JITTER);
     *oper_duration = duration;
     mpls_timer_start(g->timer_handle, *timer, MPLS_TIMER_REOCCURRING);
   } else {
@@ -95,7 +95,7 @@ ldp_if *ldp_if_insert(ldp_global *g, mpls_if_handle handle)
     LDP_PRINT(g->user_data,"ldp_if_insert: unable to alloc ldp_if\n");
     return NULL;
   }
-  iff->handle = handle;
+  _ldp_global_set_if_handle(g, iff, handle);
   return iff;
 }
 
@@ -280,6 +280,7 @@ mpls_return_enum ldp_if_shutdown(ldp_global * g, ldp_if * i)
   if (i->hello) {
     ldp_mesg_delete(i->hello);
     i->hello = NULL;
+    i->tx_buffer->size = 0;
   }
 
   LDP_EXIT(g->user_data, "ldp_if_shutdown");
@@ -0,0 +1,233 @@
+
+/*
+ *  Copyright (C) James R. Leu 2000
+ *  jleu@mindspring.com
+ *
+ *  This software is covered under the LGPL, for more
+ *  info check out http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#include <string.h>
+#include "ldp_struct.h"
+#include "ldp_index.h"
+
+#include "mpls_assert.h"
+#include "mpls_mm_impl.h"
+
+/*
+ * Open addressed map from an object index to the object, used by the
+ * ldp_global_find_*_index functions.  Indexes are never 0, so a slot
+ * with index 0 is empty.  Removal shifts the following run back so no
+ * tombstones are needed and lookups stay short.
+ */
+
+#define LDP_INDEX_MIN_SIZE 64
+
+static uint32_t _ldp_index_hash(ldp_index_table * t, uint32_t index)
+{
+  return (index * 2654435761U) & (t->size - 1);
+}
+
+static mpls_return_enum _ldp_index_resize(ldp_index_table * t, uint32_t size)
+{
+  ldp_index_slot *old = t->slot;
+  uint32_t old_size = t->size;
+  uint32_t i, j;
+
+  t->slot = (ldp_index_slot *) mpls_malloc(sizeof(ldp_index_slot) * size);
+  if (!t->slot) {
+    t->slot = old;
+    return MPLS_FAILURE;
+  }
+  memset(t->slot, 0, sizeof(ldp_index_slot) * size);
+  t->size = size;
+
+  for (i = 0; i < old_size; i++) {
+    if (old[i].index) {
+      j = _ldp_index_hash(t, old[i].index);
+      while (t->slot[j].index) {
+        j = (j + 1) & (t->size - 1);
+      }
+      t->slot[j] = old[i];
+    }
+  }
+
+  if (old) {
+    mpls_free(old);
+  }
+  return MPLS_SUCCESS;
+}
+
+void ldp_index_init(ldp_index_table * t)
+{
+  memset(t, 0, sizeof(ldp_index_table));
+  t->incomplete = MPLS_BOOL_FALSE;
+}
+
+void ldp_index_clear(ldp_index_table * t)
+{
+  if (t->slot) {
+    mpls_free(t->slot);
+  }
+  ldp_index_init(t);
+}
+
+mpls_return_enum ldp_index_insert(ldp_index_table * t, uint32_t index,
+  void *obj)
+{
+  uint32_t i;
+
+  MPLS_ASSERT(t && index);
+
+  /* keep the load below one half */
+  if ((t->count + 1) * 2 > t->size) {
+    if (_ldp_index_resize(t, t->size ? t->size * 2 : LDP_INDEX_MIN_SIZE) !=
+      MPLS_SUCCESS && t->count + 1 >= t->size) {
+      t->incomplete = MPLS_BOOL_TRUE;
+      return MPLS_FAILURE;
+    }
+  }
+
+  i = _ldp_index_hash(t, index);
+  while (t->slot[i].index) {
+    if (t->slot[i].index == index) {
+      t->slot[i].obj = obj;
+      return MPLS_SUCCESS;
+    }
+    i = (i + 1) & (t->size - 1);
+  }
+
+  t->slot[i].index = index;
+  t->slot[i].obj = obj;
+  t->count++;
+  return MPLS_SUCCESS;
+}
+
+static void _ldp_index_remove_slot(ldp_index_table * t, uint32_t i)
+{
+  uint32_t j, k;
+
+  /* pull back entries whose home slot is not between the hole and them */
+  j = i;
+  while (1) {
+    j = (j + 1) & (t->size - 1);
+    if (!t->slot[j].index) {
+      break;
+    }
+    k = _ldp_index_hash(t, t->slot[j].index);
+    if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+      t->slot[i] = t->slot[j];
+      i = j;
+    }
+  }
+
+  t->slot[i].index = 0;
+  t->slot[i].obj = NULL;
+  t->count--;
+}
+
+void ldp_index_remove(ldp_index_table * t, uint32_t index)
+{
+  uint32_t i;
+
+  if (!t->count) {
+    return;
+  }
+
+  i = _ldp_index_hash(t, index);
+  while (t->slot[i].index != index) {
+    if (!t->slot[i].index) {
+      return;
+    }
+    i = (i + 1) & (t->size - 1);
+  }
+
+  _ldp_index_remove_slot(t, i);
+}
+
+void *ldp_index_lookup(ldp_index_table * t, uint32_t index)
+{
+  uint32_t i;
+
+  if (!t->count) {
+    return NULL;
+  }
+
+  i = _ldp_index_hash(t, index);
+  while (t->slot[i].index) {
+    if (t->slot[i].index == index) {
+      return t->slot[i].obj;
+    }
+    i = (i + 1) & (t->size - 1);
+  }
+  return NULL;
+}
+
+/*
+ * ldp_index_add/del/next use a table as a multimap, for keys that are
+ * hashes of something else and may repeat.  The caller checks every
+ * object ldp_index_next returns against what it is looking for.
+ */
+
+mpls_return_enum ldp_index_add(ldp_index_table * t, uint32_t key, void *obj)
+{
+  uint32_t i;
+
+  MPLS_ASSERT(t && key);
+
+  if ((t->count + 1) * 2 > t->size) {
+    if (_ldp_index_resize(t, t->size ? t->size * 2 : LDP_INDEX_MIN_SIZE) !=
+      MPLS_SUCCESS && t->count + 1 >= t->size) {
+      t->incomplete = MPLS_BOOL_TRUE;
+      return MPLS_FAILURE;
+    }
+  }
+
+  i = _ldp_index_hash(t, key);
+  while (t->slot[i].index) {
+    i = (i + 1) & (t->size - 1);
+  }
+
+  t->slot[i].index = key;
+  t->slot[i].obj = obj;
+  t->count++;
+  return MPLS_SUCCESS;
+}
+
+void ldp_index_del(ldp_index_table * t, uint32_t key, void *obj)
+{
+  uint32_t i;
+
+  if (!t->count) {
+    return;
+  }
+
+  i = _ldp_index_hash(t, key);
+  while (t->slot[i].index) {
+    if (t->slot[i].index == key && t->slot[i].obj == obj) {
+      _ldp_index_remove_slot(t, i);
+      return;
+    }
+    i = (i + 1) & (t->size - 1);
+  }
+}
+
+/* *pos must be 0 for the first call, NULL means no more objects */
+void *ldp_index_next(ldp_index_table * t, uint32_t key, uint32_t * pos)
+{
+  uint32_t i;
+
+  if (!t->count) {
+    return NULL;
+  }
+
+  i = (_ldp_index_hash(t, key) + *pos) & (t->size - 1);
+  while (t->slot[i].index) {
+    (*pos)++;
+    if (t->slot[i].index == key) {
+      return t->slot[i].obj;
+    }
+    i = (i + 1) & (t->size - 1);
+  }
+  return NULL;
+}
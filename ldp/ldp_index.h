@@ -0,0 +1,28 @@
+
+/*
+ *  Copyright (C) James R. Leu 2000
+ *  jleu@mindspring.com
+ *
+ *  This software is covered under the LGPL, for more
+ *  info check out http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#ifndef _LDP_INDEX_H_
+#define _LDP_INDEX_H_
+
+#include "ldp_struct.h"
+
+extern void ldp_index_init(ldp_index_table * t);
+extern void ldp_index_clear(ldp_index_table * t);
+
+extern mpls_return_enum ldp_index_insert(ldp_index_table * t, uint32_t index,
+  void *obj);
+extern void ldp_index_remove(ldp_index_table * t, uint32_t index);
+extern void *ldp_index_lookup(ldp_index_table * t, uint32_t index);
+
+extern mpls_return_enum ldp_index_add(ldp_index_table * t, uint32_t key,
+  void *obj);
+extern void ldp_index_del(ldp_index_table * t, uint32_t key, void *obj);
+extern void *ldp_index_next(ldp_index_table * t, uint32_t key, uint32_t * pos);
+
+#endif
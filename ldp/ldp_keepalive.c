@@ -21,37 +21,59 @@
 #include "mpls_lock_impl.h"
 #include "mpls_trace_impl.h"
 
-void ldp_keepalive_timeout_callback(mpls_timer_handle timer, void *extra,
+/* seconds until the next keepalive is due or the hold time runs out */
+static int ldp_keepalive_next(ldp_session * s, uint32_t now)
+{
+  uint32_t tx = s->oper_keepalive_interval * 1000;
+  uint32_t rx = s->oper_keepalive * 1000;
+  uint32_t wait;
+
+  wait = (now - s->last_tx < tx) ? tx - (now - s->last_tx) : 0;
+  if (now - s->last_rx < rx && rx - (now - s->last_rx) < wait) {
+    wait = rx - (now - s->last_rx);
+  }
+  wait = (wait + 999) / 1000;
+  return wait ? wait : 1;
+}
+
+/*
+ * one timer per session takes care of both directions, it fires at the
+ * earlier of the two deadlines and checks them against the times the
+ * session last read and wrote, which message processing keeps current
+ */
+void ldp_keepalive_callback(mpls_timer_handle timer, void *extra,
   mpls_cfg_handle handle)
 {
   ldp_session *s = (ldp_session *) extra;
   ldp_global *g = (ldp_global*)handle;
-
-  LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_TIMER,
-    "Keepalive Timeout fired: session(%d)\n", s->index);
+  uint32_t now;
 
   mpls_lock_get(g->global_lock);
 
-  s->shutdown_notif = LDP_NOTIF_KEEPALIVE_TIMER_EXPIRED;
-  s->shutdown_fatal = MPLS_BOOL_FALSE;
-  /* we should go into backoff, so don't completly kill the session */
-  ldp_session_shutdown(g, s, MPLS_BOOL_FALSE);
-  MPLS_REFCNT_RELEASE(s, ldp_session_delete);
+  now = mpls_timer_get_msec(g->timer_handle);
+  if (now - s->last_rx >= (uint32_t)s->oper_keepalive * 1000) {
+    LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_TIMER,
+      "Keepalive Timeout fired: session(%d)\n", s->index);
 
-  mpls_lock_release(g->global_lock);
-}
+    s->shutdown_notif = LDP_NOTIF_KEEPALIVE_TIMER_EXPIRED;
+    s->shutdown_fatal = MPLS_BOOL_FALSE;
+    /* we should go into backoff, so don't completly kill the session */
+    ldp_session_shutdown(g, s, MPLS_BOOL_FALSE);
+    MPLS_REFCNT_RELEASE(s, ldp_session_delete);
 
-void ldp_keepalive_send_callback(mpls_timer_handle timer, void *extra,
-  mpls_cfg_handle handle)
-{
-  ldp_session *s = (ldp_session *) extra;
-  ldp_global *g = (ldp_global*)handle;
+    mpls_lock_release(g->global_lock);
+    return;
+  }
+
+  if (now - s->last_tx >= (uint32_t)s->oper_keepalive_interval * 1000) {
+    LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_TIMER,
+      "Keepalive Send fired: session(%d)\n", s->index);
+    ldp_keepalive_send(g, s);
+  }
 
-  LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_TIMER,
-    "Keepalive Send fired: session(%d)\n", s->index);
+  mpls_timer_modify(g->timer_handle, timer, ldp_keepalive_next(s, now));
+  mpls_timer_start(g->timer_handle, timer, MPLS_TIMER_ONESHOT);
 
-  mpls_lock_get(g->global_lock);
-  ldp_keepalive_send(g, s);
   mpls_lock_release(g->global_lock);
 }
 
@@ -88,34 +110,24 @@ mpls_return_enum ldp_keepalive_send(ldp_global * g, ldp_session * s)
     ldp_keepalive_set_message_id(s->keepalive, g->message_identifier++);
   }
 
-  if (mpls_timer_handle_verify(g->timer_handle, s->keepalive_recv_timer) ==
-    MPLS_BOOL_FALSE) {
-    MPLS_REFCNT_HOLD(s);
-    s->keepalive_recv_timer = mpls_timer_create(g->timer_handle, MPLS_UNIT_SEC,
-      s->oper_keepalive, (void *)s, g, ldp_keepalive_timeout_callback);
-    if (mpls_timer_handle_verify(g->timer_handle, s->keepalive_recv_timer) ==
-      MPLS_BOOL_FALSE) {
-      MPLS_REFCNT_RELEASE(s, ldp_session_delete);
-      LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_ERROR,
-        "ldp_keepalive_send: error creating timer\n");
-      return MPLS_FAILURE;
-    }
-    mpls_timer_start(g->timer_handle, s->keepalive_recv_timer, MPLS_TIMER_ONESHOT);
-  }
-
-  if (mpls_timer_handle_verify(g->timer_handle, s->keepalive_send_timer) ==
+  if (mpls_timer_handle_verify(g->timer_handle, s->keepalive_timer) ==
     MPLS_BOOL_FALSE) {
     MPLS_REFCNT_HOLD(s);
-    s->keepalive_send_timer = mpls_timer_create(g->timer_handle, MPLS_UNIT_SEC,
-      s->oper_keepalive_interval, (void *)s, g, ldp_keepalive_send_callback);
-    if (mpls_timer_handle_verify(g->timer_handle, s->keepalive_send_timer) ==
+    s->keepalive_timer = mpls_timer_create(g->timer_handle, MPLS_UNIT_SEC,
+      1, (void *)s, g, ldp_keepalive_callback);
+    if (mpls_timer_handle_verify(g->timer_handle, s->keepalive_timer) ==
       MPLS_BOOL_FALSE) {
       MPLS_REFCNT_RELEASE(s, ldp_session_delete);
       LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_ERROR,
         "ldp_keepalive_send: error creating timer\n");
       return MPLS_FAILURE;
     }
-    mpls_timer_start(g->timer_handle, s->keepalive_send_timer, MPLS_TIMER_REOCCURRING);
+    /* the hold time starts now, whatever was read before */
+    ldp_session_maintain_timer(g, s, LDP_KEEPALIVE_RECV);
+    ldp_session_maintain_timer(g, s, LDP_KEEPALIVE_SEND);
+    mpls_timer_modify(g->timer_handle, s->keepalive_timer,
+      ldp_keepalive_next(s, s->last_rx));
+    mpls_timer_start(g->timer_handle, s->keepalive_timer, MPLS_TIMER_ONESHOT);
   }
 
   LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_SEND, LDP_TRACE_FLAG_PERIODIC,
@@ -14,9 +14,7 @@
 
 extern ldp_mesg *ldp_keepalive_create(uint32_t msgid);
 extern mpls_return_enum ldp_keepalive_send(ldp_global * g, ldp_session * s);
-extern void ldp_keepalive_send_callback(mpls_timer_handle timer, void *extra,
-  mpls_cfg_handle g);
-extern void ldp_keepalive_timeout_callback(mpls_timer_handle timer, void *extra,
+extern void ldp_keepalive_callback(mpls_timer_handle timer, void *extra,
   mpls_cfg_handle g);
 extern void ldp_keepalive_set_message_id(ldp_mesg * keep, uint32_t msgid);
 
@@ -52,7 +52,7 @@ mpls_return_enum ldp_label_abort_send(ldp_global * g, ldp_session * s,
 
   LDP_ENTER(g->user_data, "ldp_label_abort_send");
 
-  fec_tlv2mpls_fec(&s_attr->fecTlv, 0, &fec);
+  ldp_attr2mpls_fec(s_attr, &fec);
   if ((ds_attr = ldp_attr_find_downstream_state(g, s, &fec,
         LDP_LSP_STATE_ABORT_SENT)) != NULL) {
     return MPLS_SUCCESS;
@@ -160,6 +160,6 @@ LAbR_12:
   return retval;
 }
 
-void abort2attr(mplsLdpLblAbortMsg_t * abrt, ldp_attr * a, uint32_t flag)
+void abort2attr(ldp_mesg * msg, ldp_attr * a, uint32_t flag)
 {
 }
@@ -22,7 +22,7 @@ extern mpls_return_enum ldp_label_abort_process(ldp_global * g, ldp_session * s,
 extern void Prepare_Label_Abort_Attributes(ldp_global * g, ldp_session * s,
   mpls_fec * fec, ldp_attr * r_attr, ldp_attr * s_attr);
 
-extern void abort2attr(mplsLdpLblAbortMsg_t * abrt, ldp_attr * a,
+extern void abort2attr(ldp_mesg * msg, ldp_attr * a,
   uint32_t flag);
 
 #endif
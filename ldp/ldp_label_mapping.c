@@ -12,6 +12,7 @@
 #include "ldp_attr.h"
 #include "ldp_fec.h"
 #include "ldp_mesg.h"
+#include "ldp_buf.h"
 #include "ldp_notif.h"
 #include "ldp_entity.h"
 #include "ldp_inlabel.h"
@@ -110,9 +111,11 @@ mpls_return_enum ldp_label_mapping_with_xc(ldp_global * g, ldp_session * s,
       if ((*us_attr)->inlabel->outlabel) {
         /*
          * if we use an existing upstream mapping (in ldp_label_mapping_send())
-         * the inlabel will already be be connected to an outlabel;
+         * the inlabel will already be be connected to an outlabel, the one
+         * of another path when the FEC has several
          */
-        MPLS_ASSERT((*us_attr)->inlabel->outlabel == ds_attr->outlabel);
+        MPLS_ASSERT((*us_attr)->inlabel->outlabel == ds_attr->outlabel ||
+          f->nh_root.count > 1);
       } else {
         LDP_TRACE_LOG(g->user_data,MPLS_TRACE_STATE_ALL,LDP_TRACE_FLAG_BINDING,
           "Cross Connect Added for %08x/%d from %s -> %s\n",
@@ -185,9 +188,10 @@ mpls_return_enum Check_Received_Attributes(ldp_global * g, ldp_session * s,
   }
 
   for (i = 0; i < MPLS_MAXHOPSNUMBER; i++) { /* CRa.4 */
-    if (r_attr->pathVecTlv.lsrId[i]) {
+    if (LDP_ATTR_EXT(r_attr)->pathVecTlv.lsrId[i]) {
       count++;
-      if (r_attr->pathVecTlv.lsrId[i] == g->lsr_identifier.u.ipv4) {
+      if (LDP_ATTR_EXT(r_attr)->pathVecTlv.lsrId[i] ==
+        g->lsr_identifier.u.ipv4) {
         goto Check_Received_Attributes_6;
         LDP_PRINT(g->user_data, "CRa.4a\n");
       }
@@ -213,6 +217,7 @@ void Prepare_Label_Mapping_Attributes(ldp_global * g, ldp_session * s,
   mpls_bool already, mpls_bool egress)
 {
   ldp_attr dummy;
+  ldp_attr_ext *ext;
   int i;
 
   /* NOTE: PMpA.21 is the end of the procedure (ie return) */
@@ -223,9 +228,7 @@ void Prepare_Label_Mapping_Attributes(ldp_global * g, ldp_session * s,
 
   if (!r_attr) {
     memset(&dummy, 0, sizeof(ldp_attr));
-    mpls_fec2fec_tlv(fec, &dummy.fecTlv, 0);
-    dummy.fecTlvExists = 1;
-    dummy.fecTlv.numberFecElements = 1;
+    mpls_fec2ldp_attr(fec, &dummy);
     r_attr = &dummy;
   }
 
@@ -314,11 +317,15 @@ Prepare_Label_Mapping_Attributes_14:
   }
 
 Prepare_Label_Mapping_Attributes_19:
+  if ((ext = ldp_attr_ext_get(s_attr)) == NULL) {
+    LDP_EXIT(g->user_data, "Prepare_Label_Mapping_Attributes");
+    return;
+  }
   s_attr->pathVecTlvExists = 1;
-  s_attr->pathVecTlv.lsrId[0] = g->lsr_identifier.u.ipv4;
+  ext->pathVecTlv.lsrId[0] = g->lsr_identifier.u.ipv4;
   for (i = 1; i < (MPLS_MAXHOPSNUMBER - 1); i++) {
-    if (r_attr->pathVecTlv.lsrId[i - 1]) {
-      s_attr->pathVecTlv.lsrId[0] = r_attr->pathVecTlv.lsrId[i - 1];
+    if (LDP_ATTR_EXT(r_attr)->pathVecTlv.lsrId[i - 1]) {
+      ext->pathVecTlv.lsrId[0] = LDP_ATTR_EXT(r_attr)->pathVecTlv.lsrId[i - 1];
     }
   }
 
@@ -326,49 +333,64 @@ Prepare_Label_Mapping_Attributes_19:
   return;
 
 Prepare_Label_Mapping_Attributes_20:
+  if ((ext = ldp_attr_ext_get(s_attr)) == NULL) {
+    LDP_EXIT(g->user_data, "Prepare_Label_Mapping_Attributes");
+    return;
+  }
   s_attr->pathVecTlvExists = 1;
-  s_attr->pathVecTlv.lsrId[0] = g->lsr_identifier.u.ipv4;
+  ext->pathVecTlv.lsrId[0] = g->lsr_identifier.u.ipv4;
 
   LDP_EXIT(g->user_data, "Prepare_Label_Mapping_Attributes");
   return;
 }
 
-void map2attr(mplsLdpLblMapMsg_t * map, ldp_attr * attr, uint32_t flag)
+void map2attr(ldp_mesg * msg, ldp_attr * attr, uint32_t flag)
 {
+  mplsLdpLblMapMsg_t *map = &msg->u.map;
+  ldp_attr_ext *ext;
+
   attr->msg_id = map->baseMsg.msgId;
 
-  if (map->fecTlvExists && flag & LDP_ATTR_FEC) {
-    memcpy(&attr->fecTlv, &map->fecTlv, sizeof(mplsLdpFecTlv_t));
-    attr->fecTlvExists = 1;
+  if (flag & LDP_ATTR_FEC && ldp_mesg_tlv(msg, MPLS_FEC_TLVTYPE)) {
+    fec_tlv2ldp_attr(&map->fecTlv, 0, attr);
   }
-  if (map->genLblTlvExists && flag & LDP_ATTR_LABEL) {
+  if (flag & LDP_ATTR_LABEL && ldp_mesg_tlv(msg, MPLS_GENLBL_TLVTYPE)) {
     memcpy(&attr->genLblTlv, &map->genLblTlv, sizeof(mplsLdpGenLblTlv_t));
     attr->genLblTlvExists = 1;
-  } else if (map->atmLblTlvExists && flag & LDP_ATTR_LABEL) {
+  } else if (flag & LDP_ATTR_LABEL && ldp_mesg_tlv(msg, MPLS_ATMLBL_TLVTYPE)) {
     memcpy(&attr->atmLblTlv, &map->atmLblTlv, sizeof(mplsLdpAtmLblTlv_t));
     attr->atmLblTlvExists = 1;
-  } else if (map->frLblTlvExists && flag & LDP_ATTR_LABEL) {
+  } else if (flag & LDP_ATTR_LABEL && ldp_mesg_tlv(msg, MPLS_FRLBL_TLVTYPE)) {
     memcpy(&attr->frLblTlv, &map->frLblTlv, sizeof(mplsLdpFrLblTlv_t));
     attr->frLblTlvExists = 1;
   }
-  if (map->hopCountTlvExists && flag & LDP_ATTR_HOPCOUNT) {
+  if (flag & LDP_ATTR_HOPCOUNT && ldp_mesg_tlv(msg, MPLS_HOPCOUNT_TLVTYPE)) {
     memcpy(&attr->hopCountTlv, &map->hopCountTlv, sizeof(mplsLdpHopTlv_t));
     attr->hopCountTlvExists = 1;
   }
-  if (map->pathVecTlvExists && flag & LDP_ATTR_PATH) {
-    memcpy(&attr->pathVecTlv, &map->pathVecTlv, sizeof(mplsLdpPathTlv_t));
-    attr->pathVecTlvExists = 1;
-  }
-  if (map->lblMsgIdTlvExists && flag & LDP_ATTR_MSGID) {
+  if (flag & LDP_ATTR_MSGID && ldp_mesg_tlv(msg, MPLS_REQMSGID_TLVTYPE)) {
     memcpy(&attr->lblMsgIdTlv, &map->lblMsgIdTlv, sizeof(mplsLdpLblMsgIdTlv_t));
     attr->lblMsgIdTlvExists = 1;
   }
-  if (map->lspidTlvExists && flag & LDP_ATTR_LSPID) {
-    memcpy(&attr->lspidTlv, &map->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
+
+  if (!(flag & LDP_ATTR_PATH && ldp_mesg_tlv(msg, MPLS_PATH_TLVTYPE)) &&
+    !(flag & LDP_ATTR_LSPID && ldp_mesg_tlv(msg, MPLS_LSPID_TLVTYPE)) &&
+    !(flag & LDP_ATTR_TRAFFIC && ldp_mesg_tlv(msg, MPLS_TRAFFIC_TLVTYPE))) {
+    return;
+  }
+  if ((ext = ldp_attr_ext_get(attr)) == NULL) {
+    return;
+  }
+  if (flag & LDP_ATTR_PATH && ldp_mesg_tlv(msg, MPLS_PATH_TLVTYPE)) {
+    memcpy(&ext->pathVecTlv, &map->pathVecTlv, sizeof(mplsLdpPathTlv_t));
+    attr->pathVecTlvExists = 1;
+  }
+  if (flag & LDP_ATTR_LSPID && ldp_mesg_tlv(msg, MPLS_LSPID_TLVTYPE)) {
+    memcpy(&ext->lspidTlv, &map->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
     attr->lspidTlvExists = 1;
   }
-  if (map->trafficTlvExists && flag & LDP_ATTR_TRAFFIC) {
-    memcpy(&attr->trafficTlv, &map->trafficTlv, sizeof(mplsLdpTrafficTlv_t));
+  if (flag & LDP_ATTR_TRAFFIC && ldp_mesg_tlv(msg, MPLS_TRAFFIC_TLVTYPE)) {
+    memcpy(&ext->trafficTlv, &map->trafficTlv, sizeof(mplsLdpTrafficTlv_t));
     attr->trafficTlvExists = 1;
   }
 }
@@ -376,7 +398,7 @@ void map2attr(mplsLdpLblMapMsg_t * map, ldp_attr * attr, uint32_t flag)
 void attr2map(ldp_attr * attr, mplsLdpLblMapMsg_t * map)
 {
   if (attr->fecTlvExists) {
-    memcpy(&map->fecTlv, &attr->fecTlv, sizeof(mplsLdpFecTlv_t));
+    ldp_attr2fec_tlv(attr, &map->fecTlv);
     map->fecTlvExists = 1;
   }
   if (attr->genLblTlvExists) {
@@ -396,7 +418,7 @@ void attr2map(ldp_attr * attr, mplsLdpLblMapMsg_t * map)
     map->hopCountTlvExists = 1;
   }
   if (attr->pathVecTlvExists) {
-    memcpy(&map->pathVecTlv, &attr->pathVecTlv, sizeof(mplsLdpPathTlv_t));
+    memcpy(&map->pathVecTlv, &attr->ext->pathVecTlv, sizeof(mplsLdpPathTlv_t));
     map->pathVecTlvExists = 1;
   }
   if (attr->lblMsgIdTlvExists) {
@@ -404,26 +426,155 @@ void attr2map(ldp_attr * attr, mplsLdpLblMapMsg_t * map)
     map->lblMsgIdTlvExists = 1;
   }
   if (attr->lspidTlvExists) {
-    memcpy(&map->lspidTlv, &attr->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
+    memcpy(&map->lspidTlv, &attr->ext->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
     map->lspidTlvExists = 1;
   }
   if (attr->trafficTlvExists) {
-    memcpy(&map->trafficTlv, &attr->trafficTlv, sizeof(mplsLdpTrafficTlv_t));
+    memcpy(&map->trafficTlv, &attr->ext->trafficTlv,
+      sizeof(mplsLdpTrafficTlv_t));
     map->trafficTlvExists = 1;
   }
 }
 
+/*
+ * Sends s a mapping for f through nh unless policy rejects it or one was
+ * sent already, the way a new session learns about the existing FECs
+ */
+mpls_return_enum ldp_label_mapping_offer(ldp_global * g, ldp_session * s,
+  ldp_fec * f, ldp_nexthop * nh)
+{
+  ldp_attr *ds_attr = NULL;
+  ldp_attr *us_attr = NULL;
+  ldp_session *nh_session = NULL;
+
+  /* are we allowed to export this route from the rib */
+  if (mpls_policy_export_check(g->user_data, &f->info, &nh->info,
+    ldp_session_lsraddr(s)) == MPLS_BOOL_FALSE) {
+    LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
+      LDP_TRACE_FLAG_POLICY, "Rejected by export policy\n");
+    return MPLS_SUCCESS;
+  }
+
+  /* have we already sent a mapping for this fec to the session? */
+  if (ldp_attr_find_upstream_state2(g, s, f, LDP_LSP_STATE_MAP_SENT)) {
+    /* no need to sent another mapping */
+    LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
+      LDP_TRACE_FLAG_ROUTE, "Already sent this FEC to session %d\n",
+      s->index);
+    return MPLS_SUCCESS;
+  }
+
+  if (!(nh_session = ldp_get_next_hop_session_for_fec2(f,nh))) {
+    ds_attr = NULL;
+  } else {
+    if (g->edge_inlabel == MPLS_BOOL_FALSE && nh_session->index == s->index) {
+      LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
+        LDP_TRACE_FLAG_ROUTE, "Nexthop session(%d) == session(%d)\n",
+        nh_session->index, s->index);
+      return MPLS_SUCCESS;
+    }
+    ds_attr = ldp_attr_find_downstream_state2(g, nh_session, f,
+      LDP_LSP_STATE_MAP_RECV);
+  }
+
+  if ((g->label_merge != MPLS_BOOL_TRUE) &&
+    ldp_attr_num_us2ds(ds_attr)) {
+    /* we have a ds label, but can't use it */
+    ds_attr = NULL;
+  }
+
+  if (ds_attr) {
+    /* we can use it, merge on baby */
+    return ldp_label_mapping_with_xc(g, s, f, &us_attr, ds_attr);
+  }
+
+  /* we don't have a ds label, we will be egress? */
+  if (g->lsp_control_mode == LDP_CONTROL_ORDERED &&
+    mpls_policy_egress_check(g->user_data, &f->info, &nh->info) ==
+    MPLS_BOOL_FALSE) {
+    return MPLS_SUCCESS;
+  }
+  return ldp_label_mapping_with_xc(g, s, f, &us_attr, NULL);
+}
+
+/*
+ * Takes a received mapping the import policy now rejects out of use, the
+ * way LMp.11 stores away a rejected one.  The outlabel and the cross
+ * connects on it are removed and, in ordered mode, the upstream mappings
+ * that depend on it are withdrawn.  No release is sent and the mapping is
+ * kept as filtered, so it can be processed again once policy permits it.
+ */
+mpls_return_enum ldp_label_mapping_filter(ldp_global * g, ldp_session * s,
+  ldp_attr * ds_attr)
+{
+  mpls_return_enum retval = MPLS_SUCCESS;
+  ldp_outlabel *out = NULL;
+  ldp_inlabel *in = NULL;
+  ldp_attr *us_temp = NULL;
+  mpls_fec fec;
+
+  LDP_ENTER(g->user_data, "ldp_label_mapping_filter");
+
+  if (g->lsp_control_mode == LDP_CONTROL_ORDERED) {
+    us_temp = MPLS_LIST_HEAD(&ds_attr->us_attr_root);
+    while (us_temp) {
+      if (us_temp->state == LDP_LSP_STATE_MAP_SENT) {
+        if (ldp_label_withdraw_send(g, us_temp->session, us_temp,
+            LDP_NOTIF_NONE) != MPLS_SUCCESS) {
+          retval = MPLS_FATAL;
+          break;
+        }
+      }
+      us_temp = MPLS_LIST_NEXT(&ds_attr->us_attr_root, us_temp, _ds_attr);
+    }
+  }
+
+  while ((us_temp = MPLS_LIST_HEAD(&ds_attr->us_attr_root)) != NULL) {
+    ldp_attr_del_us2ds(g, us_temp, ds_attr);
+  }
+
+  if ((out = ds_attr->outlabel) != NULL) {
+    while ((in = MPLS_LIST_HEAD(&out->inlabel_root)) != NULL) {
+      ldp_inlabel_del_outlabel(g, in);
+    }
+    if (ds_attr->ingress == MPLS_BOOL_TRUE && out->merge_count > 0) {
+      ldp_attr2mpls_fec(ds_attr, &fec);
+      out->merge_count--;
+#if MPLS_USE_LSR
+      {
+        lsr_ftn ftn;
+        memcpy(&ftn.fec, &fec, sizeof(mpls_fec));
+        ftn.outsegment_index = out->info.handle;
+        lsr_cfg_ftn_set2(g->lsr_handle, &ftn, LSR_CFG_DEL);
+      }
+#else
+      mpls_mpls_fec2out_del(g->mpls_handle, &fec, &out->info);
+#endif
+    }
+    ds_attr->ingress = MPLS_BOOL_FALSE;
+    ldp_attr_del_outlabel(g, ds_attr);
+    ldp_session_del_outlabel(g, s, out);
+  }
+
+  ds_attr->filtered = MPLS_BOOL_TRUE;
+
+  LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_POLICY,
+    "Label Mapping from %s filtered by import policy\n", s->session_name);
+
+  LDP_EXIT(g->user_data, "ldp_label_mapping_filter");
+
+  return retval;
+}
+
 void ldp_label_mapping_initial_callback(mpls_timer_handle timer, void *extra,
   mpls_cfg_handle handle)
 {
   ldp_session *s = (ldp_session *) extra;
   ldp_global *g = (ldp_global*)handle;
-  ldp_attr *ds_attr = NULL;
-  ldp_attr *us_attr = NULL;
-  ldp_session *nh_session = NULL;
-  mpls_bool done = MPLS_BOOL_FALSE;
-  ldp_fec *f;
+  ldp_fec *f = NULL;
   ldp_nexthop *nh;
+  uint32_t start;
+  int count;
 
   LDP_ENTER(g->user_data, "ldp_label_mapping_initial_callback");
 
@@ -434,8 +585,16 @@ void ldp_label_mapping_initial_callback(mpls_timer_handle timer, void *extra,
 
   mpls_timer_stop(g->timer_handle, timer);
 
-  f = MPLS_LIST_HEAD(&g->fec);
-  while (f) {
+  /* a failed send may shut the session down under us */
+  MPLS_REFCNT_HOLD(s);
+
+  start = mpls_timer_get_msec(g->timer_handle);
+  ldp_global_find_fec_next(g, s->initial_fec_index, &f);
+  for (count = 0; f && s->state == LDP_STATE_OPERATIONAL; count++) {
+    if (ldp_session_initial_slice_over(g, s, count, start) == MPLS_BOOL_TRUE) {
+      break;
+    }
+
     nh = MPLS_LIST_HEAD(&f->nh_root);
     while (nh) {
       switch (f->info.type) {
@@ -468,75 +627,17 @@ void ldp_label_mapping_initial_callback(mpls_timer_handle timer, void *extra,
           LDP_TRACE_FLAG_ROUTE, "via %p\n", nh->iff->handle);
       }
 
-      /* are we allowed to export this route from the rib */
-      if (mpls_policy_export_check(g->user_data, &f->info, &nh->info) ==
-        MPLS_BOOL_FALSE) {
-        LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
-	  LDP_TRACE_FLAG_POLICY, "Rejected by export policy\n");
-        goto ldp_label_mapping_initial_callback_end_nh;
-      }
-
-      /* have we already sent a mapping for this fec to the new session? */
-      if ((us_attr = ldp_attr_find_upstream_state2(g, s, f,
-        LDP_LSP_STATE_MAP_SENT))) {
-        /* no need to sent another mapping */
-        LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
-          LDP_TRACE_FLAG_ROUTE, "Already sent this FEC to session %d\n",
-	  s->index);
-        goto ldp_label_mapping_initial_callback_end_nh;
-      }
-
-      if (!(nh_session = ldp_get_next_hop_session_for_fec2(f,nh))) {
-        ds_attr = NULL;
-      } else {
-        if (g->edge_inlabel == MPLS_BOOL_FALSE && nh_session->index == s->index) {
-          LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
-            LDP_TRACE_FLAG_ROUTE, "Nexthop session(%d) == session(%d)\n",
-            nh_session->index, s->index);
-          goto ldp_label_mapping_initial_callback_end_nh;
-        }
-        ds_attr = ldp_attr_find_downstream_state2(g, nh_session, f,
-          LDP_LSP_STATE_MAP_RECV);
-      }
-
-      if ((g->label_merge != MPLS_BOOL_TRUE) &&
-        ldp_attr_num_us2ds(ds_attr)) {
-        /* we have a ds label, but can't use it */
-        ds_attr = NULL;
-      }
-
-      us_attr = NULL;
-      if (ds_attr) {
-        /* we can use it, merge on baby */
-        ldp_label_mapping_with_xc(g, s, f, &us_attr, ds_attr);
-      } else {
-        /* we don't have a ds label */
-
-        /* we will be egress? */
-        if (g->lsp_control_mode == LDP_CONTROL_ORDERED) {
-          if (mpls_policy_egress_check(g->user_data, &f->info,
-	    &nh->info) == MPLS_BOOL_TRUE) {
-            ldp_label_mapping_with_xc(g, s, f, &us_attr, NULL);
-          }
-        } else {
-          ldp_label_mapping_with_xc(g, s, f, &us_attr, NULL);
-        }
-      }
-ldp_label_mapping_initial_callback_end_nh:
+      ldp_label_mapping_offer(g, s, f, nh);
       nh = MPLS_LIST_NEXT(&f->nh_root, nh, _fec);
     }
+    s->initial_fec_index = f->index + 1;
+    s->initial_fec_done++;
     f = MPLS_LIST_NEXT(&g->fec, f, _global);
   }
-  done = MPLS_BOOL_TRUE;
 
-  if (done == MPLS_BOOL_TRUE) {
-    mpls_timer_delete(g->timer_handle, timer);
-    MPLS_REFCNT_RELEASE(s, ldp_session_delete);
-    s->initial_distribution_timer = (mpls_timer_handle) 0;
-  } else {
-    mpls_timer_start(g->timer_handle, timer, MPLS_TIMER_ONESHOT);
-    /* need to mark the session with where it left off */
-  }
+  ldp_session_initial_reschedule(g, s, timer, f ? MPLS_BOOL_FALSE :
+    MPLS_BOOL_TRUE);
+  MPLS_REFCNT_RELEASE(s, ldp_session_delete);
 
   mpls_lock_release(g->global_lock);
 
@@ -668,9 +769,9 @@ void ldp_label_mapping_prepare_msg(ldp_mesg * msg, uint32_t msgid,
     map->pathVecTlvExists = 1;
     map->baseMsg.msgLength += setupPathTlv(&map->pathVecTlv);
     for (i = 0; i < MPLS_MAXHOPSNUMBER; i++) {
-      if (s_attr->pathVecTlv.lsrId[i]) {
+      if (s_attr->ext->pathVecTlv.lsrId[i]) {
         map->baseMsg.msgLength += addLsrId2PathTlv(&map->pathVecTlv,
-          s_attr->pathVecTlv.lsrId[i]);
+          s_attr->ext->pathVecTlv.lsrId[i]);
       }
     }
   }
@@ -705,17 +806,18 @@ mpls_return_enum ldp_label_mapping_process(ldp_global * g, ldp_session * s,
 
   LDP_ENTER(g->user_data, "ldp_label_mapping_process");
 
+  dumb_attr.ext = NULL;
+
   LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_RECV, LDP_TRACE_FLAG_LABEL,
     "Label Mapping Recv from %s for %08x/%d\n",
     s->session_name,
     r_attr->fecTlv.fecElArray[0].addressEl.address,
     r_attr->fecTlv.fecElArray[0].addressEl.preLen);
 
-  printf("Label Mapping Recv from %s: %d for %s/%d\n",
-          s->session_name,
-          r_attr->genLblTlv.label,
-          inet_ntoa(htonl(r_attr->fecTlv.fecElArray[0].addressEl.address)),
-          r_attr->fecTlv.fecElArray[0].addressEl.preLen);
+  MPLS_LOG(MPLS_LOG_DEBUG, "Label Mapping Recv from %08x: %d for %08x/%d",
+    s->remote_dest.addr.u.ipv4, r_attr->genLblTlv.label,
+    r_attr->fecTlv.fecElArray[0].addressEl.address,
+    r_attr->fecTlv.fecElArray[0].addressEl.preLen);
 
   if ((ds_attr = ldp_attr_find_downstream_state2(g, s, f,
         LDP_LSP_STATE_REQ_SENT)) != NULL) { /* LMp.1 */
@@ -774,6 +876,15 @@ LMp_9:
   /*
    * No Loop Detected
    */
+  if (ds_attr->in_tree == MPLS_BOOL_TRUE) {
+    /*
+     * a stored mapping processed again, by FEC.2 or once the import
+     * policy permits it, is its own existing mapping
+     */
+    existing = ds_attr;
+    goto LMp_11;
+  }
+
   ds_temp = ldp_attr_find_downstream_state2(g, s, f, LDP_LSP_STATE_MAP_RECV);
   if (requested == MPLS_BOOL_TRUE ||
       g->label_merge == MPLS_BOOL_FALSE || !ds_temp) {
@@ -839,8 +950,8 @@ LMp_11:
    *
    * Are we configured to accept and INSTALL this mapping?
    */
-  if (mpls_policy_import_check(g->user_data, &f->info, &nh->info) ==
-    MPLS_BOOL_FALSE) {
+  if (mpls_policy_import_check(g->user_data, &f->info, &nh->info,
+    ldp_session_lsraddr(s)) == MPLS_BOOL_FALSE) {
     /*
      * policy has rejected it, store it away
      */
@@ -947,9 +1058,7 @@ LMp_11:
    * if we need to send an updated mapping
    */
   memset(&dumb_attr, 0, sizeof(ldp_attr));
-  mpls_fec2fec_tlv(&f->info, &dumb_attr.fecTlv, 0);
-  dumb_attr.fecTlvExists = 1;
-  dumb_attr.fecTlv.numberFecElements = 1;
+  mpls_fec2ldp_attr(&f->info, &dumb_attr);
 
   /*
    * by definition (we received a label mapping that will be used) this
@@ -1011,7 +1120,8 @@ LMp_11:
             r_attr->fecTlv.fecElArray[0].addressEl.address,
             r_attr->fecTlv.fecElArray[0].addressEl.preLen, peer->session_name);
 
-          if ((!existing) || (existing->index == us_temp->ds_attr->index)) {
+          if ((!existing) || (us_temp->ds_attr &&
+            existing->index == us_temp->ds_attr->index)) {
 
             LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_RECV,
               LDP_TRACE_FLAG_BINDING, "Part of same LSP\n");
@@ -1063,6 +1173,10 @@ LMp_11:
          * this is the first peer we're propogating this mapping to
          */
         /* LMp.20-21,30 */
+        if (mpls_policy_export_check(g->user_data, &f->info, &nh->info,
+          ldp_session_lsraddr(peer)) == MPLS_BOOL_FALSE) {
+          goto next_peer;
+        }
         us_attr = NULL;
         if (ldp_label_mapping_with_xc(g, peer, f, &us_attr, ds_attr) !=
           MPLS_SUCCESS) {
@@ -1080,6 +1194,17 @@ LMp_11:
     }
 
     /* LMp.28 */
+    if (mpls_policy_export_check(g->user_data, &f->info, &nh->info,
+      ldp_session_lsraddr(peer)) == MPLS_BOOL_FALSE) {
+      /* pending requests of a peer that may not learn the FEC are refused */
+      while ((us_temp = ldp_attr_find_upstream_state2(g, peer, f,
+        LDP_LSP_STATE_REQ_RECV))) {
+        ldp_notif_send(g, peer, us_temp, LDP_NOTIF_NO_ROUTE);
+        ldp_attr_remove_complete(g, us_temp, MPLS_BOOL_FALSE);
+      }
+      goto next_peer;
+    }
+
     while ((us_temp = ldp_attr_find_upstream_state2(g, peer, f,
       LDP_LSP_STATE_REQ_RECV))) {
 
@@ -1148,6 +1273,9 @@ LMp_11:
   }
 
 LMp_33:
+  if (dumb_attr.ext) {
+    mpls_free(dumb_attr.ext);
+  }
   LDP_EXIT(g->user_data, "ldp_label_mapping_process");
   return retval;
 
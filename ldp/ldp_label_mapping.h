@@ -14,9 +14,13 @@
 extern mpls_return_enum ldp_label_mapping_with_xc(ldp_global * g,
   ldp_session * s, ldp_fec * fec, ldp_attr ** us_attr, ldp_attr * ds_attr);
 
-extern void map2attr(mplsLdpLblMapMsg_t * map, ldp_attr * attr, uint32_t flag);
+extern void map2attr(ldp_mesg * msg, ldp_attr * attr, uint32_t flag);
 extern void attr2map(ldp_attr * attr, mplsLdpLblMapMsg_t * map);
 
+extern mpls_return_enum ldp_label_mapping_offer(ldp_global * g,
+  ldp_session * s, ldp_fec * f, ldp_nexthop * nh);
+extern mpls_return_enum ldp_label_mapping_filter(ldp_global * g,
+  ldp_session * s, ldp_attr * ds_attr);
 extern void ldp_label_mapping_initial_callback(mpls_timer_handle timer,
   void *extra, mpls_cfg_handle g);
 
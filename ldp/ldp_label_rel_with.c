@@ -19,27 +19,26 @@
 #include "ldp_label_mapping.h"
 #include "ldp_fec.h"
 #include "ldp_mesg.h"
+#include "ldp_buf.h"
 #include "ldp_pdu_setup.h"
 
 #include "mpls_trace_impl.h"
 
-mpls_bool rel_with2attr(mplsLdpLbl_W_R_Msg_t * rw, ldp_attr * attr)
+mpls_bool rel_with2attr(ldp_mesg * msg, ldp_attr * attr)
 {
+  mplsLdpLbl_W_R_Msg_t *rw = &msg->u.release;
   mpls_bool retval = MPLS_BOOL_FALSE;
 
-  if (rw->fecTlvExists) {
-    memcpy(&attr->fecTlv, &rw->fecTlv, sizeof(mplsLdpFecTlv_t));
-    attr->fecTlvExists = 1;
-  }
-  if (rw->genLblTlvExists) {
+  /* attr was created with its FEC, one element of rw->fecTlv */
+  if (ldp_mesg_tlv(msg, MPLS_GENLBL_TLVTYPE)) {
     retval = MPLS_BOOL_TRUE;
     memcpy(&attr->genLblTlv, &rw->genLblTlv, sizeof(mplsLdpGenLblTlv_t));
     attr->genLblTlvExists = 1;
-  } else if (rw->atmLblTlvExists) {
+  } else if (ldp_mesg_tlv(msg, MPLS_ATMLBL_TLVTYPE)) {
     retval = MPLS_BOOL_TRUE;
     memcpy(&attr->atmLblTlv, &rw->atmLblTlv, sizeof(mplsLdpAtmLblTlv_t));
     attr->atmLblTlvExists = 1;
-  } else if (rw->frLblTlvExists) {
+  } else if (ldp_mesg_tlv(msg, MPLS_FRLBL_TLVTYPE)) {
     retval = MPLS_BOOL_TRUE;
     memcpy(&attr->frLblTlv, &rw->frLblTlv, sizeof(mplsLdpFrLblTlv_t));
     attr->frLblTlvExists = 1;
@@ -77,7 +76,7 @@ void ldp_label_rel_with_prepare_msg(ldp_mesg * msg, uint32_t msgid,
   if (a->lspidTlvExists) {
     rw->lspidTlvExists = 1;
     rw->baseMsg.msgLength += setupLspidTlv(&rw->lspidTlv, 0,
-      a->lspidTlv.localCrlspId, a->lspidTlv.routerId);
+      a->ext->lspidTlv.localCrlspId, a->ext->lspidTlv.routerId);
   }
 }
 
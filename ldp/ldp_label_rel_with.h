@@ -14,7 +14,7 @@ extern mpls_return_enum ldp_label_release_send(ldp_global *, ldp_session *,
   ldp_attr *, ldp_notif_status);
 extern mpls_return_enum ldp_label_withdraw_send(ldp_global *, ldp_session *,
   ldp_attr *, ldp_notif_status);
-extern mpls_bool rel_with2attr(mplsLdpLbl_W_R_Msg_t * rw, ldp_attr * attr);
+extern mpls_bool rel_with2attr(ldp_mesg * msg, ldp_attr * attr);
 extern ldp_mesg *ldp_label_rel_with_create_msg(uint32_t msgid, ldp_attr * a,
   ldp_notif_status status, uint16_t type);
 extern mpls_return_enum ldp_label_release_process(ldp_global * g,
@@ -11,9 +11,11 @@
 #include "ldp_attr.h"
 #include "ldp_fec.h"
 #include "ldp_mesg.h"
+#include "ldp_buf.h"
 #include "ldp_pdu_setup.h"
 #include "ldp_notif.h"
 #include "ldp_session.h"
+#include "ldp_global.h"
 #include "ldp_entity.h"
 #include "ldp_label_mapping.h"
 #include "ldp_label_request.h"
@@ -72,9 +74,9 @@ void ldp_label_request_prepare_msg(ldp_mesg * msg, uint32_t msgid,
     req->pathVecTlvExists = 1;
     req->baseMsg.msgLength += setupPathTlv(&req->pathVecTlv);
     for (i = 0; i < MPLS_MAXHOPSNUMBER; i++) {
-      if (s_attr->pathVecTlv.lsrId[i]) {
+      if (s_attr->ext->pathVecTlv.lsrId[i]) {
         req->baseMsg.msgLength += addLsrId2PathTlv(&req->pathVecTlv,
-          s_attr->pathVecTlv.lsrId[i]);
+          s_attr->ext->pathVecTlv.lsrId[i]);
       }
     }
   }
@@ -89,7 +91,7 @@ mpls_return_enum ldp_label_request_send(ldp_global * g, ldp_session * s,
   LDP_ENTER(g->user_data, "ldp_label_request_send");
   MPLS_ASSERT(ds_attr && *ds_attr);
 
-  fec_tlv2mpls_fec(&((*ds_attr)->fecTlv), 0, &fec);
+  ldp_attr2mpls_fec(*ds_attr, &fec);
 
   if ((ds_temp = ldp_attr_find_downstream_state(g, s, &fec,
         LDP_LSP_STATE_REQ_SENT)) != NULL) { /* SLRq.1 */
@@ -147,32 +149,43 @@ ldp_label_request_send_error:
   return MPLS_FAILURE;           /* SLRq.7 */
 }
 
-void req2attr(mplsLdpLblReqMsg_t * req, ldp_attr * attr, uint32_t flag)
+void req2attr(ldp_mesg * msg, ldp_attr * attr, uint32_t flag)
 {
+  mplsLdpLblReqMsg_t *req = &msg->u.request;
+  ldp_attr_ext *ext;
+
   attr->msg_id = req->baseMsg.msgId;
 
-  if (req->fecTlvExists && flag & LDP_ATTR_FEC) {
-    memcpy(&attr->fecTlv, &req->fecTlv, sizeof(mplsLdpFecTlv_t));
-    attr->fecTlvExists = 1;
+  if (flag & LDP_ATTR_FEC && ldp_mesg_tlv(msg, MPLS_FEC_TLVTYPE)) {
+    fec_tlv2ldp_attr(&req->fecTlv, 0, attr);
   }
-  if (req->hopCountTlvExists && flag & LDP_ATTR_HOPCOUNT) {
+  if (flag & LDP_ATTR_HOPCOUNT && ldp_mesg_tlv(msg, MPLS_HOPCOUNT_TLVTYPE)) {
     memcpy(&attr->hopCountTlv, &req->hopCountTlv, sizeof(mplsLdpHopTlv_t));
     attr->hopCountTlvExists = 1;
   }
-  if (req->pathVecTlvExists && flag & LDP_ATTR_PATH) {
-    memcpy(&attr->pathVecTlv, &req->pathVecTlv, sizeof(mplsLdpPathTlv_t));
-    attr->pathVecTlvExists = 1;
-  }
-  if (req->lblMsgIdTlvExists && flag & LDP_ATTR_MSGID) {
+  if (flag & LDP_ATTR_MSGID && ldp_mesg_tlv(msg, MPLS_LBLMSGID_TLVTYPE)) {
     memcpy(&attr->lblMsgIdTlv, &req->lblMsgIdTlv, sizeof(mplsLdpLblMsgIdTlv_t));
     attr->lblMsgIdTlvExists = 1;
   }
-  if (req->lspidTlvExists && flag & LDP_ATTR_LSPID) {
-    memcpy(&attr->lspidTlv, &req->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
+
+  if (!(flag & LDP_ATTR_PATH && ldp_mesg_tlv(msg, MPLS_PATH_TLVTYPE)) &&
+    !(flag & LDP_ATTR_LSPID && ldp_mesg_tlv(msg, MPLS_LSPID_TLVTYPE)) &&
+    !(flag & LDP_ATTR_TRAFFIC && ldp_mesg_tlv(msg, MPLS_TRAFFIC_TLVTYPE))) {
+    return;
+  }
+  if ((ext = ldp_attr_ext_get(attr)) == NULL) {
+    return;
+  }
+  if (flag & LDP_ATTR_PATH && ldp_mesg_tlv(msg, MPLS_PATH_TLVTYPE)) {
+    memcpy(&ext->pathVecTlv, &req->pathVecTlv, sizeof(mplsLdpPathTlv_t));
+    attr->pathVecTlvExists = 1;
+  }
+  if (flag & LDP_ATTR_LSPID && ldp_mesg_tlv(msg, MPLS_LSPID_TLVTYPE)) {
+    memcpy(&ext->lspidTlv, &req->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
     attr->lspidTlvExists = 1;
   }
-  if (req->trafficTlvExists && flag & LDP_ATTR_TRAFFIC) {
-    memcpy(&attr->trafficTlv, &req->trafficTlv, sizeof(mplsLdpTrafficTlv_t));
+  if (flag & LDP_ATTR_TRAFFIC && ldp_mesg_tlv(msg, MPLS_TRAFFIC_TLVTYPE)) {
+    memcpy(&ext->trafficTlv, &req->trafficTlv, sizeof(mplsLdpTrafficTlv_t));
     attr->trafficTlvExists = 1;
   }
 }
@@ -186,7 +199,8 @@ void ldp_label_request_initial_callback(mpls_timer_handle timer, void *extra,
   ldp_fec *f = NULL;
 
   ldp_session *nh_session = NULL;
-  mpls_bool done = MPLS_BOOL_FALSE;
+  uint32_t start;
+  int count;
 
   ldp_attr *attr = NULL;
   ldp_fs *fs = NULL;
@@ -201,104 +215,108 @@ void ldp_label_request_initial_callback(mpls_timer_handle timer, void *extra,
 
   mpls_timer_stop(g->timer_handle, timer);
 
-  if ((f = MPLS_LIST_HEAD(&g->fec))) {
-    do {
-      if ((nh = MPLS_LIST_HEAD(&f->nh_root))) {
-        do {
-          switch (f->info.type) {
-            case MPLS_FEC_PREFIX:
-              LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
-                LDP_TRACE_FLAG_ROUTE, "Processing prefix FEC: %08x/%d ",
-                f->info.u.prefix.network.u.ipv4, f->info.u.prefix.length);
-              break;
-            case MPLS_FEC_HOST:
-              LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
-                LDP_TRACE_FLAG_ROUTE, "Processing host FEC: %08x ",
-                f->info.u.host.u.ipv4);
-              break;
-            case MPLS_FEC_L2CC:
-              LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
-              LDP_TRACE_FLAG_ROUTE, "Processing L2CC FEC: %d %d %d ",
-                f->info.u.l2cc.connection_id, f->info.u.l2cc.group_id,
-                f->info.u.l2cc.type);
-              break;
-            default:
-              MPLS_ASSERT(0);
-          }
+  /* a failed send may shut the session down under us */
+  MPLS_REFCNT_HOLD(s);
+
+  start = mpls_timer_get_msec(g->timer_handle);
+  ldp_global_find_fec_next(g, s->initial_fec_index, &f);
+  for (count = 0; f && s->state == LDP_STATE_OPERATIONAL; count++) {
+    if (ldp_session_initial_slice_over(g, s, count, start) == MPLS_BOOL_TRUE) {
+      break;
+    }
 
-          if (nh->info.type & MPLS_NH_IP) {
+    if ((nh = MPLS_LIST_HEAD(&f->nh_root))) {
+      do {
+        switch (f->info.type) {
+          case MPLS_FEC_PREFIX:
             LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
-              LDP_TRACE_FLAG_ROUTE, "via %08x\n", nh->addr->address.u.ipv4);
-          }
-          if (nh->info.type & MPLS_NH_IF) {
+              LDP_TRACE_FLAG_ROUTE, "Processing prefix FEC: %08x/%d ",
+              f->info.u.prefix.network.u.ipv4, f->info.u.prefix.length);
+            break;
+          case MPLS_FEC_HOST:
             LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
-              LDP_TRACE_FLAG_ROUTE, "via %p\n", nh->iff->handle);
-          }
-
-          /* check to see if export policy allows us to 'see' this route */
-          if (mpls_policy_export_check(g->user_data, &f->info, &nh->info)
-              == MPLS_BOOL_FALSE) {
+              LDP_TRACE_FLAG_ROUTE, "Processing host FEC: %08x ",
+              f->info.u.host.u.ipv4);
+            break;
+          case MPLS_FEC_L2CC:
             LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
-              LDP_TRACE_FLAG_DEBUG, "Rejected by export policy\n");
-            continue;
-          }
-
-	  /* find the next hop session corresponding to this FEC */
-	  nh_session = ldp_session_for_nexthop(nh);
-
-          /* do we have a valid next hop session, and is the nexp hop session
-           * this session? */
-          if ((!nh_session) || (nh_session->index != s->index)) {
-            continue;
-          }
-
-          /* have we already sent a label request to this peer for this FEC? */
-          if (ldp_attr_find_downstream_state(g, s, &f->info,
-	    LDP_LSP_STATE_REQ_SENT)) {
-            continue;
-          }
-
-          /* clear out info from the last FEC */
-          ds_attr = NULL;
-
-          /* jleu: duplicate code from ldp_attr_find_upstream_state_any */
-          fs = MPLS_LIST_HEAD(&f->fs_root_us);
-          while (fs) {
-            attr = MPLS_LIST_HEAD(&fs->attr_root);
-            while (attr) {
-              if (attr->state == LDP_LSP_STATE_REQ_RECV ||
-	        attr->state == LDP_LSP_STATE_MAP_SENT) {
-	        if (!ds_attr) {
-                  /* this is not neccessarily going to be XC'd to something */
-                  ldp_label_request_for_xc(g, s, &f->info, attr, &ds_attr);
-	        }
-	      }
-              attr = MPLS_LIST_NEXT(&fs->attr_root, attr, _fs);
+            LDP_TRACE_FLAG_ROUTE, "Processing L2CC FEC: %d %d %d ",
+              f->info.u.l2cc.connection_id, f->info.u.l2cc.group_id,
+              f->info.u.l2cc.type);
+            break;
+          default:
+            MPLS_ASSERT(0);
+        }
+
+        if (nh->info.type & MPLS_NH_IP) {
+          LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
+            LDP_TRACE_FLAG_ROUTE, "via %08x\n", nh->addr->address.u.ipv4);
+        }
+        if (nh->info.type & MPLS_NH_IF) {
+          LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
+            LDP_TRACE_FLAG_ROUTE, "via %p\n", nh->iff->handle);
+        }
+
+        /* check to see if export policy allows us to 'see' this route */
+        if (mpls_policy_export_check(g->user_data, &f->info, &nh->info,
+            NULL) == MPLS_BOOL_FALSE) {
+          LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL,
+            LDP_TRACE_FLAG_DEBUG, "Rejected by export policy\n");
+          continue;
+        }
+
+        /* find the next hop session corresponding to this FEC */
+        nh_session = ldp_session_for_nexthop(nh);
+
+        /* do we have a valid next hop session, and is the nexp hop session
+         * this session? */
+        if ((!nh_session) || (nh_session->index != s->index)) {
+          continue;
+        }
+
+        /* have we already sent a label request to this peer for this FEC? */
+        if (ldp_attr_find_downstream_state(g, s, &f->info,
+          LDP_LSP_STATE_REQ_SENT)) {
+          continue;
+        }
+
+        /* clear out info from the last FEC */
+        ds_attr = NULL;
+
+        /* jleu: duplicate code from ldp_attr_find_upstream_state_any */
+        fs = MPLS_LIST_HEAD(&f->fs_root_us);
+        while (fs) {
+          attr = MPLS_LIST_HEAD(&fs->attr_root);
+          while (attr) {
+            if (attr->state == LDP_LSP_STATE_REQ_RECV ||
+              attr->state == LDP_LSP_STATE_MAP_SENT) {
+              if (!ds_attr) {
+                /* this is not neccessarily going to be XC'd to something */
+                ldp_label_request_for_xc(g, s, &f->info, attr, &ds_attr);
+              }
             }
-            fs = MPLS_LIST_NEXT(&f->fs_root_us, fs, _fec);
-          }
-      
-          if (!ds_attr) {
-            /*
-	     * we did not find any received requests or sent mappings so
-	     * send a request and xc it to nothing
-	     */
-            ldp_label_request_for_xc(g, s, &f->info, NULL, &ds_attr);
+            attr = MPLS_LIST_NEXT(&fs->attr_root, attr, _fs);
           }
-        } while ((nh = MPLS_LIST_NEXT(&f->nh_root, nh, _fec)));
-      }
-    } while ((f = MPLS_LIST_NEXT(&g->fec, f, _global)));
-    done = MPLS_BOOL_TRUE;
+          fs = MPLS_LIST_NEXT(&f->fs_root_us, fs, _fec);
+        }
+    
+        if (!ds_attr) {
+          /*
+           * we did not find any received requests or sent mappings so
+           * send a request and xc it to nothing
+           */
+          ldp_label_request_for_xc(g, s, &f->info, NULL, &ds_attr);
+        }
+      } while ((nh = MPLS_LIST_NEXT(&f->nh_root, nh, _fec)));
+    }
+    s->initial_fec_index = f->index + 1;
+    s->initial_fec_done++;
+    f = MPLS_LIST_NEXT(&g->fec, f, _global);
   }
 
-  if (done == MPLS_BOOL_TRUE) {
-    mpls_timer_delete(g->timer_handle, timer);
-    MPLS_REFCNT_RELEASE(s, ldp_session_delete);
-    s->initial_distribution_timer = (mpls_timer_handle) 0;
-  } else {
-    mpls_timer_start(g->timer_handle, timer, MPLS_TIMER_ONESHOT);
-    /* need to mark the session with where it left off */
-  }
+  ldp_session_initial_reschedule(g, s, timer, f ? MPLS_BOOL_FALSE :
+    MPLS_BOOL_TRUE);
+  MPLS_REFCNT_RELEASE(s, ldp_session_delete);
 
   mpls_lock_release(g->global_lock);
 
@@ -308,6 +326,7 @@ void ldp_label_request_initial_callback(mpls_timer_handle timer, void *extra,
 void Prepare_Label_Request_Attributes(ldp_global * g, ldp_session * s,
   mpls_fec * fec, ldp_attr * r_attr, ldp_attr * s_attr)
 {
+  ldp_attr_ext *ext;
   int i;
 
   MPLS_ASSERT(s && r_attr);
@@ -358,18 +377,24 @@ void Prepare_Label_Request_Attributes(ldp_global * g, ldp_session * s,
 
 Prepare_Label_Request_Attributes_12:
   /* we only get to PRqA.12 if we have verified we have a r_attr */
+  if ((ext = ldp_attr_ext_get(s_attr)) == NULL) {
+    return;
+  }
   s_attr->pathVecTlvExists = 1;
-  s_attr->pathVecTlv.lsrId[0] = g->lsr_identifier.u.ipv4;
+  ext->pathVecTlv.lsrId[0] = g->lsr_identifier.u.ipv4;
   for (i = 1; i < (MPLS_MAXHOPSNUMBER - 1); i++) {
-    if (r_attr->pathVecTlv.lsrId[i - 1]) {
-      s_attr->pathVecTlv.lsrId[i] = r_attr->pathVecTlv.lsrId[i - 1];
+    if (r_attr->ext->pathVecTlv.lsrId[i - 1]) {
+      ext->pathVecTlv.lsrId[i] = r_attr->ext->pathVecTlv.lsrId[i - 1];
     }
   }
   return;
 
 Prepare_Label_Request_Attributes_13:
+  if ((ext = ldp_attr_ext_get(s_attr)) == NULL) {
+    return;
+  }
   s_attr->pathVecTlvExists = 1;
-  s_attr->pathVecTlv.lsrId[0] = g->lsr_identifier.u.ipv4;
+  ext->pathVecTlv.lsrId[0] = g->lsr_identifier.u.ipv4;
 }
 
 mpls_return_enum ldp_label_request_process(ldp_global * g, ldp_session * s,
@@ -413,6 +438,16 @@ mpls_return_enum ldp_label_request_process(ldp_global * g, ldp_session * s,
     goto LRq_13;
   }
 
+  /* is the peer allowed to learn about this FEC */
+  nh = MPLS_LIST_HEAD(&f->nh_root);
+  if (nh && mpls_policy_export_check(g->user_data, &f->info, &nh->info,
+    ldp_session_lsraddr(s)) == MPLS_BOOL_FALSE) {
+    LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_RECV, LDP_TRACE_FLAG_POLICY,
+      "Label Request from %s rejected by export policy\n", s->session_name);
+    ldp_notif_send(g, s, us_attr, LDP_NOTIF_NO_ROUTE); /* LRq.5 */
+    goto LRq_13;
+  }
+
   if ((us_list = ldp_attr_find_upstream_all2(g, s, f)) != NULL) {
     us_temp = MPLS_LIST_HEAD(us_list);
     while (us_temp != NULL) {
@@ -26,5 +26,5 @@ extern void Prepare_Label_Request_Attributes(ldp_global * g, ldp_session * s,
 
 extern mpls_return_enum ldp_label_request_for_xc(ldp_global * g, ldp_session * s, mpls_fec * fec, ldp_attr * us_attr, ldp_attr ** ds_attr);
 
-extern void req2attr(mplsLdpLblReqMsg_t * req, ldp_attr * attr, uint32_t flag);
+extern void req2attr(ldp_mesg * msg, ldp_attr * attr, uint32_t flag);
 #endif
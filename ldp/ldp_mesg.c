@@ -12,57 +12,132 @@
 #include "ldp_struct.h"
 #include "ldp_mesg.h"
 #include "ldp_buf.h"
+#include "ldp_session.h"
 
 #include "mpls_assert.h"
 #include "mpls_mm_impl.h"
 #include "mpls_socket_impl.h"
 #include "mpls_trace_impl.h"
 
+/*
+ * Messages that come in bursts are collected in the session's open PDU
+ * and sent as one, everything else closes the PDU and goes out at once.
+ */
+static mpls_bool ldp_mesg_is_bulk(ldp_mesg * msg)
+{
+  switch (msg->u.generic.flags.flags.msgType) {
+    case MPLS_LBLMAP_MSGTYPE:
+    case MPLS_LBLREQ_MSGTYPE:
+    case MPLS_LBLWITH_MSGTYPE:
+    case MPLS_LBLREL_MSGTYPE:
+    case MPLS_ADDR_MSGTYPE:
+    case MPLS_ADDRWITH_MSGTYPE:
+      return MPLS_BOOL_TRUE;
+  }
+  return MPLS_BOOL_FALSE;
+}
+
+mpls_return_enum ldp_mesg_flush_session(ldp_global * g, ldp_session * s)
+{
+  ldp_buf *b = s->tx_buffer;
+  int size = b->size;
+  int result;
+
+  if (s->tx_pending == MPLS_BOOL_TRUE) {
+    s->tx_pending = MPLS_BOOL_FALSE;
+    g->tx_pending--;
+  }
+
+  if (size <= 0) {
+    return MPLS_SUCCESS;
+  }
+  b->size = 0;
+
+  /* queued on the socket, it is written out once the socket is writable */
+  result = mpls_socket_tcp_write(g->socket_handle, s->socket, b->buffer, size);
+
+  if (result != size) {
+    LDP_PRINT(g->user_data, "send failed(%d)\n",
+      mpls_socket_get_errno(g->socket_handle, s->socket));
+    return MPLS_FAILURE;
+  }
+  /* every PDU stands in for a keepalive */
+  ldp_session_maintain_timer(g, s, LDP_KEEPALIVE_SEND);
+  return MPLS_SUCCESS;
+}
+
+void ldp_mesg_flush_tcp(ldp_global * g)
+{
+  ldp_session *s;
+
+  if (!g->tx_pending) {
+    return;
+  }
+
+  s = MPLS_LIST_HEAD(&g->session);
+  while (s != NULL && g->tx_pending > 0) {
+    if (s->tx_pending == MPLS_BOOL_TRUE) {
+      ldp_mesg_flush_session(g, s);
+    }
+    s = MPLS_LIST_NEXT(&g->session, s, _global);
+  }
+}
+
 mpls_return_enum ldp_mesg_send_tcp(ldp_global * g, ldp_session * s,
   ldp_mesg * msg)
 {
-  int32_t result = 0;
+  int result = 0;
 
   MPLS_ASSERT(s);
 
-  result = ldp_encode_one_mesg(g, g->lsr_identifier.u.ipv4,
-    s->cfg_label_space, s->tx_buffer, msg);
+  result = ldp_encode_append_mesg(g, g->lsr_identifier.u.ipv4,
+    s->cfg_label_space, s->tx_buffer, msg, s->oper_max_pdu);
+
+  if (result < 0 && s->tx_buffer->size > 0) {
+    /* the open PDU is full, send it and start a new one */
+    if (ldp_mesg_flush_session(g, s) == MPLS_FAILURE) {
+      return MPLS_FAILURE;
+    }
+    result = ldp_encode_append_mesg(g, g->lsr_identifier.u.ipv4,
+      s->cfg_label_space, s->tx_buffer, msg, s->oper_max_pdu);
+  }
 
   if (result <= 0)
     return MPLS_FAILURE;
 
   s->mesg_tx++;
 
-  result = mpls_socket_tcp_write(g->socket_handle, s->socket,
-    s->tx_buffer->buffer, s->tx_buffer->size);
-
-  if (result <= 0) {
-    LDP_PRINT(g->user_data, "send failed(%d)\n", result);
-    perror("send");
-    return MPLS_FAILURE;
+  if (ldp_mesg_is_bulk(msg) == MPLS_BOOL_TRUE) {
+    if (s->tx_pending == MPLS_BOOL_FALSE) {
+      s->tx_pending = MPLS_BOOL_TRUE;
+      g->tx_pending++;
+    }
+    return MPLS_SUCCESS;
   }
-  return MPLS_SUCCESS;
+  return ldp_mesg_flush_session(g, s);
 }
 
+/*
+ * A hello is encoded into the entity's tx_buffer the first time it is
+ * sent and again only after the cached hello was thrown away, in between
+ * just the message id is rewritten in place.
+ */
 mpls_return_enum ldp_mesg_send_udp(ldp_global * g, ldp_entity * e,
   ldp_mesg * msg)
 {
   ldp_buf *buf = NULL;
   mpls_dest *dest = NULL;
+  mpls_if_handle iface = 0;
   int32_t result = 0;
   uint16_t label_space = 0;
+  uint32_t id;
 
   MPLS_ASSERT(e);
 
   switch (e->entity_type) {
     case LDP_DIRECT:
       MPLS_ASSERT(e->p.iff != NULL);
-      if (mpls_socket_multicast_if_tx(g->socket_handle, g->hello_socket,
-          e->p.iff->handle) == MPLS_FAILURE) {
-        LDP_PRINT(g->user_data, "ldp_mesg_send_udp: muticast tx error(%d)\n",
-          mpls_socket_get_errno(g->socket_handle, g->hello_socket));
-        return MPLS_FAILURE;
-      }
+      iface = e->p.iff->handle;
       dest = &e->p.iff->dest;
       buf = e->p.iff->tx_buffer;
       label_space = e->p.iff->label_space;
@@ -76,30 +151,28 @@ mpls_return_enum ldp_mesg_send_udp(ldp_global * g, ldp_entity * e,
     default:
       MPLS_ASSERT(0);
   }
-  result =
-    ldp_encode_one_mesg(g, g->lsr_identifier.u.ipv4, label_space, buf, msg);
 
-  if (result <= 0)
-    return MPLS_FAILURE;
+  if (buf->size <= 0) {
+    result =
+      ldp_encode_one_mesg(g, g->lsr_identifier.u.ipv4, label_space, buf, msg);
+
+    if (result <= 0) {
+      buf->size = 0;
+      return MPLS_FAILURE;
+    }
+  } else {
+    id = htonl(g->message_identifier++);
+    memcpy(buf->buffer + MPLS_LDP_HDRSIZE + MPLS_MSGIDFIXLEN, &id, sizeof(id));
+  }
 
   e->mesg_tx++;
 
-  result = mpls_socket_udp_sendto(g->socket_handle, g->hello_socket,
-    buf->buffer, buf->size, dest);
-
-  switch (e->entity_type) {
-    case LDP_DIRECT:
-      mpls_socket_multicast_if_tx(g->socket_handle, g->hello_socket, NULL);
-      break;
-    case LDP_INDIRECT:
-      break;
-    default:
-      MPLS_ASSERT(0);
-  }
+  result = mpls_socket_udp_sendto_if(g->socket_handle, g->hello_socket,
+    buf->buffer, buf->size, dest, iface);
 
   if (result <= 0) {
-    LDP_PRINT(g->user_data, "sendto failed(%d)\n", result);
-    perror("sendto");
+    LDP_PRINT(g->user_data, "ldp_mesg_send_udp: sendto failed(%d)\n",
+      mpls_socket_get_errno(g->socket_handle, g->hello_socket));
     return MPLS_FAILURE;
   }
   return MPLS_SUCCESS;
@@ -30,6 +30,9 @@ extern mpls_return_enum ldp_mesg_hello_get_request(ldp_mesg * mesg, int *req);
 
 extern mpls_return_enum ldp_mesg_send_tcp(ldp_global * g, ldp_session * s,
   ldp_mesg * mesg);
+extern mpls_return_enum ldp_mesg_flush_session(ldp_global * g,
+  ldp_session * s);
+extern void ldp_mesg_flush_tcp(ldp_global * g);
 extern mpls_return_enum ldp_mesg_send_udp(ldp_global * g, ldp_entity * s,
   ldp_mesg * mesg);
 
@@ -2371,6 +2371,8 @@ int Mpls_decodeLdpFecAdrEl
         if ((int)preLen > bufSize - decodedSize) {
           return MPLS_DEC_BUFFTOOSMALL;
         }
+        /* only preLen octets are copied, the rest must not be left over */
+        fecAdrEl->addressEl.address = 0;
         MEM_COPY((u_char *) & (fecAdrEl->addressEl.address), tempBuff, preLen);
 
         fecAdrEl->addressEl.address = ntohl(fecAdrEl->addressEl.address);
@@ -2412,6 +2414,8 @@ int Mpls_decodeLdpFecAdrEl
         if ((int)preLen > bufSize - decodedSize) {
           return MPLS_DEC_BUFFTOOSMALL;
         }
+        /* only preLen octets are copied, the rest must not be left over */
+        fecAdrEl->addressEl.address = 0;
         MEM_COPY((u_char *) & (fecAdrEl->addressEl.address), tempBuff, preLen);
 
         fecAdrEl->addressEl.address = ntohl(fecAdrEl->addressEl.address);
@@ -110,19 +110,24 @@ ldp_notif_send_error:
 
 void not2attr(mplsLdpNotifMsg_t * not, ldp_attr * attr, uint32_t flag)
 {
+  ldp_attr_ext *ext;
+
   attr->msg_id = not->baseMsg.msgId;
 
+  if ((ext = ldp_attr_ext_get(attr)) == NULL) {
+    return;
+  }
   if (not->statusTlvExists && flag & LDP_ATTR_STATUS) {
-    memcpy(&attr->statusTlv, &not->status, sizeof(mplsLdpStatusTlv_t));
+    memcpy(&ext->statusTlv, &not->status, sizeof(mplsLdpStatusTlv_t));
     attr->statusTlvExists = 1;
   }
   if (not->lspidTlvExists && flag & LDP_ATTR_LSPID) {
-    memcpy(&attr->lspidTlv, &not->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
+    memcpy(&ext->lspidTlv, &not->lspidTlv, sizeof(mplsLdpLspIdTlv_t));
     attr->lspidTlvExists = 1;
   }
 
   if (not->retMsgTlvExists && flag & LDP_ATTR_MSGID) {
-    memcpy(&attr->retMsgTlv, &not->retMsg, sizeof(mplsLdpLblMsgIdTlv_t));
+    memcpy(&ext->retMsgTlv, &not->retMsg, sizeof(mplsLdpLblMsgIdTlv_t));
     attr->retMsgTlvExists = 1;
   }
   /* Attribute types are not defined in ldp_attr.h file need to 
@@ -146,7 +151,7 @@ mpls_return_enum ldp_notif_process(ldp_global * g, ldp_session * s,
 
   LDP_ENTER(g->user_data, "ldp_notif_process");
 
-  status = r_attr->statusTlv.flags.flags.status;
+  status = LDP_ATTR_EXT(r_attr)->statusTlv.flags.flags.status;
 
   switch (status) {
     case LDP_NOTIF_LABEL_ABORT:
@@ -249,7 +254,7 @@ mpls_return_enum ldp_notif_label_request_aborted(ldp_global * g, ldp_session * s
       ds_attr->msg_id == r_attr->msg_id) {
       break;
     }
-    ds_attr = MPLS_LIST_NEXT(&s->attr_root, ds_attr, _fs);
+    ds_attr = MPLS_LIST_NEXT(&s->attr_root, ds_attr, _session);
   }
 
   if (ds_attr) {                /* LRqA.1 */
@@ -272,7 +277,7 @@ mpls_return_enum ldp_notif_no_label_resources(ldp_global * g, ldp_session * s,
 
   LDP_ENTER(g->user_data, "ldp_notif_no_label_resources");
 
-  fec_tlv2mpls_fec(&s_attr->fecTlv, 0, &nfec);
+  ldp_attr2mpls_fec(s_attr, &nfec);
   /* NoRes.1 do not actually remove from tree, just change it's state */
 
   if ((ds_list = ldp_attr_find_downstream_all(g, s, &nfec))) {
@@ -281,7 +286,7 @@ mpls_return_enum ldp_notif_no_label_resources(ldp_global * g, ldp_session * s,
       if (ds_attr->state == LDP_LSP_STATE_REQ_SENT) {
         ds_attr->state = LDP_LSP_STATE_NO_LABEL_RESOURCE_RECV; /* NoRes.2 */
       }
-      ds_attr = MPLS_LIST_NEXT(&s->attr_root, ds_attr, _fs);
+      ds_attr = MPLS_LIST_NEXT(&s->attr_root, ds_attr, _session);
     }
   }
 
@@ -301,7 +306,7 @@ mpls_return_enum ldp_notif_no_route(ldp_global * g, ldp_session * s,
 
   LDP_ENTER(g->user_data, "ldp_notif_no_route\n");
 
-  fec_tlv2mpls_fec(&s_attr->fecTlv, 0, &nfec);
+  ldp_attr2mpls_fec(s_attr, &nfec);
 
   if ((ds_list = ldp_attr_find_downstream_all(g, s, &nfec))) {
     ds_attr = MPLS_LIST_HEAD(&s->attr_root);
@@ -325,7 +330,7 @@ mpls_return_enum ldp_notif_no_route(ldp_global * g, ldp_session * s,
           retval = MPLS_FAILURE;
         }
       }
-      ds_attr = MPLS_LIST_NEXT(&s->attr_root, ds_attr, _fs);
+      ds_attr = MPLS_LIST_NEXT(&s->attr_root, ds_attr, _session);
     }
   }
 
@@ -367,7 +372,7 @@ mpls_return_enum ldp_notif_label_resources_available(ldp_global * g,
 	nh = MPLS_LIST_NEXT(&f->nh_root, nh, _fec);
       }
     }
-    ds_attr = MPLS_LIST_NEXT(&s->attr_root, ds_attr, _fs);
+    ds_attr = MPLS_LIST_NEXT(&s->attr_root, ds_attr, _session);
   }								/* Res.6 */
 
   LDP_EXIT(g->user_data, "ldp_notif_label_resources_available");
@@ -160,6 +160,7 @@ void ldp_peer_send_stop(ldp_global * g, ldp_peer * p)
   if (p->hello != NULL) {
     ldp_mesg_delete(p->hello);
     p->hello = NULL;
+    p->tx_buffer->size = 0;
   }
 
   LDP_EXIT(g->user_data, "ldp_peer_send_stop");
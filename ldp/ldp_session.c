@@ -17,6 +17,7 @@
 #include "ldp_addr.h"
 #include "ldp_attr.h"
 #include "ldp_adj.h"
+#include "ldp_fec.h"
 #include "ldp_mesg.h"
 #include "ldp_buf.h"
 #include "ldp_inet_addr.h"
@@ -25,6 +26,7 @@
 #include "ldp_label_rel_with.h"
 #include "ldp_label_request.h"
 #include "ldp_label_mapping.h"
+#include "ldp_index.h"
 
 #include "mpls_refcnt.h"
 #include "mpls_assert.h"
@@ -98,13 +100,15 @@ ldp_session *ldp_session_create()
     MPLS_LIST_INIT(&s->outlabel_root, ldp_outlabel);
     MPLS_LIST_INIT(&s->attr_root, ldp_attr);
     MPLS_LIST_INIT(&s->adj_root, ldp_adj);
-    mpls_link_list_init(&s->inlabel_root);
+    ldp_index_init(&s->inlabel_index);
     mpls_link_list_init(&s->addr_root);
 
     s->on_global = MPLS_BOOL_FALSE;
     s->tx_buffer = ldp_buf_create(MPLS_PDUMAXLEN);
+    s->rx_buffer = ldp_buf_create(MPLS_PDUMAXLEN);
     s->tx_message = ldp_mesg_create();
     s->index = _ldp_session_get_next_index();
+    s->slot = -1;
     s->oper_role = LDP_NONE;
   }
   return s;
@@ -252,6 +256,16 @@ void ldp_session_delete(ldp_session * s)
 {
   LDP_PRINT(NULL, "session delete");
   MPLS_REFCNT_ASSERT(s, 0);
+  ldp_index_clear(&s->inlabel_index);
+  if (s->tx_buffer) {
+    ldp_buf_delete(s->tx_buffer);
+  }
+  if (s->rx_buffer) {
+    ldp_buf_delete(s->rx_buffer);
+  }
+  if (s->tx_message) {
+    ldp_mesg_delete(s->tx_message);
+  }
   mpls_free(s);
 }
 
@@ -306,9 +320,14 @@ mpls_return_enum ldp_session_startup(ldp_global * g, ldp_session * s)
    * create a timer which will go about "chunking" the initial
    * set of requests or mappings
    */
+  s->initial_fec_index = 0;
+  s->initial_fec_done = 0;
+  s->initial_fec_total = g->fec.count;
+  s->initial_blocked = MPLS_BOOL_FALSE;
+
   MPLS_REFCNT_HOLD(s);
   s->initial_distribution_timer = mpls_timer_create(g->timer_handle,
-    MPLS_UNIT_SEC, LDP_REQUEST_CHUNK, (void *)s, g, callback);
+    MPLS_UNIT_MICRO, LDP_REQUEST_CHUNK * 1000000, (void *)s, g, callback);
 
   if (mpls_timer_handle_verify(g->timer_handle,
       s->initial_distribution_timer) == MPLS_BOOL_FALSE) {
@@ -334,11 +353,94 @@ ldp_session_startup_end:
   return retval;
 }
 
+/*
+ * The initial distribution callbacks walk the FECs in index order and
+ * hand the event loop back after each slice, s->initial_fec_index is
+ * where the next one starts.  A slice ends after initial_slice_fecs FECs
+ * or initial_slice_msec milliseconds, but always covers at least one FEC
+ * unless the socket is backed up.  Then no slice is run until
+ * ldp_session_tx_writable() finds it drained.
+ */
+mpls_bool ldp_session_initial_slice_over(ldp_global * g, ldp_session * s,
+  int count, uint32_t start)
+{
+  if (ldp_session_tx_blocked(g, s) == MPLS_BOOL_TRUE) {
+    return MPLS_BOOL_TRUE;
+  }
+  if (!count) {
+    return MPLS_BOOL_FALSE;
+  }
+  if (g->initial_slice_fecs > 0 && count >= g->initial_slice_fecs) {
+    return MPLS_BOOL_TRUE;
+  }
+  if (g->initial_slice_msec > 0 && mpls_timer_get_msec(g->timer_handle) -
+    start >= (uint32_t)g->initial_slice_msec) {
+    return MPLS_BOOL_TRUE;
+  }
+  return MPLS_BOOL_FALSE;
+}
+
+void ldp_session_initial_reschedule(ldp_global * g, ldp_session * s,
+  mpls_timer_handle timer, mpls_bool done)
+{
+  if (s->initial_distribution_timer != timer) {
+    /* shutdown already deleted the timer */
+    return;
+  }
+
+  if (done == MPLS_BOOL_TRUE) {
+    LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_TIMER,
+      "Initial distribution done: session(%d) fecs(%d)\n", s->index,
+      s->initial_fec_done);
+    mpls_timer_delete(g->timer_handle, timer);
+    s->initial_distribution_timer = (mpls_timer_handle) 0;
+    MPLS_REFCNT_RELEASE(s, ldp_session_delete);
+  } else if (ldp_session_tx_blocked(g, s) == MPLS_BOOL_TRUE) {
+    /* the writable event starts the next slice */
+    s->initial_blocked = MPLS_BOOL_TRUE;
+  } else {
+    /* run the next slice as soon as pending events are handled */
+    mpls_timer_modify(g->timer_handle, timer, 0);
+    mpls_timer_start(g->timer_handle, timer, MPLS_TIMER_ONESHOT);
+  }
+}
+
+/*
+ * Bulk senders ask between FECs.  With more than LDP_SESSION_TX_HIWAT bytes
+ * queued to the socket they stop, and ldp_session_tx_writable() is called
+ * once it has drained to LDP_SESSION_TX_LOWAT.
+ */
+mpls_bool ldp_session_tx_blocked(ldp_global * g, ldp_session * s)
+{
+  if (mpls_socket_tcp_tx_queued(g->socket_handle, s->socket) <=
+    LDP_SESSION_TX_HIWAT) {
+    return MPLS_BOOL_FALSE;
+  }
+  mpls_socket_tcp_tx_notify(g->socket_handle, s->socket,
+    LDP_SESSION_TX_LOWAT);
+  return MPLS_BOOL_TRUE;
+}
+
+mpls_return_enum ldp_session_tx_writable(ldp_global * g, ldp_session * s)
+{
+  if (s->state != LDP_STATE_OPERATIONAL) {
+    return MPLS_SUCCESS;
+  }
+  if (s->initial_blocked == MPLS_BOOL_TRUE &&
+    mpls_timer_handle_verify(g->timer_handle, s->initial_distribution_timer) ==
+    MPLS_BOOL_TRUE) {
+    s->initial_blocked = MPLS_BOOL_FALSE;
+    mpls_timer_modify(g->timer_handle, s->initial_distribution_timer, 0);
+    mpls_timer_start(g->timer_handle, s->initial_distribution_timer,
+      MPLS_TIMER_ONESHOT);
+  }
+  return ldp_fec_policy_resume(g, s);
+}
+
 void ldp_session_shutdown(ldp_global * g, ldp_session * s, mpls_bool complete)
 {
   ldp_addr *a = NULL;
   ldp_attr *attr = NULL;
-  ldp_attr *nattr = NULL;
   ldp_adj* ap;
 
   MPLS_ASSERT(s);
@@ -358,19 +460,12 @@ void ldp_session_shutdown(ldp_global * g, ldp_session * s, mpls_bool complete)
   /*
    * kill the timers for the session
    */
-  if (mpls_timer_handle_verify(g->timer_handle, s->keepalive_recv_timer) ==
-    MPLS_BOOL_TRUE) {
-    mpls_timer_stop(g->timer_handle, s->keepalive_recv_timer);
-    mpls_timer_delete(g->timer_handle, s->keepalive_recv_timer);
-    MPLS_REFCNT_RELEASE(s, ldp_session_delete);
-    s->keepalive_recv_timer = (mpls_timer_handle) 0;
-  }
-  if (mpls_timer_handle_verify(g->timer_handle, s->keepalive_send_timer) ==
+  if (mpls_timer_handle_verify(g->timer_handle, s->keepalive_timer) ==
     MPLS_BOOL_TRUE) {
-    mpls_timer_stop(g->timer_handle, s->keepalive_send_timer);
-    mpls_timer_delete(g->timer_handle, s->keepalive_send_timer);
+    mpls_timer_stop(g->timer_handle, s->keepalive_timer);
+    mpls_timer_delete(g->timer_handle, s->keepalive_timer);
     MPLS_REFCNT_RELEASE(s, ldp_session_delete);
-    s->keepalive_send_timer = (mpls_timer_handle) 0;
+    s->keepalive_timer = (mpls_timer_handle) 0;
   }
   if (mpls_timer_handle_verify(g->timer_handle,s->initial_distribution_timer) ==
     MPLS_BOOL_TRUE) {
@@ -381,13 +476,15 @@ void ldp_session_shutdown(ldp_global * g, ldp_session * s, mpls_bool complete)
   }
 
   /*
-   * get rid of the socket
+   * get rid of the socket, whatever is left in the open PDU goes out first
    */
   if (mpls_socket_handle_verify(g->socket_handle, s->socket) ==
     MPLS_BOOL_TRUE) {
+    ldp_mesg_flush_session(g, s);
     mpls_socket_readlist_del(g->socket_handle, s->socket);
     mpls_socket_close(g->socket_handle, s->socket);
   }
+  ldp_buf_reset(s->rx_buffer);
 
   /*
    * get rid of out cached keepalive
@@ -399,17 +496,18 @@ void ldp_session_shutdown(ldp_global * g, ldp_session * s, mpls_bool complete)
 
   ldp_session_backoff_stop(g,s);
 
-  attr = MPLS_LIST_HEAD(&g->attr);
-  while (attr != NULL) {
-    nattr = MPLS_LIST_NEXT(&g->attr, attr, _global);
-    if (attr->session && attr->session->index == s->index) {
-      /*
-       * ldp_attr_remove_complete removed everythig associated with the attr.
-       * in and out labels, and cross connects as well
-       */
-      ldp_attr_remove_complete(g, attr, complete);
+  /*
+   * every attr of this session is on its attr_root, so only the session's
+   * own state is walked. ldp_attr_remove_complete removes everything
+   * associated with the attr, in and out labels, and cross connects as
+   * well, and takes the attr off attr_root
+   */
+  while ((attr = MPLS_LIST_HEAD(&s->attr_root)) != NULL) {
+    ldp_attr_remove_complete(g, attr, complete);
+    if (attr == MPLS_LIST_HEAD(&s->attr_root)) {
+      MPLS_ASSERT(0);
+      break;
     }
-    attr = nattr;
   }
 
   /*
@@ -447,29 +545,18 @@ void ldp_session_shutdown(ldp_global * g, ldp_session * s, mpls_bool complete)
   LDP_EXIT(g->user_data, "ldp_session_shutdown");
 }
 
-mpls_return_enum ldp_session_maintain_timer(ldp_global * g, ldp_session * s,
-  int flag)
+/*
+ * all session keepalive maintainance comes through here (SEND and RECV),
+ * it only stamps the session, the keepalive timer checks the stamps when
+ * it fires, so no timer is touched per message
+ */
+void ldp_session_maintain_timer(ldp_global * g, ldp_session * s, int flag)
 {
-  mpls_return_enum result = MPLS_FAILURE;
-
-  LDP_ENTER(g->user_data, "ldp_session_maintain_timer");
-
-  /*
-   * all session keepalive maintainance comes through here (SEND and RECV)
-   */
   if (flag == LDP_KEEPALIVE_RECV) {
-    mpls_timer_stop(g->timer_handle, s->keepalive_recv_timer);
-    result = mpls_timer_start(g->timer_handle, s->keepalive_recv_timer,
-      MPLS_TIMER_ONESHOT);
+    s->last_rx = mpls_timer_get_msec(g->timer_handle);
   } else {
-    mpls_timer_stop(g->timer_handle, s->keepalive_send_timer);
-    result = mpls_timer_start(g->timer_handle, s->keepalive_send_timer,
-      MPLS_TIMER_REOCCURRING);
+    s->last_tx = mpls_timer_get_msec(g->timer_handle);
   }
-
-  LDP_EXIT(g->user_data, "ldp_session_maintain_timer");
-
-  return result;
 }
 
 void ldp_session_add_outlabel(ldp_session * s, ldp_outlabel * o)
@@ -492,11 +579,11 @@ mpls_return_enum ldp_session_add_inlabel(ldp_global * g,ldp_session * s, ldp_inl
 {
   MPLS_ASSERT(s && i);
   MPLS_REFCNT_HOLD(i);
-  if (mpls_link_list_add_tail(&s->inlabel_root, i) == MPLS_SUCCESS) {
+  if (ldp_index_insert(&s->inlabel_index, i->index, i) == MPLS_SUCCESS) {
     if (_ldp_inlabel_add_session(i, s) == MPLS_SUCCESS) {
       return MPLS_SUCCESS;
     }
-    mpls_link_list_remove_data(&s->inlabel_root, i);
+    ldp_index_remove(&s->inlabel_index, i->index);
   }
   MPLS_REFCNT_RELEASE2(g, i, ldp_inlabel_delete);
   return MPLS_FAILURE;
@@ -505,7 +592,7 @@ mpls_return_enum ldp_session_add_inlabel(ldp_global * g,ldp_session * s, ldp_inl
 void ldp_session_del_inlabel(ldp_global * g,ldp_session * s, ldp_inlabel * i)
 {
   MPLS_ASSERT(s && i);
-  mpls_link_list_remove_data(&s->inlabel_root, i);
+  ldp_index_remove(&s->inlabel_index, i->index);
   _ldp_inlabel_del_session(i, s);
   MPLS_REFCNT_RELEASE2(g, i, ldp_inlabel_delete)
 }
@@ -728,6 +815,14 @@ mpls_return_enum ldp_session_backoff_start(ldp_global * g, ldp_session * s)
   return MPLS_SUCCESS;
 }
 
+/* LSR-ID of the peer, learned by the adjacencies of the session */
+mpls_inet_addr *ldp_session_lsraddr(ldp_session * s)
+{
+  ldp_adj *a = MPLS_LIST_HEAD(&s->adj_root);
+
+  return a ? &a->remote_lsr_address : NULL;
+}
+
 ldp_session *ldp_session_for_nexthop(ldp_nexthop *nh)
 {
   MPLS_ASSERT(nh);
@@ -22,6 +22,13 @@ extern ldp_session *ldp_session_create_passive(ldp_global * g,
 extern ldp_session *ldp_session_create();
 extern void ldp_session_delete(ldp_session * s);
 extern mpls_return_enum ldp_session_startup(ldp_global * g, ldp_session * s);
+extern mpls_bool ldp_session_initial_slice_over(ldp_global * g,
+  ldp_session * s, int count, uint32_t start);
+extern void ldp_session_initial_reschedule(ldp_global * g, ldp_session * s,
+  mpls_timer_handle timer, mpls_bool done);
+extern mpls_bool ldp_session_tx_blocked(ldp_global * g, ldp_session * s);
+extern mpls_return_enum ldp_session_tx_writable(ldp_global * g,
+  ldp_session * s);
 extern void ldp_session_shutdown(ldp_global * g, ldp_session * s, mpls_bool);
 
 extern void _ldp_session_add_attr(ldp_session * s, ldp_attr * a);
@@ -41,12 +48,13 @@ extern void _ldp_session_add_adj(ldp_session * s, ldp_adj * a);
 extern void _ldp_session_del_adj(ldp_session * s, ldp_adj * a);
 
 extern uint32_t _ldp_session_get_next_index();
-extern mpls_return_enum ldp_session_maintain_timer(ldp_global * g,
-  ldp_session * s, int flag);
+extern void ldp_session_maintain_timer(ldp_global * g, ldp_session * s,
+  int flag);
 
 extern mpls_return_enum ldp_session_find_raddr_index(ldp_session * s,
   uint32_t index, ldp_addr ** addr);
 
 extern ldp_session *ldp_session_for_nexthop(ldp_nexthop *nh);
+extern mpls_inet_addr *ldp_session_lsraddr(ldp_session * s);
 
 #endif
@@ -16,6 +16,7 @@
 #include "ldp_adj.h"
 #include "ldp_attr.h"
 #include "ldp_mesg.h"
+#include "ldp_buf.h"
 #include "ldp_hello.h"
 #include "ldp_init.h"
 #include "ldp_label_rel_with.h"
@@ -284,18 +285,26 @@ mpls_return_enum ldp_state_process(ldp_global * g, ldp_session * s, ldp_adj * a,
   switch (msg->u.generic.flags.flags.msgType) {
     case MPLS_LBLWITH_MSGTYPE:
       {
-        mplsLdpLbl_W_R_Msg_t *rw = &msg->u.release;
+        mplsLdpFecTlv_t *fecTlv = ldp_mesg_tlv(msg, MPLS_FEC_TLVTYPE);
 	ldp_fec *f;
 
-        for (i = 0; i < rw->fecTlv.numberFecElements; i++) {
-          fec_tlv2mpls_fec(&rw->fecTlv, i, &fec);
+        if (msg->tlv_error == MPLS_BOOL_TRUE) {
+          goto ldp_state_process_decode;
+        }
+
+        for (i = 0; fecTlv && i < fecTlv->numberFecElements; i++) {
+          fec_tlv2mpls_fec(fecTlv, i, &fec);
           if (!(r_attr = ldp_attr_create(g, &fec))) {
             goto ldp_state_process_error;
           }
 
           MPLS_REFCNT_HOLD(r_attr);
 
-          rel_with2attr(rw, r_attr);
+          rel_with2attr(msg, r_attr);
+          if (msg->tlv_error == MPLS_BOOL_TRUE) {
+            MPLS_REFCNT_RELEASE2(g, r_attr, ldp_attr_delete);
+            goto ldp_state_process_decode;
+          }
 	  f = ldp_fec_find2(g, &fec);
 	  MPLS_REFCNT_HOLD(f);
 
@@ -310,18 +319,26 @@ mpls_return_enum ldp_state_process(ldp_global * g, ldp_session * s, ldp_adj * a,
       }
     case MPLS_LBLREL_MSGTYPE:
       {
-        mplsLdpLbl_W_R_Msg_t *rw = &msg->u.release;
+        mplsLdpFecTlv_t *fecTlv = ldp_mesg_tlv(msg, MPLS_FEC_TLVTYPE);
 	ldp_fec *f;
 
-        for (i = 0; i < rw->fecTlv.numberFecElements; i++) {
-          fec_tlv2mpls_fec(&rw->fecTlv, i, &fec);
+        if (msg->tlv_error == MPLS_BOOL_TRUE) {
+          goto ldp_state_process_decode;
+        }
+
+        for (i = 0; fecTlv && i < fecTlv->numberFecElements; i++) {
+          fec_tlv2mpls_fec(fecTlv, i, &fec);
           if (!(r_attr = ldp_attr_create(g, &fec))) {
             goto ldp_state_process_error;
           }
 
           MPLS_REFCNT_HOLD(r_attr);
 
-          rel_with2attr(rw, r_attr);
+          rel_with2attr(msg, r_attr);
+          if (msg->tlv_error == MPLS_BOOL_TRUE) {
+            MPLS_REFCNT_RELEASE2(g, r_attr, ldp_attr_delete);
+            goto ldp_state_process_decode;
+          }
 	  f = ldp_fec_find2(g, &fec);
 	  MPLS_REFCNT_HOLD(f);
 
@@ -336,20 +353,28 @@ mpls_return_enum ldp_state_process(ldp_global * g, ldp_session * s, ldp_adj * a,
       }
     case MPLS_LBLREQ_MSGTYPE:
       {
-        mplsLdpLblReqMsg_t *req = &msg->u.request;
+        mplsLdpFecTlv_t *fecTlv = ldp_mesg_tlv(msg, MPLS_FEC_TLVTYPE);
 	ldp_fec *f;
 
-        MPLS_ASSERT(req->fecTlv.numberFecElements == 1);
+        if (msg->tlv_error == MPLS_BOOL_TRUE) {
+          goto ldp_state_process_decode;
+        }
+
+        MPLS_ASSERT(fecTlv && fecTlv->numberFecElements == 1);
 
-        for (i = 0; i < req->fecTlv.numberFecElements; i++) {
-          fec_tlv2mpls_fec(&req->fecTlv, i, &fec);
+        for (i = 0; fecTlv && i < fecTlv->numberFecElements; i++) {
+          fec_tlv2mpls_fec(fecTlv, i, &fec);
           if (!(r_attr = ldp_attr_create(g, &fec))) {
             goto ldp_state_process_error;
           }
 
           MPLS_REFCNT_HOLD(r_attr);
 
-          req2attr(req, r_attr, LDP_ATTR_ALL & ~LDP_ATTR_FEC);
+          req2attr(msg, r_attr, LDP_ATTR_ALL & ~LDP_ATTR_FEC);
+          if (msg->tlv_error == MPLS_BOOL_TRUE) {
+            MPLS_REFCNT_RELEASE2(g, r_attr, ldp_attr_delete);
+            goto ldp_state_process_decode;
+          }
 	  f = ldp_fec_find2(g, &fec);
 	  MPLS_REFCNT_HOLD(f);
 
@@ -364,18 +389,26 @@ mpls_return_enum ldp_state_process(ldp_global * g, ldp_session * s, ldp_adj * a,
       }
     case MPLS_LBLMAP_MSGTYPE:
       {
-        mplsLdpLblMapMsg_t *map = &msg->u.map;
+        mplsLdpFecTlv_t *fecTlv = ldp_mesg_tlv(msg, MPLS_FEC_TLVTYPE);
 	ldp_fec *f;
 
-        for (i = 0; i < map->fecTlv.numberFecElements; i++) {
-          fec_tlv2mpls_fec(&map->fecTlv, i, &fec);
+        if (msg->tlv_error == MPLS_BOOL_TRUE) {
+          goto ldp_state_process_decode;
+        }
+
+        for (i = 0; fecTlv && i < fecTlv->numberFecElements; i++) {
+          fec_tlv2mpls_fec(fecTlv, i, &fec);
           if (!(r_attr = ldp_attr_create(g, &fec))) {
             goto ldp_state_process_error;
           }
 
           MPLS_REFCNT_HOLD(r_attr);
 
-          map2attr(map, r_attr, LDP_ATTR_ALL & ~LDP_ATTR_FEC);
+          map2attr(msg, r_attr, LDP_ATTR_ALL & ~LDP_ATTR_FEC);
+          if (msg->tlv_error == MPLS_BOOL_TRUE) {
+            MPLS_REFCNT_RELEASE2(g, r_attr, ldp_attr_delete);
+            goto ldp_state_process_decode;
+          }
 	  f = ldp_fec_find2(g, &fec);
 	  MPLS_REFCNT_HOLD(f);
 
@@ -390,18 +423,26 @@ mpls_return_enum ldp_state_process(ldp_global * g, ldp_session * s, ldp_adj * a,
       }
     case MPLS_LBLABORT_MSGTYPE:
       {
-        mplsLdpLblAbortMsg_t *abrt = &msg->u.abort;
+        mplsLdpFecTlv_t *fecTlv = ldp_mesg_tlv(msg, MPLS_FEC_TLVTYPE);
 	ldp_fec *f;
 
-        for (i = 0; i < abrt->fecTlv.numberFecElements; i++) {
-          fec_tlv2mpls_fec(&abrt->fecTlv, i, &fec);
+        if (msg->tlv_error == MPLS_BOOL_TRUE) {
+          goto ldp_state_process_decode;
+        }
+
+        for (i = 0; fecTlv && i < fecTlv->numberFecElements; i++) {
+          fec_tlv2mpls_fec(fecTlv, i, &fec);
           if (!(r_attr = ldp_attr_create(g, &fec))) {
             goto ldp_state_process_error;
           }
 
           MPLS_REFCNT_HOLD(r_attr);
 
-          abort2attr(abrt, r_attr, LDP_ATTR_ALL & ~LDP_ATTR_FEC);
+          abort2attr(msg, r_attr, LDP_ATTR_ALL & ~LDP_ATTR_FEC);
+          if (msg->tlv_error == MPLS_BOOL_TRUE) {
+            MPLS_REFCNT_RELEASE2(g, r_attr, ldp_attr_delete);
+            goto ldp_state_process_decode;
+          }
 	  f = ldp_fec_find2(g, &fec);
 	  MPLS_REFCNT_HOLD(f);
 
@@ -431,6 +472,13 @@ mpls_return_enum ldp_state_process(ldp_global * g, ldp_session * s, ldp_adj * a,
 
   return retval;
 
+ldp_state_process_decode:
+
+  LDP_EXIT(g->user_data, "ldp_state_process");
+
+  s->shutdown_notif = LDP_NOTIF_BAD_MESG_LEN;
+  return MPLS_FAILURE;
+
 ldp_state_process_error:
 
   LDP_EXIT(g->user_data, "ldp_state_process");
@@ -470,16 +518,15 @@ mpls_return_enum ldp_state_keepalive_maintainance(ldp_global * g,
   ldp_session * s, ldp_adj * a, ldp_entity * e, uint32_t event, ldp_mesg * msg,
   mpls_dest * from)
 {
-  mpls_return_enum result;
-
   MPLS_ASSERT(s);
 
   LDP_ENTER(g->user_data, "ldp_state_keepalive_maintainance");
-  result = ldp_session_maintain_timer(g, s, LDP_KEEPALIVE_RECV);
+
+  /* ldp_event already stamped the session when the data was read */
 
   LDP_EXIT(g->user_data, "ldp_state_keepalive_maintainance");
 
-  return result;
+  return MPLS_SUCCESS;
 }
 
 mpls_return_enum ldp_state_notif(ldp_global * g, ldp_session * s, ldp_adj * adj,
@@ -70,10 +70,9 @@ mpls_return_enum ldp_event(mpls_cfg_handle handle, mpls_socket_handle socket,
   ldp_entity *entity = NULL;
   ldp_adj *adj = NULL;
 
-  uint8_t buffer[MPLS_PDUMAXLEN];
   mpls_dest from;
-  ldp_mesg mesg;
-  ldp_buf buf;
+  ldp_mesg *mesg = g->rx_mesg;
+  ldp_buf *buf;
 
   LDP_ENTER(g->user_data, "ldp_event");
 
@@ -85,20 +84,21 @@ mpls_return_enum ldp_event(mpls_cfg_handle handle, mpls_socket_handle socket,
     {
       mpls_bool more;
 
-      buf.current = buffer;
-      buf.buffer = buffer;
-      buf.total = MPLS_PDUMAXLEN;
-      buf.size = 0;
-      buf.current_size = 0;
-      buf.want = 0;
-
       /* do this so a failure will know which session caused it */
       if (event == LDP_EVENT_TCP_DATA) {
         session = extra;
+        /* any data from the peer refreshes the hold time */
+        ldp_session_maintain_timer(g, session, LDP_KEEPALIVE_RECV);
+        /* the stream may have stopped in the middle of a PDU last time */
+        buf = session->rx_buffer;
+      } else {
+        /* datagrams always carry whole PDUs */
+        buf = g->rx_buffer;
+        ldp_buf_reset(buf);
       }
 
       do {
-        retval = ldp_buf_process(g, socket, &buf, extra, event, &from, &more);
+        retval = ldp_buf_process(g, socket, buf, extra, event, &from, &more);
       } while (retval == MPLS_SUCCESS && more == MPLS_BOOL_TRUE);
       break;
     }
@@ -117,7 +117,7 @@ mpls_return_enum ldp_event(mpls_cfg_handle handle, mpls_socket_handle socket,
         retval = MPLS_FATAL;
       } else {
         retval = ldp_state_machine(g, session, NULL, NULL,
-          LDP_EVENT_CONNECT, &mesg, &from);
+          LDP_EVENT_CONNECT, mesg, &from);
       }
       break;
     }
@@ -130,7 +130,7 @@ mpls_return_enum ldp_event(mpls_cfg_handle handle, mpls_socket_handle socket,
         /* only get this case if we did a non-block connect */
         mpls_socket_writelist_del(g->socket_handle, socket);
         retval = ldp_state_machine(g, session, NULL, NULL,
-          LDP_EVENT_CONNECT, &mesg, &from);
+          LDP_EVENT_CONNECT, mesg, &from);
       } else if (retval != MPLS_NON_BLOCKING) {
         LDP_TRACE_LOG(g->user_data, MPLS_TRACE_STATE_ALL, LDP_TRACE_FLAG_ERROR,
           "ldp_event: LDP_EVENT_TCP_CONNECT errno = %d\n",
@@ -141,10 +141,17 @@ mpls_return_enum ldp_event(mpls_cfg_handle handle, mpls_socket_handle socket,
       }
       break;
     }
+    case LDP_EVENT_TCP_WRITABLE:
+    {
+      /* the backlog drained, bulk sends stopped on it go on */
+      session = (ldp_session *)extra;
+      retval = ldp_session_tx_writable(g, session);
+      break;
+    }
     case LDP_EVENT_CLOSE:
     {
       retval = ldp_state_machine(g, session, adj, entity,
-        LDP_EVENT_CLOSE, &mesg, &from);
+        LDP_EVENT_CLOSE, mesg, &from);
       break;
     }
     default:
@@ -240,7 +247,7 @@ mpls_return_enum ldp_buf_process(ldp_global * g, mpls_socket_handle socket,
   ldp_session *session = NULL;
   ldp_entity *entity = NULL;
   ldp_adj *adj = NULL;
-  ldp_mesg mesg;
+  ldp_mesg *mesg = g->rx_mesg;
 
   int size = 0;
 
@@ -248,9 +255,12 @@ mpls_return_enum ldp_buf_process(ldp_global * g, mpls_socket_handle socket,
 
   *more = MPLS_BOOL_TRUE;
 
-  memset(&mesg, 0, sizeof(mesg));
+  memset(&mesg->header, 0, sizeof(mesg->header));
   if (!buf->want) {
     buf->want = MPLS_LDP_HDRSIZE;
+  } else if (buf->want > MPLS_LDP_HDRSIZE) {
+    /* the header of the PDU we are in the middle of was decoded earlier */
+    Mpls_decodeLdpMsgHeader(&mesg->header, buf->buffer, MPLS_LDP_HDRSIZE);
   }
 
 read_again:
@@ -322,8 +332,8 @@ decode_again:
   }
 
   /* upon succesful decode the pduLength will be non 0 */
-  if (!mesg.header.pduLength) {
-    if (ldp_decode_header(g, buf, &mesg) != MPLS_SUCCESS) {
+  if (!mesg->header.pduLength) {
+    if (ldp_decode_header(g, buf, mesg) != MPLS_SUCCESS) {
       retval = MPLS_FAILURE;
 
       if (session) {
@@ -338,7 +348,7 @@ decode_again:
      * therefore add 4 so we can compare buf->want to buf->size and
      * not have to adjust
      */
-    buf->want = mesg.header.pduLength + 4;
+    buf->want = mesg->header.pduLength + 4;
     if (buf->size < buf->want) {
       goto read_again;
     }
@@ -348,7 +358,7 @@ decode_again:
   }
 
   do {
-    if (ldp_decode_one_mesg(g, buf, &mesg) != MPLS_SUCCESS) {
+    if (ldp_decode_one_mesg(g, buf, mesg) != MPLS_SUCCESS) {
       retval = MPLS_FAILURE;
 
       if (session) {
@@ -357,7 +367,7 @@ decode_again:
       goto ldp_event_end_loop;
     }
 
-    switch (ldp_mesg_get_type(&mesg)) {
+    switch (ldp_mesg_get_type(mesg)) {
       case MPLS_HELLO_MSGTYPE:
       {
         mpls_oper_state_enum oper_state = MPLS_OPER_DOWN;
@@ -368,9 +378,9 @@ decode_again:
         event = LDP_EVENT_HELLO;
 
         targeted = 0;
-        ldp_mesg_hello_get_targeted(&mesg, &targeted);
-        ldp_mesg_hdr_get_lsraddr(&mesg, &addr);
-        ldp_mesg_hdr_get_labelspace(&mesg, &labelspace);
+        ldp_mesg_hello_get_targeted(mesg, &targeted);
+        ldp_mesg_hdr_get_lsraddr(mesg, &addr);
+        ldp_mesg_hdr_get_labelspace(mesg, &labelspace);
 
         if (targeted) {
           ldp_peer *peer = NULL;
@@ -402,7 +412,7 @@ decode_again:
         }
 
         
-	if ((adj = ldp_entity_find_adj(entity, &mesg))) {
+	if ((adj = ldp_entity_find_adj(g, entity, mesg))) {
 	  session = adj->session;
 	} else {
 	  session = NULL;
@@ -447,7 +457,7 @@ decode_again:
     }
 
     retval =
-      ldp_state_machine(g, session, adj, entity, event, &mesg, from);
+      ldp_state_machine(g, session, adj, entity, event, mesg, from);
 
 ldp_event_end_loop:
 
@@ -465,7 +475,7 @@ ldp_event_end_loop:
   }
 
   buf->current = buf->buffer;
-  memset(&mesg, 0, sizeof(mesg));
+  memset(&mesg->header, 0, sizeof(mesg->header));
   buf->want = MPLS_LDP_HDRSIZE;
 
   if (buf->current_size) {
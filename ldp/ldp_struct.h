@@ -95,6 +95,7 @@ typedef enum {
   LDP_EVENT_TCP_CONNECT,
   LDP_EVENT_UDP_DATA,
   LDP_EVENT_TCP_DATA,
+  LDP_EVENT_TCP_WRITABLE,
 } ldp_event_enum;
 
 typedef enum {
@@ -187,8 +188,26 @@ typedef enum {
 #include "mpls_handle_type.h"
 #include "ldp_nortel.h"
 
+/*
+ * Where one TLV of a received label message is, ldp_decode_one_mesg only
+ * finds the TLVs and ldp_mesg_tlv decodes one into the message the first
+ * time it is asked for.  value points into the receive buffer, it is good
+ * until the next message is decoded.
+ */
+typedef struct ldp_tlv_view {
+  mplsLdpTlv_t tlv;
+  u_char *value;
+  void *decoded;
+  mpls_bool done;
+} ldp_tlv_view;
+
+#define LDP_MESG_TLV_MAX 10     /* TLV types known in a label request */
+
 typedef struct ldp_mesg {
   mplsLdpHeader_t header;
+  ldp_tlv_view tlv[LDP_MESG_TLV_MAX];
+  int tlv_count;
+  mpls_bool tlv_error;          /* a TLV did not decode */
   union {
     mplsLdpMsg_t generic;
     mplsLdpInitMsg_t init;
@@ -212,6 +231,18 @@ typedef struct ldp_buf {
   int want;
 } ldp_buf;
 
+typedef struct ldp_index_slot {
+  uint32_t index;
+  void *obj;
+} ldp_index_slot;
+
+typedef struct ldp_index_table {
+  ldp_index_slot *slot;
+  uint32_t size;
+  uint32_t count;
+  mpls_bool incomplete;	/* an insert failed, lookups must fall back */
+} ldp_index_table;
+
 typedef struct ldp_global {
   struct ldp_outlabel_list outlabel;
   struct ldp_resource_list resource;
@@ -228,6 +259,30 @@ typedef struct ldp_global {
   struct ldp_if_list iff;
   struct ldp_fec_list fec;
 
+  /* index -> object maps for the lists above */
+  ldp_index_table outlabel_index;
+  ldp_index_table resource_index;
+  ldp_index_table hop_list_index;
+  ldp_index_table inlabel_index;
+  ldp_index_table session_index;
+  ldp_index_table tunnel_index;
+  ldp_index_table entity_index;
+  ldp_index_table peer_index;
+  ldp_index_table attr_index;
+  ldp_index_table addr_index;
+  ldp_index_table adj_index;
+  ldp_index_table if_index;
+  ldp_index_table fec_index;
+
+  /* hashed lookups on the hello receive path, see ldp_index_add() */
+  ldp_index_table peer_addr_hash;	/* peer dest address */
+  ldp_index_table if_handle_hash;	/* if handle */
+  ldp_index_table adj_ldpid_hash;	/* adj LSR-ID and label space */
+
+  /* slot -> session, slots are handed out lowest first */
+  struct ldp_session **session_slot;
+  int session_slot_size;
+
   mpls_lock_handle global_lock;
   mpls_instance_handle user_data;
 
@@ -237,6 +292,10 @@ typedef struct ldp_global {
   mpls_socket_handle hello_socket;
   mpls_socket_handle listen_socket;
 
+  /* receive scratch space, reused for every event */
+  struct ldp_buf *rx_buffer;
+  struct ldp_mesg *rx_mesg;
+
   mpls_timer_mgr_handle timer_handle;
   mpls_socket_mgr_handle socket_handle;
   mpls_fib_handle fib_handle;
@@ -259,6 +318,9 @@ typedef struct ldp_global {
    */
   uint32_t message_identifier;
 
+  /* number of sessions with an unsent PDU in their tx_buffer */
+  int tx_pending;
+
   struct mpls_inet_addr lsr_identifier;
   mpls_bool send_address_messages;
   mpls_bool send_lsrid_mapping;
@@ -275,6 +337,10 @@ typedef struct ldp_global {
   int no_route_to_peer_time;
   mpls_bool edge_inlabel;
 
+  /* bounds of one slice of initial label distribution, 0 is unbounded */
+  int initial_slice_fecs;
+  int initial_slice_msec;
+
   /*
    * some global defaults, entities will inherit these values unless
    * instructed otherwise
@@ -389,13 +455,14 @@ typedef struct ldp_session {
   MPLS_REFCNT_FIELD;
   MPLS_LIST_ELEM(ldp_session) _global;
   struct ldp_outlabel_list outlabel_root;
-  struct mpls_link_list inlabel_root;
+  ldp_index_table inlabel_index;
   struct mpls_link_list addr_root;
-  struct ldp_attr_list attr_root;
+  struct ldp_attr_list attr_root; /* every attr, upstream and downstream */
   struct ldp_adj_list adj_root;
   mpls_timer_handle initial_distribution_timer;
-  mpls_timer_handle keepalive_recv_timer;
-  mpls_timer_handle keepalive_send_timer;
+  mpls_timer_handle keepalive_timer;
+  uint32_t last_rx; /* msec, data read from the peer */
+  uint32_t last_tx; /* msec, PDU written to the peer */
   uint32_t index;
   ldp_state_enum state;
   uint32_t oper_up;
@@ -404,6 +471,17 @@ typedef struct ldp_session {
   mpls_socket_handle socket;
   mpls_timer_handle backoff_timer;
   int backoff;
+  int slot; /* dense number while on the global list, -1 otherwise */
+
+  /* initial label distribution, the next slice starts at fec index */
+  uint32_t initial_fec_index;
+  uint32_t initial_fec_done;
+  uint32_t initial_fec_total;
+  mpls_bool initial_blocked; /* waits for the tx backlog to drain */
+
+  /* policy re-apply stopped on the tx backlog, resumes at fec index */
+  mpls_bool policy_pending;
+  uint32_t policy_fec_index;
 
   /* operational values learned from initialization */
   int oper_max_pdu;
@@ -430,6 +508,8 @@ typedef struct ldp_session {
   struct ldp_mesg *keepalive;
   struct ldp_mesg *tx_message;
   struct ldp_buf *tx_buffer;
+  mpls_bool tx_pending;
+  struct ldp_buf *rx_buffer; /* keeps a partial PDU between reads */
 
   /* cached from adj's */ 
   ldp_role_enum oper_role;
@@ -562,6 +642,13 @@ typedef struct ldp_inlabel {
   uint32_t outlabel_index;
 } ldp_inlabel;
 
+/* fs of a FEC indexed by session slot */
+typedef struct ldp_fs_slots {
+  struct ldp_fs **fs;
+  int size;
+  mpls_bool incomplete; /* some fs are only on the list */
+} ldp_fs_slots;
+
 typedef struct ldp_fec {
   MPLS_REFCNT_FIELD;
   MPLS_LIST_ELEM(ldp_fec) _global;
@@ -573,6 +660,8 @@ typedef struct ldp_fec {
   MPLS_LIST_ELEM(ldp_fec) _if;
   struct ldp_fs_list fs_root_us;
   struct ldp_fs_list fs_root_ds;
+  ldp_fs_slots fs_slot_us;
+  ldp_fs_slots fs_slot_ds;
   /* ECMP */
   struct ldp_nexthop_list nh_root;
   struct mpls_fec info;
@@ -584,8 +673,28 @@ typedef struct ldp_fs {
   struct ldp_attr_list attr_root;
   MPLS_LIST_ELEM(ldp_fs) _fec;
   struct ldp_session *session;
+  int slot; /* position in the fec's ldp_fs_slots, -1 if not there */
 } ldp_fs;
 
+/* an attr is for a single FEC, so its FEC TLV has room for one element */
+typedef struct ldp_attr_fec_tlv {
+  union mplsFecElement_u fecElArray[1];
+  u_short fecElemTypes[1];
+  u_short numberFecElements;
+} ldp_attr_fec_tlv;
+
+/*
+ * TLVs that prefix FEC attrs rarely carry, kept out of line and only
+ * allocated once one of them is set, see ldp_attr_ext_get()
+ */
+typedef struct ldp_attr_ext {
+  mplsLdpPathTlv_t pathVecTlv;
+  mplsLdpLspIdTlv_t lspidTlv;
+  mplsLdpTrafficTlv_t trafficTlv;
+  mplsLdpStatusTlv_t statusTlv;
+  mplsLdpLblMsgIdTlv_t retMsgTlv; /* head of the returned message only */
+} ldp_attr_ext;
+
 typedef struct ldp_attr {
   MPLS_REFCNT_FIELD;
   uint32_t index;
@@ -607,17 +716,13 @@ typedef struct ldp_attr {
   MPLS_LIST_ELEM(ldp_attr) _ds_attr;
   MPLS_LIST_ELEM(ldp_attr) _fs;
 
-  mplsLdpFecTlv_t fecTlv;
+  ldp_attr_fec_tlv fecTlv;
   mplsLdpGenLblTlv_t genLblTlv;
   mplsLdpAtmLblTlv_t atmLblTlv;
   mplsLdpFrLblTlv_t frLblTlv;
   mplsLdpHopTlv_t hopCountTlv;
-  mplsLdpPathTlv_t pathVecTlv;
   mplsLdpLblMsgIdTlv_t lblMsgIdTlv;
-  mplsLdpLspIdTlv_t lspidTlv;
-  mplsLdpTrafficTlv_t trafficTlv;
-  mplsLdpStatusTlv_t statusTlv;
-  mplsLdpRetMsgTlv_t retMsgTlv;
+  ldp_attr_ext *ext;
 
   uint8_t fecTlvExists:1;
   uint8_t genLblTlvExists:1;
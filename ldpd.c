@@ -1,4 +1,5 @@
 #include "ldpd.h"
+#include <signal.h>
 
 
 void handleSignal(int sig, short event, void *arg)
@@ -12,10 +13,13 @@ void handleSignal(int sig, short event, void *arg)
 		Interfaces_Shutdown();
 		LDP_Shutdown();
 		mpls_shutdown();
+		Label_Shutdown();
+		mpls_log_flush();
 		exit(0);
 		break;
 	case SIGHUP:
 		Config_Reload();
+		ldp_cfg_flush(ldp->config);
 		break;
 	default:
 		fprintf(stderr, "unexpected signal");
@@ -57,6 +61,11 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+#if MPLS_LOG_LEVEL < MPLS_LOG_TRACE
+	if(ldp_traceflags == LDP_TRACE_FLAG_ALL)
+		fprintf(stderr, "LDP_ENTER/EXIT/PRINT are compiled out, rebuild with LOG_LEVEL=4 to see them\n");
+#endif
+
 	if(!debug) {
 		ldp_traceflags = 0;
 		daemon(1, 0);
@@ -71,6 +80,12 @@ int main(int argc, char *argv[])
 	signal_add(&eventTERM, NULL);
 	signal_add(&eventHUP, NULL);
 
+	/* a control client or peer that goes away mid-write is an error on the write */
+	signal(SIGPIPE, SIG_IGN);
+
+	mpls_mm_init();
+	mpls_log_init();
+	Label_Init();
 	mpls_init();
 	LDP_Init();
 	Interfaces_Init();
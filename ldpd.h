@@ -5,6 +5,7 @@
 #include <sys/param.h>
 #include <sys/time.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/tree.h>
 #include <net/if.h>
 #include <net/if_dl.h>
@@ -59,6 +60,15 @@ typedef enum {
 	LDP_ADDRESS_LDP		/* only LDP interfaces */
 } addressMode_t;
 
+/* decisions a label filter applies to */
+typedef enum {
+	POLICY_IMPORT,		/* mappings learned from a peer */
+	POLICY_EXPORT,		/* mappings sent to a peer */
+	POLICY_EGRESS		/* FECs this LSR is egress for */
+} policyType_t;
+
+typedef struct policySet_s policySet_t;
+
 /* global transport address */
 typedef enum {
 	LDP_TRANS_ADDR_NONE = 0,			/* none */
@@ -69,6 +79,23 @@ typedef enum {
 } transAddrMode_t;
 
 
+/* label blocks managed by label.c */
+typedef enum {
+	LABEL_BLOCK_RESERVED,	/* 0-15, never allocated */
+	LABEL_BLOCK_VPN,		/* l2transport VPN labels */
+	LABEL_BLOCK_DYNAMIC,	/* labels for FECs */
+	LABEL_BLOCK_NUM
+} labelBlockType_t;
+
+#define LABEL_MIN			16
+#define LABEL_MAX			0xFFFFF
+
+#define LABEL_DEF_VPN_MIN	16
+#define LABEL_DEF_VPN_MAX	99
+#define LABEL_DEF_DYN_MIN	100
+#define LABEL_DEF_DYN_MAX	LABEL_MAX
+
+
 #define LDP_DEF_EGRESS_POLICY LDP_EGRESS_CONNECTED
 #define LDP_DEF_ADDRESS_POLICY LDP_ADDRESS_ALL
 #define LDP_DEF_TRANSPORT_ADDRESS_POLICY LDP_TRANS_ADDR_INTERFACE
@@ -147,6 +174,27 @@ void Config_Load(char *path);
 void Config_Reload();
 void Config_Save();
 
+/* control.c */
+typedef struct client_s client_t;
+
+/* where a streamed answer is, zeroed when it starts */
+typedef struct controlCursor_s {
+	int			started;
+	uint64_t	index;		/* where the show function got to */
+	uint32_t	left;		/* records still to send */
+	void		*data;		/* free()d when the answer ends */
+} controlCursor_t;
+
+/* sends records while Control_Room() lets it, returns 0 once done */
+typedef int (*controlShow_t)(client_t *client, controlCursor_t *cursor);
+
+void Control_Init();
+void Control_Shutdown();
+void Control_Write(client_t *client, const void *data, uint32_t length);
+int Control_Room(client_t *client);
+void Control_Follow(uint32_t type, const void *data, uint32_t length);
+void Control_FollowFlush();
+
 /* ldp.c */
 int LDP_Init();
 void LDP_Shutdown();
@@ -178,9 +226,23 @@ void Peer_Destroy(peer_t *peer);
 void Peer_Enable(peer_t *peer);
 void Peer_Disable(peer_t *peer);
 
+/* label.c */
+int Label_Init();
+void Label_Shutdown();
+int Label_SetRange(int type, int32_t min, int32_t max);
+void Label_GetRange(int type, int32_t *min, int32_t *max);
+int32_t Label_Alloc(int type);
+void Label_Free(int32_t label);
+void Label_ShowBlocks(client_t *client);
+
 /* kernel.c */
+#define KERNEL_DEF_ROUTE_BATCH	50	/* msec */
+
 void Kernel_Init();
 void Kernel_Shutdown();
+void Kernel_SetBatch(int msec);
+int Kernel_GetBatch();
+void Kernel_GetStats(uint32_t *received, uint32_t *coalesced, uint32_t *applied);
 
 /* mpls.c */
 void MPLS_Disable();
@@ -194,9 +256,34 @@ void MPLS_DelOut(int label, struct in_addr *prefix, int prefixLen, const char *i
 void MPLS_AddCrossConnect(int local, int outgoing);
 void MPLS_DelCrossConnect(int local, int outgoing);
 void MPLS_AddVPN(int type, const char *iface, struct in_addr *dest, int label);
-void MPLS_ShowLIB(int fd);
+int MPLS_ShowLIB(client_t *client, controlCursor_t *cursor);
+void MPLS_GetStats(uint32_t *flushes, uint32_t *queued, uint32_t *cancelled);
 void MPLS_Init();
 void MPLS_Shutdown();
+void mpls_flush();
+int32_t mpls_alloc_label();
+void mpls_free_label(int32_t label);
+
+/* freebsd/mpls_mm_impl.c */
+void mpls_mm_init();
+void mpls_mm_name(mpls_size_type size, const char *name);
+void mpls_mm_show(client_t *client);
+
+/* freebsd/mpls_policy_impl.c */
+policySet_t *mpls_policy_create();
+void mpls_policy_free(policySet_t *set);
+int mpls_policy_add_prefix(policySet_t *set, const char *name, int permit, struct in_addr prefix, int length, int ge, int le);
+int mpls_policy_add_filter(policySet_t *set, policyType_t type, struct in_addr neighbor, const char *name);
+int mpls_policy_install(policySet_t *set);
+void mpls_policy_save(FILE *file);
+
+/* freebsd/mpls_socket_impl.c */
+void mpls_socket_get_stats(uint32_t *wakeups, uint32_t *datagrams, uint32_t *batchMax);
+
+/* freebsd/mpls_trace_impl.c */
+void mpls_log_init();
+void mpls_log_flush();
+int mpls_log_show(client_t *client, controlCursor_t *cursor);
 
 
 #endif
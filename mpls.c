@@ -18,7 +18,13 @@
 #include <netinet/in.h>
 #include <netinet/ip.h>
 
+#include <poll.h>
+
+#ifdef NETGRAPH_MOCK
+#include "ngmock.h"
+#else
 #include <netgraph.h>
+#endif
 
 #include <stdio.h>
 #include <stdarg.h>
@@ -27,78 +33,409 @@
 #include "../ng_mpls/public.h"
 
 
-static int32_t label = 100;
-
+/* mpls_alloc_label: allocates a label from the dynamic block */
 int32_t mpls_alloc_label()
 {
-	return label++;
+	return Label_Alloc(LABEL_BLOCK_DYNAMIC);
+}
+
+/* mpls_free_label: returns a label to its block */
+void mpls_free_label(int32_t label)
+{
+	if(label >= 16)
+		Label_Free(label);
 }
 
+/* persistent netgraph control socket, opened by mpls_init() */
+static int ctl_socket = -1;
+static struct event ctl_event;
+
+#define MPLS_REPLY_TIMEOUT	1000	/* msec to wait for a synchronous reply */
+
+
+static void mpls_drain(int fd, short event, void *arg);
+
 static int mpls_connect()
 {
-	int s;
+	if(ctl_socket >= 0)
+		return ctl_socket;
 
-	if(NgMkSockNode("mplsctl", &s, NULL) == -1) {
+	if(NgMkSockNode("mplsctl", &ctl_socket, NULL) == -1) {
 		printf("mpls_connect: Cannot create control socket (may be already exists)\n");
+		ctl_socket = -1;
 		return -1;
 	}
 
-	return s;
+	/* requests are pipelined, so never block on a full socket queue */
+	fcntl(ctl_socket, F_SETFL, O_NONBLOCK);
+
+	/* replies nobody waits for are drained from the event loop */
+	event_set(&ctl_event, ctl_socket, EV_READ | EV_PERSIST, mpls_drain, NULL);
+	event_add(&ctl_event, NULL);
+
+	return ctl_socket;
 }
 
-/* mpls_netgraph_request */
-static struct ng_mesg *mpls_netgraph_request(const char *name, int cookie, int command, const void *request, int size, int need_result)
+static void mpls_disconnect()
+{
+	if(ctl_socket < 0)
+		return;
+
+	event_del(&ctl_event);
+	close(ctl_socket);
+	ctl_socket = -1;
+}
+
+/* mpls_drain: discard pending replies to fire-and-forget requests */
+static void mpls_drain(int fd, short event, void *arg)
 {
-	int token, s;
 	struct ng_mesg *reply;
 
-	if(size < 0) {
-		return NULL;
+	reply = NULL;
+	while(NgAllocRecvMsg(fd, &reply, NULL) != -1) {
+		free(reply);
+		reply = NULL;
+	}
+
+	if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+		printf("mpls_drain: control socket lost (%s), reconnecting\n", strerror(errno));
+		mpls_disconnect();
+		mpls_connect();
+	}
+}
+
+/* mpls_send: queue one message on the control socket, returns its token */
+static int mpls_send(const char *path, int cookie, int command, const void *request, int size)
+{
+	int s, token, attempt;
+
+	for(attempt = 0; attempt < 2; attempt++) {
+		s = mpls_connect();
+		if(s < 0)
+			return -1;
+
+		token = NgSendMsg(s, path, cookie, command, request, size);
+		if(token != -1)
+			return token;
+
+		switch(errno) {
+		case EAGAIN:
+		case ENOBUFS:
+			/* queue is full of unread replies */
+			mpls_drain(s, EV_READ, NULL);
+			break;
+		case EBADF:
+		case EPIPE:
+		case ENOTCONN:
+		case ECONNRESET:
+			/* node went away under us */
+			mpls_disconnect();
+			break;
+		default:
+			return -1;
+		}
 	}
 
+	return -1;
+}
+
+/* mpls_recv: wait for the reply carrying given token */
+static struct ng_mesg *mpls_recv(int token)
+{
+	int s;
+	struct pollfd pfd;
+	struct ng_mesg *reply;
+
 	s = mpls_connect();
-	if(!s) {
+	if(s < 0)
+		return NULL;
+
+	pfd.fd = s;
+	pfd.events = POLLIN;
+	while(1) {
+		reply = NULL;
+		if(NgAllocRecvMsg(s, &reply, NULL) == -1) {
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				break;
+			if(poll(&pfd, 1, MPLS_REPLY_TIMEOUT) <= 0)
+				break;
+			continue;
+		}
+
+		if(reply && reply->header.token == token)
+			return reply;
+
+		/* late reply to an earlier pipelined request */
+		free(reply);
+	}
+
+	printf("mpls_recv: Cannot receive reply for token %d\n", token);
+	return NULL;
+}
+
+/* mpls_netgraph_request */
+static struct ng_mesg *mpls_netgraph_request(const char *name, int cookie, int command, const void *request, int size, int need_result)
+{
+	int token;
+
+	if(size < 0) {
 		return NULL;
 	}
 
 	/* send request */
-	token = NgSendMsg(s, name, cookie, command, request, size);
+	token = mpls_send(name, cookie, command, request, size);
 	if(token == -1) {
 		printf("mpls_netgraph_request: Cannot send message %u (%s)\n", command, strerror(errno));
-		close(s);
 		return NULL;
 	}
 
 	if(!need_result) {
-		close(s);
 		return NULL;
 	}
 
 	/* read reply */
-	reply = NULL;
-	if(NgAllocRecvMsg(s, &reply, NULL) == -1 || !reply) {
-		printf("mpls_netgraph_request: Cannot receive message\n");
-		close(s);
-		return NULL;
+	return mpls_recv(token);
+}
+
+
+/* mpls_request */
+static struct ng_mesg *mpls_request(int command, const void *request, int size, int need_result)
+{
+	return mpls_netgraph_request("mpls:", NGM_MPLS_COOKIE, command, request, size, need_result);
+}
+
+
+/*
+ * LIB updates are not sent right away but collected in a batch which is
+ * flushed once the current event has been handled. An update followed by
+ * its opposite within the same batch cancels out and never reaches ng_mpls.
+ */
+#define MPLS_BATCH_HASH		1024
+#define MPLS_BATCH_INITIAL	256
+
+typedef struct mplsBatchOp_s {
+	int							command;	/* NGM_MPLS_*, 0 when cancelled */
+	int							next;		/* hash chain, -1 terminates */
+	uint32_t					key;
+	struct ng_mpls_lib_entry	entry;
+} mplsBatchOp_t;
+
+static mplsBatchOp_t *batch = NULL;
+static int batchSize = 0;
+static int batchMax = 0;
+static int batchHash[MPLS_BATCH_HASH];
+static struct event batchEvent;
+static int batchScheduled = 0;
+
+/* batch statistics */
+static uint32_t batchFlushes = 0;
+static uint32_t batchQueued = 0;
+static uint32_t batchCancelled = 0;
+
+
+static void mpls_flush_event(int fd, short event, void *arg);
+
+/* mpls_batch_key: hash of the LIB object an entry refers to */
+static uint32_t mpls_batch_key(int command, const struct ng_mpls_lib_entry *entry)
+{
+	uint32_t key;
+
+	switch(command) {
+	case NGM_MPLS_ADD_XC:
+	case NGM_MPLS_DELETE_XC:
+		key = entry->local * 31 + entry->remote;
+		break;
+	case NGM_MPLS_DELETE_LOCAL:
+		key = entry->local;
+		break;
+	default:
+		if(entry->type == LIB_NORMAL && entry->local == -1)
+			key = entry->remote * 31 + entry->prefix.prefix.s_addr + entry->nexthop.s_addr;
+		else
+			key = entry->local;
+		break;
 	}
 
-	if(reply->header.token != token) {
-		printf("mpls_netgraph_request: Token mismatch\n");
-		free(reply);
-		close(s);
-		return NULL;
+	return key % MPLS_BATCH_HASH;
+}
+
+/* mpls_batch_opposite: pending command that given one cancels, 0 if none */
+static int mpls_batch_opposite(int command, const struct ng_mpls_lib_entry *entry)
+{
+	switch(command) {
+	case NGM_MPLS_ADD:
+		/* a delete carries no prefix, so only a NHLFE re-add can cancel it */
+		if(entry->type == LIB_NORMAL)
+			return NGM_MPLS_DELETE_REMOTE;
+		return 0;
+	case NGM_MPLS_DELETE_LOCAL:
+	case NGM_MPLS_DELETE_REMOTE:
+		return NGM_MPLS_ADD;
+	case NGM_MPLS_ADD_XC:
+		return NGM_MPLS_DELETE_XC;
+	case NGM_MPLS_DELETE_XC:
+		return NGM_MPLS_ADD_XC;
 	}
 
-	close(s);
+	return 0;
+}
+
+/* mpls_batch_match: does pending op refer to the same LIB object as entry */
+static int mpls_batch_match(const mplsBatchOp_t *op, int command, const struct ng_mpls_lib_entry *entry)
+{
+	const struct ng_mpls_lib_entry *pending;
+
+	pending = &op->entry;
+	switch(command) {
+	case NGM_MPLS_ADD_XC:
+	case NGM_MPLS_DELETE_XC:
+		return pending->local == entry->local && pending->remote == entry->remote;
+	case NGM_MPLS_DELETE_LOCAL:
+		return pending->type == LIB_IN && pending->local == entry->local;
+	case NGM_MPLS_DELETE_REMOTE:
+		break;
+	case NGM_MPLS_ADD:
+		break;
+	default:
+		return 0;
+	}
 
-	return reply;
+	/* NHLFE */
+	return pending->local == -1 && pending->remote == entry->remote &&
+		pending->prefix.prefix.s_addr == entry->prefix.prefix.s_addr &&
+		pending->prefix.length == entry->prefix.length &&
+		pending->nexthop.s_addr == entry->nexthop.s_addr &&
+		!strcmp(pending->if_name, entry->if_name);
 }
 
+/* mpls_batch_class: the kind of LIB object an update refers to */
+static int mpls_batch_class(int command, const struct ng_mpls_lib_entry *entry)
+{
+	switch(command) {
+	case NGM_MPLS_ADD_XC:
+	case NGM_MPLS_DELETE_XC:
+		return NGM_MPLS_ADD_XC;
+	case NGM_MPLS_DELETE_REMOTE:
+		return NGM_MPLS_DELETE_REMOTE;
+	case NGM_MPLS_ADD:
+		if(entry->type == LIB_NORMAL && entry->local == -1)
+			return NGM_MPLS_DELETE_REMOTE;
+		break;
+	}
+
+	return NGM_MPLS_DELETE_LOCAL;
+}
 
-/* mpls_request */
-static struct ng_mesg *mpls_request(int command, const void *request, int size, int need_result)
+/* mpls_batch_same: does pending op touch the LIB object entry refers to, whatever it does to it */
+static int mpls_batch_same(const mplsBatchOp_t *op, int command, const struct ng_mpls_lib_entry *entry)
 {
-	return mpls_netgraph_request("mpls:", NGM_MPLS_COOKIE, command, request, size, need_result);
+	const struct ng_mpls_lib_entry *pending;
+
+	pending = &op->entry;
+	if(mpls_batch_class(op->command, pending) != mpls_batch_class(command, entry))
+		return 0;
+
+	switch(mpls_batch_class(command, entry)) {
+	case NGM_MPLS_ADD_XC:
+		return pending->local == entry->local && pending->remote == entry->remote;
+	case NGM_MPLS_DELETE_REMOTE:
+		return pending->remote == entry->remote &&
+			pending->prefix.prefix.s_addr == entry->prefix.prefix.s_addr &&
+			pending->prefix.length == entry->prefix.length &&
+			pending->nexthop.s_addr == entry->nexthop.s_addr &&
+			!strcmp(pending->if_name, entry->if_name);
+	default:
+		return pending->local == entry->local;
+	}
+}
+
+/* mpls_batch: queue one LIB update until the next flush */
+static void mpls_batch(int command, const struct ng_mpls_lib_entry *entry)
+{
+	int i, opposite;
+	uint32_t key;
+	mplsBatchOp_t *op;
+	struct timeval tv;
+
+	key = mpls_batch_key(command, entry);
+
+	/*
+	 * add and delete of the same object in one batch cancel out, as long as
+	 * nothing else was queued for that object in between. batchHash is only
+	 * valid while the batch holds updates, those of a flushed batch are out.
+	 */
+	opposite = mpls_batch_opposite(command, entry);
+	if(opposite && batchSize) {
+		for(i = batchHash[key]; i != -1; i = batch[i].next) {
+			if(!batch[i].command || !mpls_batch_same(&batch[i], command, entry))
+				continue;
+			if(batch[i].command == opposite && mpls_batch_match(&batch[i], command, entry)) {
+				batch[i].command = 0;
+				batchCancelled++;
+				return;
+			}
+			break;
+		}
+	}
+
+	if(batchSize == batchMax) {
+		op = realloc(batch, sizeof(mplsBatchOp_t) * (batchMax ? batchMax * 2 : MPLS_BATCH_INITIAL));
+		if(!op) {
+			/* no memory to defer it, program the node directly */
+			mpls_flush();
+			mpls_request(command, entry, sizeof(*entry), 0);
+			return;
+		}
+		batch = op;
+		batchMax = batchMax ? batchMax * 2 : MPLS_BATCH_INITIAL;
+	}
+
+	if(!batchSize)
+		memset(batchHash, 0xff, sizeof(batchHash));
+
+	op = &batch[batchSize];
+	op->command = command;
+	op->key = key;
+	op->next = batchHash[key];
+	memcpy(&op->entry, entry, sizeof(*entry));
+	batchHash[key] = batchSize++;
+	batchQueued++;
+
+	/* updates made outside of socket and timer events are flushed on the next loop pass */
+	if(!batchScheduled) {
+		timerclear(&tv);
+		evtimer_set(&batchEvent, mpls_flush_event, NULL);
+		evtimer_add(&batchEvent, &tv);
+		batchScheduled = 1;
+	}
+}
+
+/* mpls_flush: send every pending LIB update to ng_mpls */
+void mpls_flush()
+{
+	int i;
+
+	if(batchScheduled) {
+		evtimer_del(&batchEvent);
+		batchScheduled = 0;
+	}
+
+	if(!batchSize)
+		return;
+
+	/* requests are pipelined on the control socket, no reply is awaited */
+	for(i = 0; i < batchSize; i++)
+		if(batch[i].command)
+			mpls_request(batch[i].command, &batch[i].entry, sizeof(batch[i].entry), 0);
+
+	batchSize = 0;
+	batchFlushes++;
+}
+
+static void mpls_flush_event(int fd, short event, void *arg)
+{
+	batchScheduled = 0;
+	mpls_flush();
 }
 
 
@@ -109,22 +446,13 @@ MPLS_Disable
 */
 void mpls_disable()
 {
-	int s;
-
-	s = mpls_connect();
-	if(!s) { 
-		return;
-	}
-
-	NgSendMsg(s, "mpls:", NGM_GENERIC_COOKIE, NGM_SHUTDOWN, NULL, 0);
-	close(s);
+	mpls_send("mpls:", NGM_GENERIC_COOKIE, NGM_SHUTDOWN, NULL, 0);
 }
 
 
 /* mpls_enable_interface */
 void mpls_enable_interface(const char *name)
 {
-	int s;
 	char path[IFNAMSIZ + NG_HOOKSIZ + 2];
 	struct ngm_mkpeer make_peer;
 	struct ngm_name set_name;
@@ -134,15 +462,9 @@ void mpls_enable_interface(const char *name)
 	strcpy(path, name);
 	strcat(path, ":");
 
-	s = mpls_connect();
-	if(!s) {
-		return;
-	}
-
-	if(NgSendMsg(s, "mpls:", NGM_GENERIC_COOKIE, NGM_NODEINFO, NULL, 0) == -1) {
-		if(errno != 2) {
+	if(mpls_send("mpls:", NGM_GENERIC_COOKIE, NGM_NODEINFO, NULL, 0) == -1) {
+		if(errno != ENOENT) {
 			printf("mpls_enable_interface: MPLS node not found (%s)\n", strerror(errno));
-			close(s);
 			return;
 		}
 
@@ -174,8 +496,6 @@ void mpls_enable_interface(const char *name)
 	strcpy(node_connect.peerhook, NG_MPLS_HOOK_UPPER);
 	strcat(node_connect.peerhook, name);
 	mpls_netgraph_request(path, NGM_GENERIC_COOKIE, NGM_CONNECT, &node_connect, sizeof(node_connect), 0);
-
-	close(s);
 }
 
 
@@ -199,6 +519,7 @@ int32_t mpls_get_label_by_prefix(struct in_addr *prefix_in, int length)
 
 	prefix.prefix.s_addr = prefix_in->s_addr;
 	prefix.length = length;
+	mpls_flush();
 	reply = mpls_request(NGM_MPLS_GET, &prefix, sizeof(prefix), 1);
 	if(!reply) {
 		return -1;
@@ -226,7 +547,7 @@ void mpls_add_local(int32_t label, struct in_addr *prefix, int length)
 	entry.prefix.prefix.s_addr = prefix->s_addr;
 	entry.prefix.length = length;
 
-	mpls_request(NGM_MPLS_ADD, &entry, sizeof(entry), 0);
+	mpls_batch(NGM_MPLS_ADD, &entry);
 }
 
 
@@ -239,7 +560,7 @@ void mpls_delete_local(int32_t label)
 	entry.type = LIB_NORMAL;
 	entry.local = label;
 
-	mpls_request(NGM_MPLS_DELETE_LOCAL, &entry, sizeof(entry), 0);
+	mpls_batch(NGM_MPLS_DELETE_LOCAL, &entry);
 }
 
 
@@ -266,7 +587,7 @@ void mpls_add_remote(int32_t label, struct in_addr *prefix, int length, const ch
 	strcpy(entry.if_name, ifname);
 	entry.nexthop.s_addr = nexthop->s_addr;
 
-	mpls_request(NGM_MPLS_ADD, &entry, sizeof(entry), 0);
+	mpls_batch(NGM_MPLS_ADD, &entry);
 }
 
 
@@ -288,7 +609,7 @@ void mpls_remove_remote(int32_t label, struct in_addr *prefix, int length, const
 	strcpy(entry.if_name, ifname);
 	entry.nexthop.s_addr = nexthop->s_addr;
 
-	mpls_request(NGM_MPLS_DELETE_REMOTE, &entry, sizeof(entry), 0);
+	mpls_batch(NGM_MPLS_DELETE_REMOTE, &entry);
 }
 
 
@@ -311,7 +632,7 @@ void mpls_add_xc(int32_t local, int32_t remote)
 	entry.local = local;
 	entry.remote = remote;
 
-	mpls_request(NGM_MPLS_ADD_XC, &entry, sizeof(entry), 0);
+	mpls_batch(NGM_MPLS_ADD_XC, &entry);
 }
 
 
@@ -325,7 +646,7 @@ void mpls_delete_xc(int local, int remote)
 	entry.local = local;
 	entry.remote = remote;
 
-	mpls_request(NGM_MPLS_DELETE_XC, &entry, sizeof(entry), 0);
+	mpls_batch(NGM_MPLS_DELETE_XC, &entry);
 }
 
 
@@ -345,36 +666,40 @@ void mpls_add_vpn(int type, const char *ifname, struct in_addr *destination, int
 	strcpy(entry.if_name, ifname);
 	entry.nexthop.s_addr = destination->s_addr;
 
-	mpls_request(NGM_MPLS_ADD, &entry, sizeof(entry), 0);
+	mpls_batch(NGM_MPLS_ADD, &entry);
 }
 
 
 /*
 ==============
 MPLS_ShowLIB
+
+The LIB is read from the node once, the reply stays with the cursor
+until all of it has been sent.
 ==============
 */
-void MPLS_ShowLIB(int fd)
+int MPLS_ShowLIB(client_t *client, controlCursor_t *cursor)
 {
-	uint32_t i, size;
+	uint32_t size;
 	struct ng_mesg *reply;
 	struct ng_mpls_lib *lib;
 	struct ng_mpls_lib_entry *info;
 	msgLIBEntry_t entry;
 
-	reply = mpls_request(NGM_MPLS_SHOW, NULL, 0, 1);
-	if(!reply) {
-		size = 0;
-		write(fd, &size, sizeof(size));
-		return;
+	if(!cursor->started) {
+		cursor->started = 1;
+		mpls_flush();
+		reply = mpls_request(NGM_MPLS_SHOW, NULL, 0, 1);
+		size = reply ? ((struct ng_mpls_lib *)reply->data)->size : 0;
+		Control_Write(client, &size, sizeof(size));
+		cursor->data = reply;
+		cursor->left = size;
 	}
 
-	lib = (struct ng_mpls_lib *)reply->data;
-	size = lib->size;
-	write(fd, &size, sizeof(size));
-
-	info = &lib->entries[0];
-	for(i = 0; i < size; i++) {
+	reply = cursor->data;
+	while(cursor->left && Control_Room(client)) {
+		lib = (struct ng_mpls_lib *)reply->data;
+		info = &lib->entries[cursor->index];
 		entry.type = info->type;
 		entry.local = info->local;
 		entry.outgoing = info->remote;
@@ -382,22 +707,46 @@ void MPLS_ShowLIB(int fd)
 		entry.length = info->prefix.length;
 		strlcpy(entry.iface, info->if_name, sizeof(entry.iface));
 		entry.nexthop = info->nexthop.s_addr;
-		info++;
-		write(fd, &entry, sizeof(entry));
+		Control_Write(client, &entry, sizeof(entry));
+		cursor->index++;
+		cursor->left--;
 	}
 
-	free(reply);
+	return cursor->left != 0;
+}
+
+
+/* MPLS_GetStats */
+void MPLS_GetStats(uint32_t *flushes, uint32_t *queued, uint32_t *cancelled)
+{
+	*flushes = batchFlushes;
+	*queued = batchQueued;
+	*cancelled = batchCancelled;
 }
 
 
 /* mpls_init */
 void mpls_init()
 {
+	mpls_connect();
 }
 
 
 /* mpls_shutdown */
 void mpls_shutdown()
 {
+#ifdef NETGRAPH_MOCK
+	ngMockStats_t stats;
+#endif
+
+	mpls_flush();
 	mpls_disable();
+	mpls_disconnect();
+
+#ifdef NETGRAPH_MOCK
+	/* what a mock run sent to the node it stood in for */
+	NgMockStats(&stats);
+	printf("Info: netgraph mock: %u nodes, %u messages, %u replies, %u bytes\n",
+		stats.nodes, stats.messages, stats.replies, stats.bytes);
+#endif
 }
@@ -0,0 +1,166 @@
+#ifdef NETGRAPH_MOCK
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ngmock.h"
+#include "../ng_mpls/public.h"
+
+
+#define NGMOCK_MAX_REPLY	4096
+#define NGMOCK_MAX_NODES	8
+
+/* control socket handed to ldpd and the end the mock node answers on */
+static struct {
+	int		cs;
+	int		peer;
+	uint32_t	token;
+} nodes[NGMOCK_MAX_NODES];
+
+static ngMockStats_t stats;
+
+
+static int NgMock_FindNode(int cs)
+{
+	int i;
+
+	for(i = 0; i < NGMOCK_MAX_NODES; i++)
+		if(nodes[i].peer > 0 && nodes[i].cs == cs)
+			return i;
+
+	return -1;
+}
+
+
+static void NgMock_Reply(int node, int cookie, int cmd, uint32_t token)
+{
+	char buf[sizeof(struct ng_mesg) + sizeof(struct ng_mpls_lib)];
+	struct ng_mesg *reply;
+	int32_t label;
+	uint32_t size;
+
+	memset(buf, 0, sizeof(buf));
+	reply = (struct ng_mesg *)buf;
+	reply->header.cmd = cmd;
+	reply->header.token = token;
+	reply->header.typecookie = cookie;
+
+	switch(cmd) {
+	case NGM_MPLS_GET:
+		label = -1;
+		memcpy(reply->data, &label, sizeof(label));
+		reply->header.arglen = sizeof(label);
+		break;
+	case NGM_MPLS_SHOW:
+		size = 0;
+		memcpy(reply->data, &size, sizeof(size));
+		reply->header.arglen = sizeof(struct ng_mpls_lib);
+		break;
+	default:
+		return;
+	}
+
+	if(send(nodes[node].peer, buf, sizeof(struct ng_mesg) + reply->header.arglen, 0) != -1)
+		stats.replies++;
+}
+
+
+int NgMkSockNode(const char *name, int *csp, int *dsp)
+{
+	int i, sv[2];
+
+	if(socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) == -1)
+		return -1;
+
+	/* a reused descriptor means ldpd has closed that node */
+	for(i = 0; i < NGMOCK_MAX_NODES; i++)
+		if(nodes[i].peer > 0 && (nodes[i].cs == sv[0] || nodes[i].cs == sv[1])) {
+			close(nodes[i].peer);
+			nodes[i].peer = 0;
+		}
+
+	for(i = 0; i < NGMOCK_MAX_NODES && nodes[i].peer > 0; i++);
+	if(i == NGMOCK_MAX_NODES) {
+		close(sv[0]);
+		close(sv[1]);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	nodes[i].cs = sv[0];
+	nodes[i].peer = sv[1];
+	nodes[i].token = 1;
+	stats.nodes++;
+
+	*csp = sv[0];
+	if(dsp)
+		*dsp = -1;
+
+	return 0;
+}
+
+
+int NgSendMsg(int cs, const char *path, int cookie, int cmd, const void *args, size_t arglen)
+{
+	int node;
+	uint32_t token;
+
+	node = NgMock_FindNode(cs);
+	if(node < 0) {
+		errno = ENOTCONN;
+		return -1;
+	}
+
+	token = nodes[node].token++;
+	stats.messages++;
+	stats.bytes += arglen;
+
+	if(cookie == NGM_MPLS_COOKIE)
+		NgMock_Reply(node, cookie, cmd, token);
+
+	return token;
+}
+
+
+int NgAllocRecvMsg(int cs, struct ng_mesg **reply, char *path)
+{
+	int node;
+	ssize_t len;
+
+	node = NgMock_FindNode(cs);
+	if(node < 0) {
+		errno = ENOTCONN;
+		return -1;
+	}
+
+	*reply = malloc(NGMOCK_MAX_REPLY);
+	if(!*reply) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	len = recv(cs, *reply, NGMOCK_MAX_REPLY, 0);
+	if(len == -1) {
+		free(*reply);
+		*reply = NULL;
+		return -1;
+	}
+
+	if(path)
+		path[0] = '\0';
+
+	return len;
+}
+
+
+void NgMockStats(ngMockStats_t *out)
+{
+	memcpy(out, &stats, sizeof(stats));
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef _NGMOCK_H_
+#define _NGMOCK_H_
+
+/*
+ * In-process stand-in for libnetgraph and the ng_mpls node, used when
+ * ldpd is built with -DNETGRAPH_MOCK.  Every message is accepted and
+ * counted; GET and SHOW requests are answered with empty replies so the
+ * control channel can be exercised without a FreeBSD kernel.
+ */
+
+#include <stdint.h>
+
+#define NG_NODESIZ	32
+#define NG_HOOKSIZ	32
+#define NG_PATHSIZ	512
+#define NG_TYPESIZ	32
+#define NG_CMDSTRSIZ	32
+
+#define NGM_GENERIC_COOKIE	977674408
+
+enum {
+	NGM_SHUTDOWN = 1,
+	NGM_MKPEER,
+	NGM_CONNECT,
+	NGM_NAME,
+	NGM_RMHOOK,
+	NGM_NODEINFO
+};
+
+struct ng_mesg {
+	struct ng_msghdr {
+		u_char		version;
+		u_char		spare;
+		uint16_t	spare2;
+		uint32_t	arglen;
+		uint32_t	cmd;
+		uint32_t	flags;
+		uint32_t	token;
+		uint32_t	typecookie;
+		u_char		cmdstr[NG_CMDSTRSIZ];
+	} header;
+	char	data[];
+};
+
+struct ngm_mkpeer {
+	char	type[NG_TYPESIZ];
+	char	ourhook[NG_HOOKSIZ];
+	char	peerhook[NG_HOOKSIZ];
+};
+
+struct ngm_name {
+	char	name[NG_NODESIZ];
+};
+
+struct ngm_connect {
+	char	path[NG_PATHSIZ];
+	char	ourhook[NG_HOOKSIZ];
+	char	peerhook[NG_HOOKSIZ];
+};
+
+typedef struct ngMockStats_s {
+	uint32_t	nodes;		/* socket nodes created */
+	uint32_t	messages;	/* messages accepted */
+	uint32_t	replies;	/* replies queued */
+	uint32_t	bytes;		/* request payload bytes */
+} ngMockStats_t;
+
+int NgMkSockNode(const char *name, int *csp, int *dsp);
+int NgSendMsg(int cs, const char *path, int cookie, int cmd, const void *args, size_t arglen);
+int NgAllocRecvMsg(int cs, struct ng_mesg **reply, char *path);
+void NgMockStats(ngMockStats_t *stats);
+
+#endif
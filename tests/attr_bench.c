@@ -0,0 +1,75 @@
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ldp_struct.h"
+
+
+#define BENCH_ATTRS		500000
+
+/*
+ * An ldp_attr before the rarely used TLVs moved out of line: the full FEC
+ * TLV instead of the single element one, and the path vector, LSP id,
+ * traffic, status and returned message TLVs inline instead of ext, give or
+ * take padding.
+ */
+#define ATTR_BEFORE		(sizeof(ldp_attr) - sizeof(ldp_attr_fec_tlv) - sizeof(ldp_attr_ext *) + \
+	sizeof(mplsLdpFecTlv_t) + sizeof(mplsLdpPathTlv_t) + sizeof(mplsLdpLspIdTlv_t) + \
+	sizeof(mplsLdpTrafficTlv_t) + sizeof(mplsLdpStatusTlv_t) + sizeof(mplsLdpRetMsgTlv_t))
+
+
+static long benchResident()
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+
+	return ru.ru_maxrss;	/* kB */
+}
+
+
+/* allocates and touches BENCH_ATTRS attrs in a child, every ext'th with an ext */
+static void bench(const char *name, size_t size, int ext)
+{
+	char **attrs;
+	long base;
+	int i, status;
+
+	if(fork()) {
+		wait(&status);
+		return;
+	}
+
+	attrs = malloc(BENCH_ATTRS * sizeof(*attrs));
+	base = benchResident();
+	for(i = 0; i < BENCH_ATTRS; i++) {
+		attrs[i] = malloc(size);
+		if(!attrs[i]) {
+			printf("%s: out of memory after %d attrs\n", name, i);
+			exit(1);
+		}
+		memset(attrs[i], 0, size);
+		if(ext && !(i % ext)) {
+			((ldp_attr *)attrs[i])->ext = malloc(sizeof(ldp_attr_ext));
+			memset(((ldp_attr *)attrs[i])->ext, 0, sizeof(ldp_attr_ext));
+		}
+	}
+
+	printf("%-12s %5zu bytes/attr %8ld kB resident for %d attrs\n", name, size,
+		benchResident() - base, BENCH_ATTRS);
+	exit(0);
+}
+
+
+int main(int argc, char **argv)
+{
+	bench("before", ATTR_BEFORE, 0);
+	bench("after", sizeof(ldp_attr), 0);
+	bench("after, 1%ext", sizeof(ldp_attr), 100);
+
+	return 0;
+}
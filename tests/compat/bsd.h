@@ -0,0 +1,38 @@
+/*
+ * Forced into every test build on Linux: the headers FreeBSD pulls in on
+ * the way, and the BSD string functions glibc gained late.
+ */
+#ifndef _COMPAT_BSD_H_
+#define _COMPAT_BSD_H_
+
+#ifdef __linux__
+#include <stdlib.h>
+#include <string.h>
+
+#if !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+	size_t len = strlen(src);
+
+	if(size) {
+		size = len < size ? len : size - 1;
+		memcpy(dst, src, size);
+		dst[size] = '\0';
+	}
+
+	return len;
+}
+
+static inline size_t strlcat(char *dst, const char *src, size_t size)
+{
+	size_t len = strnlen(dst, size);
+
+	if(len == size)
+		return len + strlen(src);
+
+	return len + strlcpy(dst + len, src, size - len);
+}
+#endif
+#endif
+
+#endif
@@ -0,0 +1,11 @@
+/* lets the headers that want <machine/endian.h> build the tests on Linux */
+#ifndef _COMPAT_MACHINE_ENDIAN_H_
+#define _COMPAT_MACHINE_ENDIAN_H_
+
+#ifdef __linux__
+#include <endian.h>
+#else
+#include_next <machine/endian.h>
+#endif
+
+#endif
@@ -0,0 +1,24 @@
+/* FreeBSD <net/if_dl.h> for the tests on Linux */
+#ifndef _COMPAT_NET_IF_DL_H_
+#define _COMPAT_NET_IF_DL_H_
+
+#ifdef __linux__
+#include <sys/types.h>
+
+#define AF_LINK	18
+
+struct sockaddr_dl {
+	u_char	sdl_len;
+	u_char	sdl_family;
+	u_short	sdl_index;
+	u_char	sdl_type;
+	u_char	sdl_nlen;
+	u_char	sdl_alen;
+	u_char	sdl_slen;
+	char	sdl_data[46];
+};
+#else
+#include_next <net/if_dl.h>
+#endif
+
+#endif
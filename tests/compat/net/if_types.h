@@ -0,0 +1,12 @@
+/* FreeBSD <net/if_types.h> for the tests on Linux */
+#ifndef _COMPAT_NET_IF_TYPES_H_
+#define _COMPAT_NET_IF_TYPES_H_
+
+#ifdef __linux__
+#define IFT_ETHER	0x6
+#define IFT_CARP	0xf8
+#else
+#include_next <net/if_types.h>
+#endif
+
+#endif
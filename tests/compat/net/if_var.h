@@ -0,0 +1,11 @@
+/* FreeBSD <net/if_var.h> for the tests on Linux, ldpd only needs its queue macros */
+#ifndef _COMPAT_NET_IF_VAR_H_
+#define _COMPAT_NET_IF_VAR_H_
+
+#ifdef __linux__
+#include <sys/queue.h>
+#else
+#include_next <net/if_var.h>
+#endif
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * FreeBSD routing socket messages for the tests on Linux. The tests feed
+ * kernel.c parsed updates, never raw messages, so only the layout the code
+ * compiles against matters. Linux sockaddrs carry no length, sa_len and
+ * sin_len alias a byte of the address data.
+ */
+#ifndef _COMPAT_NET_ROUTE_H_
+#define _COMPAT_NET_ROUTE_H_
+
+#ifdef __linux__
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <net/if.h>
+
+#define sa_len		sa_data[0]
+#define sin_len		sin_zero[0]
+
+#define SO_USELOOPBACK	0x0040
+
+#define RTM_ADD			0x1
+#define RTM_DELETE		0x2
+#define RTM_CHANGE		0x3
+#define RTM_GET			0x4
+#define RTM_NEWADDR		0xc
+#define RTM_DELADDR		0xd
+#define RTM_IFINFO		0xe
+#define RTM_NEWMADDR	0xf
+#define RTM_DELMADDR	0x10
+#define RTM_IFANNOUNCE	0x11
+
+#define RTF_HOST		0x4
+#define RTF_LLINFO		0x400
+
+#define RTAX_DST		0
+#define RTAX_GATEWAY	1
+#define RTAX_NETMASK	2
+#define RTAX_GENMASK	3
+#define RTAX_IFP		4
+#define RTAX_IFA		5
+#define RTAX_AUTHOR		6
+#define RTAX_BRD		7
+#define RTAX_MAX		8
+
+#define IFAN_ARRIVAL	0
+#define IFAN_DEPARTURE	1
+
+#define LINK_STATE_UNKNOWN	0
+#define LINK_STATE_DOWN		1
+#define LINK_STATE_UP		2
+
+struct rt_msghdr {
+	u_short	rtm_msglen;
+	u_char	rtm_version;
+	u_char	rtm_type;
+	u_short	rtm_index;
+	int		rtm_flags;
+	int		rtm_addrs;
+	pid_t	rtm_pid;
+	int		rtm_seq;
+	int		rtm_errno;
+};
+
+struct if_data {
+	u_char	ifi_type;
+	u_char	ifi_link_state;
+	u_int	ifi_mtu;
+};
+
+struct if_msghdr {
+	u_short	ifm_msglen;
+	u_char	ifm_version;
+	u_char	ifm_type;
+	int		ifm_addrs;
+	int		ifm_flags;
+	u_short	ifm_index;
+	struct if_data	ifm_data;
+};
+
+struct ifa_msghdr {
+	u_short	ifam_msglen;
+	u_char	ifam_version;
+	u_char	ifam_type;
+	int		ifam_addrs;
+	int		ifam_flags;
+	u_short	ifam_index;
+};
+
+struct if_announcemsghdr {
+	u_short	ifan_msglen;
+	u_char	ifan_version;
+	u_char	ifan_type;
+	u_short	ifan_index;
+	char	ifan_name[IFNAMSIZ];
+	u_short	ifan_what;
+};
+#else
+#include_next <net/route.h>
+#endif
+
+#endif
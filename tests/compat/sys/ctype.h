@@ -0,0 +1,9 @@
+/* FreeBSD <sys/ctype.h> for the tests on Linux, mpls.c includes it but uses none of it */
+#ifndef _COMPAT_SYS_CTYPE_H_
+#define _COMPAT_SYS_CTYPE_H_
+
+#ifndef __linux__
+#include_next <sys/ctype.h>
+#endif
+
+#endif
@@ -0,0 +1,17 @@
+/* FreeBSD <sys/sysctl.h> for the tests on Linux, they never read the kernel tables */
+#ifndef _COMPAT_SYS_SYSCTL_H_
+#define _COMPAT_SYS_SYSCTL_H_
+
+#ifdef __linux__
+#include <stddef.h>
+
+#define CTL_NET			4
+#define NET_RT_DUMP		1
+#define NET_RT_IFLIST	3
+
+int sysctl(const int *name, unsigned int namelen, void *oldp, size_t *oldlenp, const void *newp, size_t newlen);
+#else
+#include_next <sys/sysctl.h>
+#endif
+
+#endif
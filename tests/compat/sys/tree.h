@@ -0,0 +1,15 @@
+/*
+ * FreeBSD <sys/tree.h> for the tests on Linux. Nothing in ldpd uses it
+ * any more, tree_bench builds the old RB tree against the copy libuv
+ * ships when there is one.
+ */
+#ifndef _COMPAT_SYS_TREE_H_
+#define _COMPAT_SYS_TREE_H_
+
+#if defined(__linux__) && defined(TEST_RB_TREE)
+#include <node/uv/tree.h>
+#elif !defined(__linux__)
+#include_next <sys/tree.h>
+#endif
+
+#endif
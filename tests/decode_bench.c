@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+/*
+ * ldp_buf.c and the codec are built in, the bench decodes a PDU of label
+ * mappings the way ldp_decode_one_mesg used to, every TLV into the union
+ * up front, and the way it does now, TLV headers only and each TLV when
+ * ldp_mesg_tlv asks for it.
+ */
+#include "../ldp/ldp_buf.c"
+
+
+#define BENCH_MESGS		64			/* label mappings in the PDU */
+#define BENCH_ROUNDS	20000
+#define BENCH_HOPS		4			/* LSRs in each path vector */
+
+uint32_t ldp_traceflags;
+uint8_t trace_buffer[16834];
+int trace_buffer_len;
+
+static ldp_global g;
+static ldp_mesg msg;
+static uint8_t pdu[MPLS_PDUMAXLEN];
+static int pduSize;
+
+
+void *mpls_malloc(const mpls_size_type size)
+{
+	return malloc(size);
+}
+
+void mpls_free(void *mem)
+{
+	free(mem);
+}
+
+
+static uint8_t *put8(uint8_t *p, int v)
+{
+	*p = v;
+	return p + 1;
+}
+
+static uint8_t *put16(uint8_t *p, int v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+	return p + 2;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v)
+{
+	p = put16(p, v >> 16);
+	return put16(p, v);
+}
+
+
+/*
+ * A mapping of 10.i.i.0/24 to label 16 + i, with a hop count and a path
+ * vector of hops LSRs when loop detection is on (hops > 0).
+ */
+static uint8_t *putMapping(uint8_t *p, int i, int hops)
+{
+	uint8_t *start = p;
+	int hop;
+
+	p = put16(p, MPLS_LBLMAP_MSGTYPE);
+	p += 2;										/* length, below */
+	p = put32(p, 1000 + i);
+
+	p = put16(p, MPLS_FEC_TLVTYPE);
+	p = put16(p, 7);
+	p = put8(p, MPLS_PREFIX_FEC);
+	p = put16(p, 1);							/* IPv4 */
+	p = put8(p, 24);
+	p = put8(p, 10);
+	p = put8(p, i);
+	p = put8(p, i);
+
+	p = put16(p, MPLS_GENLBL_TLVTYPE);
+	p = put16(p, 4);
+	p = put32(p, 16 + i);
+
+	if(hops) {
+		p = put16(p, MPLS_HOPCOUNT_TLVTYPE);
+		p = put16(p, 1);
+		p = put8(p, hops);
+
+		p = put16(p, MPLS_PATH_TLVTYPE);
+		p = put16(p, 4 * hops);
+		for(hop = 0; hop < hops; hop++)
+			p = put32(p, 0xc0a80001 + hop);
+	}
+
+	put16(start + 2, p - start - 4);
+	return p;
+}
+
+
+static void buildPdu(int hops)
+{
+	uint8_t *p = pdu + MPLS_LDP_HDRSIZE;
+	int i;
+
+	for(i = 0; i < BENCH_MESGS; i++)
+		p = putMapping(p, i, hops);
+	pduSize = p - pdu;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.header.pduLength = pduSize - 4;
+}
+
+
+/* the old decode of one label mapping, the whole of it into the union */
+static int decodeEager(uint8_t *buf, int size)
+{
+	memset(&msg.u.map, 0, sizeof(msg.u.map));
+	return Mpls_decodeLdpLblMapMsg(&msg.u.map, buf, size);
+}
+
+
+/* every mapping decodes the same either way */
+static void testSame()
+{
+	static mplsLdpLblMapMsg_t eager[BENCH_MESGS];
+	mplsLdpFecTlv_t *fec;
+	mplsLdpGenLblTlv_t *label;
+	mplsLdpHopTlv_t *hop;
+	mplsLdpPathTlv_t *path;
+	ldp_buf b;
+	int i, size, off = MPLS_LDP_HDRSIZE;
+
+	for(i = 0; i < BENCH_MESGS; i++) {
+		size = decodeEager(pdu + off, pduSize - off);
+		CHECK(size > 0);
+		eager[i] = msg.u.map;
+		off += size;
+	}
+	CHECK(off == pduSize);
+
+	memset(&b, 0, sizeof(b));
+	b.buffer = pdu;
+	b.total = b.size = pduSize;
+	b.current = pdu + MPLS_LDP_HDRSIZE;
+	b.current_size = pduSize - MPLS_LDP_HDRSIZE;
+	for(i = 0; i < BENCH_MESGS; i++) {
+		CHECK(ldp_decode_one_mesg(&g, &b, &msg) == MPLS_SUCCESS);
+		CHECK(msg.u.map.baseMsg.msgId == eager[i].baseMsg.msgId);
+		CHECK(msg.tlv_count == 4);
+
+		fec = ldp_mesg_tlv(&msg, MPLS_FEC_TLVTYPE);
+		label = ldp_mesg_tlv(&msg, MPLS_GENLBL_TLVTYPE);
+		hop = ldp_mesg_tlv(&msg, MPLS_HOPCOUNT_TLVTYPE);
+		path = ldp_mesg_tlv(&msg, MPLS_PATH_TLVTYPE);
+		CHECK(fec && label && hop && path);
+		CHECK(ldp_mesg_tlv(&msg, MPLS_LSPID_TLVTYPE) == NULL);
+		CHECK(msg.tlv_error == MPLS_BOOL_FALSE);
+		if(!fec || !label || !hop || !path)
+			continue;
+
+		CHECK(fec->numberFecElements == 1);
+		CHECK(fec->fecElArray[0].addressEl.address ==
+			eager[i].fecTlv.fecElArray[0].addressEl.address);
+		CHECK(fec->fecElArray[0].addressEl.preLen == 24);
+		CHECK(label->label == 16 + i && label->label == eager[i].genLblTlv.label);
+		CHECK(hop->hcValue == BENCH_HOPS);
+		CHECK(!memcmp(path->lsrId, eager[i].pathVecTlv.lsrId, sizeof(path->lsrId)));
+		CHECK(msg.u.map.fecTlvExists && msg.u.map.genLblTlvExists);
+		CHECK(!msg.u.map.lspidTlvExists && !msg.u.map.trafficTlvExists);
+	}
+	CHECK(b.current_size == 0);
+}
+
+
+/* a TLV that runs past its message fails the message, a bad FEC fails on access */
+static void testBroken()
+{
+	static uint8_t bad[256];
+	uint8_t *p;
+	ldp_buf b;
+
+	p = putMapping(bad + MPLS_LDP_HDRSIZE, 1, BENCH_HOPS);
+	memset(&b, 0, sizeof(b));
+	b.buffer = bad;
+	b.total = b.size = p - bad;
+	msg.header.pduLength = b.size - 4;
+
+	put16(bad + MPLS_LDP_HDRSIZE + 10, 200);				/* FEC TLV length */
+	b.current = bad + MPLS_LDP_HDRSIZE;
+	b.current_size = b.size - MPLS_LDP_HDRSIZE;
+	CHECK(ldp_decode_one_mesg(&g, &b, &msg) == MPLS_FAILURE);
+
+	put16(bad + MPLS_LDP_HDRSIZE + 10, 7);
+	put8(bad + MPLS_LDP_HDRSIZE + 12, 9);					/* FEC element type */
+	b.current = bad + MPLS_LDP_HDRSIZE;
+	b.current_size = b.size - MPLS_LDP_HDRSIZE;
+	CHECK(ldp_decode_one_mesg(&g, &b, &msg) == MPLS_SUCCESS);
+	CHECK(ldp_mesg_tlv(&msg, MPLS_GENLBL_TLVTYPE) != NULL);
+	CHECK(msg.tlv_error == MPLS_BOOL_FALSE);
+	CHECK(ldp_mesg_tlv(&msg, MPLS_FEC_TLVTYPE) == NULL);
+	CHECK(msg.tlv_error == MPLS_BOOL_TRUE);
+
+	msg.header.pduLength = pduSize - 4;
+}
+
+
+/* decodes the PDU BENCH_ROUNDS times, asking for the FEC and label or every TLV */
+static double benchLazy(int every)
+{
+	volatile uint32_t sink = 0;
+	mplsLdpFecTlv_t *fec;
+	mplsLdpGenLblTlv_t *label;
+	ldp_buf b;
+	double begin;
+	int r, i;
+
+	memset(&b, 0, sizeof(b));
+	b.buffer = pdu;
+	b.total = b.size = pduSize;
+
+	begin = benchClock();
+	for(r = 0; r < BENCH_ROUNDS; r++) {
+		b.current = pdu + MPLS_LDP_HDRSIZE;
+		b.current_size = pduSize - MPLS_LDP_HDRSIZE;
+		for(i = 0; i < BENCH_MESGS; i++) {
+			ldp_decode_one_mesg(&g, &b, &msg);
+			if(every)
+				ldp_mesg_tlv_all(&msg);
+			fec = ldp_mesg_tlv(&msg, MPLS_FEC_TLVTYPE);
+			label = ldp_mesg_tlv(&msg, MPLS_GENLBL_TLVTYPE);
+			sink += fec->fecElArray[0].addressEl.address + label->label;
+		}
+	}
+
+	return (benchClock() - begin) * 1e9 / BENCH_ROUNDS / BENCH_MESGS;
+}
+
+
+static void bench(const char *name, int hops)
+{
+	volatile uint32_t sink = 0;
+	double begin, before;
+	int r, i, off;
+
+	buildPdu(hops);
+
+	begin = benchClock();
+	for(r = 0; r < BENCH_ROUNDS; r++) {
+		off = MPLS_LDP_HDRSIZE;
+		for(i = 0; i < BENCH_MESGS; i++) {
+			off += decodeEager(pdu + off, pduSize - off);
+			sink += msg.u.map.fecTlv.fecElArray[0].addressEl.address +
+				msg.u.map.genLblTlv.label;
+		}
+	}
+	before = (benchClock() - begin) * 1e9 / BENCH_ROUNDS / BENCH_MESGS;
+
+	/* map2attr asks for every TLV the mapping has */
+	printf("%-16s before %6.1f  after %6.1f  FEC and label only %6.1f ns/mapping\n",
+		name, before, benchLazy(1), benchLazy(0));
+}
+
+
+int main(int argc, char **argv)
+{
+	buildPdu(BENCH_HOPS);
+	testSame();
+	testBroken();
+
+	if(argc > 1 && !strcmp(argv[1], "-b")) {
+		bench("FEC, label", 0);
+		bench("loop detection", BENCH_HOPS);
+	}
+
+	return testResult();
+}
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+/*
+ * ldp_attr.c and ldp_global.c are built in for their fs and session slot
+ * code, the rest of them is dropped by the linker (see the Makefile).  The
+ * bench finds and adds the fs of every session on every FEC, once with the
+ * sessions left without a slot, which is the list walk the lookup used to
+ * be, and once with the slots handed out by _ldp_global_add_session_slot.
+ */
+#include "../ldp/ldp_attr.c"
+#include "../ldp/ldp_global.c"
+
+
+#define BENCH_SESSIONS	200
+#define BENCH_FECS		50000
+#define TEST_FECS		16
+
+static ldp_global g;
+static ldp_session sessions[BENCH_SESSIONS + 1];
+static ldp_fec *fecs;
+
+
+void *mpls_malloc(const mpls_size_type size)
+{
+	return malloc(size);
+}
+
+void mpls_free(void *mem)
+{
+	free(mem);
+}
+
+/* the sessions are static and hold a reference of their own */
+void ldp_session_delete(ldp_session *s)
+{
+}
+
+
+static void setup(int nfecs, int slots)
+{
+	ldp_session *s;
+	int i;
+
+	memset(&g, 0, sizeof(g));
+	for(i = 0; i <= BENCH_SESSIONS; i++) {
+		s = &sessions[i];
+		memset(s, 0, sizeof(*s));
+		MPLS_REFCNT_INIT(s, 1);
+		s->index = i + 1;
+		s->slot = -1;
+		if(slots && i < BENCH_SESSIONS)
+			_ldp_global_add_session_slot(&g, s);
+	}
+
+	fecs = calloc(nfecs, sizeof(ldp_fec));
+	for(i = 0; i < nfecs; i++) {
+		MPLS_LIST_INIT(&fecs[i].fs_root_us, ldp_fs);
+		MPLS_LIST_INIT(&fecs[i].fs_root_ds, ldp_fs);
+	}
+}
+
+
+static void teardown(int nfecs)
+{
+	ldp_fec *f;
+	int i;
+
+	for(i = 0; i < nfecs; i++) {
+		f = &fecs[i];
+		while(!MPLS_LIST_EMPTY(&f->fs_root_us))
+			_ldp_fec_del_fs_us(f, MPLS_LIST_HEAD(&f->fs_root_us));
+	}
+	free(fecs);
+	free(g.session_slot);
+}
+
+
+/* the fs of every session on every FEC, each of them found by its session */
+static void checkAll(int nfecs, int nsessions)
+{
+	ldp_session *s;
+	ldp_fs *fs;
+	int i, j;
+
+	for(i = 0; i < nfecs; i++)
+		for(j = 0; j < nsessions; j++) {
+			s = &sessions[j];
+			fs = _ldp_fec_find_fs_us(&fecs[i], s, MPLS_BOOL_FALSE);
+			CHECK(fs && fs->session == s);
+		}
+}
+
+
+static void testSlots()
+{
+	ldp_session *s;
+	ldp_fs *fs;
+	int i, j;
+
+	setup(TEST_FECS, 1);
+	for(i = 0; i < BENCH_SESSIONS; i++)
+		CHECK(sessions[i].slot == i);
+	CHECK(g.session_slot_size >= BENCH_SESSIONS);
+
+	for(i = 0; i < TEST_FECS; i++)
+		for(j = 0; j < BENCH_SESSIONS; j++)
+			CHECK(_ldp_fec_find_fs_us(&fecs[i], &sessions[j], MPLS_BOOL_TRUE));
+	checkAll(TEST_FECS, BENCH_SESSIONS);
+	for(i = 0; i < TEST_FECS; i++) {
+		CHECK(fecs[i].fs_slot_us.incomplete == MPLS_BOOL_FALSE);
+		CHECK(_ldp_fec_find_fs_us(&fecs[i], &sessions[BENCH_SESSIONS],
+			MPLS_BOOL_FALSE) == NULL);
+	}
+
+	/* session 7 goes away with its fs still on FEC 0, the spare one gets its slot */
+	s = &sessions[BENCH_SESSIONS];
+	g.session_slot[sessions[7].slot] = NULL;
+	sessions[7].slot = -1;
+	_ldp_global_add_session_slot(&g, s);
+	CHECK(s->slot == 7);
+
+	fs = _ldp_fec_find_fs_us(&fecs[0], s, MPLS_BOOL_TRUE);
+	CHECK(fs && fs->session == s && fs->slot == -1);
+	CHECK(fecs[0].fs_slot_us.incomplete == MPLS_BOOL_TRUE);
+	CHECK(_ldp_fec_find_fs_us(&fecs[0], s, MPLS_BOOL_FALSE) == fs);
+	fs = _ldp_fec_find_fs_us(&fecs[0], &sessions[7], MPLS_BOOL_FALSE);
+	CHECK(fs && fs->session == &sessions[7]);
+	checkAll(TEST_FECS, BENCH_SESSIONS);
+
+	/* a FEC whose list drains forgets its table */
+	fs = _ldp_fec_find_fs_us(&fecs[1], &sessions[7], MPLS_BOOL_FALSE);
+	_ldp_fec_del_fs_us(&fecs[1], fs);
+	CHECK(_ldp_fec_find_fs_us(&fecs[1], &sessions[7], MPLS_BOOL_FALSE) == NULL);
+	CHECK(_ldp_fec_find_fs_us(&fecs[1], s, MPLS_BOOL_FALSE) == NULL);
+	while(!MPLS_LIST_EMPTY(&fecs[1].fs_root_us))
+		_ldp_fec_del_fs_us(&fecs[1], MPLS_LIST_HEAD(&fecs[1].fs_root_us));
+	CHECK(fecs[1].fs_slot_us.fs == NULL && fecs[1].fs_slot_us.size == 0);
+	CHECK(fecs[1].fs_slot_us.incomplete == MPLS_BOOL_FALSE);
+
+	teardown(TEST_FECS);
+}
+
+
+/* sessions without a slot are found by walking the list */
+static void testNoSlots()
+{
+	int i, j;
+
+	setup(TEST_FECS, 0);
+	for(i = 0; i < TEST_FECS; i++)
+		for(j = 0; j < BENCH_SESSIONS; j++)
+			CHECK(_ldp_fec_find_fs_us(&fecs[i], &sessions[j], MPLS_BOOL_TRUE));
+	checkAll(TEST_FECS, BENCH_SESSIONS);
+	CHECK(fecs[0].fs_slot_us.incomplete == MPLS_BOOL_TRUE);
+	CHECK(fecs[0].fs_slot_us.fs == NULL);
+	teardown(TEST_FECS);
+}
+
+
+/* ns to add, then to find, the fs of every session on every FEC */
+static void bench(const char *name, int slots)
+{
+	volatile int found = 0;
+	double begin, add, find;
+	int i, j;
+
+	setup(BENCH_FECS, slots);
+
+	begin = benchClock();
+	for(i = 0; i < BENCH_FECS; i++)
+		for(j = 0; j < BENCH_SESSIONS; j++)
+			found += _ldp_fec_find_fs_us(&fecs[i], &sessions[j], MPLS_BOOL_TRUE) != NULL;
+	add = benchClock() - begin;
+
+	begin = benchClock();
+	for(i = 0; i < BENCH_FECS; i++)
+		for(j = 0; j < BENCH_SESSIONS; j++)
+			found += _ldp_fec_find_fs_us(&fecs[i], &sessions[j], MPLS_BOOL_FALSE) != NULL;
+	find = benchClock() - begin;
+
+	printf("%-8s add %7.1f  find %7.1f ns/fs, %d sessions x %d FECs\n", name,
+		add * 1e9 / BENCH_FECS / BENCH_SESSIONS,
+		find * 1e9 / BENCH_FECS / BENCH_SESSIONS, BENCH_SESSIONS, BENCH_FECS);
+
+	teardown(BENCH_FECS);
+}
+
+
+int main(int argc, char **argv)
+{
+	testSlots();
+	testNoSlots();
+
+	if(argc > 1 && !strcmp(argv[1], "-b")) {
+		bench("before", 0);
+		bench("after", 1);
+	}
+
+	return testResult();
+}
@@ -0,0 +1,419 @@
+#include <arpa/inet.h>
+
+#include "../ldpd.h"
+#include "test.h"
+
+#include "../kernel.c"
+
+
+/*
+ * kernel.c is tested against a fake LDP FEC table and interface list, the
+ * updates go in through QueueRouteUpdate and ParseInterfaceAnnounce as if
+ * they had been read from the routing socket.
+ */
+
+#define FAKE_FECS		16
+#define FAKE_NEXTHOPS	8
+#define FAKE_IFACES		16
+
+typedef struct fakeFec_s {
+	int				used;
+	uint32_t		index;
+	uint32_t		network;
+	int				length;
+	mpls_nexthop	nexthops[FAKE_NEXTHOPS];	/* index 0 is a free slot */
+} fakeFec_t;
+
+static fakeFec_t fecs[FAKE_FECS];
+static uint32_t fecIndex, nexthopIndex;
+static interface_t *ifaces[FAKE_IFACES];
+
+static ldp_t ldpInstance;
+ldp_t *ldp = &ldpInstance;
+
+
+void *mpls_malloc(mpls_size_type size)
+{
+	return malloc(size);
+}
+
+void mpls_free(void *mem)
+{
+	free(mem);
+}
+
+void mpls_flush()
+{
+}
+
+void ldp_cfg_flush(mpls_cfg_handle handle)
+{
+}
+
+int sysctl(const int *name, unsigned int namelen, void *oldp, size_t *oldlenp, const void *newp, size_t newlen)
+{
+	return -1;
+}
+
+
+interface_t *Interface_Create()
+{
+	int i;
+
+	for(i = 0; i < FAKE_IFACES && ifaces[i]; i++)
+		;
+	MPLS_ASSERT(i < FAKE_IFACES);
+	ifaces[i] = calloc(1, sizeof(interface_t));
+
+	return ifaces[i];
+}
+
+/* the memory is poisoned, so a queued update still pointing at it shows */
+void Interface_Destroy(interface_t *iface)
+{
+	int i;
+
+	for(i = 0; i < FAKE_IFACES; i++)
+		if(ifaces[i] == iface)
+			ifaces[i] = NULL;
+	memset(iface, 0xdb, sizeof(*iface));
+	free(iface);
+}
+
+interface_t *Interface_FindByIndex(int index)
+{
+	int i;
+
+	for(i = 0; i < FAKE_IFACES; i++)
+		if(ifaces[i] && ifaces[i]->index == index)
+			return ifaces[i];
+
+	return NULL;
+}
+
+interface_t *Interface_FindByName(const char *name)
+{
+	int i;
+
+	for(i = 0; i < FAKE_IFACES; i++)
+		if(ifaces[i] && !strcmp(ifaces[i]->name, name))
+			return ifaces[i];
+
+	return NULL;
+}
+
+void Interface_AddAddress(interface_t *iface, address_t *addr)
+{
+}
+
+void Interface_DelAddress(interface_t *iface, address_t *addr)
+{
+}
+
+
+static fakeFec_t *fakeFecFind(mpls_fec *fec, uint32_t flag)
+{
+	int i;
+
+	for(i = 0; i < FAKE_FECS; i++) {
+		if(!fecs[i].used)
+			continue;
+		if(flag & LDP_FEC_CFG_BY_INDEX) {
+			if(fecs[i].index == fec->index)
+				return &fecs[i];
+		} else if(fecs[i].network == fec->u.prefix.network.u.ipv4 && fecs[i].length == fec->u.prefix.length)
+			return &fecs[i];
+	}
+
+	return NULL;
+}
+
+static mpls_nexthop *fakeNexthopFind(fakeFec_t *f, mpls_nexthop *nh)
+{
+	int i;
+
+	for(i = 1; i < FAKE_NEXTHOPS; i++)
+		if(f->nexthops[i].index && f->nexthops[i].ip.u.ipv4 == nh->ip.u.ipv4 &&
+			f->nexthops[i].if_handle == nh->if_handle && f->nexthops[i].type == nh->type)
+			return &f->nexthops[i];
+
+	return NULL;
+}
+
+mpls_return_enum ldp_cfg_fec_get(mpls_cfg_handle handle, mpls_fec *fec, uint32_t flag)
+{
+	fakeFec_t *f;
+
+	if(!(f = fakeFecFind(fec, flag)))
+		return MPLS_FAILURE;
+	fec->index = f->index;
+	fec->is_route = MPLS_BOOL_TRUE;
+
+	return MPLS_SUCCESS;
+}
+
+mpls_return_enum ldp_cfg_fec_set(mpls_cfg_handle handle, mpls_fec *fec, uint32_t flag)
+{
+	int i;
+	fakeFec_t *f;
+
+	if(flag & LDP_CFG_DEL) {
+		if(!(f = fakeFecFind(fec, flag)))
+			return MPLS_FAILURE;
+		memset(f, 0, sizeof(*f));
+		return MPLS_SUCCESS;
+	}
+
+	for(i = 0; i < FAKE_FECS && fecs[i].used; i++)
+		;
+	MPLS_ASSERT(i < FAKE_FECS);
+	fecs[i].used = 1;
+	fecs[i].index = fec->index = ++fecIndex;
+	fecs[i].network = fec->u.prefix.network.u.ipv4;
+	fecs[i].length = fec->u.prefix.length;
+
+	return MPLS_SUCCESS;
+}
+
+mpls_return_enum ldp_cfg_fec_nexthop_get(mpls_cfg_handle handle, mpls_fec *fec, mpls_nexthop *nh, uint32_t flag)
+{
+	fakeFec_t *f;
+	mpls_nexthop *n;
+
+	if(!(f = fakeFecFind(fec, flag)) || !(n = fakeNexthopFind(f, nh)))
+		return MPLS_FAILURE;
+	*nh = *n;
+
+	return MPLS_SUCCESS;
+}
+
+mpls_return_enum ldp_cfg_fec_nexthop_getnext(mpls_cfg_handle handle, mpls_fec *fec, mpls_nexthop *nh, uint32_t flag)
+{
+	int i;
+	fakeFec_t *f;
+	mpls_nexthop *next = NULL;
+
+	if(!(f = fakeFecFind(fec, flag)))
+		return MPLS_FAILURE;
+	for(i = 1; i < FAKE_NEXTHOPS; i++)
+		if(f->nexthops[i].index > nh->index && (!next || f->nexthops[i].index < next->index))
+			next = &f->nexthops[i];
+	if(!next)
+		return MPLS_END_OF_LIST;
+	*nh = *next;
+
+	return MPLS_SUCCESS;
+}
+
+mpls_return_enum ldp_cfg_fec_nexthop_set(mpls_cfg_handle handle, mpls_fec *fec, mpls_nexthop *nh, uint32_t flag)
+{
+	int i;
+	fakeFec_t *f;
+
+	if(!(f = fakeFecFind(fec, flag)))
+		return MPLS_FAILURE;
+
+	if(flag & LDP_CFG_DEL) {
+		for(i = 1; i < FAKE_NEXTHOPS; i++)
+			if(f->nexthops[i].index == nh->index) {
+				memset(&f->nexthops[i], 0, sizeof(mpls_nexthop));
+				return MPLS_SUCCESS;
+			}
+		return MPLS_FAILURE;
+	}
+
+	for(i = 1; i < FAKE_NEXTHOPS && f->nexthops[i].index; i++)
+		;
+	MPLS_ASSERT(i < FAKE_NEXTHOPS);
+	f->nexthops[i] = *nh;
+	f->nexthops[i].index = nh->index = ++nexthopIndex;
+
+	return MPLS_SUCCESS;
+}
+
+
+static prefix_t *testPrefix(const char *network, int length)
+{
+	static prefix_t prefix;
+
+	inet_aton(network, &prefix.prefix);
+	prefix.length = length;
+
+	return &prefix;
+}
+
+static mpls_nexthop *testNexthop(const char *address)
+{
+	static mpls_nexthop nexthop;
+	struct in_addr addr;
+
+	inet_aton(address, &addr);
+	memset(&nexthop, 0, sizeof(nexthop));
+	nexthop.ip.type = MPLS_FAMILY_IPV4;
+	nexthop.ip.u.ipv4 = ntohl(addr.s_addr);
+	nexthop.type = MPLS_NH_IP;
+
+	return &nexthop;
+}
+
+static fakeFec_t *testFec(const char *network, int length)
+{
+	mpls_fec fec;
+
+	prefix2mpls_fec(testPrefix(network, length), &fec);
+
+	return fakeFecFind(&fec, 0);
+}
+
+/* the path of f through address, whatever its interface */
+static mpls_nexthop *testPath(fakeFec_t *f, const char *address)
+{
+	int i;
+	uint32_t ip = testNexthop(address)->ip.u.ipv4;
+
+	for(i = 1; f && i < FAKE_NEXTHOPS; i++)
+		if(f->nexthops[i].index && f->nexthops[i].ip.u.ipv4 == ip)
+			return &f->nexthops[i];
+
+	return NULL;
+}
+
+static int testPaths(fakeFec_t *f)
+{
+	int i, count = 0;
+
+	for(i = 1; f && i < FAKE_NEXTHOPS; i++)
+		if(f->nexthops[i].index)
+			count++;
+
+	return count;
+}
+
+static void testAnnounce(int what, int index, const char *name)
+{
+	struct if_announcemsghdr ifan;
+
+	memset(&ifan, 0, sizeof(ifan));
+	ifan.ifan_type = RTM_IFANNOUNCE;
+	ifan.ifan_what = what;
+	ifan.ifan_index = index;
+	strlcpy(ifan.ifan_name, name, sizeof(ifan.ifan_name));
+	ParseInterfaceAnnounce(&ifan);
+}
+
+static void testReset()
+{
+	ApplyRouteUpdates(-1, 0, NULL);
+	memset(fecs, 0, sizeof(fecs));
+	updatesReceived = updatesCoalesced = updatesApplied = 0;
+}
+
+
+/* a path that flaps inside the window is applied once, or not at all */
+static void testCoalesce()
+{
+	uint32_t received, coalesced, applied;
+
+	testReset();
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.1.0.0", 16), testNexthop("192.168.0.1"), 1);
+	QueueRouteUpdate(RTM_DELETE, testPrefix("10.1.0.0", 16), testNexthop("192.168.0.1"), 1);
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.1.0.0", 16), testNexthop("192.168.0.1"), 1);
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.2.0.0", 16), testNexthop("192.168.0.1"), 1);
+	QueueRouteUpdate(RTM_DELETE, testPrefix("10.2.0.0", 16), testNexthop("192.168.0.1"), 1);
+	CHECK(!testFec("10.1.0.0", 16));
+
+	ApplyRouteUpdates(-1, 0, NULL);
+	CHECK(testPaths(testFec("10.1.0.0", 16)) == 1);
+	CHECK(!testFec("10.2.0.0", 16));
+
+	Kernel_GetStats(&received, &coalesced, &applied);
+	CHECK(received == 5);
+	CHECK(applied == 1);
+	CHECK(coalesced == 4);
+}
+
+
+/* the paths of a multipath route are kept apart, by address and interface */
+static void testMultipath()
+{
+	testReset();
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.3.0.0", 16), testNexthop("192.168.0.1"), 1);
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.3.0.0", 16), testNexthop("192.168.1.1"), 2);
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.3.0.0", 16), testNexthop("192.168.1.1"), 3);
+	QueueRouteUpdate(RTM_DELETE, testPrefix("10.3.0.0", 16), testNexthop("192.168.1.1"), 3);
+	ApplyRouteUpdates(-1, 0, NULL);
+	CHECK(testPaths(testFec("10.3.0.0", 16)) == 2);
+}
+
+
+/* RTM_CHANGE overrides the paths queued before it and replaces those installed */
+static void testChange()
+{
+	fakeFec_t *f;
+
+	testReset();
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.4.0.0", 16), testNexthop("192.168.0.1"), 1);
+	ApplyRouteUpdates(-1, 0, NULL);
+
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.4.0.0", 16), testNexthop("192.168.0.2"), 1);
+	QueueRouteUpdate(RTM_CHANGE, testPrefix("10.4.0.0", 16), testNexthop("192.168.0.3"), 1);
+	ApplyRouteUpdates(-1, 0, NULL);
+
+	f = testFec("10.4.0.0", 16);
+	CHECK(testPaths(f) == 1);
+	CHECK(testPath(f, "192.168.0.3"));
+}
+
+
+/* an interface departing while its updates are queued is not dereferenced */
+static void testDeparture()
+{
+	fakeFec_t *f;
+	interface_t *iface;
+	mpls_nexthop *nexthop;
+
+	testReset();
+	testAnnounce(IFAN_ARRIVAL, 7, "em7");
+	iface = Interface_FindByIndex(7);
+	CHECK(iface);
+
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.5.0.0", 16), testNexthop("192.168.7.1"), 7);
+	testAnnounce(IFAN_DEPARTURE, 7, "em7");
+	CHECK(!Interface_FindByIndex(7));
+	ApplyRouteUpdates(-1, 0, NULL);
+
+	f = testFec("10.5.0.0", 16);
+	CHECK(testPaths(f) == 1);
+	nexthop = testPath(f, "192.168.7.1");
+	CHECK(nexthop && !nexthop->if_handle && !(nexthop->type & MPLS_NH_IF));
+
+	/* a new interface with the index gets the updates queued after it came */
+	testAnnounce(IFAN_ARRIVAL, 7, "em7");
+	iface = Interface_FindByIndex(7);
+	QueueRouteUpdate(RTM_ADD, testPrefix("10.6.0.0", 16), testNexthop("192.168.7.1"), 7);
+	ApplyRouteUpdates(-1, 0, NULL);
+
+	f = testFec("10.6.0.0", 16);
+	CHECK(testPaths(f) == 1);
+	nexthop = testPath(f, "192.168.7.1");
+	CHECK(nexthop && nexthop->if_handle == iface && (nexthop->type & MPLS_NH_IF));
+	testAnnounce(IFAN_DEPARTURE, 7, "em7");
+}
+
+
+int main(int argc, char **argv)
+{
+	event_init();
+	pendingTree = mpls_tree_create(32);
+	evtimer_set(&batchEv, ApplyRouteUpdates, NULL);
+	testAnnounce(IFAN_ARRIVAL, 1, "em1");
+	testAnnounce(IFAN_ARRIVAL, 2, "em2");
+	testAnnounce(IFAN_ARRIVAL, 3, "em3");
+
+	testCoalesce();
+	testMultipath();
+	testChange();
+	testDeparture();
+
+	return testResult();
+}
@@ -0,0 +1,133 @@
+#include "../ldpd.h"
+#include "test.h"
+
+#include "../label.c"
+
+
+/*
+ * Churn of the dynamic block: BENCH_LIVE labels are held, and each cycle
+ * releases one of them at random and allocates another, the way FECs come
+ * and go.  The counter label.c replaced only went up, it is run alongside
+ * to show when it would have left the label space.
+ */
+
+#define BENCH_LIVE		100000
+#define BENCH_CYCLES	1000000
+
+static int32_t live[BENCH_LIVE];
+
+
+void Control_Write(client_t *client, const void *data, uint32_t length)
+{
+}
+
+
+static uint32_t benchRandom()
+{
+	static uint32_t seed = 1;
+
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+
+/* released labels are not handed out again until the block has been walked */
+static void testFresh()
+{
+	int32_t a, b;
+
+	CHECK(Label_SetRange(LABEL_BLOCK_DYNAMIC, 100, 103) == 0);
+	a = Label_Alloc(LABEL_BLOCK_DYNAMIC);
+	b = Label_Alloc(LABEL_BLOCK_DYNAMIC);
+	CHECK(a == 100 && b == 101);
+	Label_Free(a);
+	CHECK(Label_Alloc(LABEL_BLOCK_DYNAMIC) == 102);
+	CHECK(Label_Alloc(LABEL_BLOCK_DYNAMIC) == 103);
+	CHECK(Label_Alloc(LABEL_BLOCK_DYNAMIC) == a);
+
+	CHECK(Label_Alloc(LABEL_BLOCK_DYNAMIC) == -1);
+	CHECK(blocks[LABEL_BLOCK_DYNAMIC].failures == 1);
+	CHECK(blocks[LABEL_BLOCK_DYNAMIC].inUse == 4);
+	CHECK(blocks[LABEL_BLOCK_DYNAMIC].peak == 4);
+
+	/* the range only moves while the block is empty */
+	CHECK(Label_SetRange(LABEL_BLOCK_DYNAMIC, 100, 200) == -1);
+	for(a = 100; a <= 103; a++)
+		Label_Free(a);
+	CHECK(blocks[LABEL_BLOCK_DYNAMIC].inUse == 0);
+	CHECK(Label_SetRange(LABEL_BLOCK_DYNAMIC, 50, 200) == -1);		/* overlaps vpn */
+	CHECK(Label_SetRange(LABEL_BLOCK_DYNAMIC, LABEL_DEF_DYN_MIN, LABEL_DEF_DYN_MAX) == 0);
+}
+
+
+/* double frees and labels of no block are ignored */
+static void testBadFree()
+{
+	int32_t a;
+	uint32_t frees;
+
+	a = Label_Alloc(LABEL_BLOCK_VPN);
+	CHECK(a == LABEL_DEF_VPN_MIN);
+	frees = blocks[LABEL_BLOCK_VPN].frees;
+	Label_Free(a);
+	Label_Free(a);
+	Label_Free(3);
+	CHECK(blocks[LABEL_BLOCK_VPN].frees == frees + 1);
+	CHECK(blocks[LABEL_BLOCK_VPN].inUse == 0);
+	CHECK(blocks[LABEL_BLOCK_VPN].freeCount == 1);
+}
+
+
+static void bench()
+{
+	labelBlock_t *block = &blocks[LABEL_BLOCK_DYNAMIC];
+	int32_t counter = LABEL_DEF_DYN_MIN, counterOut = 0;
+	double begin, elapsed;
+	uint32_t allocs, failures;
+	int i, n;
+
+	for(i = 0; i < BENCH_LIVE; i++) {
+		live[i] = Label_Alloc(LABEL_BLOCK_DYNAMIC);
+		counter++;
+	}
+	allocs = block->allocs;
+	failures = block->failures;
+
+	begin = benchClock();
+	for(i = 0; i < BENCH_CYCLES; i++) {
+		n = benchRandom() % BENCH_LIVE;
+		Label_Free(live[n]);
+		live[n] = Label_Alloc(LABEL_BLOCK_DYNAMIC);
+		if(live[n] < 0)
+			break;
+	}
+	elapsed = benchClock() - begin;
+
+	for(i = 0; i < BENCH_CYCLES && !counterOut; i++)
+		if(counter++ > LABEL_MAX)
+			counterOut = i;
+
+	CHECK(block->allocs - allocs == BENCH_CYCLES);
+	CHECK(block->inUse == BENCH_LIVE && block->failures == failures);
+
+	printf("%d cycles with %d labels held: %.1f ns/cycle, %u failures, peak %u, free stack %u\n",
+		BENCH_CYCLES, BENCH_LIVE, elapsed * 1e9 / BENCH_CYCLES, block->failures - failures,
+		block->peak, block->freeMax);
+	if(counterOut)
+		printf("the old counter leaves the label space after %d cycles\n", counterOut);
+}
+
+
+int main(int argc, char **argv)
+{
+	CHECK(Label_Init() == 0);
+	testFresh();
+	testBadFree();
+
+	if(argc > 1 && !strcmp(argv[1], "-b"))
+		bench();
+
+	Label_Shutdown();
+
+	return testResult();
+}
@@ -0,0 +1,56 @@
+/*
+ * Stand-in for the public header of the ng_mpls node, which is not part of
+ * this tree.  mpls.c and ngmock.c include it as ../ng_mpls/public.h, the
+ * tests find it here through -Icompat.  Only what ldpd uses is declared.
+ */
+#ifndef _NG_MPLS_PUBLIC_H_
+#define _NG_MPLS_PUBLIC_H_
+
+#include <sys/types.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stdint.h>
+
+#define NGM_MPLS_COOKIE		1144018140
+
+#define NG_MPLS_HOOK_LOWER	"lower_"
+#define NG_MPLS_HOOK_UPPER	"upper_"
+
+enum {
+	NGM_MPLS_ADD = 1,
+	NGM_MPLS_ADD_XC,
+	NGM_MPLS_DELETE_LOCAL,
+	NGM_MPLS_DELETE_REMOTE,
+	NGM_MPLS_DELETE_XC,
+	NGM_MPLS_GET,
+	NGM_MPLS_SHOW
+};
+
+/* LIB entry types */
+enum {
+	LIB_NORMAL,
+	LIB_IN,
+	LIB_L2VPN,
+	LIB_L3VPN
+};
+
+struct ng_mpls_prefix {
+	struct in_addr	prefix;
+	int				length;
+};
+
+struct ng_mpls_lib_entry {
+	int						type;
+	int32_t					local;
+	int32_t					remote;
+	struct ng_mpls_prefix	prefix;
+	char					if_name[IFNAMSIZ];
+	struct in_addr			nexthop;
+};
+
+struct ng_mpls_lib {
+	uint32_t					size;
+	struct ng_mpls_lib_entry	entries[];
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "../ldpd.h"
+#include "../ngmock.h"
+#include "../ng_mpls/public.h"
+#include "test.h"
+
+
+/*
+ * mpls.c built against ngmock.c, the way ldpd is with NETGRAPH_MOCK. The
+ * LIB of BENCH_FECS FECs is programmed and removed in batches of
+ * BENCH_BATCH FECs, one batch per event, and the mock's counters show what
+ * reached the node.  A second run flaps every FEC within its batch, which
+ * the batch cancels before anything is sent.
+ */
+
+#define BENCH_FECS		100000
+#define BENCH_BATCH		64
+#define TEST_FECS		10
+
+/* mpls.c, ldpd.h has them under their old MPLS_ names */
+void mpls_init();
+void mpls_shutdown();
+int32_t mpls_get_label_by_prefix(struct in_addr *prefix, int length);
+void mpls_add_local(int32_t label, struct in_addr *prefix, int length);
+void mpls_delete_local(int32_t label);
+void mpls_add_remote(int32_t label, struct in_addr *prefix, int length, const char *ifname, struct in_addr *nexthop);
+void mpls_remove_remote(int32_t label, struct in_addr *prefix, int length, const char *ifname, struct in_addr *nexthop);
+void mpls_add_xc(int32_t local, int32_t remote);
+void mpls_delete_xc(int local, int remote);
+
+
+void Control_Write(client_t *client, const void *data, uint32_t length)
+{
+}
+
+int Control_Room(client_t *client)
+{
+	return 1;
+}
+
+int32_t Label_Alloc(int type)
+{
+	return -1;
+}
+
+void Label_Free(int32_t label)
+{
+}
+
+
+static void addFec(int i)
+{
+	struct in_addr prefix, nexthop;
+
+	prefix.s_addr = htonl(0x0a000000 + (i << 8));
+	nexthop.s_addr = htonl(0xc0a80001);
+	mpls_add_local(100 + i, &prefix, 24);
+	mpls_add_remote(200 + i, &prefix, 24, "em0", &nexthop);
+	mpls_add_xc(100 + i, 200 + i);
+}
+
+
+static void deleteFec(int i)
+{
+	struct in_addr prefix, nexthop;
+
+	prefix.s_addr = htonl(0x0a000000 + (i << 8));
+	nexthop.s_addr = htonl(0xc0a80001);
+	mpls_delete_xc(100 + i, 200 + i);
+	mpls_remove_remote(200 + i, &prefix, 24, "em0", &nexthop);
+	mpls_delete_local(100 + i);
+}
+
+
+/* every update is one message of one LIB entry, a flap within a batch is none */
+static void testMessages()
+{
+	ngMockStats_t before, after;
+	struct in_addr prefix;
+	uint32_t flushes, queued, cancelled;
+	int i;
+
+	NgMockStats(&before);
+	for(i = 0; i < TEST_FECS; i++)
+		addFec(i);
+	mpls_flush();
+	NgMockStats(&after);
+	CHECK(after.nodes == 1);
+	CHECK(after.messages - before.messages == 3 * TEST_FECS);
+	CHECK(after.bytes - before.bytes == 3 * TEST_FECS * sizeof(struct ng_mpls_lib_entry));
+	CHECK(after.replies == before.replies);
+
+	for(i = TEST_FECS; i < 2 * TEST_FECS; i++) {
+		addFec(i);
+		deleteFec(i);
+	}
+	mpls_flush();
+	NgMockStats(&before);
+	CHECK(before.messages == after.messages);
+	MPLS_GetStats(&flushes, &queued, &cancelled);
+	CHECK(cancelled == 3 * TEST_FECS);
+
+	/* a GET waits for the node's answer */
+	prefix.s_addr = htonl(0x0a000000);
+	CHECK(mpls_get_label_by_prefix(&prefix, 24) == -1);
+	NgMockStats(&after);
+	CHECK(after.messages == before.messages + 1);
+	CHECK(after.replies == before.replies + 1);
+
+	for(i = 0; i < TEST_FECS; i++)
+		deleteFec(i);
+	mpls_flush();
+}
+
+
+static void bench(const char *name, int flap)
+{
+	ngMockStats_t before, after;
+	uint32_t flushes, queued, cancelled, f0, q0, c0;
+	double begin, elapsed;
+	int i;
+
+	NgMockStats(&before);
+	MPLS_GetStats(&f0, &q0, &c0);
+
+	begin = benchClock();
+	for(i = 0; i < BENCH_FECS; i++) {
+		addFec(i);
+		if(flap)
+			deleteFec(i);
+		if(i % BENCH_BATCH == BENCH_BATCH - 1)
+			mpls_flush();
+	}
+	if(!flap)
+		for(i = 0; i < BENCH_FECS; i++) {
+			deleteFec(i);
+			if(i % BENCH_BATCH == BENCH_BATCH - 1)
+				mpls_flush();
+		}
+	mpls_flush();
+	elapsed = benchClock() - begin;
+
+	NgMockStats(&after);
+	MPLS_GetStats(&flushes, &queued, &cancelled);
+	printf("%-8s %6.1f ns/update, %u flushes, %u queued, %u cancelled\n", name,
+		elapsed * 1e9 / (6 * BENCH_FECS), flushes - f0, queued - q0, cancelled - c0);
+	printf("%-8s mock: %u nodes, %u messages, %u replies, %u bytes\n", "",
+		after.nodes, after.messages - before.messages, after.replies - before.replies,
+		after.bytes - before.bytes);
+}
+
+
+int main(int argc, char **argv)
+{
+	event_init();
+	mpls_init();
+
+	testMessages();
+
+	if(argc > 1 && !strcmp(argv[1], "-b")) {
+		bench("program", 0);
+		bench("flap", 1);
+	}
+
+	mpls_shutdown();
+
+	return testResult();
+}
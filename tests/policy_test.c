@@ -0,0 +1,223 @@
+#include <arpa/inet.h>
+
+#include "../ldpd.h"
+#include "test.h"
+
+#include "../freebsd/mpls_policy_impl.c"
+
+
+/*
+ * Prefix lists are matched through Policy_Match on the compiled trie, and
+ * label filters through Policy_Check with the policy installed, the way
+ * the import, export and egress checks use them.
+ */
+
+struct in_addr routerID;
+ldp_t *ldp;
+
+
+interface_t *Interface_FindByAddress(struct in_addr addr)
+{
+	return NULL;
+}
+
+
+static int add(policySet_t *set, const char *name, int permit, const char *prefix, int length, int ge, int le)
+{
+	struct in_addr addr;
+
+	inet_pton(AF_INET, prefix, &addr);
+
+	return mpls_policy_add_prefix(set, name, permit, addr, length, ge, le);
+}
+
+
+/* entry of list name matching prefix/length, POLICY_NONE if none does */
+static int32_t match(policySet_t *set, const char *name, const char *prefix, int length)
+{
+	struct in_addr addr;
+	policyList_t *list;
+
+	inet_pton(AF_INET, prefix, &addr);
+	list = Policy_FindList(set, name);
+	if(!list)
+		return POLICY_NONE;
+
+	return Policy_Match(list, ntohl(addr.s_addr) & Policy_Mask(length), length);
+}
+
+
+static mpls_bool check(policyType_t type, const char *prefix, int length, const char *neighbor)
+{
+	struct in_addr addr;
+	mpls_fec fec;
+	mpls_inet_addr lsrid;
+
+	memset(&fec, 0, sizeof(fec));
+	inet_pton(AF_INET, prefix, &addr);
+	fec.type = MPLS_FEC_PREFIX;
+	fec.u.prefix.network.type = MPLS_FAMILY_IPV4;
+	fec.u.prefix.network.u.ipv4 = ntohl(addr.s_addr);
+	fec.u.prefix.length = length;
+
+	if(!neighbor)
+		return Policy_Check(type, &fec, NULL);
+
+	inet_pton(AF_INET, neighbor, &addr);
+	lsrid.type = MPLS_FAMILY_IPV4;
+	lsrid.u.ipv4 = ntohl(addr.s_addr);
+
+	return Policy_Check(type, &fec, &lsrid);
+}
+
+
+/* the first entry in sequence decides, whichever trie depth it hangs off */
+static void testOrder()
+{
+	policySet_t *set = mpls_policy_create();
+
+	/* a shorter prefix before a longer one */
+	CHECK(add(set, "a", 0, "10.1.0.0", 16, 0, 32) == 0);
+	CHECK(add(set, "a", 1, "10.0.0.0", 8, 0, 32) == 0);
+	CHECK(add(set, "a", 1, "10.1.2.0", 24, 0, 0) == 0);
+	CHECK(match(set, "a", "10.1.2.0", 24) == 0);
+	CHECK(match(set, "a", "10.2.0.0", 16) == 1);
+	CHECK(match(set, "a", "10.0.0.0", 8) == 1);
+
+	/* a longer prefix before a shorter one */
+	CHECK(add(set, "b", 1, "10.1.2.0", 24, 0, 0) == 0);
+	CHECK(add(set, "b", 0, "10.0.0.0", 8, 0, 32) == 0);
+	CHECK(match(set, "b", "10.1.2.0", 24) == 0);
+	CHECK(match(set, "b", "10.1.3.0", 24) == 1);
+	CHECK(match(set, "b", "10.1.2.0", 25) == 1);
+
+	/* entries of the same prefix */
+	CHECK(add(set, "c", 0, "10.0.0.0", 8, 24, 24) == 0);
+	CHECK(add(set, "c", 1, "10.0.0.0", 8, 0, 32) == 0);
+	CHECK(add(set, "c", 0, "10.1.0.0", 16, 0, 0) == 0);
+	CHECK(match(set, "c", "10.1.1.0", 24) == 0);
+	CHECK(match(set, "c", "10.1.0.0", 16) == 1);
+	CHECK(match(set, "c", "10.1.1.1", 32) == 1);
+
+	mpls_policy_free(set);
+}
+
+
+static void testRange()
+{
+	policySet_t *set = mpls_policy_create();
+
+	CHECK(add(set, "r", 1, "10.0.0.0", 8, 16, 24) == 0);
+	CHECK(match(set, "r", "10.0.0.0", 8) == POLICY_NONE);
+	CHECK(match(set, "r", "10.1.0.0", 16) == 0);
+	CHECK(match(set, "r", "10.1.1.0", 24) == 0);
+	CHECK(match(set, "r", "10.1.1.0", 25) == POLICY_NONE);
+	CHECK(match(set, "r", "11.1.0.0", 16) == POLICY_NONE);
+
+	/* ge alone goes up to 32, le alone starts at the prefix length */
+	CHECK(add(set, "ge", 1, "10.0.0.0", 8, 24, 0) == 0);
+	CHECK(match(set, "ge", "10.1.1.1", 32) == 0);
+	CHECK(match(set, "ge", "10.1.0.0", 23) == POLICY_NONE);
+	CHECK(add(set, "le", 1, "10.0.0.0", 8, 0, 16) == 0);
+	CHECK(match(set, "le", "10.0.0.0", 8) == 0);
+	CHECK(match(set, "le", "10.1.0.0", 16) == 0);
+	CHECK(match(set, "le", "10.1.0.0", 17) == POLICY_NONE);
+
+	/* without a range only the prefix itself */
+	CHECK(add(set, "x", 1, "10.1.0.0", 16, 0, 0) == 0);
+	CHECK(match(set, "x", "10.1.0.0", 16) == 0);
+	CHECK(match(set, "x", "10.1.1.0", 24) == POLICY_NONE);
+
+	CHECK(add(set, "bad", 1, "10.0.0.0", 8, 4, 0) == -1);
+	CHECK(add(set, "bad", 1, "10.0.0.0", 8, 24, 16) == -1);
+	CHECK(add(set, "bad", 1, "10.0.0.0", 33, 0, 0) == -1);
+
+	mpls_policy_free(set);
+}
+
+
+/* /0 alone is the default route, with le 32 it is every prefix */
+static void testDefault()
+{
+	policySet_t *set = mpls_policy_create();
+
+	CHECK(add(set, "d", 1, "0.0.0.0", 0, 0, 0) == 0);
+	CHECK(match(set, "d", "0.0.0.0", 0) == 0);
+	CHECK(match(set, "d", "10.0.0.0", 8) == POLICY_NONE);
+
+	CHECK(add(set, "any", 0, "192.168.0.0", 16, 0, 32) == 0);
+	CHECK(add(set, "any", 1, "0.0.0.0", 0, 0, 32) == 0);
+	CHECK(match(set, "any", "0.0.0.0", 0) == 1);
+	CHECK(match(set, "any", "10.0.0.0", 8) == 1);
+	CHECK(match(set, "any", "10.1.1.1", 32) == 1);
+	CHECK(match(set, "any", "192.168.1.0", 24) == 0);
+
+	mpls_policy_free(set);
+}
+
+
+/* a prefix no entry matches is denied, a type without a filter permits */
+static void testImplicitDeny()
+{
+	policySet_t *set = mpls_policy_create();
+	struct in_addr any = { INADDR_ANY };
+
+	CHECK(add(set, "l", 1, "10.0.0.0", 8, 0, 32) == 0);
+	CHECK(add(set, "l", 0, "10.1.0.0", 16, 0, 32) == 0);
+	CHECK(mpls_policy_add_filter(set, POLICY_EXPORT, any, "l") == 0);
+	CHECK(mpls_policy_install(set) == 1);
+
+	CHECK(check(POLICY_EXPORT, "10.1.0.0", 16, NULL) == MPLS_BOOL_TRUE);
+	CHECK(check(POLICY_EXPORT, "192.168.0.0", 16, NULL) == MPLS_BOOL_FALSE);
+	CHECK(check(POLICY_EXPORT, "0.0.0.0", 0, NULL) == MPLS_BOOL_FALSE);
+	CHECK(check(POLICY_IMPORT, "192.168.0.0", 16, NULL) == MPLS_BOOL_TRUE);
+
+	mpls_policy_install(NULL);
+	CHECK(check(POLICY_EXPORT, "192.168.0.0", 16, NULL) == MPLS_BOOL_TRUE);
+}
+
+
+/* the filter for a neighbor overrides the one for all peers */
+static void testNeighbor()
+{
+	policySet_t *set = mpls_policy_create();
+	struct in_addr any = { INADDR_ANY }, neighbor;
+
+	inet_pton(AF_INET, "1.1.1.1", &neighbor);
+	CHECK(add(set, "all", 1, "10.0.0.0", 8, 0, 32) == 0);
+	CHECK(add(set, "peer", 0, "10.0.0.0", 8, 0, 32) == 0);
+	CHECK(add(set, "peer", 1, "0.0.0.0", 0, 0, 32) == 0);
+	CHECK(mpls_policy_add_filter(set, POLICY_EXPORT, neighbor, "peer") == 0);
+	CHECK(mpls_policy_add_filter(set, POLICY_EXPORT, any, "all") == 0);
+	CHECK(mpls_policy_install(set) == 1);
+
+	CHECK(check(POLICY_EXPORT, "10.1.0.0", 16, "1.1.1.1") == MPLS_BOOL_FALSE);
+	CHECK(check(POLICY_EXPORT, "192.168.0.0", 16, "1.1.1.1") == MPLS_BOOL_TRUE);
+	CHECK(check(POLICY_EXPORT, "10.1.0.0", 16, "2.2.2.2") == MPLS_BOOL_TRUE);
+	CHECK(check(POLICY_EXPORT, "192.168.0.0", 16, "2.2.2.2") == MPLS_BOOL_FALSE);
+	CHECK(check(POLICY_EXPORT, "10.1.0.0", 16, NULL) == MPLS_BOOL_TRUE);
+
+	/* a later filter for the same neighbor replaces the earlier one */
+	set = mpls_policy_create();
+	CHECK(add(set, "all", 1, "10.0.0.0", 8, 0, 32) == 0);
+	CHECK(add(set, "peer", 0, "10.0.0.0", 8, 0, 32) == 0);
+	CHECK(mpls_policy_add_filter(set, POLICY_EXPORT, neighbor, "peer") == 0);
+	CHECK(mpls_policy_add_filter(set, POLICY_EXPORT, neighbor, "all") == 0);
+	CHECK(set->filterCount == 1);
+	CHECK(mpls_policy_install(set) == 1);
+	CHECK(check(POLICY_EXPORT, "10.1.0.0", 16, "1.1.1.1") == MPLS_BOOL_TRUE);
+
+	mpls_policy_install(NULL);
+}
+
+
+int main(int argc, char **argv)
+{
+	testOrder();
+	testRange();
+	testDefault();
+	testImplicitDeny();
+	testNeighbor();
+
+	return testResult();
+}
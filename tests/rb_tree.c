@@ -0,0 +1,113 @@
+#include "../ldpd.h"
+
+
+/*
+ * The RB tree mpls_tree_impl.c was before the radix tree, with mpls_tree
+ * renamed to rb_tree so tree_bench can have both.  Only what the bench
+ * uses is kept.
+ */
+
+struct rb_tree_node {
+	RB_ENTRY(rb_tree_node)	node;
+	uint32_t				key;
+	int						length;
+	void					*info;
+};
+
+
+static int rb_tree_node_compare(struct rb_tree_node *a, struct rb_tree_node *b)
+{
+	if(ntohl(a->key) < ntohl(b->key))
+		return (-1);
+	if(ntohl(a->key) > ntohl(b->key))
+		return (1);
+	if(a->length < b->length)
+		return (-1);
+	if(a->length > b->length)
+		return (1);
+	return (0);
+}
+
+
+RB_HEAD(rb_tree, rb_tree_node);
+RB_PROTOTYPE(rb_tree, rb_tree_node, node, rb_tree_node_compare)
+RB_GENERATE(rb_tree, rb_tree_node, node, rb_tree_node_compare)
+
+
+struct rb_tree *rb_tree_create(int depth)
+{
+	struct rb_tree *tree;
+
+	tree = mpls_malloc(sizeof(struct rb_tree));
+	if(tree)
+		RB_INIT(tree);
+
+	return tree;
+}
+
+
+mpls_return_enum rb_tree_insert(struct rb_tree *tree, uint32_t key, int length, void *info)
+{
+	struct rb_tree_node *node;
+
+	node = mpls_malloc(sizeof(struct rb_tree_node));
+	node->key = key;
+	node->length = length;
+	node->info = info;
+	if(RB_INSERT(rb_tree, tree, node) != NULL)
+		return MPLS_FAILURE;
+
+	return MPLS_SUCCESS;
+}
+
+
+static struct rb_tree_node *rb_tree_find(struct rb_tree *tree, uint32_t key, int length)
+{
+	struct rb_tree_node query;
+
+	query.key = key;
+	query.length = length;
+	return RB_FIND(rb_tree, tree, &query);
+}
+
+
+mpls_return_enum rb_tree_remove(struct rb_tree *tree, uint32_t key, int length, void **info)
+{
+	struct rb_tree_node *node;
+
+	node = rb_tree_find(tree, key, length);
+	if(!node)
+		return MPLS_FAILURE;
+	*info = node->info;
+	RB_REMOVE(rb_tree, tree, node);
+	mpls_free(node);
+
+	return MPLS_SUCCESS;
+}
+
+
+mpls_return_enum rb_tree_get(struct rb_tree *tree, uint32_t key, int length, void **info)
+{
+	struct rb_tree_node *node;
+
+	node = rb_tree_find(tree, key, length);
+	if(!node)
+		return MPLS_FAILURE;
+
+	*info = node->info;
+
+	return MPLS_SUCCESS;
+}
+
+
+void rb_tree_delete(struct rb_tree *tree)
+{
+	struct rb_tree_node *node, *next;
+
+	for(node = RB_MIN(rb_tree, tree); node != NULL; node = next) {
+		next = RB_NEXT(rb_tree, tree, node);
+		RB_REMOVE(rb_tree, tree, node);
+		mpls_free(node);
+	}
+	mpls_free(tree);
+}
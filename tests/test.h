@@ -0,0 +1,40 @@
+#ifndef _TEST_H_
+#define _TEST_H_
+
+/* shared by the tests and benchmarks, each of them is a single file */
+
+#include <stdio.h>
+#include <time.h>
+
+static int failed;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		printf("%s:%d: %s failed\n", __func__, __LINE__, #cond); \
+		failed++; \
+	} \
+} while(0)
+
+
+static double benchClock()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int testResult()
+{
+	if(failed) {
+		printf("%d checks failed\n", failed);
+		return 1;
+	}
+	printf("ok\n");
+
+	return 0;
+}
+
+#endif
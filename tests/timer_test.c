@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+/*
+ * Stand-in for ../ldpd.h, mpls_timer_impl.c is built with libevent and the
+ * clock replaced, so a test decides when time moves and when the wheel's
+ * event fires.
+ */
+#define _LDPD_H_
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/queue.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mpls_struct.h"
+#include "mpls_timer_impl.h"
+
+
+struct event {
+	void		(*handler)(int fd, short event, void *arg);
+	uint64_t	at;		/* ms the event fires at */
+};
+
+extern uint64_t testNow;	/* ms */
+
+#define evtimer_set(ev, cb, arg)	((ev)->handler = (cb))
+#define evtimer_add(ev, tv)			((ev)->at = testNow + (tv)->tv_sec * 1000 + (tv)->tv_usec / 1000, 0)
+#define evtimer_del(ev)				((void)(ev))
+
+#define clock_gettime(id, ts)		((ts)->tv_sec = testNow / 1000, (ts)->tv_nsec = testNow % 1000 * 1000000)
+
+#define mpls_malloc(size)			malloc(size)
+#define mpls_free(mem)				free(mem)
+#define mpls_mm_name(size, name)
+#define ldp_cfg_flush(handle)
+#define mpls_flush()
+
+#include "../freebsd/mpls_timer_impl.c"
+
+
+#define TEST_START		1000000		/* ms, a tick boundary */
+#define BENCH_TIMERS	100000
+
+uint64_t testNow = TEST_START;
+
+struct testTimer {
+	mpls_timer_handle	timer;
+	int					fired;
+	uint64_t			last;		/* ms it fired at */
+	int					restart;	/* start again from the handler */
+};
+
+
+static void testHandler(mpls_timer_handle timer, void *extra, mpls_cfg_handle cfg)
+{
+	struct testTimer *t = extra;
+
+	t->fired++;
+	t->last = testNow;
+	if(t->restart)
+		mpls_timer_start(0, timer, MPLS_TIMER_ONESHOT);
+}
+
+
+/* lets the clock run until ms, firing the wheel whenever it is due */
+static void testRun(uint64_t ms)
+{
+	while(wheel.armed && wheel.ev.at <= ms) {
+		if(wheel.ev.at > testNow)
+			testNow = wheel.ev.at;
+		wheel.armed = 0;
+		wheel.ev.handler(-1, 0, NULL);
+	}
+	if(ms > testNow)
+		testNow = ms;
+}
+
+
+static void testCreate(struct testTimer *t, mpls_time_unit_enum unit, int duration)
+{
+	memset(t, 0, sizeof(*t));
+	t->timer = mpls_timer_create(0, unit, duration, t, 0, testHandler);
+}
+
+
+/* setupTimeval used to test mult instead of unit, minutes and hours ran on garbage */
+static void testUnits()
+{
+	static const struct {
+		mpls_time_unit_enum	unit;
+		int					duration;
+		uint64_t			ms;
+	} units[] = {
+		{ MPLS_UNIT_MICRO,	50000,	50 },
+		{ MPLS_UNIT_MICRO,	2500000,	2500 },
+		{ MPLS_UNIT_SEC,	3,		3000 },
+		{ MPLS_UNIT_MIN,	2,		120000 },
+		{ MPLS_UNIT_HOUR,	1,		3600000 },
+	};
+	struct testTimer t;
+	uint64_t start;
+	int i;
+
+	for(i = 0; i < sizeof(units) / sizeof(units[0]); i++) {
+		testCreate(&t, units[i].unit, units[i].duration);
+		start = testNow;
+		mpls_timer_start(0, t.timer, MPLS_TIMER_ONESHOT);
+		testRun(start + units[i].ms - MPLS_TIMER_TICK);
+		CHECK(t.fired == 0);
+		testRun(start + units[i].ms * 2);
+		CHECK(t.fired == 1);
+		CHECK(t.last == start + units[i].ms);
+		mpls_timer_delete(0, t.timer);
+	}
+	CHECK(wheel.count == 0);
+}
+
+
+static void testStop()
+{
+	struct testTimer t;
+
+	testCreate(&t, MPLS_UNIT_SEC, 5);
+	mpls_timer_start(0, t.timer, MPLS_TIMER_ONESHOT);
+	testRun(testNow + 1000);
+	mpls_timer_stop(0, t.timer);
+	CHECK(wheel.count == 0);
+	testRun(testNow + 10000);
+	CHECK(t.fired == 0);
+	mpls_timer_delete(0, t.timer);
+}
+
+
+/* a running timer restarts with the new duration from now */
+static void testModify()
+{
+	struct testTimer t;
+	uint64_t start;
+
+	testCreate(&t, MPLS_UNIT_SEC, 10);
+	mpls_timer_start(0, t.timer, MPLS_TIMER_ONESHOT);
+	testRun(testNow + 2000);
+	start = testNow;
+	mpls_timer_modify(0, t.timer, 1);
+	testRun(start + 20000);
+	CHECK(t.fired == 1);
+	CHECK(t.last == start + 1000);
+	mpls_timer_delete(0, t.timer);
+}
+
+
+static void testReoccurring()
+{
+	struct testTimer t;
+
+	testCreate(&t, MPLS_UNIT_SEC, 1);
+	mpls_timer_start(0, t.timer, MPLS_TIMER_REOCCURRING);
+	testRun(testNow + 10500);
+	CHECK(t.fired == 10);
+	mpls_timer_delete(0, t.timer);
+	CHECK(wheel.count == 0);
+}
+
+
+static void testJitter()
+{
+	struct testTimer t[100];
+	uint64_t start;
+	int i, spread = 0;
+
+	start = testNow;
+	for(i = 0; i < 100; i++) {
+		testCreate(&t[i], MPLS_UNIT_SEC, 4);
+		mpls_timer_jitter(0, t[i].timer, 25);
+		mpls_timer_start(0, t[i].timer, MPLS_TIMER_ONESHOT);
+	}
+	testRun(start + 5000);
+	for(i = 0; i < 100; i++) {
+		CHECK(t[i].fired == 1);
+		CHECK(t[i].last >= start + 3000 && t[i].last <= start + 4000);
+		spread |= t[i].last != t[0].last;
+		mpls_timer_delete(0, t[i].timer);
+	}
+	CHECK(spread);
+}
+
+
+/* duration 0 runs on the next pass of the event loop, without a tick */
+static void testZero()
+{
+	struct testTimer t;
+	uint64_t start;
+
+	start = testNow;
+	testCreate(&t, MPLS_UNIT_MICRO, 0);
+	t.restart = 1;
+	mpls_timer_start(0, t.timer, MPLS_TIMER_ONESHOT);
+	CHECK(wheel.armed && wheel.ev.at == start);
+
+	wheel.armed = 0;
+	wheel.ev.handler(-1, 0, NULL);
+	CHECK(t.fired == 1);
+	CHECK(wheel.armed && wheel.ev.at == start);
+
+	wheel.armed = 0;
+	wheel.ev.handler(-1, 0, NULL);
+	CHECK(t.fired == 2);
+	CHECK(testNow == start);
+
+	mpls_timer_delete(0, t.timer);
+	CHECK(wheel.count == 0);
+}
+
+
+/* the handler may delete its own timer */
+static void delHandler(mpls_timer_handle timer, void *extra, mpls_cfg_handle cfg)
+{
+	(*(int *)extra)++;
+	mpls_timer_delete(0, timer);
+}
+
+static void testDelete()
+{
+	mpls_timer_handle timer;
+	int fired = 0;
+
+	timer = mpls_timer_create(0, MPLS_UNIT_SEC, 1, &fired, 0, delHandler);
+	mpls_timer_start(0, timer, MPLS_TIMER_REOCCURRING);
+	testRun(testNow + 5000);
+	CHECK(fired == 1);
+	CHECK(wheel.count == 0);
+}
+
+
+/* start, restart, stop and run BENCH_TIMERS timers spread over an hour */
+static void bench()
+{
+	static struct testTimer t[BENCH_TIMERS];
+	static int duration[BENCH_TIMERS];
+	uint64_t start;
+	double begin;
+	int i, fired = 0;
+
+	for(i = 0; i < BENCH_TIMERS; i++) {
+		testCreate(&t[i], MPLS_UNIT_SEC, 1 + arc4random_uniform(3600));
+		duration[i] = 1 + arc4random_uniform(3600);
+	}
+
+	start = testNow;
+	begin = benchClock();
+	for(i = 0; i < BENCH_TIMERS; i++)
+		mpls_timer_start(0, t[i].timer, MPLS_TIMER_ONESHOT);
+	printf("start   %8.1f ns/timer\n", (benchClock() - begin) * 1e9 / BENCH_TIMERS);
+
+	begin = benchClock();
+	for(i = 0; i < BENCH_TIMERS; i++)
+		mpls_timer_modify(0, t[i].timer, duration[i]);
+	printf("modify  %8.1f ns/timer\n", (benchClock() - begin) * 1e9 / BENCH_TIMERS);
+
+	begin = benchClock();
+	for(i = 0; i < BENCH_TIMERS; i += 2)
+		mpls_timer_stop(0, t[i].timer);
+	printf("stop    %8.1f ns/timer\n", (benchClock() - begin) * 1e9 / (BENCH_TIMERS / 2));
+
+	begin = benchClock();
+	testRun(start + 3601000);
+	printf("expire  %8.1f ns/timer\n", (benchClock() - begin) * 1e9 / (BENCH_TIMERS / 2));
+
+	for(i = 0; i < BENCH_TIMERS; i++) {
+		fired += t[i].fired;
+		mpls_timer_delete(0, t[i].timer);
+	}
+	CHECK(fired == BENCH_TIMERS / 2);
+	CHECK(wheel.count == 0);
+}
+
+
+int main(int argc, char **argv)
+{
+	mpls_timer_open(NULL);
+
+	if(argc > 1 && !strcmp(argv[1], "-b"))
+		bench();
+	else {
+		testUnits();
+		testStop();
+		testModify();
+		testReoccurring();
+		testJitter();
+		testZero();
+		testDelete();
+	}
+
+	return testResult();
+}
@@ -0,0 +1,200 @@
+#include "../ldpd.h"
+#include "test.h"
+
+
+/*
+ * The radix tree of mpls_tree_impl.c against the RB tree it replaced
+ * (rb_tree.c), both filled with the same mix of /24 and /32 prefixes the
+ * FEC and address trees hold, in random order.
+ */
+
+#define BENCH_PREFIXES	500000
+#define TEST_PREFIXES	20000
+
+struct rb_tree *rb_tree_create(int depth);
+mpls_return_enum rb_tree_insert(struct rb_tree *tree, uint32_t key, int length, void *info);
+mpls_return_enum rb_tree_remove(struct rb_tree *tree, uint32_t key, int length, void **info);
+mpls_return_enum rb_tree_get(struct rb_tree *tree, uint32_t key, int length, void **info);
+void rb_tree_delete(struct rb_tree *tree);
+
+/* not in mpls_tree_impl.h, ldp-portable has no use for them */
+mpls_return_enum mpls_tree_getfirst(mpls_tree_handle tree, uint32_t *key, int *length, void **info);
+mpls_return_enum mpls_tree_getnext(mpls_tree_handle tree, uint32_t *key, int *length, void **info);
+
+static uint32_t keys[BENCH_PREFIXES];
+static int lengths[BENCH_PREFIXES];
+static uint32_t misses[BENCH_PREFIXES];
+
+
+void *mpls_malloc(mpls_size_type size)
+{
+	return malloc(size);
+}
+
+void mpls_free(void *mem)
+{
+	free(mem);
+}
+
+
+static uint32_t benchRandom()
+{
+	static uint32_t seed = 1;
+
+	/* xorshift, the low bits of an LCG would end up on top after ntohl */
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+
+/* a quarter of them host routes, the rest /24, none of them twice */
+static int makePrefixes(int count)
+{
+	mpls_tree_handle seen;
+	void *info;
+	int i, n;
+
+	seen = mpls_tree_create(32);
+	for(i = n = 0; i < count; i++) {
+		lengths[n] = (i & 3) ? 24 : 32;
+		keys[n] = benchRandom() & (lengths[n] == 24 ? 0xFFFFFF00 : 0xFFFFFFFF);
+		if(mpls_tree_insert(seen, keys[n], lengths[n], NULL) == MPLS_SUCCESS)
+			n++;
+	}
+	for(i = 0; i < n; i++) {
+		do
+			misses[i] = benchRandom() | 1;
+		while(mpls_tree_get(seen, misses[i], 32, &info) == MPLS_SUCCESS);
+	}
+	mpls_tree_delete(seen);
+
+	return n;
+}
+
+
+/* both trees hold the same prefixes and give back the same info */
+static void testSame()
+{
+	struct rb_tree *rb;
+	mpls_tree_handle radix;
+	uint32_t key;
+	int i, n, length, count;
+	void *a, *b;
+
+	n = makePrefixes(TEST_PREFIXES);
+	rb = rb_tree_create(32);
+	radix = mpls_tree_create(32);
+	for(i = 0; i < n; i++) {
+		CHECK(rb_tree_insert(rb, keys[i], lengths[i], &keys[i]) == MPLS_SUCCESS);
+		CHECK(mpls_tree_insert(radix, keys[i], lengths[i], &keys[i]) == MPLS_SUCCESS);
+	}
+	CHECK(mpls_tree_insert(radix, keys[0], lengths[0], NULL) == MPLS_FAILURE);
+
+	for(i = 0; i < n; i++) {
+		a = b = NULL;
+		CHECK(rb_tree_get(rb, keys[i], lengths[i], &a) == MPLS_SUCCESS);
+		CHECK(mpls_tree_get(radix, keys[i], lengths[i], &b) == MPLS_SUCCESS);
+		CHECK(a == &keys[i] && b == a);
+		CHECK(rb_tree_get(rb, misses[i], 32, &a) == MPLS_FAILURE);
+		CHECK(mpls_tree_get(radix, misses[i], 32, &b) == MPLS_FAILURE);
+	}
+
+	count = 0;
+	if(mpls_tree_getfirst(radix, &key, &length, &a) == MPLS_SUCCESS)
+		do
+			count++;
+		while(mpls_tree_getnext(radix, &key, &length, &a) == MPLS_SUCCESS);
+	CHECK(count == n);
+
+	/* every other one goes, the rest stay */
+	for(i = 0; i < n; i += 2) {
+		CHECK(rb_tree_remove(rb, keys[i], lengths[i], &a) == MPLS_SUCCESS);
+		CHECK(mpls_tree_remove(radix, keys[i], lengths[i], &b) == MPLS_SUCCESS);
+		CHECK(a == &keys[i] && b == a);
+	}
+	for(i = 0; i < n; i++) {
+		CHECK((rb_tree_get(rb, keys[i], lengths[i], &a) == MPLS_SUCCESS) == (i & 1));
+		CHECK((mpls_tree_get(radix, keys[i], lengths[i], &b) == MPLS_SUCCESS) == (i & 1));
+	}
+
+	rb_tree_delete(rb);
+	mpls_tree_delete(radix);
+}
+
+
+/* ns per prefix to insert, get, miss and remove count prefixes, repeated up to BENCH_PREFIXES */
+static void bench(int count)
+{
+	struct rb_tree *rb;
+	mpls_tree_handle radix;
+	double t[2][4], begin;
+	int i, n, r, rounds, found = 0;
+	void *info;
+
+	n = makePrefixes(count);
+	rounds = BENCH_PREFIXES / count;
+	memset(t, 0, sizeof(t));
+
+	for(r = 0; r < rounds; r++) {
+		rb = rb_tree_create(32);
+		begin = benchClock();
+		for(i = 0; i < n; i++)
+			rb_tree_insert(rb, keys[i], lengths[i], &keys[i]);
+		t[0][0] += benchClock() - begin;
+		begin = benchClock();
+		for(i = 0; i < n; i++)
+			found += rb_tree_get(rb, keys[i], lengths[i], &info) == MPLS_SUCCESS;
+		t[0][1] += benchClock() - begin;
+		begin = benchClock();
+		for(i = 0; i < n; i++)
+			found += rb_tree_get(rb, misses[i], 32, &info) == MPLS_SUCCESS;
+		t[0][2] += benchClock() - begin;
+		begin = benchClock();
+		for(i = 0; i < n; i++)
+			rb_tree_remove(rb, keys[i], lengths[i], &info);
+		t[0][3] += benchClock() - begin;
+		rb_tree_delete(rb);
+
+		radix = mpls_tree_create(32);
+		begin = benchClock();
+		for(i = 0; i < n; i++)
+			mpls_tree_insert(radix, keys[i], lengths[i], &keys[i]);
+		t[1][0] += benchClock() - begin;
+		begin = benchClock();
+		for(i = 0; i < n; i++)
+			found += mpls_tree_get(radix, keys[i], lengths[i], &info) == MPLS_SUCCESS;
+		t[1][1] += benchClock() - begin;
+		begin = benchClock();
+		for(i = 0; i < n; i++)
+			found += mpls_tree_get(radix, misses[i], 32, &info) == MPLS_SUCCESS;
+		t[1][2] += benchClock() - begin;
+		begin = benchClock();
+		for(i = 0; i < n; i++)
+			mpls_tree_remove(radix, keys[i], lengths[i], &info);
+		t[1][3] += benchClock() - begin;
+		mpls_tree_delete(radix);
+	}
+
+	CHECK(found == 2 * n * rounds);
+
+	for(i = 0; i < 2; i++)
+		printf("%6d prefixes, %-8s insert %6.1f  get %6.1f  miss %6.1f  remove %6.1f ns\n",
+			n, i ? "radix" : "rb tree", t[i][0] * 1e9 / n / rounds, t[i][1] * 1e9 / n / rounds,
+			t[i][2] * 1e9 / n / rounds, t[i][3] * 1e9 / n / rounds);
+}
+
+
+int main(int argc, char **argv)
+{
+	testSame();
+
+	if(argc > 1 && !strcmp(argv[1], "-b")) {
+		bench(1000);
+		bench(50000);
+		bench(BENCH_PREFIXES);
+	}
+
+	return testResult();
+}